@@ -0,0 +1,88 @@
+/*
+	DerivedQuantity
+
+	Hydraulic quantities derived from an sww file's stage and momentum.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef DERIVEDQUANTITY_H_
+#define DERIVEDQUANTITY_H_
+
+#include <stddef.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Per-vertex kernels for the quantities the water surface can be coloured by.
+ *
+ * Vertices shallower than a minimum depth are dry and get zero, so momentum left
+ * on nearly dry vertices never shows as a huge velocity. Each kernel is a single
+ * branch-free loop over contiguous arrays, which the compiler vectorises.
+ */
+class SWWREADER_EXPORT DerivedQuantity
+{
+public:
+	enum Type
+	{
+		DQ_MOMENTUM = 0,	/**< Magnitude of momentum, m^2/s */
+		DQ_VELOCITY,	/**< Flow speed, m/s */
+		DQ_FROUDE,	/**< Froude number, speed over wave celerity */
+		DQ_HAZARD,	/**< Hazard rating, depth times speed plus half a metre a second */
+		DQ_NUM_OF
+	};
+
+	/**
+	 * Short name, as shown on the HUD.
+	 */
+	static const char * getName(Type aType);
+
+	/**
+	 * Units, empty for dimensionless quantities.
+	 */
+	static const char * getUnits(Type aType);
+
+	/**
+	 * Value at the top of the colour ramp.
+	 */
+	static float getScale(Type aType);
+
+	/**
+	 * Depth below which a vertex counts as dry, metres.
+	 */
+	static float getMinDepth();
+
+	/**
+	 * Flow speed at one vertex, as DQ_VELOCITY gives it: zero where dry.
+	 * @param aDepth water depth, stage less elevation
+	 */
+	static float speed(float aDepth, float aXMomentum, float aYMomentum);
+
+	/**
+	 * Compute a quantity at every vertex of a frame.
+	 * @param aStage stage at each vertex
+	 * @param aElevation bed elevation at each vertex
+	 * @param aXMomentum x momentum at each vertex
+	 * @param aYMomentum y momentum at each vertex
+	 * @param aOut receives aNumPoints values
+	 */
+	static void compute(Type aType, size_t aNumPoints, const float * aStage, const float * aElevation,
+						const float * aXMomentum, const float * aYMomentum, float * aOut);
+
+	/**
+	 * Compute the flow velocity at a subset of the vertices, zero where dry.
+	 * @param aCount number of vertices
+	 * @param aVertices index of each vertex into the other arrays
+	 * @param aU receives the x velocity of each listed vertex
+	 * @param aV receives the y velocity of each listed vertex
+	 */
+	static void computeVelocity(size_t aCount, const unsigned int * aVertices, const float * aStage, const float * aElevation,
+								const float * aXMomentum, const float * aYMomentum, float * aU, float * aV);
+};
+
+#endif // DERIVEDQUANTITY_H_
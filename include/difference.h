@@ -0,0 +1,236 @@
+/*
+	Difference
+
+	Per-vertex differences between two runs on the same mesh, over all their timesteps.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef DIFFERENCE_H_
+#define DIFFERENCE_H_
+
+#include <string>
+#include <vector>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class SidecarCache;
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+// frames of the second run read ahead of the first
+#define DIFFERENCE_PIPELINE_DEPTH 2
+
+/**
+ * The difference in depth and stage between two runs of one mesh, a run less a base
+ * run, reduced to the difference of greatest size reached at each vertex and when.
+ *
+ * Computed in one pass over both files in step, timestep by timestep. The run is read
+ * on a thread of its own a few frames ahead of the base, which is read on the calling
+ * thread, so decoding one file overlaps decoding the other; each pair of frames is
+ * then split across a pool of threads by vertex range. The result is kept in a
+ * SidecarCache next to the run, stamped with both files. The pass over the base can be
+ * shared with other visitors of it, see beginPass().
+ *
+ * Both runs must have the same mesh and the same output times.
+ *
+ * Usage
+ *
+ * Difference difference;
+ * if (difference.compute(base, run))
+ * {
+ *     const std::vector<float> & depth = difference.getMaximum(Difference::DIFFERENCE_DEPTH);
+ * }
+ */
+class SWWREADER_EXPORT Difference : public SWWReader::FrameVisitor
+{
+public:
+	enum Quantity
+	{
+		DIFFERENCE_DEPTH = 0,	/**< Water depth, stage less elevation */
+		DIFFERENCE_STAGE,		/**< Absolute water level */
+		DIFFERENCE_NUM_OF
+	};
+
+	/**
+	 * Constructor
+	 * @param aNumThreads threads sharing each frame's reduction, 0 for one less than the number of processors
+	 */
+	Difference(unsigned int aNumThreads = 0);
+
+	~Difference();
+
+	/**
+	 * Get the differences of a run from a base, from the sidecar cache if that is up to
+	 * date, otherwise by a pass over both files, after which the cache is written.
+	 * Safe to call from a background thread while the render thread uses the readers.
+	 * @return false if the runs don't match, either file can't be read, or cancel() was called
+	 */
+	bool compute(SWWReader * aBase, SWWReader * aRun);
+
+	/**
+	 * First half of compute(), for a caller feeding the frames of one pass over the base
+	 * to this and other visitors: answered from the cache if it can be, otherwise the
+	 * pass over the run is started, to meet the base's frames as they are visited.
+	 * @return true if the frames of a pass over the base are wanted, before endPass() is called
+	 */
+	bool beginPass(SWWReader * aBase, SWWReader * aRun);
+
+	/**
+	 * Second half of compute(), after the pass over the base: stops the pass over the
+	 * run and writes the cache.
+	 * @return false if either pass ended early, or cancel() was called
+	 */
+	bool endPass();
+
+	/**
+	 * Stop a compute() in progress, from another thread.
+	 */
+	void cancel()	{	_cancelled.exchange(1);	}
+
+	bool isValid() const	{	return _valid;	}
+
+	/**
+	 * Was the last compute() answered from the cache.
+	 */
+	bool isFromCache() const	{	return _fromCache;	}
+
+	/**
+	 * Fraction of the frames compared so far by a compute() in progress.
+	 */
+	float getProgress() const;
+
+	/**
+	 * Get the difference of greatest size at each vertex, with its sign, run less base.
+	 */
+	const std::vector<float> & getMaximum(Quantity aQuantity) const	{	return _maximum[aQuantity];	}
+
+	/**
+	 * Get the time, in seconds, at which each vertex first reached that difference.
+	 */
+	const std::vector<float> & getTimeOfMaximum(Quantity aQuantity) const	{	return _timeOfMaximum[aQuantity];	}
+
+	/**
+	 * Write the differences as CSV, one line per vertex: x, y, then the maximum depth and
+	 * stage differences, each followed by when it was reached.
+	 * @param aReader either run, for the vertex locations
+	 * @return false if the file can't be written
+	 */
+	bool write(const std::string & aFilename, SWWReader * aReader) const;
+
+	/**
+	 * Check that two runs can be compared: the same mesh, and the same output times.
+	 */
+	static bool isComparable(SWWReader * aBase, SWWReader * aRun);
+
+	/**
+	 * Subtract one frame from another, vertex by vertex, as a plain loop the compiler
+	 * vectorises.
+	 * @param aOut receives aRun less aBase, may be either of them
+	 */
+	static void subtract(const float * aRun, const float * aBase, float * aOut, size_t aCount);
+
+	/**
+	 * Water depth less than zero is dry land, taken as zero.
+	 * @param aOut receives the depth of each vertex, may be aStage
+	 */
+	static void depth(const float * aStage, const float * aElevation, float * aOut, size_t aCount);
+
+	/**
+	 * Name of the sidecar cache of the differences of a run from a base.
+	 */
+	static std::string getCacheFilename(const std::string & aBaseFilename, const std::string & aRunFilename);
+
+protected:
+
+	/**
+	 * A frame of the run, read ahead of the base.
+	 */
+	struct Slot
+	{
+		unsigned int _timestep;
+		std::vector<float> _stage;
+		std::vector<float> _elevation;
+	};
+
+	/**
+	 * Hands each frame of the run over to the base pass, from the run's reading thread.
+	 */
+	class RunVisitor : public SWWReader::FrameVisitor
+	{
+	public:
+		RunVisitor(Difference * aOwner) : _owner(aOwner) {}
+		virtual bool visit(const SWWReader::FrameData & aFrame)	{	return _owner->produce(aFrame);	}
+
+	private:
+		Difference * _owner;
+	};
+
+	class ReadJob;
+
+	/**
+	 * Copy a frame of the run into the next free slot, waiting while they are all full.
+	 * @return false once the base pass has stopped
+	 */
+	bool produce(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Compare a frame of the base with the run's frame of the same timestep.
+	 */
+	virtual bool visit(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Reduce a range of vertices of the current pair of frames.
+	 */
+	void reduce(size_t aBegin, size_t aEnd);
+
+	/**
+	 * The arrays saved in the sidecar, in their order there.
+	 */
+	std::vector< std::vector<float> * > getCacheArrays();
+
+	/**
+	 * Runs reduce() for a parallelFor.
+	 */
+	struct ReduceBody
+	{
+		ReduceBody(Difference * aDifference) : _difference(aDifference) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_difference->reduce(aBegin, aEnd);	}
+		Difference * _difference;
+	};
+
+private:
+	WorkerPool _pool;
+	WorkerPool _readPool;	/**< One thread, reads the run */
+	std::vector<float> _maximum[DIFFERENCE_NUM_OF];
+	std::vector<float> _timeOfMaximum[DIFFERENCE_NUM_OF];
+	bool _valid;
+	bool _fromCache;
+	SidecarCache * _cache;	/**< Stamped as a pass begins, NULL if its result isn't cached */
+
+	// the frames read ahead, _consumed <= _produced <= _consumed + DIFFERENCE_PIPELINE_DEPTH
+	Slot _slots[DIFFERENCE_PIPELINE_DEPTH];
+	unsigned int _produced;
+	unsigned int _consumed;
+	bool _runFinished;	/**< The run's pass has returned */
+	bool _baseStopped;	/**< The base pass has returned */
+	OpenThreads::Mutex _slotMutex;
+	OpenThreads::Condition _slotChanged;	/**< Signalled when a slot is filled or freed, or a pass ends */
+
+	const SWWReader::FrameData * _frame;	/**< Frame of the base being reduced */
+	const Slot * _runFrame;	/**< Frame of the run being reduced */
+	unsigned int _numFrames;
+	OpenThreads::Atomic _numFramesDone;
+	OpenThreads::Atomic _cancelled;
+};
+
+#endif // DIFFERENCE_H_
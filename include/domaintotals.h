@@ -0,0 +1,150 @@
+/*
+	DomainTotals
+
+	Wet area, water volume and peak depth of a whole sww file at each timestep.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef DOMAINTOTALS_H_
+#define DOMAINTOTALS_H_
+
+#include <vector>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Totals over the domain at each timestep, for checking mass conservation and the
+ * extent of flooding over a run.
+ *
+ * The depth is taken to vary linearly over each triangle, so a triangle holds its
+ * area times the mean depth of its vertices, and counts as wet in proportion to how
+ * many of its vertices are wet. Vertices shallower than the wet depth count as dry
+ * towards the wet area, but their water still counts towards the volume, so a thin
+ * film spread over much of the domain doesn't look like mass lost.
+ * Triangle areas are the reader's, computed on load.
+ * Computed in one sequential pass over the file, each frame's sums split across a
+ * pool of threads by triangle range. Totals are published a frame at a time, so the
+ * leading getNumFramesDone() values can be read while the pass runs.
+ *
+ * Usage
+ *
+ * DomainTotals totals;
+ * if (totals.compute(reader))
+ * {
+ *     const std::vector<float> & volume = totals.getTotal(DomainTotals::TOTAL_VOLUME);
+ * }
+ */
+class SWWREADER_EXPORT DomainTotals : public SWWReader::FrameVisitor
+{
+public:
+	enum Quantity
+	{
+		TOTAL_WET_AREA = 0,	/**< Area of the wet part of the mesh */
+		TOTAL_VOLUME,		/**< Depth integrated over the mesh */
+		TOTAL_MAX_DEPTH,	/**< Deepest vertex */
+		TOTAL_NUM_OF
+	};
+
+	/**
+	 * Constructor
+	 * @param aWetDepth depth above which a vertex is wet, metres; it only affects the wet area
+	 * @param aNumThreads threads sharing each frame's sums, 0 for one less than the number of processors
+	 * @param aLowPriority run at low priority and give way to the render thread's frame loads
+	 */
+	DomainTotals(float aWetDepth = 0.001f, unsigned int aNumThreads = 0, bool aLowPriority = false);
+
+	/**
+	 * Total a file by a pass over it.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @return false if the file can't be read, or cancel() was called
+	 */
+	bool compute(SWWReader * aReader);
+
+	/**
+	 * Stop a compute() in progress, from another thread.
+	 */
+	void cancel()	{	_cancelled.exchange(1);	}
+
+	bool isValid() const	{	return _valid;	}
+
+	/**
+	 * Fraction of the frames totalled so far by a compute() in progress.
+	 */
+	float getProgress() const;
+
+	/**
+	 * Number of leading timesteps whose totals are final.
+	 */
+	unsigned int getNumFramesDone() const	{	return _numFramesDone;	}
+
+	/**
+	 * Get a total at each timestep, sized for the whole file once compute() starts.
+	 */
+	const std::vector<float> & getTotal(Quantity aQuantity) const	{	return _total[aQuantity];	}
+
+	/**
+	 * Short name, as shown on the HUD.
+	 */
+	static const char * getName(Quantity aQuantity);
+
+	/**
+	 * Units, for a file in metres.
+	 */
+	static const char * getUnits(Quantity aQuantity);
+
+protected:
+
+	/**
+	 * Total one frame.
+	 */
+	virtual bool visit(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Total a range of triangles of the current frame into its sums.
+	 */
+	void sum(size_t aBegin, size_t aEnd);
+
+	/**
+	 * Runs sum() for a parallelFor.
+	 */
+	struct SumBody
+	{
+		SumBody(DomainTotals * aTotals) : _totals(aTotals) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_totals->sum(aBegin, aEnd);	}
+		DomainTotals * _totals;
+	};
+
+private:
+	float _wetDepth;
+	bool _lowPriority;
+	WorkerPool _pool;
+	std::vector<float> _total[TOTAL_NUM_OF];
+	bool _valid;
+
+	// the mesh, copied from the reader for the pass
+	std::vector<unsigned int> _triangles;
+	std::vector<float> _areas;
+
+	const SWWReader::FrameData * _frame;	/**< Frame being totalled */
+	OpenThreads::Mutex _sumMutex;	/**< Guards the sums of the current frame */
+	double _wetArea;
+	double _volume;
+	float _maxDepth;
+
+	unsigned int _numFrames;
+	OpenThreads::Atomic _numFramesDone;
+	OpenThreads::Atomic _cancelled;
+};
+
+#endif // DOMAINTOTALS_H_
@@ -0,0 +1,159 @@
+/*
+	Envelope
+
+	Per-vertex maxima of an sww file over all its timesteps.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef ENVELOPE_H_
+#define ENVELOPE_H_
+
+#include <string>
+#include <vector>
+#include <OpenThreads/Atomic>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class SidecarCache;
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * The maximum depth, speed and stage reached at each vertex over a whole run, and
+ * the time each maximum was first reached.
+ *
+ * Computed in one sequential pass over the file, each frame's reduction split across
+ * a pool of threads by vertex range. The result is kept in a SidecarCache next to
+ * the sww. The pass can be shared with other visitors of the file, see beginPass().
+ *
+ * Usage
+ *
+ * Envelope envelope;
+ * if (envelope.compute(reader))
+ * {
+ *     const std::vector<float> & depth = envelope.getMaximum(Envelope::ENVELOPE_DEPTH);
+ * }
+ */
+class SWWREADER_EXPORT Envelope : public SWWReader::FrameVisitor
+{
+public:
+	enum Quantity
+	{
+		ENVELOPE_DEPTH = 0,	/**< Water depth, stage less elevation */
+		ENVELOPE_SPEED,		/**< Flow speed, as DerivedQuantity::speed() */
+		ENVELOPE_STAGE,		/**< Absolute water level */
+		ENVELOPE_NUM_OF
+	};
+
+	/**
+	 * Constructor
+	 * @param aNumThreads threads sharing each frame's reduction, 0 for one less than the number of processors
+	 */
+	Envelope(unsigned int aNumThreads = 0);
+
+	~Envelope();
+
+	/**
+	 * Get the envelope of a file, from its sidecar cache if that is up to date, otherwise
+	 * by a pass over the file, after which the cache is written.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @return false if the file can't be read, or cancel() was called
+	 */
+	bool compute(SWWReader * aReader);
+
+	/**
+	 * First half of compute(), for a caller feeding the frames of one pass to this and
+	 * other visitors, eg. with a SWWReader::FrameVisitorList: answered from the cache if
+	 * it can be, otherwise the maxima are readied for the pass.
+	 * @return true if the frames of a pass are wanted, before endPass() is called
+	 */
+	bool beginPass(SWWReader * aReader);
+
+	/**
+	 * Second half of compute(), after the pass, writing the cache.
+	 * @param aRead false if the pass failed
+	 * @return false if the pass failed, or cancel() was called
+	 */
+	bool endPass(bool aRead);
+
+	/**
+	 * Stop a compute() in progress, from another thread.
+	 */
+	void cancel()	{	_cancelled.exchange(1);	}
+
+	bool isValid() const	{	return _valid;	}
+
+	/**
+	 * Was the last compute() answered from the cache.
+	 */
+	bool isFromCache() const	{	return _fromCache;	}
+
+	/**
+	 * Fraction of the frames reduced so far by a compute() in progress.
+	 */
+	float getProgress() const;
+
+	/**
+	 * Get the maximum of a quantity at each vertex.
+	 */
+	const std::vector<float> & getMaximum(Quantity aQuantity) const	{	return _maximum[aQuantity];	}
+
+	/**
+	 * Get the time, in seconds, at which each vertex first reached its maximum.
+	 */
+	const std::vector<float> & getTimeOfMaximum(Quantity aQuantity) const	{	return _timeOfMaximum[aQuantity];	}
+
+	/**
+	 * Name of the sidecar cache of an sww file.
+	 */
+	static std::string getCacheFilename(const std::string & aFilename);
+
+protected:
+
+	/**
+	 * Reduce one frame into the maxima.
+	 */
+	virtual bool visit(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Reduce a range of vertices of the current frame.
+	 */
+	void reduce(size_t aBegin, size_t aEnd);
+
+	/**
+	 * The arrays saved in the sidecar, in their order there.
+	 */
+	std::vector< std::vector<float> * > getCacheArrays();
+
+	/**
+	 * Runs reduce() for a parallelFor.
+	 */
+	struct ReduceBody
+	{
+		ReduceBody(Envelope * aEnvelope) : _envelope(aEnvelope) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_envelope->reduce(aBegin, aEnd);	}
+		Envelope * _envelope;
+	};
+
+private:
+	WorkerPool _pool;
+	std::vector<float> _maximum[ENVELOPE_NUM_OF];
+	std::vector<float> _timeOfMaximum[ENVELOPE_NUM_OF];
+	bool _valid;
+	bool _fromCache;
+	SidecarCache * _cache;	/**< Stamped as a pass begins, NULL if its result isn't cached */
+
+	const SWWReader::FrameData * _frame;	/**< Frame being reduced */
+	unsigned int _numFrames;
+	OpenThreads::Atomic _numFramesDone;
+	OpenThreads::Atomic _cancelled;
+};
+
+#endif // ENVELOPE_H_
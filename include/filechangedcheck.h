@@ -10,12 +10,17 @@
 #ifndef FILECHANGEDCHECK_H_
 #define FILECHANGEDCHECK_H_
 
+#include <string>
+#include <time.h>
+#include <sys/stat.h>
+#include <OpenThreads/Atomic>
+#include <osg/Timer>
+
 // needed to create a .lib file under win32/Visual Studio
 #if defined(_MSC_VER)
     #define SWWREADER_EXPORT   __declspec(dllexport)
 #else
     	#define SWWREADER_EXPORT
-	#define _off_t int
 #endif
 
 /**
@@ -36,6 +41,14 @@
  * // do something
  * }
  *
+ * Each isChanged() stats the file, which is slow on network filesystems. To check every
+ * frame instead start a watcher thread with watchAsync(), after which isChanged() only
+ * tests a flag the watcher sets. The watcher is told of changes by inotify where the
+ * filesystem supports it, and otherwise stats the file at a fixed interval.
+ *
+ * FileChangedCheck checker;
+ * checker.watchAsync("myfile.txt");
+ *
  */
 class SWWREADER_EXPORT FileChangedCheck
 {
@@ -50,7 +63,12 @@ class SWWREADER_EXPORT FileChangedCheck
 		 * Constructor with filename and intialisation.
 		 * @param aFilename Filename of file to watch.
 		 */
-		FileChangedCheck(const std::string & aFilename)	{	watch(aFilename);	}
+		FileChangedCheck(const std::string & aFilename);
+
+		/**
+		 * Destructor, stops any watcher thread.
+		 */
+		~FileChangedCheck();
 
 		/**
 		 * Initialisation.
@@ -60,19 +78,85 @@ class SWWREADER_EXPORT FileChangedCheck
 		 */
 		bool watch(const std::string & aFilename);
 
+		/**
+		 * Initialisation, watching from a thread of its own.
+		 * Changes are seen a little after they happen: at once with inotify, otherwise
+		 * within the poll interval.
+		 * @param aFilename The name of the filename to watch for changes.
+		 * @param aPollMs time between stats when inotify can't be used, milliseconds
+		 * @param aAllowNotify false to always poll
+		 * @return false if file could not be watched, ie, it doesn't exist. It is
+		 *         watched anyway, so its creation is seen.
+		 */
+		bool watchAsync(const std::string & aFilename, unsigned int aPollMs = 1000, bool aAllowNotify = true);
+
+		/**
+		 * Is a watcher thread being told of changes by inotify, rather than polling.
+		 */
+		bool isNotifying() const	{	return _notifyFd >= 0;	}
+
 		/**
 		 * Has file changed.
 		 * Triggers once when a change has been detected, then returns false as usual.
 		 * Drop this in before any code that requires loading.
+		 * With a watcher thread it only tests and clears the watcher's flag, as it does
+		 * with no file watched, when only recheck() sets it.
 		 * @return true if the file has changed between calls.
 		 */
 		bool isChanged();
 
+		/**
+		 * Have the next isChanged() return true whatever the file, for a change seen
+		 * only in part, eg. a record still being written, that may be finished
+		 * without the file looking any different.
+		 */
+		void recheck()	{	_changed.exchange(1);	}
+
+		/**
+		 * As recheck(), but not before a delay has passed, so a change that may never
+		 * be finished, eg. by a run that was killed, isn't looked at again every call.
+		 * Call from the thread that calls isChanged().
+		 * @param aDelayMs milliseconds from now
+		 */
+		void recheckAfter(unsigned int aDelayMs);
+
+	private:
+		class Watcher;
+
+		// not copyable, it may own a thread
+		FileChangedCheck(const FileChangedCheck &);
+		FileChangedCheck & operator=(const FileChangedCheck &);
+
+		/**
+		 * Stat the file and compare it with the last stat.
+		 * @return true if it changed in between
+		 */
+		bool statChanged();
+
+		/**
+		 * Remember the time and length of the file as last stat'ed.
+		 */
+		void setStat(const struct stat & aStat);
+
+		/**
+		 * Stop and delete the watcher thread, if there is one.
+		 */
+		void stopWatcher();
+
 	private:
 		std::string _filename;	/**< Name of file to watch */
 		bool _exists;		/**< Does file exist */
-		time_t _modificationTime;	/**< When the file was modified. */
-		_off_t _oldLength;	/**< Old length of the file. */
+		long long _modificationTime;	/**< When the file was modified, nanoseconds where the system keeps them */
+		long long _oldLength;	/**< Old length of the file, beyond 2GB too */
+
+		Watcher * _watcher;	/**< NULL unless watching asynchronously */
+		int _notifyFd;	/**< Watcher's inotify descriptor, -1 if it polls */
+		OpenThreads::Atomic _changed;	/**< Set by the watcher or recheck(), cleared by isChanged() */
+		OpenThreads::Atomic _stopping;	/**< Tells the watcher to finish */
+
+		bool _recheckPending;	/**< Set by recheckAfter(), cleared once it is due or a change is seen */
+		osg::Timer_t _recheckAt;	/**< When recheckAfter() was called */
+		unsigned int _recheckDelayMs;
 
 };
 
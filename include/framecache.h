@@ -0,0 +1,99 @@
+/*
+	FrameCache
+
+	Recently read timesteps of an sww file.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef FRAMECACHE_H_
+#define FRAMECACHE_H_
+
+#include <list>
+#include <map>
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+#include <derivedquantity.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Least recently used cache of the quantities of whole timesteps, so stepping back
+ * and forth over recent frames doesn't go back to the file. Derived quantities are
+ * computed on first use and kept with their frame.
+ *
+ * Not thread safe, the reader uses it under its own lock.
+ */
+class SWWREADER_EXPORT FrameCache
+{
+public:
+	/**
+	 * The quantities of one timestep.
+	 */
+	class SWWREADER_EXPORT Frame : public osg::Referenced
+	{
+	public:
+		Frame(unsigned int aTimestep) : _timestep(aTimestep) {}
+
+		/**
+		 * Get a derived quantity, computing it the first time it's asked for.
+		 * @param aElevation bed elevation at each vertex
+		 * @return one value per vertex, NULL if the frame has no momentum
+		 */
+		const float * getDerived(DerivedQuantity::Type aType, const float * aElevation);
+
+		unsigned int _timestep;
+		std::vector<float> _stage;
+		std::vector<float> _xmomentum;	/**< Empty if the file has no momentum */
+		std::vector<float> _ymomentum;	/**< Empty if the file has no momentum */
+
+	protected:
+		virtual ~Frame() {}
+
+		std::vector<float> _derived[DerivedQuantity::DQ_NUM_OF];	/**< Empty until asked for */
+	};
+
+	/**
+	 * Constructor
+	 * @param aCapacity most frames held
+	 */
+	FrameCache(size_t aCapacity = 8);
+
+	/**
+	 * Get a cached frame, making it the most recently used.
+	 * @return NULL if the frame isn't cached
+	 */
+	Frame * find(unsigned int aTimestep);
+
+	/**
+	 * Add a frame, dropping the least recently used if the cache is full.
+	 */
+	void insert(Frame * aFrame);
+
+	/**
+	 * Drop every frame, eg. when the file changes.
+	 */
+	void clear();
+
+	void setCapacity(size_t aCapacity);
+	size_t getCapacity() const	{	return _capacity;	}
+	size_t size() const	{	return _frames.size();	}
+
+protected:
+	typedef std::list< osg::ref_ptr<Frame> > FrameList;
+
+	void trim();
+
+	size_t _capacity;
+	FrameList _frames;	/**< Most recently used first */
+	std::map<unsigned int, FrameList::iterator> _index;	/**< Timestep to its place in _frames */
+};
+
+#endif // FRAMECACHE_H_
@@ -0,0 +1,168 @@
+/*
+	FrameScheduler
+
+	Frames of an sww file read in the background, most urgent first.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef FRAMESCHEDULER_H_
+#define FRAMESCHEDULER_H_
+
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+
+#include <framecache.h>
+#include <workerpool.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+class SWWReader;
+
+/**
+ * A frame asked for from a FrameScheduler, the handle to it while it is read and the
+ * frame once it has been. The frame is shared with the reader's cache and is not to be
+ * changed; derived quantities are computed from its arrays rather than asked of it.
+ */
+class SWWREADER_EXPORT FrameRequest : public osg::Referenced
+{
+public:
+	FrameRequest(unsigned int aTimestep, int aPriority, unsigned int aOrder);
+
+	unsigned int getTimestep() const	{	return _timestep;	}
+
+	/**
+	 * Drop the request if it hasn't started being read, eg. once the user has stepped past
+	 * it. A read in progress runs on.
+	 */
+	void cancel();
+
+	bool isCancelled() const	{	return _cancelled != 0;	}
+
+	/**
+	 * Has the frame been read, failed to be, or been cancelled.
+	 */
+	bool isDone() const	{	return _done != 0;	}
+
+	/**
+	 * Block until done.
+	 * @return the frame, NULL if it couldn't be read or the request was cancelled
+	 */
+	const FrameCache::Frame * wait();
+
+	/**
+	 * Get the frame without blocking.
+	 * @return NULL until done
+	 */
+	const FrameCache::Frame * getFrame() const	{	return isDone() ? _frame.get() : NULL;	}
+
+protected:
+	friend class FrameScheduler;
+
+	virtual ~FrameRequest() {}
+
+	/**
+	 * Mark the request as being read.
+	 * @return false if it was cancelled first
+	 */
+	bool start();
+
+	/**
+	 * Hand over the frame read, waking those waiting on it.
+	 */
+	void finish(FrameCache::Frame * aFrame);
+
+	/**
+	 * Does this go before another, by priority then by the order asked.
+	 */
+	bool isBefore(const FrameRequest & aOther) const;
+
+private:
+	unsigned int _timestep;
+	int _priority;	/**< Raised when the frame is asked for again */
+	unsigned int _order;
+	bool _started;
+	osg::ref_ptr<FrameCache::Frame> _frame;
+	OpenThreads::Atomic _done;
+	OpenThreads::Atomic _cancelled;
+	OpenThreads::Mutex _mutex;
+	OpenThreads::Condition _finished;	/**< Signalled once done */
+};
+
+
+/**
+ * Reads the frames asked of a reader in the background, so callers needing frames ahead
+ * of time (playback, scrubbing, export and analytics) share one queue instead of each
+ * blocking the render loop on the file.
+ *
+ * Requests go highest priority first, those of equal priority in the order asked. Asking
+ * again for a frame still waiting gives the same request, at the higher of the two
+ * priorities. Frames read go into the reader's FrameCache too, so a later
+ * loadStageVertexArray() of the same timestep finds them there.
+ *
+ * Usage, from the reader,
+ *
+ * osg::ref_ptr<FrameRequest> request = reader->requestFrame(t, priority);
+ * ...
+ * const FrameCache::Frame * frame = request->wait();
+ */
+class SWWREADER_EXPORT FrameScheduler
+{
+public:
+	/**
+	 * Constructor, starts the worker threads.
+	 * @param aReader reader frames are read with, through SWWReader::loadFrame()
+	 * @param aNumThreads reads at once; reads of one file are serialised on its lock, so
+	 *        more help only when frames are decoded from a cache
+	 */
+	FrameScheduler(SWWReader * aReader, unsigned int aNumThreads = 1);
+
+	/**
+	 * Destructor, cancels every request waiting and waits for those being read.
+	 */
+	~FrameScheduler();
+
+	/**
+	 * Ask for a frame to be read.
+	 * @param aPriority higher first
+	 */
+	osg::ref_ptr<FrameRequest> request(unsigned int aTimestep, int aPriority);
+
+	/**
+	 * Cancel every request waiting.
+	 */
+	void cancelAll();
+
+	/**
+	 * Get the number of requests waiting, not counting those being read.
+	 */
+	unsigned int getNumWaiting();
+
+protected:
+
+	class ReadJob;
+
+	/**
+	 * Take the most urgent request waiting and mark it as being read.
+	 * @return NULL if none is left
+	 */
+	osg::ref_ptr<FrameRequest> takeNext();
+
+private:
+	SWWReader * _reader;
+	OpenThreads::Mutex _mutex;
+	std::vector< osg::ref_ptr<FrameRequest> > _waiting;
+	unsigned int _numAsked;	/**< Orders requests of equal priority */
+	WorkerPool _pool;	/**< One job per request, each reading the most urgent waiting */
+};
+
+#endif // FRAMESCHEDULER_H_
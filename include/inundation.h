@@ -0,0 +1,171 @@
+/*
+	Inundation
+
+	When each vertex of an sww file first floods, and for how long.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef INUNDATION_H_
+#define INUNDATION_H_
+
+#include <string>
+#include <vector>
+#include <OpenThreads/Atomic>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class SidecarCache;
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * The arrival time and duration of inundation at each vertex: the first time the
+ * depth exceeds a threshold, and the total time spent above it.
+ *
+ * Depth is taken to vary linearly between timesteps, so crossings of the threshold
+ * are placed between the timesteps either side rather than snapped to one of them.
+ * Computed in one sequential pass over the file, each frame split across a pool of
+ * threads by vertex range, and kept in a SidecarCache next to the sww, per threshold.
+ * The pass can be shared with other visitors of the file, see beginPass().
+ *
+ * Usage
+ *
+ * Inundation inundation(0.01);
+ * if (inundation.compute(reader))
+ * {
+ *     inundation.write("arrival.csv", reader);
+ * }
+ */
+class SWWREADER_EXPORT Inundation : public SWWReader::FrameVisitor
+{
+public:
+	/**
+	 * Constructor
+	 * @param aThreshold depth above which a vertex is inundated, metres
+	 * @param aNumThreads threads sharing each frame, 0 for one less than the number of processors
+	 */
+	Inundation(float aThreshold = 0.01f, unsigned int aNumThreads = 0);
+
+	~Inundation();
+
+	/**
+	 * Get the maps of a file, from its sidecar cache if that is up to date, otherwise
+	 * by a pass over the file, after which the cache is written.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @return false if the file can't be read, or cancel() was called
+	 */
+	bool compute(SWWReader * aReader);
+
+	/**
+	 * First half of compute(), for a caller feeding the frames of one pass to this and
+	 * other visitors: answered from the cache if it can be, otherwise the maps are
+	 * readied for the pass.
+	 * @return true if the frames of a pass are wanted, before endPass() is called
+	 */
+	bool beginPass(SWWReader * aReader);
+
+	/**
+	 * Second half of compute(), after the pass, writing the cache.
+	 * @param aRead false if the pass failed
+	 * @return false if the pass failed, or cancel() was called
+	 */
+	bool endPass(bool aRead);
+
+	/**
+	 * Stop a compute() in progress, from another thread.
+	 */
+	void cancel()	{	_cancelled.exchange(1);	}
+
+	bool isValid() const	{	return _valid;	}
+
+	/**
+	 * Was the last compute() answered from the cache.
+	 */
+	bool isFromCache() const	{	return _fromCache;	}
+
+	/**
+	 * Fraction of the frames done so far by a compute() in progress.
+	 */
+	float getProgress() const;
+
+	float getThreshold() const	{	return _threshold;	}
+
+	/**
+	 * Get the time, in seconds, each vertex first became inundated, or getNever() if it never did.
+	 */
+	const std::vector<float> & getArrivalTime() const	{	return _arrival;	}
+
+	/**
+	 * Get the total time, in seconds, each vertex spent inundated.
+	 */
+	const std::vector<float> & getDuration() const	{	return _duration;	}
+
+	/**
+	 * Arrival time of vertices that were never inundated.
+	 */
+	static float getNever()	{	return -1.0f;	}
+
+	/**
+	 * Write the maps as CSV, one line per vertex: x, y, arrival time, duration.
+	 * @param aReader the file computed from, for the vertex locations
+	 * @return false if the file can't be written
+	 */
+	bool write(const std::string & aFilename, SWWReader * aReader) const;
+
+	/**
+	 * Name of the sidecar cache of an sww file.
+	 */
+	static std::string getCacheFilename(const std::string & aFilename);
+
+protected:
+
+	/**
+	 * Accumulate one frame into the maps.
+	 */
+	virtual bool visit(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Accumulate a range of vertices of the current frame.
+	 */
+	void accumulate(size_t aBegin, size_t aEnd);
+
+	/**
+	 * The arrays saved in the sidecar, in their order there.
+	 */
+	std::vector< std::vector<float> * > getCacheArrays();
+
+	/**
+	 * Runs accumulate() for a parallelFor.
+	 */
+	struct AccumulateBody
+	{
+		AccumulateBody(Inundation * aInundation) : _inundation(aInundation) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_inundation->accumulate(aBegin, aEnd);	}
+		Inundation * _inundation;
+	};
+
+private:
+	float _threshold;
+	WorkerPool _pool;
+	std::vector<float> _arrival;
+	std::vector<float> _duration;
+	std::vector<float> _lastDepth;	/**< Depth at the previous frame, during a pass */
+	bool _valid;
+	bool _fromCache;
+	SidecarCache * _cache;	/**< Stamped as a pass begins, NULL if its result isn't cached */
+
+	const SWWReader::FrameData * _frame;	/**< Frame being accumulated */
+	float _lastTime;	/**< Time of the previous frame */
+	unsigned int _numFrames;
+	OpenThreads::Atomic _numFramesDone;
+	OpenThreads::Atomic _cancelled;
+};
+
+#endif // INUNDATION_H_
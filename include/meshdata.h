@@ -0,0 +1,115 @@
+/*
+	MeshData
+
+	The static mesh of an sww file, shared by the readers of runs on the same mesh.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef MESHDATA_H_
+#define MESHDATA_H_
+
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/PrimitiveSet>
+
+#include <trianglegrid.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+
+typedef std::vector<unsigned int> triangle_list;
+
+/**
+ * Vertex positions and triangles of a mesh, with everything worked out from them
+ * alone: the triangles around each vertex, triangle areas, the spatial index and the
+ * index array drawn by both surfaces.
+ *
+ * Scenario runs on one mesh hold identical copies of all of it, so readers of the
+ * second and later runs check their mesh against the first and drop their own copy
+ * when it's the same, leaving each run holding only its own frames. Nothing changes
+ * once build() has run, so a shared mesh is read from any thread without locking.
+ *
+ * Usage
+ *
+ * osg::ref_ptr<MeshData> mesh = new MeshData(npoints, ntriangles);
+ * read into mesh->getX(), mesh->getY() and mesh->getTriangles()
+ * if (shared.valid() && mesh->isSameMesh(*shared)) mesh = shared; else mesh->build();
+ */
+class SWWREADER_EXPORT MeshData : public osg::Referenced
+{
+public:
+	/**
+	 * Constructor, allocates the vertex and triangle arrays for the caller to fill.
+	 * @param aNumPoints number of vertices
+	 * @param aNumTriangles number of triangles, three vertex indices each
+	 */
+	MeshData(size_t aNumPoints, size_t aNumTriangles);
+
+	size_t getNumberOfPoints() const	{	return _numPoints;	}
+	size_t getNumberOfTriangles() const	{	return _numTriangles;	}
+
+	float * getX()	{	return _x;	}
+	float * getY()	{	return _y;	}
+	unsigned int * getTriangles()	{	return _triangles;	}
+
+	/**
+	 * Work out everything else from the filled vertices and triangles.
+	 */
+	void build();
+
+	/**
+	 * Check whether another mesh has exactly the same vertices and triangles.
+	 */
+	bool isSameMesh(const MeshData & aOther) const;
+
+	/**
+	 * Get the triangles sharing each vertex.
+	 */
+	const std::vector<triangle_list> & getConnectivity() const	{	return _connectivity;	}
+
+	/**
+	 * Get the plan area of each triangle, file units squared.
+	 */
+	const std::vector<float> & getTriangleAreas() const	{	return _triangleAreas;	}
+
+	/**
+	 * Get the spatial index of the triangles, in file x,y coordinates.
+	 */
+	const TriangleGrid & getTriangleGrid() const	{	return _triangleGrid;	}
+
+	/**
+	 * Get the triangles as a primitive set, drawn by the bedslope and water surface.
+	 */
+	osg::DrawElementsUInt * getIndices()	{	return _indices.get();	}
+
+protected:
+	virtual ~MeshData();
+
+private:
+	// not copied, shared by reference
+	MeshData(const MeshData &);
+	MeshData & operator=(const MeshData &);
+
+	size_t _numPoints;
+	size_t _numTriangles;
+	float * _x;
+	float * _y;
+	unsigned int * _triangles;
+
+	// triangle connectivity, list (indexed by vertex number) of
+	// lists (indices of triangles sharing this vertex)
+	std::vector<triangle_list> _connectivity;
+
+	std::vector<float> _triangleAreas;	/**< Plan area of each triangle, file units squared */
+	TriangleGrid _triangleGrid;	/**< Spatial index of the triangles, in file x,y coordinates. */
+	osg::ref_ptr<osg::DrawElementsUInt> _indices;	/**< _triangles as a primitive set */
+};
+
+#endif // MESHDATA_H_
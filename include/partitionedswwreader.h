@@ -0,0 +1,180 @@
+/*
+	PartitionedSWWReader
+
+	Reads the per-processor sww files of a parallel ANUGA run as one mesh.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef PARTITIONEDSWWREADER_H_
+#define PARTITIONEDSWWREADER_H_
+
+#include <string>
+#include <vector>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Reader for the partitions of a domain decomposed run, named <name>_P<k>_<n>.sww for
+ * processor k of n, presented as the single mesh of the whole domain.
+ *
+ * Each partition holds the triangles of one processor plus a layer of ghost triangles
+ * copied from its neighbours, flagged 0 in tri_full_flag. Ghosts are dropped, and the
+ * vertices partitions share along their boundaries are welded into one, matched by
+ * their global node number in node_l2g when every partition has one per point, and by
+ * position otherwise. Each global vertex takes its values from the first partition
+ * holding it.
+ *
+ * A frame is read from every partition at once, one thread each from a pool. The
+ * netcdf-3 files of separate partitions share no state in the library, so their reads
+ * overlap; opening and closing stay on the calling thread under the netcdf lock, and
+ * netcdf-4 partitions are read one at a time.
+ *
+ * Only the named partition is watched for changes, the rest are checked when it changes,
+ * so a live view may lag one timestep behind the slowest processor.
+ *
+ * Usage
+ *
+ * std::vector<std::string> partitions;
+ * if (PartitionedSWWReader::getPartitionFilenames(filename, partitions))
+ * {
+ *     reader = new PartitionedSWWReader(filename);
+ * }
+ */
+class SWWREADER_EXPORT PartitionedSWWReader : public SWWReader
+{
+public:
+	/**
+	 * Find every partition of a run from the name of any one of them.
+	 * @param aFilename name of one partition
+	 * @param aFilenames set to the name of each partition in processor order
+	 * @return false if the name isn't that of a partition
+	 */
+	static bool getPartitionFilenames(const std::string & aFilename, std::vector<std::string> & aFilenames);
+
+	/**
+	 * Constructor, loads all the partitions.
+	 * @param aFilename name of any one partition
+	 * @param aNumThreads threads reading partitions at once, 0 for one less than the number of processors
+	 * @param aSharedMesh as for SWWReader, compared with the merged mesh
+	 * @param aOptions as for SWWReader, though a region isn't supported
+	 */
+	PartitionedSWWReader(const std::string & aFilename, unsigned int aNumThreads = 0, MeshData * aSharedMesh = NULL, const LoadOptions & aOptions = LoadOptions());
+
+	/**
+	 * Get the number of partitions read.
+	 */
+	unsigned int getNumberOfPartitions() const	{	return _partitions.size();	}
+
+	/**
+	 * As SWWReader::readFrames, a timestep at a time from all the partitions.
+	 */
+	virtual bool readFrames(FrameVisitor & aVisitor, bool aLowPriority = false);
+
+protected:
+
+	virtual ~PartitionedSWWReader();
+
+	virtual bool readMesh();
+	virtual bool readStage(unsigned int aTimestep, float * aStage, float * aXMomentum, float * aYMomentum);
+	virtual bool readElevation(unsigned int aTimestep, float * aElevation);
+	virtual bool readCompleteTimes(std::vector<float> & aTimes, bool & aPartial);
+	virtual int readSeries(const char * aVariable, size_t aFirstTimestep, size_t aNumTimesteps, const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries);
+
+	/**
+	 * Read variables of one timestep from every partition into the global vertex arrays.
+	 * @param aNames netcdf variable names
+	 * @param aOut global array for each variable, NULL to skip it
+	 * @param aNumVariables number of variables
+	 * @return false if any partition can't be read
+	 */
+	bool readPartitions(unsigned int aTimestep, const char * const * aNames, float * const * aOut, int aNumVariables);
+
+	/**
+	 * Read and scatter a range of partitions, opened by readPartitions.
+	 */
+	void readRange(size_t aBegin, size_t aEnd);
+
+	/**
+	 * Runs readRange() for a parallelFor.
+	 */
+	struct ReadBody
+	{
+		ReadBody(PartitionedSWWReader * aReader) : _reader(aReader) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_reader->readRange(aBegin, aEnd);	}
+		PartitionedSWWReader * _reader;
+	};
+
+	/**
+	 * Everything one partition holds about the mesh, before welding.
+	 */
+	struct PartitionMesh
+	{
+		size_t _numPoints;
+		size_t _numVolumes;
+		std::vector<float> _x;
+		std::vector<float> _y;
+		std::vector<int> _volumes;
+		std::vector<int> _full;		/**< tri_full_flag, empty if every triangle is full */
+		std::vector<int> _nodes;	/**< node_l2g, empty without one global node per point */
+		std::vector<float> _times;	/**< Times of the complete timesteps */
+		std::string _elevationName;
+		bool _animated;
+		bool _momentum;
+		bool _netcdf4;
+		double _xllcorner;
+		double _yllcorner;
+	};
+
+	/**
+	 * Read the mesh of one open partition.
+	 * @return netcdf status of the first failed read, NC_NOERR on success
+	 */
+	static int readPartitionMesh(int aNcid, PartitionMesh & aMesh);
+
+	// most variables read from a partition at once
+	enum { MAX_READ_VARIABLES = 3 };
+
+	/**
+	 * One partition file, and where its points go in the global mesh.
+	 */
+	struct Partition
+	{
+		std::string _filename;
+		size_t _numPoints;
+		size_t _numVolumes;
+		std::vector<unsigned int> _points;	/**< Points of this file that are the first copy of a global vertex */
+		std::vector<unsigned int> _vertices;	/**< The global vertex of each of _points */
+
+		// the read in progress
+		int _ncid;
+		int _varids[MAX_READ_VARIABLES];
+		bool _perTimestep[MAX_READ_VARIABLES];	/**< Variable has a record per timestep */
+		int _status;
+		std::vector<float> _buffer;
+	};
+
+private:
+	std::vector<Partition> _partitions;
+	std::vector<unsigned int> _vertexPartition;	/**< Partition each global vertex is read from */
+	std::vector<unsigned int> _vertexPoint;	/**< Point in that partition */
+	std::string _elevationName;	/**< elevation, or z in old files */
+	bool _parallelReads;	/**< False if any partition is netcdf-4, which can't be read by two threads at once */
+
+	WorkerPool _pool;
+
+	// the read in progress
+	unsigned int _readTimestep;
+	float * const * _readOut;
+	int _readNumVariables;
+};
+
+#endif // PARTITIONEDSWWREADER_H_
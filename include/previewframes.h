@@ -0,0 +1,157 @@
+/*
+	PreviewFrames
+
+	Every timestep of an sww file at a coarse resolution, for stepping through quickly.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef PREVIEWFRAMES_H_
+#define PREVIEWFRAMES_H_
+
+#include <string>
+#include <vector>
+#include <OpenThreads/Atomic>
+
+#include <swwreader.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+// most the frames take by default, and the limits on cells along the longer side of the mesh
+#define PREVIEW_DEFAULT_BYTES (64*1024*1024)
+#define PREVIEW_MIN_CELLS 16
+#define PREVIEW_MAX_CELLS 256
+
+/**
+ * A spatially decimated copy of every frame of a run, small enough to hold in memory
+ * whole, so any timestep can be shown at once while the full frame is still to be read.
+ *
+ * The mesh is clustered onto a square grid, each cell standing for the first vertex in
+ * it, and the triangles left with three different corners are kept, in the winding of
+ * the first triangle to give them. The grid is as fine as the memory allowed lets every
+ * timestep be held, within PREVIEW_MIN_CELLS and PREVIEW_MAX_CELLS along the longer side.
+ * Each frame holds the depth and momentum at each cell's vertex.
+ *
+ * Computed in one sequential pass over the file at low priority, so frames become
+ * available from the first onwards while the pass goes on, and kept in a SidecarCache
+ * next to the sww, stamped with the number of values of each array.
+ *
+ * Usage
+ *
+ * PreviewFrames preview;
+ * preview.compute(reader);	// on a background thread
+ * ...
+ * if (preview.isReady(t))
+ * {
+ *     const float * depth = preview.getDepth(t);	// one per preview.getVertices()
+ * }
+ */
+class SWWREADER_EXPORT PreviewFrames : public SWWReader::FrameVisitor
+{
+public:
+	/**
+	 * Constructor
+	 * @param aMaxBytes most the frames take
+	 */
+	PreviewFrames(size_t aMaxBytes = PREVIEW_DEFAULT_BYTES);
+
+	/**
+	 * Get the frames of a file, from its sidecar cache if that is up to date, otherwise
+	 * by a pass over the file, after which the cache is written. Call once.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @return false if the file can't be read, or cancel() was called
+	 */
+	bool compute(SWWReader * aReader);
+
+	/**
+	 * Stop a compute() in progress, from another thread.
+	 */
+	void cancel()	{	_cancelled.exchange(1);	}
+
+	bool isValid() const	{	return _valid;	}
+
+	/**
+	 * Was the last compute() answered from the cache.
+	 */
+	bool isFromCache() const	{	return _fromCache;	}
+
+	/**
+	 * Fraction of the frames taken so far by a compute() in progress.
+	 */
+	float getProgress() const;
+
+	/**
+	 * Has a timestep been taken yet, by a compute() finished or still in progress. The
+	 * vertices, triangles and frames may be read from any thread once it has.
+	 */
+	bool isReady(unsigned int aTimestep) const	{	return aTimestep < (unsigned int) _numFramesDone;	}
+
+	unsigned int getCellsAcross() const	{	return _cellsAcross;	}
+
+	/**
+	 * Get the reader's vertex standing for each cell, ascending.
+	 */
+	const std::vector<unsigned int> & getVertices() const	{	return _vertices;	}
+
+	/**
+	 * Get the triangles of the clustered mesh, three indices into getVertices() each.
+	 */
+	const std::vector<unsigned int> & getTriangles() const	{	return _triangles;	}
+
+	/**
+	 * Get the depth of a frame, stage less elevation, at each of getVertices().
+	 */
+	const float * getDepth(unsigned int aTimestep) const	{	return &_depth[aTimestep * _vertices.size()];	}
+
+	/**
+	 * Get the momentum of a frame at each of getVertices().
+	 * @return NULL if the file has no momentum
+	 */
+	const float * getXMomentum(unsigned int aTimestep) const	{	return _momentum ? &_xmomentum[aTimestep * _vertices.size()] : NULL;	}
+	const float * getYMomentum(unsigned int aTimestep) const	{	return _momentum ? &_ymomentum[aTimestep * _vertices.size()] : NULL;	}
+
+	/**
+	 * Name of the sidecar cache of an sww file.
+	 */
+	static std::string getCacheFilename(const std::string & aFilename);
+
+protected:
+
+	/**
+	 * Take one frame at the cells' vertices.
+	 */
+	virtual bool visit(const SWWReader::FrameData & aFrame);
+
+	/**
+	 * Cluster the reader's mesh onto the grid, filling in the vertices and triangles.
+	 */
+	void decimate(MeshData * aMesh);
+
+	/**
+	 * The arrays saved in the sidecar, in their order there.
+	 */
+	std::vector< std::vector<float> * > getCacheArrays();
+
+private:
+	size_t _maxBytes;
+	unsigned int _cellsAcross;
+	std::vector<unsigned int> _vertices;
+	std::vector<unsigned int> _triangles;
+	std::vector<float> _depth;	/**< Each frame in turn */
+	std::vector<float> _xmomentum;	/**< Empty if the file has no momentum */
+	std::vector<float> _ymomentum;
+	bool _momentum;
+	bool _valid;
+	bool _fromCache;
+
+	unsigned int _numFrames;
+	OpenThreads::Atomic _numFramesDone;
+	OpenThreads::Atomic _cancelled;
+};
+
+#endif // PREVIEWFRAMES_H_
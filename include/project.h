@@ -27,6 +27,7 @@
 #define DEF_PAUSED_START        true
 #define DEF_BACKGROUND_COLOUR   0.5, 0.5, 0.5, 1.0    // R, G, B, Alpha (grey)
 #define DEF_TPS                 10.0                  // sww timesteps per second
+#define DEF_INUNDATION_DEPTH    0.01                  // metres, deeper is inundated
 
 	/**
 	 * Several wireframe modes, a bitfield detailing which parts of the scene geometry
@@ -0,0 +1,76 @@
+/*
+	Region
+
+	Part of a domain, a box or a polygon in georeferenced coordinates.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef REGION_H_
+#define REGION_H_
+
+#include <string>
+#include <vector>
+#include <osg/Vec2d>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * An area of interest within a domain, either an axis aligned box or a simple
+ * polygon, in the same georeferenced coordinates as SWWReader::getGeoreferencedVertex.
+ * Kept in double, as a float easting or northing is only good to a metre or so.
+ * An empty region stands for the whole domain.
+ *
+ * Usage
+ *
+ * Region region;
+ * if (Region::parse("305000,6187000,306000,6188000", region) && region.contains(x, y))
+ * {
+ * }
+ */
+class SWWREADER_EXPORT Region
+{
+public:
+	/**
+	 * Constructor, the whole domain.
+	 */
+	Region();
+
+	/**
+	 * Parse a region from the command line.
+	 * @param aSpec xmin,ymin,xmax,ymax for a box, or x1,y1,x2,y2,x3,y3,... for a polygon
+	 *        of three or more corners
+	 * @return false if it is neither, leaving aRegion as it was
+	 */
+	static bool parse(const std::string & aSpec, Region & aRegion);
+
+	void setBox(double aXMin, double aYMin, double aXMax, double aYMax);
+
+	/**
+	 * @param aCorners three or more, in either order, closed back to the first
+	 */
+	void setPolygon(const std::vector<osg::Vec2d> & aCorners);
+
+	/**
+	 * Back to the whole domain.
+	 */
+	void clear();
+
+	bool isEmpty() const	{	return _corners.empty();	}
+
+	/**
+	 * Is a point inside, or on the edge. Everywhere is inside an empty region.
+	 */
+	bool contains(double aX, double aY) const;
+
+protected:
+	std::vector<osg::Vec2d> _corners;	/**< Polygon, a box as its four corners */
+	double _xmin, _ymin, _xmax, _ymax;	/**< Bounds of the corners, to skip most points quickly */
+};
+
+#endif // REGION_H_
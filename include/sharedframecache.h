@@ -0,0 +1,165 @@
+/*
+	SharedFrameCache
+
+	Timesteps of an sww file shared between viewers on one host.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef SHAREDFRAMECACHE_H_
+#define SHAREDFRAMECACHE_H_
+
+#include <string>
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+// most viewers one segment keeps track of, more still share it but don't keep it alive
+#define SHARED_FRAME_MAX_VIEWERS 32
+
+/**
+ * Decoded stage and momentum frames of an sww file, kept in a named POSIX shared
+ * memory segment so viewers of the same file on one host decode each frame once
+ * between them rather than once each.
+ *
+ * The segment is named from the file's device, inode, size and modification time, so
+ * a changed file gets a new segment, and from the points a frame holds, so viewers of
+ * different regions of a file don't share one. It holds a fixed number of slots, each timestep
+ * going to the slot of its number modulo the slot count. Slots are guarded by a
+ * sequence count rather than a lock: a writer claims a slot by moving its count to an
+ * odd value with a compare-and-swap, a reader copies a frame out and keeps it only if
+ * the count was even and unchanged across the copy. Neither ever waits; a reader that
+ * loses a race reads the file instead, a writer that loses one leaves the frame to
+ * the other. Pages of a slot are only allocated once a frame is written to it.
+ *
+ * Segments are created readable by whoever can read the file and writable by their
+ * owner, so viewers of other users map them read-only, reading from them but not
+ * adding to them. A segment is only used if its owner is the viewer's user or the
+ * file's, so no other user can pass off frames of their own as the file's. Each
+ * viewer that can write records its process id in the segment, and the last to close
+ * it or exit removes it. Segments left by viewers that died, or of files that have since changed
+ * or gone, are removed by the next viewer to open a segment.
+ *
+ * Only on POSIX systems, open() fails elsewhere. Not thread safe, the reader uses it
+ * under its own lock; other processes need no coordination.
+ *
+ * Usage
+ *
+ * osg::ref_ptr<SharedFrameCache> cache = SharedFrameCache::open(filename, npoints, 3, 256*1024*1024);
+ * if (!cache.valid() || !cache->find(t, arrays))
+ * {
+ *     read(t, arrays);
+ *     if (cache.valid()) cache->insert(t, arrays);
+ * }
+ */
+class SWWREADER_EXPORT SharedFrameCache : public osg::Referenced
+{
+public:
+	/**
+	 * Open the segment of a file, creating it if no other viewer has.
+	 * @param aFilename sww file the frames are read from
+	 * @param aNumPoints number of vertices in a frame
+	 * @param aNumArrays number of arrays in a frame, stage and perhaps the two momenta
+	 * @param aMaxBytes most the frames of the segment take, at least one frame
+	 * @param aSelection the file's points a frame holds, in order, NULL or empty for all
+	 * @return NULL if shared memory isn't available, or an existing segment doesn't match
+	 */
+	static SharedFrameCache * open(const std::string & aFilename, size_t aNumPoints, unsigned int aNumArrays, size_t aMaxBytes,
+								   const std::vector<unsigned int> * aSelection = NULL);
+
+	/**
+	 * Remove segments of viewers that died, and of files since changed or removed.
+	 * open() does this first.
+	 * @return number of segments removed
+	 */
+	static unsigned int removeStale();
+
+	/**
+	 * Copy a frame out of the segment.
+	 * @param aArrays one array per frame array, each of the number of vertices
+	 * @return false if the frame isn't there, or was being replaced
+	 */
+	bool find(unsigned int aTimestep, float * const * aArrays) const;
+
+	/**
+	 * Add a frame for other viewers, replacing whatever frame had its slot. Does nothing
+	 * if the segment is read-only, or another viewer is writing to the slot.
+	 * @param aArrays one array per frame array, each of the number of vertices
+	 */
+	void insert(unsigned int aTimestep, const float * const * aArrays);
+
+	/**
+	 * Name of the segment, as given to shm_open.
+	 */
+	const std::string & getName() const	{	return _name;	}
+
+	unsigned int getNumSlots() const	{	return _numSlots;	}
+
+	/**
+	 * Can frames be added, or is the segment another user's.
+	 */
+	bool isWritable() const	{	return _writable;	}
+
+protected:
+
+	struct Header;
+	struct Slot;
+
+	SharedFrameCache();
+	virtual ~SharedFrameCache();
+
+	/**
+	 * Map a segment, creating and initialising it if it doesn't exist.
+	 * @param aIdentity the file's device, inode, size and modification time
+	 * @param aSelection hash of the points in a frame, 0 for all of them
+	 * @param aOwner user id of the file's owner, whose segment is trusted
+	 * @param aMode permissions of the file, whose read bits a new segment is given
+	 * @return false if it can't be mapped, doesn't match, or is another user's
+	 */
+	bool map(const std::string & aFilename, const long long * aIdentity, unsigned long long aSelection,
+			 unsigned int aOwner, unsigned int aMode, size_t aNumPoints, unsigned int aNumArrays, unsigned int aNumSlots);
+
+	/**
+	 * Take a free place in the list of viewers of the segment.
+	 */
+	void attach();
+
+	/**
+	 * Give up that place.
+	 * @return false if other live viewers remain
+	 */
+	bool detach();
+
+	Slot * getSlot(unsigned int aTimestep) const;
+
+	/**
+	 * Give up this process's place in every segment it has open, at exit.
+	 */
+	static void detachAll();
+
+	/**
+	 * Is a segment no longer wanted: every viewer of it has gone, or its file has changed.
+	 * @param aName as given to shm_open
+	 */
+	static bool isStale(const std::string & aName);
+
+	std::string _name;
+	void * _base;	/**< Start of the mapping */
+	size_t _bytes;	/**< Length of the mapping */
+	Header * _header;
+	size_t _numPoints;
+	unsigned int _numArrays;
+	unsigned int _numSlots;
+	size_t _slotBytes;
+	bool _writable;
+	int _viewer;	/**< Place in the list of viewers, -1 for none */
+};
+
+#endif // SHAREDFRAMECACHE_H_
@@ -0,0 +1,122 @@
+/*
+	SidecarCache
+
+	Per-vertex results of a pass over an sww file, saved next to it.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef SIDECARCACHE_H_
+#define SIDECARCACHE_H_
+
+#include <string>
+#include <vector>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * A file of float arrays, one value per vertex each, computed from an sww file and
+ * trusted only while the sww's modification time and size, the number of vertices
+ * and any parameter of the computation match those it was written with. Results
+ * computed from other files as well are stamped with each of them too.
+ *
+ * Usage
+ *
+ * SidecarCache cache(filename, ".envelope", "SWWENV02");
+ * bool stamped = cache.stamp(npoints);	// before the pass
+ * if (!(stamped && cache.read(arrays)))
+ * {
+ *     ... compute the arrays ...
+ *     if (stamped) cache.write(arrays);
+ * }
+ */
+class SWWREADER_EXPORT SidecarCache
+{
+public:
+	/**
+	 * Constructor
+	 * @param aFilename sww file the results are computed from
+	 * @param aSuffix appended to the sww's name to name the sidecar
+	 * @param aMagic eight characters naming the contents and their layout version
+	 * @param aParameter anything else the results depend on, eg. a threshold
+	 */
+	SidecarCache(const std::string & aFilename, const std::string & aSuffix, const char * aMagic, float aParameter = 0.0f);
+
+	/**
+	 * Add another file the results are computed from, checked as the sww is. Call
+	 * before stamp().
+	 */
+	void addSource(const std::string & aFilename);
+
+	/**
+	 * Record the sww file's state. Taken before the pass, so changes made during it leave
+	 * the sidecar out of date.
+	 * @return false if the file can't be found
+	 */
+	bool stamp(size_t aNumPoints);
+
+	/**
+	 * Load the arrays, if the sidecar matches the stamp.
+	 * @param aArrays resized to the stamped number of points and filled, in order
+	 * @return false if there is no sidecar or it is out of date
+	 */
+	bool read(const std::vector< std::vector<float> * > & aArrays);
+
+	/**
+	 * Save the arrays with the stamp. Failure only costs the next run a pass.
+	 */
+	void write(const std::vector< std::vector<float> * > & aArrays);
+
+	const std::string & getFilename() const	{	return _cacheFilename;	}
+
+protected:
+	/**
+	 * Sidecar layout: this header, a SourceStamp for each added source, then each
+	 * array in turn.
+	 */
+	struct Header
+	{
+		char _magic[8];
+		long long _modificationTime;	/**< Of the sww file */
+		long long _size;
+		unsigned int _numPoints;
+		unsigned int _numArrays;
+		float _parameter;
+		unsigned int _numSources;	/**< Added sources, 0 in sidecars of one file */
+	};
+
+	/**
+	 * State of an added source.
+	 */
+	struct SourceStamp
+	{
+		long long _modificationTime;
+		long long _size;
+	};
+
+	/**
+	 * Fill a header with the sww file's current state.
+	 */
+	bool stampHeader(size_t aNumPoints, Header & aHeader) const;
+
+	/**
+	 * Take the current state of each added source.
+	 */
+	bool stampSources(std::vector<SourceStamp> & aStamps) const;
+
+	std::string _swwFilename;
+	std::string _cacheFilename;
+	char _magic[8];
+	float _parameter;
+	std::vector<std::string> _sources;	/**< Added by addSource() */
+	Header _stamp;
+	std::vector<SourceStamp> _sourceStamps;
+	bool _stamped;
+};
+
+#endif // SIDECARCACHE_H_
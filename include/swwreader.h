@@ -26,8 +26,16 @@
 #include <project.h>
 #include <iostream>
 #include <osg/Geometry>
+#include <OpenThreads/Mutex>
 
 #include <filechangedcheck.h>
+#include <meshdata.h>
+#include <framecache.h>
+#include <sharedframecache.h>
+#include <framescheduler.h>
+#include <region.h>
+#include <timewindow.h>
+#include <derivedquantity.h>
 
 
 // needed to create a .lib file under win32/Visual Studio
@@ -38,8 +46,6 @@
 #endif
 
 
-typedef std::vector<unsigned int> triangle_list;
-
 /**
  * Reader for an SWW file
  */
@@ -57,8 +63,101 @@ public:
 		TSTYPE_STAGE,	/** < Water height in absolute metres. */
 	};
 
+	/**
+	 * Told of the progress of a long timeseries read, and able to cancel it.
+	 */
+	class SeriesProgress
+	{
+	public:
+		virtual ~SeriesProgress() {}
+
+		/**
+		 * Called on the reading thread after each chunk of timesteps.
+		 * @param aData the series being read, valid up to aNumRead timesteps
+		 * @param aNumRead number of leading timesteps read so far
+		 * @return false to abandon the read
+		 */
+		virtual bool progress(const std::vector< osg::ref_ptr<osg::FloatArray> > & aData, size_t aNumRead) = 0;
+	};
+
+	/**
+	 * The quantities of one timestep, as stored in the file.
+	 */
+	struct FrameData
+	{
+		unsigned int _timestep;
+		float _time;
+		size_t _numPoints;
+		const float * _stage;
+		const float * _xmomentum;	/**< NULL if the file has no momentum */
+		const float * _ymomentum;	/**< NULL if the file has no momentum */
+		const float * _elevation;	/**< This timestep's, or the static elevation */
+	};
+
+	/**
+	 * Receives the frames of a pass over the file.
+	 */
+	class FrameVisitor
+	{
+	public:
+		virtual ~FrameVisitor() {}
+
+		/**
+		 * Called on the reading thread for each timestep in turn. The data is only valid
+		 * for the duration of the call.
+		 * @return false to stop the pass
+		 */
+		virtual bool visit(const FrameData & aFrame) = 0;
+	};
+
+	/**
+	 * Hands each frame to several visitors in turn, so they share one pass over the file.
+	 * A visitor that stops is passed no more frames, and the pass stops once they all have.
+	 */
+	class FrameVisitorList : public FrameVisitor
+	{
+	public:
+		void add(FrameVisitor * aVisitor)	{	_visitors.push_back(aVisitor);	}
+
+		bool empty() const	{	return _visitors.empty();	}
+
+		virtual bool visit(const FrameData & aFrame);
+
+	private:
+		std::vector<FrameVisitor*> _visitors;	/**< Those still taking frames */
+	};
+
+
+
+	/**
+	 * What part of a file a reader loads, and whether it shares its frames, given to its
+	 * constructor, so each run is cut its own way and runs compared with each other are
+	 * passed the same.
+	 */
+	struct LoadOptions
+	{
+		LoadOptions() : sharedCacheBytes(0) {}
+
+		Region region;	/**< Part of the domain loaded, empty for all of it */
+		TimeWindow timeWindow;	/**< Timesteps loaded, by default all of them */
+		size_t sharedCacheBytes;	/**< Most the frames shared with other viewers of the file on this host take, 0 to not share them */
+	};
+
 
-    SWWReader(const std::string& filename);
+
+	/**
+	 * Constructor
+	 * @param filename sww file
+	 * @param aLoad load the file now; a subclass reading the file its own way passes false
+	 *        and calls load() from its constructor, where its hooks are in place
+	 * @param aSharedMesh mesh of another run, used in place of this file's own if the two
+	 *        are the same, so runs compared side by side hold one copy of it
+	 * @param aWatch watch the file for changes from a thread of its own; false to leave it
+	 *        unwatched, refresh() then only catching up with changes markChanged() tells
+	 *        it of, for a reader following another's watcher
+	 * @param aOptions what part of the file to load
+	 */
+    SWWReader(const std::string& filename, bool aLoad = true, MeshData * aSharedMesh = NULL, bool aWatch = true, const LoadOptions & aOptions = LoadOptions());
 
     virtual bool isValid() {return _valid;}
 
@@ -91,9 +190,206 @@ public:
     virtual osg::ref_ptr<osg::Vec4Array> getStageColorArray() {return _stagecolors;}
 
 	/**
-	 * Given a polygon index, return the stage/momentum timeseries data at that point.
+	 * Choose the quantity the stage is coloured by, from the next loadStageVertexArray().
+	 * Only the chosen quantity is computed, once per cached frame.
+	 */
+	virtual void setColourQuantity(DerivedQuantity::Type aType)	{	_colourQuantity = aType;	}
+	virtual DerivedQuantity::Type getColourQuantity()	{	return _colourQuantity;	}
+
+	/**
+	 * Does the file have momentum, so the quantities derived from it can be coloured.
+	 */
+	bool hasMomentum() const	{	return (_pxmomentum != NULL) && (_pymomentum != NULL);	}
+
+	/**
+	 * Get the flow velocity of the loaded stage at a set of vertices, zero where dry.
+	 * Only reads, so parts of one list can be filled from several threads at once, though
+	 * not while a frame is loading.
+	 * @param aVertices vertex indices
+	 * @param aCount number of vertices
+	 * @param aU receives the x velocity of each vertex, in file units
+	 * @param aV receives the y velocity of each vertex, in file units
+	 * @return false if the file has no momentum
+	 */
+	virtual bool getStageVelocity(const unsigned int * aVertices, size_t aCount, float * aU, float * aV);
+
+	/**
+	 * Given a polygon index, return the stage/momentum timeseries data at its centroid.
 	 */
 	virtual bool getTimeSeries(unsigned int aPolyIndex, TimeSeriesType aPlotType, osg::ref_ptr<osg::FloatArray> aData);
+
+	/**
+	 * Return the stage/momentum timeseries at a point, interpolated from the vertices of
+	 * the triangle containing it.
+	 * @param aX georeferenced x, including any xllcorner offset
+	 * @param aY georeferenced y, including any yllcorner offset
+	 * @return false if the point is outside the mesh or the data can't be read
+	 */
+	virtual bool getTimeSeries(double aX, double aY, TimeSeriesType aPlotType, osg::ref_ptr<osg::FloatArray> aData);
+
+	/**
+	 * Return the timeseries at many points, reading the series of all their vertices together.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @param aPoints georeferenced x,y of each point
+	 * @param aData set to one series per point, empty for points outside the mesh
+	 * @param aProgress if not NULL, the series are read a chunk of timesteps at a time and
+	 *        it is told after each one
+	 * @return false if the data can't be read, or the read was cancelled
+	 */
+	virtual bool getTimeSeries(const std::vector<osg::Vec2d> & aPoints, TimeSeriesType aPlotType, std::vector< osg::ref_ptr<osg::FloatArray> > & aData,
+							   SeriesProgress * aProgress = NULL);
+
+	/**
+	 * Read every timestep in file order, handing each to a visitor. Several timesteps
+	 * are read at a time, so the pass streams through the file once whatever its size.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @param aLowPriority read in smaller blocks and hold off while the render thread is
+	 *        waiting to load a frame, for passes that run alongside playback
+	 * @return false if the data can't be read, or the visitor stopped the pass
+	 */
+	virtual bool readFrames(FrameVisitor & aVisitor, bool aLowPriority = false);
+
+	/**
+	 * Read the stage and elevation of one timestep, leaving the loaded frame as it is.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @param aStage resized to the number of vertices and filled
+	 * @param aElevation resized to the number of vertices and filled
+	 * @return false if the timestep can't be read
+	 */
+	virtual bool readFrame(unsigned int aTimestep, std::vector<float> & aStage, std::vector<float> & aElevation);
+
+	/**
+	 * Get the quantities of one timestep from the caches, or read them from the file and
+	 * cache them, leaving the loaded frame as it is. Blocks while the file is read.
+	 * Safe to call from a background thread while the render thread uses the reader.
+	 * @return NULL if the timestep can't be read
+	 */
+	virtual osg::ref_ptr<FrameCache::Frame> loadFrame(unsigned int aTimestep);
+
+	/**
+	 * Ask for a timestep to be read in the background, ahead of it being loaded, so a
+	 * later loadStageVertexArray() finds it cached. Requests of every caller go through
+	 * one FrameScheduler per reader, started on the first request.
+	 * @param aPriority higher is read first
+	 * @return handle to the frame, to wait on or cancel
+	 */
+	osg::ref_ptr<FrameRequest> requestFrame(unsigned int aTimestep, int aPriority = 0);
+
+	/**
+	 * Find the triangle containing a point.
+	 * @param aX georeferenced x, including any xllcorner offset
+	 * @param aY georeferenced y, including any yllcorner offset
+	 * @param aWeights if not NULL, set to the barycentric weights of the triangle's vertices
+	 * @return triangle index, -1 if the point is outside the mesh
+	 */
+	virtual int locate(double aX, double aY, osg::Vec3 * aWeights = NULL);
+
+	/**
+	 * Find the first triangle hit by a line segment, on either the loaded stage or
+	 * bedslope surface, whichever is nearer the start.
+	 * @param aStart segment start, in the normalised coordinates of the vertex arrays
+	 * @param aEnd segment end, in the normalised coordinates of the vertex arrays
+	 * @param aHit if not NULL, set to the hit point in normalised coordinates
+	 * @return triangle index, -1 if nothing was hit
+	 */
+	virtual int pick(const osg::Vec3 & aStart, const osg::Vec3 & aEnd, osg::Vec3 * aHit = NULL);
+
+	/**
+	 * Convert a point from the normalised coordinates of the vertex arrays back to file units.
+	 * @return georeferenced x, y, including any xllcorner/yllcorner offset, and height; in
+	 *         double, as a float holds a northing only to half a metre
+	 */
+	virtual osg::Vec3d getGeoreferencedPoint(const osg::Vec3 & aPoint);
+
+	/**
+	 * Get the factor from file units to the normalised coordinates of the vertex arrays,
+	 * the same along every axis.
+	 */
+	float getScale() const	{	return _scale;	}
+
+	/**
+	 * Normalise the vertex arrays by the extents of a larger mesh rather than those of the
+	 * vertices loaded, so pieces of one mesh loaded separately line up. Call before the
+	 * bedslope is loaded.
+	 * @param aXMin etc. extents in file units, without the georeference offset
+	 */
+	void setBoundingVolume(float aXMin, float aXMax, float aYMin, float aYMax, float aZMin, float aZMax);
+
+	/**
+	 * Get the location of a vertex in file units.
+	 * @return georeferenced x, y, including any xllcorner/yllcorner offset, in double
+	 */
+	virtual osg::Vec2d getGeoreferencedVertex(size_t aIndex)	{	return osg::Vec2d(_px[aIndex] + _xllcorner, _py[aIndex] + _yllcorner);	}
+
+	/**
+	 * Get the triangles of the mesh, three vertex indices each.
+	 */
+	virtual const unsigned int * getTriangles()	{	return _pvolumes;	}
+	virtual size_t getNumberOfTriangles()	{	return _nvolumes;	}
+
+	/**
+	 * Get the plan area of each triangle in file units, computed once on load.
+	 */
+	virtual const std::vector<float> & getTriangleAreas();
+
+	/**
+	 * Get the static mesh, to share with readers of other runs on the same mesh.
+	 * @return NULL if the file isn't loaded
+	 */
+	MeshData * getMesh()	{	return _mesh.get();	}
+
+	/**
+	 * Check whether the mesh is the one passed to the constructor, rather than a copy of
+	 * this file's own.
+	 */
+	bool isMeshShared() const	{	return _mesh.valid() && (_mesh == _sharedMesh);	}
+
+	/**
+	 * Get the frames shared with other viewers of the same file on this host, in a
+	 * SharedFrameCache of the size given to the constructor.
+	 * @return NULL if they aren't shared
+	 */
+	SharedFrameCache * getSharedCache()	{	return _sharedCache.get();	}
+
+	/**
+	 * Get what part of the file was loaded, to load other runs compared with it the same.
+	 */
+	const LoadOptions & getLoadOptions() const	{	return _options;	}
+
+	/**
+	 * Get the region loaded, as given to the constructor: only the triangles with a
+	 * corner in it, and the vertices they use, renumbered from zero in file order; frames
+	 * are then read for those vertices alone. Not supported by partitioned runs, which
+	 * load the whole domain.
+	 * @return empty for the whole domain
+	 */
+	const Region & getRegion() const	{	return _options.region;	}
+
+	/**
+	 * Get the file's index of each vertex loaded.
+	 * @return empty if the whole domain is loaded
+	 */
+	const std::vector<unsigned int> & getRegionPoints() const	{	return _regionPoints;	}
+
+	/**
+	 * Get the window of the timesteps loaded, as given to the constructor, numbered from
+	 * zero within it: getTime, the frames, timeseries and background passes all see those
+	 * alone.
+	 * @return a default window for every timestep
+	 */
+	const TimeWindow & getTimeWindow() const	{	return _options.timeWindow;	}
+
+	/**
+	 * Get the file's index of a timestep loaded.
+	 */
+	size_t getFileTimestep(unsigned int aTimestep) const	{	return _timeFirst + aTimestep * _options.timeWindow.getStride();	}
+
+	/**
+	 * Are all of the file's vertices and timesteps loaded, neither a region nor a window
+	 * having left any out.
+	 */
+	bool isWholeRun() const	{	return _regionPoints.empty() && (_timeFirst == 0) && (_ntimesteps == _fileNumTimesteps);	}
+
 	/**
 	 * Get the actual simulation time when this timestep occurred.
 	 * @return the time that this timestep occurred in seconds
@@ -118,16 +414,39 @@ public:
     virtual bool getCulling() {return _state.culling;}
     virtual void setCulling(bool value) {_state.culling = value;}
     
-    virtual triangle_list getConnectivity(unsigned int index) {return _connectivity.at(index);}
+    virtual triangle_list getConnectivity(unsigned int index) {return _mesh->getConnectivity().at(index);}
 
     const std::string getSwollenDir() {return *(_state.swollendirectory);}
+    const std::string & getFilename() {return *(_state.swwfilename);}
     virtual void setSwollenDir(const std::string path) {_state.swollendirectory = new std::string(path);}
 
+	/**
+	 * Catch up with changes to the file on disk. Timesteps appended by a running
+	 * simulation are taken on without touching the mesh or the frame cache, anything
+	 * else reloads the whole file.
+	 * @return false if the file changed and couldn't be reloaded
+	 */
 	virtual bool refresh();
 
+	/**
+	 * Have the next refresh() catch up with the file, for a reader not watching it
+	 * itself that another reader's watcher has seen change.
+	 */
+	void markChanged()	{	_fileChanged.recheck();	}
+
+	/**
+	 * Seconds between the file last being written with timesteps taken on by refresh()
+	 * and now, how far a live view lags the simulation.
+	 * @return negative if no timesteps have been appended since the file was loaded
+	 */
+	virtual float getAppendAge();
+
 
 protected:
 
+	// cuts its tiles from the file under the netcdf lock
+	friend class TileSet;
+
     virtual ~SWWReader();
 
 	/**
@@ -140,20 +459,199 @@ protected:
 	 */
 	bool load();
 
+	/**
+	 * Take on timesteps appended to the file since it was loaded.
+	 * @return false if anything else about the file changed, so it needs a full load()
+	 */
+	bool appendTimesteps();
+
+	/**
+	 * Read the mesh and times, setting the dimensions and allocating and filling the
+	 * vertex, triangle and time arrays, and allocating those read a frame at a time.
+	 * Called by load() with the netcdf lock held.
+	 * @return false if the file can't be read
+	 */
+	virtual bool readMesh();
+
+	/**
+	 * Open the file and read its dimensions, variable ids and times, leaving it open for
+	 * the mesh to be read. The first part of readMesh().
+	 * @param aMomentum set to whether the file has momentum
+	 * @return false if the file can't be read
+	 */
+	bool readHeader(bool & aMomentum);
+
+	/**
+	 * Read the optional global attributes, the bedslope texture and georeference offset.
+	 * Call while the file is still open, after readHeader().
+	 */
+	void readAttributes();
+
+	/**
+	 * (Re)allocate the arrays read a frame at a time, for _npoints vertices.
+	 */
+	void allocateFrameArrays(bool aMomentum);
+
+	/**
+	 * Read the quantities of one timestep. Called with the netcdf lock held.
+	 * @param aXMomentum NULL if the file has no momentum
+	 * @param aYMomentum NULL if the file has no momentum
+	 * @return false if the file can't be read
+	 */
+	virtual bool readStage(unsigned int aTimestep, float * aStage, float * aXMomentum, float * aYMomentum);
+
+	/**
+	 * Read the elevation at a timestep, or the static elevation. Called with the netcdf lock held.
+	 * @return false if the file can't be read
+	 */
+	virtual bool readElevation(unsigned int aTimestep, float * aElevation);
+
+	/**
+	 * Cancel the frames asked for and wait for those being read. Called from the
+	 * destructor of any subclass overriding readStage(), before its own members go.
+	 */
+	void stopFrameRequests();
+
+	/**
+	 * Read the times of the complete timesteps of the file, if its mesh is unchanged and
+	 * it has more timesteps than were loaded. Called with the netcdf lock held.
+	 * @param aPartial set if a timestep beyond the complete ones is still being written
+	 * @return false if the file changed in any other way
+	 */
+	virtual bool readCompleteTimes(std::vector<float> & aTimes, bool & aPartial);
+
+	/**
+	 * Read the whole timeseries of a variable at a set of vertices, with a file handle of
+	 * its own. Takes the netcdf lock only for each read, so may run on a background thread.
+	 * @param aVariable netcdf variable name, dimensioned (time, points)
+	 * @return netcdf status of the first failed read, NC_NOERR on success
+	 * @see readVertexSeries
+	 */
+	virtual int readSeries(const char * aVariable, size_t aFirstTimestep, size_t aNumTimesteps, const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries);
+
+	/**
+	 * Get the lock held around every netcdf call, as the library isn't thread-safe.
+	 */
+	static OpenThreads::Mutex & getNetCDFMutex();
+
+	/**
+	 * Hold off a background pass while the render thread is waiting to load a frame.
+	 */
+	static void giveWayToFrameLoads();
+
+	/**
+	 * Get the length of a netcdf dimension.
+	 * @return 0 if it can't be read
+	 */
+	static size_t readDimension(int aNcid, const char * aName);
+
+	/**
+	 * Count the leading timesteps of an open file that have been completely written.
+	 * A simulation writing a timestep adds the record, filled, then writes each of its
+	 * variables in turn, so the newest records may still hold fill values.
+	 * @param aNumTimesteps records in the file
+	 * @param aNumPoints values of each record variable per timestep
+	 */
+	static size_t countCompleteTimesteps(int aNcid, size_t aNumTimesteps, size_t aNumPoints);
+
+	/**
+	 * Read the first timesteps of the time variable, which may have more records.
+	 */
+	static int readTimes(int aNcid, int aTimeid, size_t aNumTimesteps, float * aTimes);
+
 	/**
 	 * Get the bounding volume of the bedslope mesh.
 	 * @param aZData pointer to z data for the bedslope mesh.
 	 */
 	void getBedslopeBoundingVolume(const float * aZData);
 
-private:
 	/**
-	 * Access the bedslope heights.
-	 * sww file must be open or method will fail
-	 * @param aTimestep timestep index
-	 * @return pointer to bedslope height data
+	 * Set the scale and shift factors from the extents of the bedslope.
+	 */
+	void applyBoundingVolume(float aXMin, float aXMax, float aYMin, float aYMax, float aZMin, float aZMax);
+
+	/**
+	 * Read the whole timeseries of a variable at a set of vertices.
+	 * Nearby vertices are read as one block, so each call costs a few reads however many
+	 * vertices are asked for. Uses only its arguments, so is safe from any thread.
+	 * @param aNcid open sww file
+	 * @param aVarID netcdf variable, dimensioned (time, points)
+	 * @param aFirstTimestep first timestep of the file read
+	 * @param aNumTimesteps number of timesteps read
+	 * @param aStride timesteps of the file from one read to the next
+	 * @param aVertices vertex indices, sorted without duplicates
+	 * @param aSeries set to the series of each vertex in turn, number of timesteps values each
+	 * @return netcdf status of the first failed read, NC_NOERR on success
+	 */
+	static int readVertexSeries(int aNcid, int aVarID, size_t aFirstTimestep, size_t aNumTimesteps, size_t aStride,
+								const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries);
+
+	/**
+	 * Blend the vertex series of one triangle into a point series.
+	 * @param aVertices vertices the series were read for, sorted
+	 * @param aSeries series read by readVertexSeries
+	 * @param aNumTimesteps length of each series
+	 * @param aTriangle the triangle's three vertex indices
+	 * @param aWeights barycentric weights of the point
+	 * @param aOut receives the interpolated series
 	 */
-	float * loadBedslopeZ(unsigned int aTimestep);
+	static void interpolateSeries(const std::vector<unsigned int> & aVertices, const std::vector<float> & aSeries, size_t aNumTimesteps,
+								  const unsigned int * aTriangle, const osg::Vec3 & aWeights, float * aOut);
+
+	/**
+	 * A run of the file's points read as one hyperslab, holding one or more of the
+	 * vertices of a region with the few points between them.
+	 */
+	struct PointRange
+	{
+		size_t _start;	/**< First point in the file */
+		size_t _count;	/**< Points read */
+		size_t _first;	/**< First vertex of the region held */
+		size_t _end;	/**< One past the last */
+	};
+
+	/**
+	 * Read a variable at the vertices loaded, a range at a time when a region is loaded.
+	 * Uses only its arguments, so is safe from any thread; call with the netcdf lock held.
+	 * @param aVarID netcdf variable, dimensioned (time, points), or (points) if aNumTimesteps is 0
+	 * @param aFirstTimestep first timestep of the file read
+	 * @param aStride timesteps of the file from one row to the next
+	 * @param aNumPoints vertices loaded
+	 * @param aPoints file point of each vertex, empty for the whole domain
+	 * @param aRanges runs of aPoints to read
+	 * @param aOut aNumTimesteps rows, or one, of aNumPoints values
+	 * @return netcdf status of the first failed read, NC_NOERR on success
+	 */
+	static int readPoints(int aNcid, int aVarID, size_t aFirstTimestep, size_t aNumTimesteps, size_t aStride, size_t aNumPoints,
+						  const std::vector<unsigned int> & aPoints, const std::vector<PointRange> & aRanges, float * aOut);
+
+	/**
+	 * Cut the mesh just read down to the region, if one is set. Called at the end of readMesh().
+	 * @return false if the region holds none of it
+	 */
+	bool applyRegion();
+
+	/**
+	 * Load only some of the file's points and the triangles between them in place of
+	 * the whole mesh, reallocating the frame arrays to match and grouping the points
+	 * into ranges read together.
+	 * @param aMesh vertices and triangles kept
+	 * @param aPoints file point of each vertex of aMesh, ascending
+	 * @param aMomentum does the file have momentum
+	 */
+	void setSelection(MeshData * aMesh, const std::vector<unsigned int> & aPoints, bool aMomentum);
+
+	/**
+	 * Keep only the times of the window, if one is set, from those of the whole file
+	 * in _ptime. Called by readMesh() once the times are read.
+	 * @return false if the window holds none of them
+	 */
+	bool applyTimeWindow();
+
+	/**
+	 * Does a longer list of the file's times still have the times loaded.
+	 */
+	bool hasTimesLoaded(const std::vector<float> & aFileTimes) const;
 
 protected:
 
@@ -174,6 +672,8 @@ protected:
 
     } _state;
 
+	LoadOptions _options;	/**< What part of the file to load, as given to the constructor */
+
 
     // constructor determines SWW validity (netcdf + proper structure)
     bool _valid;
@@ -187,6 +687,16 @@ protected:
     // netcdf dimension values
     size_t _nvolumes, _nvertices, _npoints, _ntimesteps;
 
+	// whole domain, _nvolumes and _npoints being those of the region loaded
+	size_t _fileNumVolumes, _fileNumPoints;
+	std::vector<unsigned int> _regionPoints;	/**< File point of each vertex, empty for the whole domain */
+	std::vector<PointRange> _regionRanges;	/**< Runs of _regionPoints read together */
+
+	// whole run, _ntimesteps and _ptime being those of the window loaded
+	size_t _fileNumTimesteps;
+	size_t _timeFirst;	/**< File timestep of the first loaded */
+	unsigned int _partialRechecks;	/**< Looks at a timestep still being written since one was last finished */
+
     // netcdf variable ids
     int _xid, _yid, _zid, _volumesid, _timeid, _stageid, _xmomentumid, _ymomentumid;
 
@@ -224,21 +734,31 @@ protected:
 	float _xscale, _yscale, _zscale, _scale;
 	float _xoffset, _yoffset, _zoffset;
 	float _xcenter, _ycenter, _zcenter;
+	bool _boundsFixed;	/**< Set by setBoundingVolume, not worked out from the vertices loaded */
 	
 	// sww file can contain optional global offset attributes
-	float _xllcorner, _yllcorner;
+	double _xllcorner, _yllcorner;
 	
 	// stack of return values from netcdf function calls
 	std::vector<int> _status;
 
 	bool _elevationAnimated;	/**< True if the elevation data is animated */
+	double _appendTime;	/**< Modification time of the file when timesteps were last appended */
+
+	DerivedQuantity::Type _colourQuantity;	/**< Stage is coloured by this */
+	FrameCache _frameCache;	/**< Recently loaded stage frames */
+	size_t _frameCacheBytes;	/**< Most _frameCache holds, though always at least two frames */
+	osg::ref_ptr<SharedFrameCache> _sharedCache;	/**< Frames shared with other viewers, NULL if not */
+	FrameScheduler * _scheduler;	/**< Reads requested frames, NULL until the first request */
+	OpenThreads::Mutex _schedulerMutex;
 
 	// error checker (iterates through _status stack)
 	bool _statusHasError();
 	
-	// triangle connectivity, list (indexed by vertex number) of 
-	// lists (indices of triangles sharing this vertex)
-	std::vector<triangle_list> _connectivity;
+	// vertices, triangles and everything worked out from them; _px, _py and _pvolumes
+	// point into it
+	osg::ref_ptr<MeshData> _mesh;
+	osg::ref_ptr<MeshData> _sharedMesh;	/**< Another run's mesh, used if this file's is the same */
 	
 	FileChangedCheck _fileChanged;	/**< Monitor this file for disk changes. */
 };
@@ -0,0 +1,209 @@
+/*
+	TileSet
+
+	The mesh of an sww file cut into spatial tiles, kept in a cache file beside it.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef TILESET_H_
+#define TILESET_H_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+// tiles along the longer side of the mesh, and cells of the overview
+#define TILESET_DEFAULT_TILES 32
+#define TILESET_MAX_TILES 255
+#define TILESET_DEFAULT_OVERVIEW 512
+
+// memory a loaded tile holds, for its reader and surfaces, per vertex and per triangle
+#define TILESET_BYTES_PER_POINT 160
+#define TILESET_BYTES_PER_TRIANGLE 96
+
+/**
+ * The static mesh of an sww file too large to load whole, cut into a grid of square
+ * tiles that are loaded one at a time, plus a coarse overview of the whole mesh.
+ *
+ * Each triangle belongs to the tile holding its centroid, so every triangle is in
+ * exactly one tile; a tile holds its triangles and every vertex they use, vertices on a
+ * tile's edge being in each tile that uses them. Vertices keep their file point numbers,
+ * so a tile's frames are read from the file as a region's are.
+ *
+ * The overview clusters the vertices onto a coarser grid, each cell standing for the
+ * first of the file's points in it, and keeps the triangles left with three different
+ * corners. Each of its triangles records the tile it was made from, so the overview can
+ * leave out the parts where tiles are loaded.
+ *
+ * The tiles are worked out once, reading the mesh a part at a time, and saved in
+ * <file>.tiles, trusted while the sww's size and modification time and the tiling
+ * parameters match. Tiles are read from that file, never from the sww.
+ *
+ * Usage
+ *
+ * osg::ref_ptr<TileSet> tiles = TileSet::open(filename);
+ * TileSet::Tile tile;
+ * if (tiles.valid() && tiles->readTile(tiles->getOverview(), tile))
+ * {
+ * }
+ */
+class SWWREADER_EXPORT TileSet : public osg::Referenced
+{
+public:
+	/**
+	 * Extents and size of a tile, or of the whole mesh.
+	 */
+	struct TileInfo
+	{
+		float _xmin, _xmax;	/**< In file units, without the georeference offset */
+		float _ymin, _ymax;
+		float _zmin, _zmax;	/**< Of the elevation at the first timestep */
+		unsigned int _numPoints;
+		unsigned int _numTriangles;
+		long long _offset;	/**< Of the tile in the cache file */
+	};
+
+	/**
+	 * The mesh of one tile.
+	 */
+	struct Tile
+	{
+		std::vector<unsigned int> _points;	/**< File point of each vertex, ascending */
+		std::vector<float> _x;	/**< Of each vertex */
+		std::vector<float> _y;
+		std::vector<unsigned int> _triangles;	/**< Three vertex indices each */
+		std::vector<unsigned int> _triangleTiles;	/**< Tile each triangle was made from, overview only */
+	};
+
+	/**
+	 * Read the tiles of a file from its cache, cutting them and writing the cache first
+	 * if there isn't an up to date one. Reads the sww with the netcdf lock held.
+	 * @param aTilesAcross tiles along the longer side of the mesh, at most TILESET_MAX_TILES
+	 * @param aOverviewAcross cells of the overview along the longer side
+	 * @return NULL if the file can't be read, or the cache can't be written
+	 */
+	static TileSet * open(const std::string & aFilename, unsigned int aTilesAcross = TILESET_DEFAULT_TILES,
+						  unsigned int aOverviewAcross = TILESET_DEFAULT_OVERVIEW);
+
+	const std::string & getFilename() const	{	return _swwFilename;	}
+
+	const std::string & getCacheFilename() const	{	return _cacheFilename;	}
+
+	/**
+	 * Get the number of tiles, not counting the overview. Some may be empty.
+	 */
+	unsigned int getNumTiles() const	{	return _numTiles;	}
+
+	/**
+	 * Get the index of the overview, read like any other tile.
+	 */
+	unsigned int getOverview() const	{	return _numTiles;	}
+
+	/**
+	 * @param aTile a tile, or the overview
+	 */
+	const TileInfo & getTileInfo(unsigned int aTile) const	{	return _tiles[aTile];	}
+
+	/**
+	 * Get the extents and size of the whole mesh.
+	 */
+	const TileInfo & getMeshInfo() const	{	return _mesh;	}
+
+	/**
+	 * Estimate the memory a tile holds once loaded.
+	 */
+	size_t getTileBytes(unsigned int aTile) const;
+
+	/**
+	 * Read a tile from the cache. Opens the cache each time, so is safe from any thread.
+	 * @param aTile a tile, or the overview
+	 * @return false if the cache can't be read
+	 */
+	bool readTile(unsigned int aTile, Tile & aData) const;
+
+	/**
+	 * Were the tiles read from an existing cache, rather than cut from the sww.
+	 */
+	bool isFromCache() const	{	return _fromCache;	}
+
+protected:
+	/**
+	 * Cache layout: this header, a TileInfo for each tile and the overview, then each
+	 * tile's points, x, y and triangles, the overview's followed by its triangle tiles.
+	 */
+	struct Header
+	{
+		char _magic[8];
+		long long _modificationTime;	/**< Of the sww file */
+		long long _size;
+		unsigned int _tilesAcross;
+		unsigned int _overviewAcross;
+		unsigned int _numTiles;
+		unsigned int _numColumns;
+		TileInfo _mesh;
+	};
+
+	TileSet(const std::string & aFilename, unsigned int aTilesAcross, unsigned int aOverviewAcross);
+	virtual ~TileSet() {}
+
+	/**
+	 * Take the sww file's current state into _header.
+	 * @return false if the file can't be found
+	 */
+	bool stamp();
+
+	/**
+	 * Load the tile table from an existing cache.
+	 * @return false if there is none, or it is out of date
+	 */
+	bool read();
+
+	/**
+	 * Cut the mesh into tiles and write the cache. Called with the netcdf lock held.
+	 * @return false if the sww can't be read or the cache written
+	 */
+	bool build();
+
+	/**
+	 * Cut the tiles, a batch at a time, and write them to an open cache.
+	 * @param aTriangleCounts triangles of each tile
+	 * @return false if the sww can't be read or the cache written
+	 */
+	bool writeTiles(FILE * aFile, int aNcid, int aVolumesID, const std::vector<float> & aX, const std::vector<float> & aY,
+				   const std::vector<float> & aZ, const std::vector<unsigned int> & aTriangleCounts);
+
+	/**
+	 * Write a tile at the end of an open cache, filling in its TileInfo.
+	 * @param aCorners three file points per triangle
+	 * @param aTriangleTiles tile of each triangle, NULL for any but the overview
+	 */
+	bool writeTile(FILE * aFile, unsigned int aTile, const std::vector<unsigned int> & aCorners,
+				   const std::vector<unsigned int> * aTriangleTiles,
+				   const std::vector<float> & aX, const std::vector<float> & aY, const std::vector<float> & aZ);
+
+	/**
+	 * Get the tile holding a point.
+	 */
+	unsigned int getTileOf(float aX, float aY) const;
+
+	std::string _swwFilename;
+	std::string _cacheFilename;
+	Header _header;
+	unsigned int _numTiles;
+	TileInfo _mesh;
+	std::vector<TileInfo> _tiles;	/**< Each tile, then the overview */
+	float _tileSize;	/**< Side of a tile, in file units */
+	bool _fromCache;
+};
+
+#endif // TILESET_H_
@@ -0,0 +1,95 @@
+/*
+	TileSWWReader
+
+	Reads one tile of the mesh of an sww file, or its overview.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef TILESWWREADER_H_
+#define TILESWWREADER_H_
+
+#include <vector>
+#include <osg/BoundingBox>
+
+#include <swwreader.h>
+#include <tileset.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Reader for one tile of a TileSet, holding only the tile's vertices and triangles and
+ * reading frames at those vertices alone, as for a region. The mesh comes from the
+ * tile cache, the sww being opened only for its dimensions, times and attributes.
+ *
+ * Every tile is normalised by the extents of the whole mesh, so tiles loaded
+ * separately line up with each other and with the overview.
+ *
+ * A tile holds few frames and shares none with other viewers, as many are loaded at
+ * once; the overview keeps the usual frame cache. Regions don't apply, the whole mesh
+ * being tiled.
+ *
+ * Usage
+ *
+ * osg::ref_ptr<TileSet> tiles = TileSet::open(filename);
+ * TileSWWReader * overview = new TileSWWReader(tiles.get(), tiles->getOverview());
+ * TileSWWReader * tile = new TileSWWReader(tiles.get(), 12, false, overview->getLoadOptions());
+ * ...
+ * delete tile;
+ */
+class SWWREADER_EXPORT TileSWWReader : public SWWReader
+{
+public:
+	/**
+	 * Constructor, loads the tile.
+	 * @param aTiles tiles of the file
+	 * @param aTile a tile, or aTiles->getOverview()
+	 * @param aWatch as for SWWReader; tiles come and go, so leave watching to the overview,
+	 *        whoever refreshes it passing changes on with markChanged()
+	 * @param aOptions as for SWWReader, the overview's for each of its tiles; a region
+	 *        isn't supported
+	 */
+	TileSWWReader(TileSet * aTiles, unsigned int aTile, bool aWatch = true, const LoadOptions & aOptions = LoadOptions());
+
+	/**
+	 * Destructor, public as tiles are dropped again once out of view.
+	 */
+	virtual ~TileSWWReader() {}
+
+	TileSet * getTileSet()	{	return _tiles.get();	}
+
+	unsigned int getTile() const	{	return _tile;	}
+
+	/**
+	 * Leave the triangles made from some tiles out of the overview's triangle list, where
+	 * those tiles are drawn in its place. Only the overview has triangles made from tiles.
+	 * @param aHidden a flag for each tile
+	 * @return the new list, as getBedslopeIndexArray() returns from now on
+	 */
+	osg::DrawElementsUInt * hideTiles(const std::vector<bool> & aHidden);
+
+	/**
+	 * Get the extents of a tile of the set in the normalised coordinates of the vertex
+	 * arrays, which every tile shares, with the elevation of the first timestep.
+	 */
+	osg::BoundingBox getTileBounds(unsigned int aTile) const;
+
+protected:
+
+	/**
+	 * Read the tile's mesh from the cache and the rest from the sww. Takes the netcdf
+	 * lock itself, just while the sww is open, so tiles can load on background threads.
+	 */
+	virtual bool readMesh();
+
+	osg::ref_ptr<TileSet> _tiles;
+	unsigned int _tile;
+	std::vector<unsigned int> _triangleTiles;	/**< Tile each triangle of the overview was made from */
+};
+
+#endif // TILESWWREADER_H_
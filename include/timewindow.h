@@ -0,0 +1,92 @@
+/*
+	TimeWindow
+
+	Part of a run, a range of timesteps and a stride through them.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef TIMEWINDOW_H_
+#define TIMEWINDOW_H_
+
+#include <string>
+#include <stddef.h>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * The timesteps of a run that are loaded: from a first to a last, each given either
+ * as a timestep of the file or as a simulation time, taking every stride'th between.
+ * Either end can be left open, and a default window takes every timestep.
+ *
+ * Usage
+ *
+ * TimeWindow window;
+ * if (window.setStart("3600s") && window.setStride(10))
+ * {
+ *     size_t first = window.getFirst(times, ntimesteps);
+ *     size_t count = window.getCount(times, ntimesteps, first);
+ * }
+ */
+class SWWREADER_EXPORT TimeWindow
+{
+public:
+	/**
+	 * Constructor, every timestep.
+	 */
+	TimeWindow();
+
+	/**
+	 * @param aSpec a timestep of the file, or a time in seconds followed by s, as "120" or "3600s"
+	 * @return false if it is neither, leaving the start as it was
+	 */
+	bool setStart(const std::string & aSpec);
+
+	/**
+	 * @param aSpec as setStart, the last timestep taken being the last at or before it
+	 */
+	bool setEnd(const std::string & aSpec);
+
+	/**
+	 * @param aStride 1 for every timestep, 0 is refused
+	 */
+	bool setStride(unsigned int aStride);
+
+	unsigned int getStride() const	{	return _stride;	}
+
+	/**
+	 * Does it take every timestep.
+	 */
+	bool isEmpty() const	{	return !_hasStart && !_hasEnd && (_stride == 1);	}
+
+	/**
+	 * Get the first timestep of a file taken.
+	 * @param aTimes of every timestep of the file, in order
+	 * @return aNumTimesteps if none are
+	 */
+	size_t getFirst(const float * aTimes, size_t aNumTimesteps) const;
+
+	/**
+	 * Get how many timesteps are taken, as a file grows the same first is kept.
+	 * @param aFirst from getFirst()
+	 */
+	size_t getCount(const float * aTimes, size_t aNumTimesteps, size_t aFirst) const;
+
+protected:
+	/**
+	 * @return false if aSpec isn't a timestep or a time
+	 */
+	static bool parseBound(const std::string & aSpec, double & aValue, bool & aSeconds);
+
+	bool _hasStart, _hasEnd;
+	double _start, _end;	/**< Timesteps, or seconds */
+	bool _startSeconds, _endSeconds;
+	unsigned int _stride;
+};
+
+#endif // TIMEWINDOW_H_
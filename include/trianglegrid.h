@@ -0,0 +1,114 @@
+/*
+	TriangleGrid
+
+	A uniform grid spatial index over the triangles of a 2D mesh.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef TRIANGLEGRID_H_
+#define TRIANGLEGRID_H_
+
+#include <vector>
+#include <osg/Vec3>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * Locates points and rays against a triangle mesh in the x,y plane.
+ * The mesh bounds are divided into roughly one square cell per triangle, and each
+ * cell lists the triangles whose bounding box overlaps it, so a point lookup tests
+ * only a handful of triangles whatever the mesh size.
+ *
+ * The grid references the caller's vertex and index arrays, which must outlive it
+ * and not change between build() calls.
+ *
+ * Usage
+ *
+ * TriangleGrid grid;
+ * grid.build(x, y, npoints, volumes, nvolumes);
+ * int tri = grid.locate(px, py);
+ */
+class SWWREADER_EXPORT TriangleGrid
+{
+public:
+	TriangleGrid();
+
+	/**
+	 * Index a mesh, replacing any previous one.
+	 * @param aX vertex x coordinates
+	 * @param aY vertex y coordinates
+	 * @param aNumPoints number of vertices
+	 * @param aVolumes vertex indices, three per triangle
+	 * @param aNumVolumes number of triangles
+	 */
+	void build(const float * aX, const float * aY, unsigned int aNumPoints, const unsigned int * aVolumes, unsigned int aNumVolumes);
+
+	/**
+	 * Free the index.
+	 */
+	void clear();
+
+	/**
+	 * Find the triangle containing a point.
+	 * @param aX point x
+	 * @param aY point y
+	 * @param aWeights if not NULL, set to the barycentric weights of the triangle's three vertices
+	 * @return triangle index, -1 if the point is outside the mesh
+	 */
+	int locate(float aX, float aY, osg::Vec3 * aWeights = NULL) const;
+
+	/**
+	 * Find the first triangle of a surface hit by a line segment.
+	 * Walks the cells under the segment from its start, so only triangles near the
+	 * segment are tested.
+	 * @param aStart segment start, mesh coordinates
+	 * @param aEnd segment end, mesh coordinates
+	 * @param aZ surface height of each vertex
+	 * @param aRatio if not NULL, set to the fraction of the way along the segment of the hit
+	 * @return triangle index, -1 if the segment misses the surface
+	 */
+	int intersect(const osg::Vec3d & aStart, const osg::Vec3d & aEnd, const float * aZ, double * aRatio = NULL) const;
+
+	bool isValid() const	{	return !_cellStart.empty();	}
+
+protected:
+
+	/**
+	 * Cell containing a coordinate, clamped to the grid.
+	 */
+	int cellX(double aX) const;
+	int cellY(double aY) const;
+
+	/**
+	 * Barycentric weights of a point within a triangle.
+	 * @return true if the point is inside, or on an edge
+	 */
+	bool contains(unsigned int aTriangle, double aX, double aY, osg::Vec3 * aWeights) const;
+
+	/**
+	 * Ray intersection with one triangle of the surface.
+	 * @return true on a hit, setting aRatio
+	 */
+	bool intersectTriangle(unsigned int aTriangle, const osg::Vec3d & aStart, const osg::Vec3d & aDir, const float * aZ, double & aRatio) const;
+
+private:
+	const float * _x;
+	const float * _y;
+	const unsigned int * _volumes;
+	unsigned int _nvolumes;
+
+	double _xmin, _ymin;
+	double _cellSize;
+	int _ncellsX, _ncellsY;
+
+	std::vector<unsigned int> _cellStart;	/**< Offset of each cell's list in _cellTriangles, one extra at the end. */
+	std::vector<unsigned int> _cellTriangles;	/**< Triangle lists of all cells, concatenated. */
+};
+
+#endif // TRIANGLEGRID_H_
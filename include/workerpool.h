@@ -0,0 +1,177 @@
+/*
+	WorkerPool
+
+	A fixed set of threads servicing a bounded queue of jobs.
+
+	copyright (C) 2009 Geoscience Australia
+*/
+
+#ifndef WORKERPOOL_H_
+#define WORKERPOOL_H_
+
+#include <deque>
+#include <vector>
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Condition>
+
+// needed to create a .lib file under win32/Visual Studio
+#if defined(_MSC_VER)
+    #define SWWREADER_EXPORT   __declspec(dllexport)
+#else
+    #define SWWREADER_EXPORT
+#endif
+
+/**
+ * A pool of worker threads servicing a bounded FIFO queue of jobs.
+ * Jobs may complete in any order. Adding a job to a full queue blocks the caller until
+ * a worker takes one off, so a producer can never run further ahead of the workers
+ * than the queue length.
+ *
+ * Usage
+ *
+ * WorkerPool pool(4, 8);
+ * pool.add(new MyJob(...));
+ * pool.wait();	// all jobs complete
+ *
+ * or, to split a loop across the threads,
+ *
+ * pool.parallelFor(0, n, body);	// body(begin, end) on each part of [0, n)
+ *
+ * A pool for work the user isn't waiting on can run its threads at low priority, so
+ * they only get the processors the render loop leaves idle.
+ *
+ */
+class SWWREADER_EXPORT WorkerPool
+{
+public:
+	/**
+	 * A unit of work. Subclasses implement run(), which is called once from a worker thread.
+	 */
+	class Job : public osg::Referenced
+	{
+	public:
+		virtual void run() = 0;
+
+	protected:
+		virtual ~Job() {}
+	};
+
+	/**
+	 * Constructor, starts the worker threads.
+	 * @param aNumThreads number of worker threads, 0 for one less than the number of processors
+	 * @param aMaxQueued maximum number of jobs waiting to run, 0 for unbounded
+	 * @param aPriority scheduling priority of the worker threads
+	 */
+	WorkerPool(unsigned int aNumThreads = 0, unsigned int aMaxQueued = 0,
+			   OpenThreads::Thread::ThreadPriority aPriority = OpenThreads::Thread::THREAD_PRIORITY_DEFAULT);
+
+	/**
+	 * Destructor, runs any queued jobs to completion then stops the worker threads.
+	 */
+	~WorkerPool();
+
+	/**
+	 * Queue a job. Blocks while the queue is full.
+	 * @param aJob job to run, the pool holds a reference until it has run
+	 */
+	void add(Job * aJob);
+
+	/**
+	 * Block until the queue is empty and no job is running.
+	 */
+	void wait();
+
+	/**
+	 * Split a range into one part per thread, run a body over each part on the workers,
+	 * and return when all parts are done. Like wait(), also waits for any other jobs.
+	 * Must not be called from one of the pool's own jobs.
+	 * @param aBegin first index
+	 * @param aEnd one past the last index
+	 * @param aBody called as aBody(begin, end) for each part, from several threads at once
+	 */
+	template <class Body>
+	void parallelFor(size_t aBegin, size_t aEnd, Body & aBody)
+	{
+		if (aEnd <= aBegin)
+		{
+			return;
+		}
+
+		const size_t nparts = _threads.size() < (aEnd - aBegin) ? _threads.size() : (aEnd - aBegin);
+		if (nparts <= 1)
+		{
+			aBody(aBegin, aEnd);
+			return;
+		}
+
+		for (size_t part=0; part<nparts; part++)
+		{
+			add(new RangeJob<Body>(aBody, aBegin + (aEnd - aBegin) * part / nparts, aBegin + (aEnd - aBegin) * (part+1) / nparts));
+		}
+		wait();
+	}
+
+	/**
+	 * Get the number of jobs queued or running.
+	 */
+	unsigned int getNumPending();
+
+	/**
+	 * Get the number of worker threads.
+	 */
+	unsigned int getNumThreads() const	{	return _threads.size();	}
+
+protected:
+
+	class WorkerThread : public OpenThreads::Thread
+	{
+	public:
+		WorkerThread(WorkerPool * aPool) : _pool(aPool) {}
+		virtual void run();
+
+	private:
+		WorkerPool * _pool;
+	};
+
+	/**
+	 * One part of a parallelFor().
+	 */
+	template <class Body>
+	class RangeJob : public Job
+	{
+	public:
+		RangeJob(Body & aBody, size_t aBegin, size_t aEnd) : _body(aBody), _begin(aBegin), _end(aEnd) {}
+		virtual void run()	{	_body(_begin, _end);	}
+
+	private:
+		Body & _body;
+		size_t _begin, _end;
+	};
+
+	/**
+	 * Take the next job off the queue, blocking until one is available.
+	 * @return NULL if the pool is shutting down
+	 */
+	Job * takeJob();
+
+	/**
+	 * Mark a job taken by takeJob() as complete.
+	 */
+	void jobDone();
+
+private:
+	std::vector<WorkerThread*> _threads;
+	std::deque< osg::ref_ptr<Job> > _queue;
+	unsigned int _maxQueued;	/**< Queue length at which add() blocks, 0 for no limit. */
+	unsigned int _running;		/**< Jobs currently running. */
+	bool _stopping;
+	OpenThreads::Mutex _mutex;
+	OpenThreads::Condition _jobAvailable;	/**< Signalled when a job is queued or the pool stops. */
+	OpenThreads::Condition _spaceAvailable;	/**< Signalled when a job is taken off the queue. */
+	OpenThreads::Condition _idle;			/**< Signalled when a job finishes. */
+};
+
+#endif // WORKERPOOL_H_
@@ -0,0 +1,136 @@
+/*
+  DerivedQuantity
+
+  Hydraulic quantities derived from an sww file's stage and momentum.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <assert.h>
+
+#include "derivedquantity.h"
+
+// vertices shallower than this, in metres, are dry
+#define DERIVED_MIN_DEPTH 0.001f
+
+// depth below which speeds are damped, as ANUGA's velocity protection
+#define DERIVED_VELOCITY_H0 1.0e-6f
+
+#define DERIVED_GRAVITY 9.8f
+
+// speed added to the flow's in the hazard rating, m/s
+#define DERIVED_HAZARD_SPEED 0.5f
+
+
+static const char * s_names[DerivedQuantity::DQ_NUM_OF] = { "momentum", "velocity", "froude", "hazard" };
+static const char * s_units[DerivedQuantity::DQ_NUM_OF] = { "m^2/s", "m/s", "", "m^2/s" };
+static const float s_scales[DerivedQuantity::DQ_NUM_OF] = { 2.0f, 2.0f, 2.0f, 2.0f };
+
+
+const char * DerivedQuantity::getName(Type aType)
+{
+	assert(aType < DQ_NUM_OF);
+	return s_names[aType];
+}
+
+
+const char * DerivedQuantity::getUnits(Type aType)
+{
+	assert(aType < DQ_NUM_OF);
+	return s_units[aType];
+}
+
+
+float DerivedQuantity::getScale(Type aType)
+{
+	assert(aType < DQ_NUM_OF);
+	return s_scales[aType];
+}
+
+
+float DerivedQuantity::getMinDepth()
+{
+	return DERIVED_MIN_DEPTH;
+}
+
+
+float DerivedQuantity::speed(float aDepth, float aXMomentum, float aYMomentum)
+{
+	if (aDepth <= DERIVED_MIN_DEPTH)
+	{
+		return 0.0f;
+	}
+
+	return sqrtf(aXMomentum*aXMomentum + aYMomentum*aYMomentum) / (aDepth + DERIVED_VELOCITY_H0/aDepth);
+}
+
+
+void DerivedQuantity::compute(Type aType, size_t aNumPoints, const float * aStage, const float * aElevation,
+							  const float * aXMomentum, const float * aYMomentum, float * aOut)
+{
+	// one loop per quantity, so each stays simple enough to vectorise; dry vertices are
+	// selected away rather than branched around, and their depth kept off zero so the
+	// unused lanes never divide by it
+	size_t iv;
+	switch (aType)
+	{
+		case DQ_MOMENTUM:
+			for (iv = 0; iv < aNumPoints; iv++)
+			{
+				aOut[iv] = sqrtf(aXMomentum[iv]*aXMomentum[iv] + aYMomentum[iv]*aYMomentum[iv]);
+			}
+			break;
+
+		case DQ_VELOCITY:
+			for (iv = 0; iv < aNumPoints; iv++)
+			{
+				float h = aStage[iv] - aElevation[iv];
+				float hs = h > DERIVED_MIN_DEPTH ? h : DERIVED_MIN_DEPTH;
+				float u = sqrtf(aXMomentum[iv]*aXMomentum[iv] + aYMomentum[iv]*aYMomentum[iv]) / (hs + DERIVED_VELOCITY_H0/hs);
+				aOut[iv] = h > DERIVED_MIN_DEPTH ? u : 0.0f;
+			}
+			break;
+
+		case DQ_FROUDE:
+			for (iv = 0; iv < aNumPoints; iv++)
+			{
+				float h = aStage[iv] - aElevation[iv];
+				float hs = h > DERIVED_MIN_DEPTH ? h : DERIVED_MIN_DEPTH;
+				float u = sqrtf(aXMomentum[iv]*aXMomentum[iv] + aYMomentum[iv]*aYMomentum[iv]) / (hs + DERIVED_VELOCITY_H0/hs);
+				float fr = u / sqrtf(DERIVED_GRAVITY * hs);
+				aOut[iv] = h > DERIVED_MIN_DEPTH ? fr : 0.0f;
+			}
+			break;
+
+		case DQ_HAZARD:
+			for (iv = 0; iv < aNumPoints; iv++)
+			{
+				float h = aStage[iv] - aElevation[iv];
+				float hs = h > DERIVED_MIN_DEPTH ? h : DERIVED_MIN_DEPTH;
+				float u = sqrtf(aXMomentum[iv]*aXMomentum[iv] + aYMomentum[iv]*aYMomentum[iv]) / (hs + DERIVED_VELOCITY_H0/hs);
+				float hr = h * (u + DERIVED_HAZARD_SPEED);
+				aOut[iv] = h > DERIVED_MIN_DEPTH ? hr : 0.0f;
+			}
+			break;
+
+		default:
+			assert(0);
+			break;
+	}
+}
+
+
+void DerivedQuantity::computeVelocity(size_t aCount, const unsigned int * aVertices, const float * aStage, const float * aElevation,
+									  const float * aXMomentum, const float * aYMomentum, float * aU, float * aV)
+{
+	for (size_t i = 0; i < aCount; i++)
+	{
+		unsigned int iv = aVertices[i];
+		float h = aStage[iv] - aElevation[iv];
+		float hs = h > DERIVED_MIN_DEPTH ? h : DERIVED_MIN_DEPTH;
+		float scale = h > DERIVED_MIN_DEPTH ? 1.0f / (hs + DERIVED_VELOCITY_H0/hs) : 0.0f;
+		aU[i] = aXMomentum[iv] * scale;
+		aV[i] = aYMomentum[iv] * scale;
+	}
+}
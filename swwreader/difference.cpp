@@ -0,0 +1,391 @@
+/*
+  Difference
+
+  Per-vertex differences between two runs on the same mesh, over all their timesteps.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include <osg/Notify>
+#include <osgDB/FileNameUtils>
+#include <OpenThreads/ScopedLock>
+
+#include "sidecarcache.h"
+#include "difference.h"
+
+// sidecar of a run is named by adding the base's name and this
+#define DIFFERENCE_CACHE_SUFFIX ".difference"
+
+// output times closer than this, relative to the time, are the same
+#define DIFFERENCE_TIME_TOLERANCE 1.0e-4f
+
+// bump the version whenever the layout or meaning of the cache changes
+static const char DIFFERENCE_CACHE_MAGIC[8] = { 'S', 'W', 'W', 'D', 'I', 'F', '0', '1' };
+
+
+/**
+ * Read every frame of the run, handing each to the base pass.
+ */
+class Difference::ReadJob : public WorkerPool::Job
+{
+public:
+	ReadJob(Difference * aOwner, SWWReader * aRun) : _owner(aOwner), _run(aRun) {}
+
+	virtual void run()
+	{
+		RunVisitor visitor(_owner);
+		_run->readFrames(visitor);
+
+		// whether it read them all or not, the base pass has all it will get
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_owner->_slotMutex);
+		_owner->_runFinished = true;
+		_owner->_slotChanged.broadcast();
+	}
+
+private:
+	Difference * _owner;
+	SWWReader * _run;
+};
+
+
+Difference::Difference(unsigned int aNumThreads) :
+	_pool(aNumThreads),
+	_readPool(1),
+	_valid(false),
+	_fromCache(false),
+	_cache(NULL),
+	_produced(0),
+	_consumed(0),
+	_runFinished(false),
+	_baseStopped(false),
+	_frame(NULL),
+	_runFrame(NULL),
+	_numFrames(0)
+{
+}
+
+
+Difference::~Difference()
+{
+	delete _cache;
+}
+
+
+std::string Difference::getCacheFilename(const std::string & aBaseFilename, const std::string & aRunFilename)
+{
+	return aRunFilename + "." + osgDB::getSimpleFileName(aBaseFilename) + DIFFERENCE_CACHE_SUFFIX;
+}
+
+
+float Difference::getProgress() const
+{
+	return _numFrames ? (float) (unsigned int) _numFramesDone / _numFrames : 0.0f;
+}
+
+
+bool Difference::isComparable(SWWReader * aBase, SWWReader * aRun)
+{
+	MeshData * base = aBase->getMesh();
+	MeshData * run = aRun->getMesh();
+	if (!base || !run || ((base != run) && !base->isSameMesh(*run)))
+	{
+		osg::notify(osg::WARN) << "[Difference] " << aRun->getFilename() << " and " << aBase->getFilename() << " have different meshes" << std::endl;
+		return false;
+	}
+
+	// the same mesh in the same place
+	if (aBase->getGeoreferencedVertex(0) != aRun->getGeoreferencedVertex(0))
+	{
+		osg::notify(osg::WARN) << "[Difference] " << aRun->getFilename() << " and " << aBase->getFilename() << " are georeferenced differently" << std::endl;
+		return false;
+	}
+
+	const unsigned int ntimesteps = aBase->getNumberOfTimesteps();
+	if ((ntimesteps == 0) || (aRun->getNumberOfTimesteps() != ntimesteps))
+	{
+		osg::notify(osg::WARN) << "[Difference] " << aRun->getFilename() << " and " << aBase->getFilename() << " have different numbers of timesteps" << std::endl;
+		return false;
+	}
+
+	for (unsigned int t=0; t<ntimesteps; t++)
+	{
+		const float time = aBase->getTime(t);
+		if (fabs(aRun->getTime(t) - time) > DIFFERENCE_TIME_TOLERANCE * osg::maximum(1.0f, (float) fabs(time)))
+		{
+			osg::notify(osg::WARN) << "[Difference] " << aRun->getFilename() << " and " << aBase->getFilename() << " differ in the time of timestep " << t << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+void Difference::subtract(const float * aRun, const float * aBase, float * aOut, size_t aCount)
+{
+	for (size_t iv=0; iv<aCount; iv++)
+	{
+		aOut[iv] = aRun[iv] - aBase[iv];
+	}
+}
+
+
+void Difference::depth(const float * aStage, const float * aElevation, float * aOut, size_t aCount)
+{
+	// a select rather than a branch, so it vectorises as subtract() does
+	for (size_t iv=0; iv<aCount; iv++)
+	{
+		const float depth = aStage[iv] - aElevation[iv];
+		aOut[iv] = (depth > 0.0f) ? depth : 0.0f;
+	}
+}
+
+
+bool Difference::compute(SWWReader * aBase, SWWReader * aRun)
+{
+	if (!beginPass(aBase, aRun))
+	{
+		return _valid;
+	}
+
+	aBase->readFrames(*this);
+	return endPass();
+}
+
+
+bool Difference::beginPass(SWWReader * aBase, SWWReader * aRun)
+{
+	_valid = false;
+	_fromCache = false;
+	_cancelled.exchange(0);
+	_numFramesDone.exchange(0);
+	_numFrames = 0;
+
+	if (!isComparable(aBase, aRun))
+	{
+		return false;
+	}
+	_numFrames = aBase->getNumberOfTimesteps();
+
+	const size_t npoints = aBase->getNumberOfVertices();
+
+	delete _cache;
+	_cache = new SidecarCache(aRun->getFilename(), "." + osgDB::getSimpleFileName(aBase->getFilename()) + DIFFERENCE_CACHE_SUFFIX, DIFFERENCE_CACHE_MAGIC);
+	_cache->addSource(aBase->getFilename());
+	// a cache holds the whole run, a region or window is computed afresh
+	if (!aBase->isWholeRun() || !_cache->stamp(npoints))
+	{
+		delete _cache;
+		_cache = NULL;
+	}
+
+	if (_cache && _cache->read(getCacheArrays()))
+	{
+		_valid = true;
+		_fromCache = true;
+		_numFramesDone.exchange(_numFrames);
+		delete _cache;
+		_cache = NULL;
+		return false;
+	}
+
+	for (int q=0; q<DIFFERENCE_NUM_OF; q++)
+	{
+		_maximum[q].assign(npoints, 0.0f);
+		_timeOfMaximum[q].assign(npoints, 0.0f);
+	}
+
+	_produced = 0;
+	_consumed = 0;
+	_runFinished = false;
+	_baseStopped = false;
+
+	// the run on its own thread, the base on the caller's, meeting in visit()
+	_readPool.add(new ReadJob(this, aRun));
+	return true;
+}
+
+
+bool Difference::endPass()
+{
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slotMutex);
+		_baseStopped = true;
+		_slotChanged.broadcast();
+	}
+	_readPool.wait();
+
+	for (unsigned int i=0; i<DIFFERENCE_PIPELINE_DEPTH; i++)
+	{
+		std::vector<float>().swap(_slots[i]._stage);
+		std::vector<float>().swap(_slots[i]._elevation);
+	}
+
+	_valid = !_cancelled && ((unsigned int) _numFramesDone == _numFrames);
+	if (_valid && _cache)
+	{
+		_cache->write(getCacheArrays());
+	}
+
+	delete _cache;
+	_cache = NULL;
+	return _valid;
+}
+
+
+bool Difference::produce(const SWWReader::FrameData & aFrame)
+{
+	if (aFrame._timestep >= _numFrames)
+	{
+		return false;
+	}
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slotMutex);
+		while (!_baseStopped && (_produced - _consumed >= DIFFERENCE_PIPELINE_DEPTH))
+		{
+			_slotChanged.wait(&_slotMutex);
+		}
+
+		if (_baseStopped)
+		{
+			return false;
+		}
+	}
+
+	// free until _produced moves past it, so filled without the lock
+	Slot & slot = _slots[_produced % DIFFERENCE_PIPELINE_DEPTH];
+	slot._timestep = aFrame._timestep;
+	slot._stage.assign(aFrame._stage, aFrame._stage + aFrame._numPoints);
+	slot._elevation.assign(aFrame._elevation, aFrame._elevation + aFrame._numPoints);
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slotMutex);
+	++_produced;
+	_slotChanged.broadcast();
+	return true;
+}
+
+
+bool Difference::visit(const SWWReader::FrameData & aFrame)
+{
+	if (_cancelled || (aFrame._timestep >= _numFrames))
+	{
+		return false;
+	}
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slotMutex);
+		while ((_produced == _consumed) && !_runFinished)
+		{
+			_slotChanged.wait(&_slotMutex);
+		}
+
+		if (_produced == _consumed)
+		{
+			// the run ended early
+			return false;
+		}
+	}
+
+	const Slot & slot = _slots[_consumed % DIFFERENCE_PIPELINE_DEPTH];
+	if ((slot._timestep != aFrame._timestep) || (slot._stage.size() != aFrame._numPoints))
+	{
+		return false;
+	}
+
+	_frame = &aFrame;
+	_runFrame = &slot;
+	ReduceBody body(this);
+	_pool.parallelFor(0, aFrame._numPoints, body);
+	_frame = NULL;
+	_runFrame = NULL;
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_slotMutex);
+		++_consumed;
+		_slotChanged.broadcast();
+	}
+
+	++_numFramesDone;
+	return true;
+}
+
+
+void Difference::reduce(size_t aBegin, size_t aEnd)
+{
+	const SWWReader::FrameData & frame = *_frame;
+	const Slot & run = *_runFrame;
+	const float time = frame._time;
+	const size_t count = aEnd - aBegin;
+
+	// whole range at a time, so each pass is a simple loop
+	std::vector<float> stage(count), depth(count), basedepth(count);
+	subtract(&run._stage[aBegin], frame._stage + aBegin, &stage[0], count);
+	Difference::depth(&run._stage[aBegin], &run._elevation[aBegin], &depth[0], count);
+	Difference::depth(frame._stage + aBegin, frame._elevation + aBegin, &basedepth[0], count);
+	subtract(&depth[0], &basedepth[0], &depth[0], count);
+
+	float * maxdepth = &_maximum[DIFFERENCE_DEPTH][aBegin];
+	float * maxstage = &_maximum[DIFFERENCE_STAGE][aBegin];
+	float * depthtime = &_timeOfMaximum[DIFFERENCE_DEPTH][aBegin];
+	float * stagetime = &_timeOfMaximum[DIFFERENCE_STAGE][aBegin];
+
+	for (size_t i=0; i<count; i++)
+	{
+		// strictly greater, so the time kept is when the difference was first reached
+		if (fabs(depth[i]) > fabs(maxdepth[i]))
+		{
+			maxdepth[i] = depth[i];
+			depthtime[i] = time;
+		}
+
+		if (fabs(stage[i]) > fabs(maxstage[i]))
+		{
+			maxstage[i] = stage[i];
+			stagetime[i] = time;
+		}
+	}
+}
+
+
+std::vector< std::vector<float> * > Difference::getCacheArrays()
+{
+	std::vector< std::vector<float> * > arrays;
+	for (int q=0; q<DIFFERENCE_NUM_OF; q++)
+	{
+		arrays.push_back(&_maximum[q]);
+		arrays.push_back(&_timeOfMaximum[q]);
+	}
+	return arrays;
+}
+
+
+bool Difference::write(const std::string & aFilename, SWWReader * aReader) const
+{
+	FILE * file = fopen(aFilename.c_str(), "w");
+	if (!file)
+	{
+		osg::notify(osg::WARN) << "[Difference] Unable to write " << aFilename << std::endl;
+		return false;
+	}
+
+	fprintf(file, "x,y,depth,depthtime,stage,stagetime\n");
+	for (size_t iv=0; iv<_maximum[DIFFERENCE_DEPTH].size(); iv++)
+	{
+		// in double, a float northing being good to only half a metre
+		const osg::Vec2d location = aReader->getGeoreferencedVertex(iv);
+		fprintf(file, "%.3f,%.3f,%g,%g,%g,%g\n", location.x(), location.y(),
+				_maximum[DIFFERENCE_DEPTH][iv], _timeOfMaximum[DIFFERENCE_DEPTH][iv],
+				_maximum[DIFFERENCE_STAGE][iv], _timeOfMaximum[DIFFERENCE_STAGE][iv]);
+	}
+
+	if (fclose(file) != 0)
+	{
+		osg::notify(osg::WARN) << "[Difference] Unable to write " << aFilename << std::endl;
+		return false;
+	}
+
+	return true;
+}
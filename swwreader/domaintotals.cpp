@@ -0,0 +1,154 @@
+/*
+  DomainTotals
+
+  Wet area, water volume and peak depth of a whole sww file at each timestep.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <OpenThreads/ScopedLock>
+
+#include "domaintotals.h"
+
+
+static const char * s_names[DomainTotals::TOTAL_NUM_OF] = { "wet area", "volume", "max depth" };
+static const char * s_units[DomainTotals::TOTAL_NUM_OF] = { "m^2", "m^3", "m" };
+
+
+DomainTotals::DomainTotals(float aWetDepth, unsigned int aNumThreads, bool aLowPriority) :
+	_wetDepth(aWetDepth),
+	_lowPriority(aLowPriority),
+	_pool(aNumThreads, 0, aLowPriority ? OpenThreads::Thread::THREAD_PRIORITY_LOW : OpenThreads::Thread::THREAD_PRIORITY_DEFAULT),
+	_valid(false),
+	_frame(NULL),
+	_wetArea(0),
+	_volume(0),
+	_maxDepth(0),
+	_numFrames(0)
+{
+}
+
+
+const char * DomainTotals::getName(Quantity aQuantity)
+{
+	return s_names[aQuantity];
+}
+
+
+const char * DomainTotals::getUnits(Quantity aQuantity)
+{
+	return s_units[aQuantity];
+}
+
+
+float DomainTotals::getProgress() const
+{
+	return _numFrames ? (float) (unsigned int) _numFramesDone / _numFrames : 0.0f;
+}
+
+
+bool DomainTotals::compute(SWWReader * aReader)
+{
+	_valid = false;
+	_cancelled.exchange(0);
+	_numFramesDone.exchange(0);
+	_numFrames = aReader->getNumberOfTimesteps();
+
+	const size_t ntriangles = aReader->getNumberOfTriangles();
+	_triangles.assign(aReader->getTriangles(), aReader->getTriangles() + 3*ntriangles);
+	_areas = aReader->getTriangleAreas();
+
+	for (int q=0; q<TOTAL_NUM_OF; q++)
+	{
+		_total[q].assign(_numFrames, 0.0f);
+	}
+
+	if (!aReader->readFrames(*this, _lowPriority))
+	{
+		return false;
+	}
+
+	_valid = true;
+	return true;
+}
+
+
+bool DomainTotals::visit(const SWWReader::FrameData & aFrame)
+{
+	if (_cancelled || (aFrame._timestep >= _numFrames))
+	{
+		return false;
+	}
+
+	_frame = &aFrame;
+	_wetArea = 0.0;
+	_volume = 0.0;
+	_maxDepth = 0.0f;
+
+	SumBody body(this);
+	_pool.parallelFor(0, _areas.size(), body);
+	_frame = NULL;
+
+	_total[TOTAL_WET_AREA][aFrame._timestep] = (float) _wetArea;
+	_total[TOTAL_VOLUME][aFrame._timestep] = (float) _volume;
+	_total[TOTAL_MAX_DEPTH][aFrame._timestep] = _maxDepth;
+
+	// after the totals are stored, so a reader never sees the count ahead of them
+	++_numFramesDone;
+	return true;
+}
+
+
+void DomainTotals::sum(size_t aBegin, size_t aEnd)
+{
+	const SWWReader::FrameData & frame = *_frame;
+	const unsigned int * triangles = &_triangles[0];
+	const float * areas = &_areas[0];
+
+	double wetarea = 0.0;
+	double volume = 0.0;
+	float maxdepth = 0.0f;
+
+	for (size_t it=aBegin; it<aEnd; it++)
+	{
+		const unsigned int * tri = &triangles[3*it];
+		if (tri[0] >= frame._numPoints || tri[1] >= frame._numPoints || tri[2] >= frame._numPoints)
+		{
+			continue;
+		}
+
+		float depthsum = 0.0f;
+		int numwet = 0;
+		for (int k=0; k<3; k++)
+		{
+			const float depth = frame._stage[tri[k]] - frame._elevation[tri[k]];
+			if (depth <= 0.0f)
+			{
+				continue;
+			}
+
+			// all the water counts to the volume, only the wet depth to the wet area
+			depthsum += depth;
+			if (depth > _wetDepth)
+			{
+				numwet++;
+			}
+			if (depth > maxdepth)
+			{
+				maxdepth = depth;
+			}
+		}
+
+		wetarea += areas[it] * numwet / 3.0;
+		volume += areas[it] * depthsum / 3.0;
+	}
+
+	// one lock per part, a handful a frame
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_sumMutex);
+	_wetArea += wetarea;
+	_volume += volume;
+	if (maxdepth > _maxDepth)
+	{
+		_maxDepth = maxdepth;
+	}
+}
@@ -0,0 +1,189 @@
+/*
+  Envelope
+
+  Per-vertex maxima of an sww file over all its timesteps.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <float.h>
+#include <osg/Notify>
+
+#include "derivedquantity.h"
+#include "sidecarcache.h"
+#include "envelope.h"
+
+// sidecar of an sww file is named by adding this
+#define ENVELOPE_CACHE_SUFFIX ".envelope"
+
+// bump the version whenever the layout or meaning of the cache changes
+static const char ENVELOPE_CACHE_MAGIC[8] = { 'S', 'W', 'W', 'E', 'N', 'V', '0', '3' };
+
+
+Envelope::Envelope(unsigned int aNumThreads) :
+	_pool(aNumThreads),
+	_valid(false),
+	_fromCache(false),
+	_cache(NULL),
+	_frame(NULL),
+	_numFrames(0)
+{
+}
+
+
+Envelope::~Envelope()
+{
+	delete _cache;
+}
+
+
+std::string Envelope::getCacheFilename(const std::string & aFilename)
+{
+	return aFilename + ENVELOPE_CACHE_SUFFIX;
+}
+
+
+float Envelope::getProgress() const
+{
+	return _numFrames ? (float) (unsigned int) _numFramesDone / _numFrames : 0.0f;
+}
+
+
+bool Envelope::compute(SWWReader * aReader)
+{
+	if (!beginPass(aReader))
+	{
+		return _valid;
+	}
+
+	return endPass(aReader->readFrames(*this));
+}
+
+
+bool Envelope::beginPass(SWWReader * aReader)
+{
+	_valid = false;
+	_fromCache = false;
+	_cancelled.exchange(0);
+	_numFramesDone.exchange(0);
+	_numFrames = aReader->getNumberOfTimesteps();
+
+	const std::string filename = aReader->getFilename();
+	const size_t npoints = aReader->getNumberOfVertices();
+
+	delete _cache;
+	_cache = new SidecarCache(filename, ENVELOPE_CACHE_SUFFIX, ENVELOPE_CACHE_MAGIC);
+	// a cache holds the whole run, a region or window is computed afresh
+	if (!aReader->isWholeRun() || !_cache->stamp(npoints))
+	{
+		delete _cache;
+		_cache = NULL;
+	}
+
+	if (_cache && _cache->read(getCacheArrays()))
+	{
+		_valid = true;
+		_fromCache = true;
+		_numFramesDone.exchange(_numFrames);
+		delete _cache;
+		_cache = NULL;
+		return false;
+	}
+
+	for (int q=0; q<ENVELOPE_NUM_OF; q++)
+	{
+		// speed stays zero in files without momentum
+		_maximum[q].assign(npoints, (q == ENVELOPE_SPEED) ? 0.0f : -FLT_MAX);
+		_timeOfMaximum[q].assign(npoints, 0.0f);
+	}
+
+	return true;
+}
+
+
+bool Envelope::endPass(bool aRead)
+{
+	_valid = aRead && !_cancelled;
+	if (_valid && _cache)
+	{
+		_cache->write(getCacheArrays());
+	}
+
+	delete _cache;
+	_cache = NULL;
+	return _valid;
+}
+
+
+bool Envelope::visit(const SWWReader::FrameData & aFrame)
+{
+	if (_cancelled)
+	{
+		return false;
+	}
+
+	_frame = &aFrame;
+	ReduceBody body(this);
+	_pool.parallelFor(0, aFrame._numPoints, body);
+	_frame = NULL;
+
+	++_numFramesDone;
+	return true;
+}
+
+
+void Envelope::reduce(size_t aBegin, size_t aEnd)
+{
+	const SWWReader::FrameData & frame = *_frame;
+	const float time = frame._time;
+
+	float * maxdepth = &_maximum[ENVELOPE_DEPTH][0];
+	float * maxspeed = &_maximum[ENVELOPE_SPEED][0];
+	float * maxstage = &_maximum[ENVELOPE_STAGE][0];
+
+	for (size_t iv=aBegin; iv<aEnd; iv++)
+	{
+		const float stage = frame._stage[iv];
+		float depth = stage - frame._elevation[iv];
+		if (depth < 0.0f)
+		{
+			depth = 0.0f;
+		}
+
+		// strictly greater, so the time kept is when the maximum was first reached
+		if (depth > maxdepth[iv])
+		{
+			maxdepth[iv] = depth;
+			_timeOfMaximum[ENVELOPE_DEPTH][iv] = time;
+		}
+
+		if (stage > maxstage[iv])
+		{
+			maxstage[iv] = stage;
+			_timeOfMaximum[ENVELOPE_STAGE][iv] = time;
+		}
+
+		if (frame._xmomentum)
+		{
+			// as the water surface shows it, so the two agree on what is dry
+			const float u = DerivedQuantity::speed(depth, frame._xmomentum[iv], frame._ymomentum[iv]);
+			if (u > maxspeed[iv])
+			{
+				maxspeed[iv] = u;
+				_timeOfMaximum[ENVELOPE_SPEED][iv] = time;
+			}
+		}
+	}
+}
+
+
+std::vector< std::vector<float> * > Envelope::getCacheArrays()
+{
+	std::vector< std::vector<float> * > arrays;
+	for (int q=0; q<ENVELOPE_NUM_OF; q++)
+	{
+		arrays.push_back(&_maximum[q]);
+		arrays.push_back(&_timeOfMaximum[q]);
+	}
+	return arrays;
+}
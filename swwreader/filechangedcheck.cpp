@@ -1,17 +1,180 @@
 #include <iostream>
 #include <sys/stat.h>
+#include <OpenThreads/Thread>
+
+#if defined(__linux__)
+	#define FILECHANGED_INOTIFY
+	#include <errno.h>
+	#include <poll.h>
+	#include <unistd.h>
+	#include <sys/inotify.h>
+	#include <sys/vfs.h>
+#endif
 
 #include "filechangedcheck.h"
 
+// longest a watcher thread takes to notice it is being stopped, milliseconds
+#define FILECHANGED_STOP_CHECK_MS 100
+
+#ifdef FILECHANGED_INOTIFY
+// filesystems whose changes made by other machines inotify never hears of
+static const long s_remoteFilesystems[] =
+{
+	0x6969,		// NFS
+	0x517B,		// SMB
+	0xFF534D42,	// CIFS
+	0xFE534D42,	// SMB2
+	0x65735546,	// FUSE, eg. sshfs
+	0x73757245,	// Coda
+	0x5346414F,	// AFS
+	0x01021997	// 9P
+};
+
+// changes to a file in the watched directory, including its replacement
+#define FILECHANGED_INOTIFY_MASK (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+
+/**
+ * Watches a file from a thread of its own, setting the owner's flag on each change.
+ * It waits on inotify if its owner has a descriptor, otherwise polls with stat().
+ */
+class FileChangedCheck::Watcher : public OpenThreads::Thread
+{
+public:
+	Watcher(FileChangedCheck * aOwner, const std::string & aName, unsigned int aPollMs) :
+		_owner(aOwner),
+		_name(aName),
+		_pollMs(aPollMs)
+	{
+	}
+
+	virtual void run()
+	{
+#ifdef FILECHANGED_INOTIFY
+		if (_owner->_notifyFd >= 0)
+		{
+			runNotify();
+			return;
+		}
+#endif
+		runPoll();
+	}
+
+private:
+	void runPoll()
+	{
+		unsigned int waited = 0;
+		while (!_owner->_stopping)
+		{
+			// short sleeps, so a stop isn't held up by a long interval
+			OpenThreads::Thread::microSleep(FILECHANGED_STOP_CHECK_MS * 1000);
+			waited += FILECHANGED_STOP_CHECK_MS;
+			if (waited < _pollMs)
+			{
+				continue;
+			}
+			waited = 0;
+
+			if (_owner->statChanged())
+			{
+				_owner->_changed.exchange(1);
+			}
+		}
+	}
+
+#ifdef FILECHANGED_INOTIFY
+	void runNotify()
+	{
+		union
+		{
+			struct inotify_event event;
+			char bytes[4096];
+		} buffer;
+
+		while (!_owner->_stopping)
+		{
+			struct pollfd pfd;
+			pfd.fd = _owner->_notifyFd;
+			pfd.events = POLLIN;
+			pfd.revents = 0;
+			if (::poll(&pfd, 1, FILECHANGED_STOP_CHECK_MS) <= 0)
+			{
+				continue;
+			}
+
+			const ssize_t length = read(_owner->_notifyFd, buffer.bytes, sizeof(buffer));
+			if (length <= 0)
+			{
+				continue;
+			}
+
+			// the whole directory is watched, only events naming the file count
+			bool changed = false;
+			for (ssize_t offset = 0; offset < length; )
+			{
+				const struct inotify_event * event = (const struct inotify_event *) (buffer.bytes + offset);
+				if ((event->mask & IN_Q_OVERFLOW) || (event->len && (_name == event->name)))
+				{
+					changed = true;
+				}
+				offset += sizeof(struct inotify_event) + event->len;
+			}
+
+			if (changed)
+			{
+				// brings the stat up to date for a later return to synchronous checks
+				_owner->statChanged();
+				_owner->_changed.exchange(1);
+			}
+		}
+	}
+#endif
+
+private:
+	FileChangedCheck * _owner;
+	std::string _name;	/**< File name within its directory */
+	unsigned int _pollMs;
+};
+
+
 FileChangedCheck::FileChangedCheck()	:
 	_exists(false),
 	_modificationTime(0),
-	_oldLength(0)
+	_oldLength(0),
+	_watcher(NULL),
+	_notifyFd(-1),
+	_recheckPending(false),
+	_recheckAt(0),
+	_recheckDelayMs(0)
 {
 }
 
+
+FileChangedCheck::FileChangedCheck(const std::string & aFilename)	:
+	_exists(false),
+	_modificationTime(0),
+	_oldLength(0),
+	_watcher(NULL),
+	_notifyFd(-1),
+	_recheckPending(false),
+	_recheckAt(0),
+	_recheckDelayMs(0)
+{
+	watch(aFilename);
+}
+
+
+FileChangedCheck::~FileChangedCheck()
+{
+	stopWatcher();
+}
+
+
 bool FileChangedCheck::watch(const std::string & aFilename)
 {
+	stopWatcher();
+
 	struct stat buf;
 
 	// Check file exists
@@ -22,15 +185,108 @@ bool FileChangedCheck::watch(const std::string & aFilename)
 	}
 
 	_filename = aFilename;
-	_modificationTime = buf.st_mtime;
-	_oldLength = buf.st_size;
+	setStat(buf);
 	_exists = true;
 
 	return true;
 }
 
 
+bool FileChangedCheck::watchAsync(const std::string & aFilename, unsigned int aPollMs, bool aAllowNotify)
+{
+	const bool exists = watch(aFilename);
+	_filename = aFilename;
+	_changed.exchange(0);
+	_stopping.exchange(0);
+
+	// the directory is watched rather than the file, so a replaced file is still seen
+	std::string directory = ".";
+	std::string name = aFilename;
+	const std::string::size_type slash = aFilename.find_last_of("/\\");
+	if (slash != std::string::npos)
+	{
+		directory = aFilename.substr(0, slash+1);
+		name = aFilename.substr(slash+1);
+	}
+
+#ifdef FILECHANGED_INOTIFY
+	struct statfs fs;
+	bool remote = (statfs(directory.c_str(), &fs) != 0);
+	for (size_t i=0; !remote && i<sizeof(s_remoteFilesystems)/sizeof(s_remoteFilesystems[0]); i++)
+	{
+		remote = ((unsigned long) fs.f_type == (unsigned long) s_remoteFilesystems[i]);
+	}
+
+	if (aAllowNotify && !remote)
+	{
+		_notifyFd = inotify_init();
+		if ((_notifyFd >= 0) && (inotify_add_watch(_notifyFd, directory.c_str(), FILECHANGED_INOTIFY_MASK) < 0))
+		{
+			close(_notifyFd);
+			_notifyFd = -1;
+		}
+	}
+#endif
+
+	_watcher = new Watcher(this, name, aPollMs);
+	_watcher->start();
+
+	return exists;
+}
+
+
+void FileChangedCheck::stopWatcher()
+{
+	if (_watcher)
+	{
+		_stopping.exchange(1);
+		_watcher->join();
+		delete _watcher;
+		_watcher = NULL;
+	}
+
+#ifdef FILECHANGED_INOTIFY
+	if (_notifyFd >= 0)
+	{
+		close(_notifyFd);
+	}
+#endif
+	_notifyFd = -1;
+}
+
+
 bool FileChangedCheck::isChanged()
+{
+	// asked to check again, or seen by the watcher
+	bool flagged = (_changed.exchange(0) != 0);
+	if (_recheckPending && (osg::Timer::instance()->delta_m(_recheckAt, osg::Timer::instance()->tick()) >= _recheckDelayMs))
+	{
+		flagged = true;
+	}
+
+	if (!_watcher && !_filename.empty())
+	{
+		flagged = statChanged() || flagged;
+	}
+
+	// a change seen stands in for any recheck still to come
+	if (flagged)
+	{
+		_recheckPending = false;
+	}
+	return flagged;
+}
+
+
+void FileChangedCheck::recheckAfter(unsigned int aDelayMs)
+{
+	_recheckPending = true;
+	_recheckAt = osg::Timer::instance()->tick();
+	_recheckDelayMs = aDelayMs;
+}
+
+
+bool FileChangedCheck::statChanged()
 {
 	struct stat buf;
 
@@ -50,15 +306,28 @@ bool FileChangedCheck::isChanged()
 	if (_exists == false)
 	{
 		// File was newly created
+		_exists = true;
+		setStat(buf);
 		return true;
 	}
 
-	if ((_modificationTime != buf.st_mtime) || (_oldLength != buf.st_size))
-	{
-		_modificationTime = buf.st_mtime;
-		_oldLength = buf.st_size;
-		return true;
-	}
+	const long long modificationTime = _modificationTime;
+	const long long length = _oldLength;
+	setStat(buf);
+	return (_modificationTime != modificationTime) || (_oldLength != length);
+}
 
-	return false;
+
+void FileChangedCheck::setStat(const struct stat & aStat)
+{
+	// to the nanosecond where the system keeps it, as a write within the same second
+	// that leaves the length alone is otherwise missed
+#if defined(__linux__)
+	_modificationTime = (long long) aStat.st_mtim.tv_sec * 1000000000LL + aStat.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+	_modificationTime = (long long) aStat.st_mtimespec.tv_sec * 1000000000LL + aStat.st_mtimespec.tv_nsec;
+#else
+	_modificationTime = (long long) aStat.st_mtime * 1000000000LL;
+#endif
+	_oldLength = (long long) aStat.st_size;
 }
@@ -0,0 +1,85 @@
+/*
+  FrameCache
+
+  Recently read timesteps of an sww file.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include "framecache.h"
+
+
+const float * FrameCache::Frame::getDerived(DerivedQuantity::Type aType, const float * aElevation)
+{
+	if (_xmomentum.empty() || _ymomentum.empty())
+	{
+		return NULL;
+	}
+
+	std::vector<float> & values = _derived[aType];
+	if (values.empty())
+	{
+		values.resize(_stage.size());
+		DerivedQuantity::compute(aType, _stage.size(), &_stage[0], aElevation, &_xmomentum[0], &_ymomentum[0], &values[0]);
+	}
+
+	return &values[0];
+}
+
+
+FrameCache::FrameCache(size_t aCapacity) :
+	_capacity(aCapacity)
+{
+}
+
+
+FrameCache::Frame * FrameCache::find(unsigned int aTimestep)
+{
+	std::map<unsigned int, FrameList::iterator>::iterator found = _index.find(aTimestep);
+	if (found == _index.end())
+	{
+		return NULL;
+	}
+
+	// move to the front, list iterators stay valid
+	_frames.splice(_frames.begin(), _frames, found->second);
+	return _frames.front().get();
+}
+
+
+void FrameCache::insert(Frame * aFrame)
+{
+	std::map<unsigned int, FrameList::iterator>::iterator found = _index.find(aFrame->_timestep);
+	if (found != _index.end())
+	{
+		_frames.erase(found->second);
+	}
+
+	_frames.push_front(aFrame);
+	_index[aFrame->_timestep] = _frames.begin();
+	trim();
+}
+
+
+void FrameCache::clear()
+{
+	_frames.clear();
+	_index.clear();
+}
+
+
+void FrameCache::setCapacity(size_t aCapacity)
+{
+	_capacity = aCapacity;
+	trim();
+}
+
+
+void FrameCache::trim()
+{
+	while (_frames.size() > _capacity)
+	{
+		_index.erase(_frames.back()->_timestep);
+		_frames.pop_back();
+	}
+}
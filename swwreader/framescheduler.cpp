@@ -0,0 +1,199 @@
+/*
+  FrameScheduler
+
+  Frames of an sww file read in the background, most urgent first.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <osg/Math>
+#include <OpenThreads/ScopedLock>
+
+#include "swwreader.h"
+#include "framescheduler.h"
+
+
+FrameRequest::FrameRequest(unsigned int aTimestep, int aPriority, unsigned int aOrder) :
+	_timestep(aTimestep),
+	_priority(aPriority),
+	_order(aOrder),
+	_started(false)
+{
+}
+
+
+void FrameRequest::cancel()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	if (!_started && !_done)
+	{
+		_cancelled.exchange(1);
+		_done.exchange(1);
+		_finished.broadcast();
+	}
+}
+
+
+const FrameCache::Frame * FrameRequest::wait()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	while (!_done)
+	{
+		_finished.wait(&_mutex);
+	}
+	return _frame.get();
+}
+
+
+bool FrameRequest::start()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	if (_done)
+	{
+		return false;
+	}
+	_started = true;
+	return true;
+}
+
+
+void FrameRequest::finish(FrameCache::Frame * aFrame)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	_frame = aFrame;
+	_done.exchange(1);
+	_finished.broadcast();
+}
+
+
+bool FrameRequest::isBefore(const FrameRequest & aOther) const
+{
+	if (_priority != aOther._priority)
+	{
+		return _priority > aOther._priority;
+	}
+	return _order < aOther._order;
+}
+
+
+/**
+ * Read whichever request is most urgent when a thread comes free, rather than the one
+ * it was added for.
+ */
+class FrameScheduler::ReadJob : public WorkerPool::Job
+{
+public:
+	ReadJob(FrameScheduler * aOwner) : _owner(aOwner) {}
+
+	virtual void run()
+	{
+		osg::ref_ptr<FrameRequest> request = _owner->takeNext();
+		if (request.valid())
+		{
+			osg::ref_ptr<FrameCache::Frame> frame = _owner->_reader->loadFrame(request->getTimestep());
+			request->finish(frame.get());
+		}
+	}
+
+private:
+	FrameScheduler * _owner;
+};
+
+
+FrameScheduler::FrameScheduler(SWWReader * aReader, unsigned int aNumThreads) :
+	_reader(aReader),
+	_numAsked(0),
+	_pool(aNumThreads)
+{
+}
+
+
+FrameScheduler::~FrameScheduler()
+{
+	cancelAll();
+	_pool.wait();
+}
+
+
+osg::ref_ptr<FrameRequest> FrameScheduler::request(unsigned int aTimestep, int aPriority)
+{
+	osg::ref_ptr<FrameRequest> request;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+		// asked for again before it was read
+		for (size_t i=0; i<_waiting.size(); i++)
+		{
+			FrameRequest * waiting = _waiting[i].get();
+			if ((waiting->getTimestep() == aTimestep) && !waiting->isDone())
+			{
+				waiting->_priority = osg::maximum(waiting->_priority, aPriority);
+				return waiting;
+			}
+		}
+
+		request = new FrameRequest(aTimestep, aPriority, _numAsked++);
+		_waiting.push_back(request);
+	}
+
+	// there are always at least as many jobs as requests waiting
+	_pool.add(new ReadJob(this));
+	return request;
+}
+
+
+void FrameScheduler::cancelAll()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	for (size_t i=0; i<_waiting.size(); i++)
+	{
+		_waiting[i]->cancel();
+	}
+	_waiting.clear();
+}
+
+
+unsigned int FrameScheduler::getNumWaiting()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	return _waiting.size();
+}
+
+
+osg::ref_ptr<FrameRequest> FrameScheduler::takeNext()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	// cancelled requests go without being read
+	osg::ref_ptr<FrameRequest> next;
+	size_t inext = 0;
+	size_t kept = 0;
+	for (size_t i=0; i<_waiting.size(); i++)
+	{
+		FrameRequest * waiting = _waiting[i].get();
+		if (waiting->isDone())
+		{
+			continue;
+		}
+		if (!next.valid() || waiting->isBefore(*next))
+		{
+			next = waiting;
+			inext = kept;
+		}
+		_waiting[kept++] = waiting;
+	}
+	_waiting.resize(kept);
+
+	if (!next.valid())
+	{
+		return NULL;
+	}
+	_waiting.erase(_waiting.begin() + inext);
+
+	// cancelled since it was chosen
+	if (!next->start())
+	{
+		return NULL;
+	}
+	return next;
+}
@@ -0,0 +1,224 @@
+/*
+  Inundation
+
+  When each vertex of an sww file first floods, and for how long.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <osg/Notify>
+
+#include "sidecarcache.h"
+#include "inundation.h"
+
+// sidecar of an sww file is named by adding this
+#define INUNDATION_CACHE_SUFFIX ".inundation"
+
+// bump the version whenever the layout or meaning of the cache changes
+static const char INUNDATION_CACHE_MAGIC[8] = { 'S', 'W', 'W', 'I', 'N', 'U', '0', '1' };
+
+
+Inundation::Inundation(float aThreshold, unsigned int aNumThreads) :
+	_threshold(aThreshold),
+	_pool(aNumThreads),
+	_valid(false),
+	_fromCache(false),
+	_cache(NULL),
+	_frame(NULL),
+	_lastTime(0),
+	_numFrames(0)
+{
+}
+
+
+Inundation::~Inundation()
+{
+	delete _cache;
+}
+
+
+std::string Inundation::getCacheFilename(const std::string & aFilename)
+{
+	return aFilename + INUNDATION_CACHE_SUFFIX;
+}
+
+
+float Inundation::getProgress() const
+{
+	return _numFrames ? (float) (unsigned int) _numFramesDone / _numFrames : 0.0f;
+}
+
+
+bool Inundation::compute(SWWReader * aReader)
+{
+	if (!beginPass(aReader))
+	{
+		return _valid;
+	}
+
+	return endPass(aReader->readFrames(*this));
+}
+
+
+bool Inundation::beginPass(SWWReader * aReader)
+{
+	_valid = false;
+	_fromCache = false;
+	_cancelled.exchange(0);
+	_numFramesDone.exchange(0);
+	_numFrames = aReader->getNumberOfTimesteps();
+
+	const size_t npoints = aReader->getNumberOfVertices();
+
+	delete _cache;
+	_cache = new SidecarCache(aReader->getFilename(), INUNDATION_CACHE_SUFFIX, INUNDATION_CACHE_MAGIC, _threshold);
+	// a cache holds the whole run, a region or window is computed afresh
+	if (!aReader->isWholeRun() || !_cache->stamp(npoints))
+	{
+		delete _cache;
+		_cache = NULL;
+	}
+
+	if (_cache && _cache->read(getCacheArrays()))
+	{
+		_valid = true;
+		_fromCache = true;
+		_numFramesDone.exchange(_numFrames);
+		delete _cache;
+		_cache = NULL;
+		return false;
+	}
+
+	_arrival.assign(npoints, getNever());
+	_duration.assign(npoints, 0.0f);
+	_lastDepth.assign(npoints, 0.0f);
+
+	return true;
+}
+
+
+bool Inundation::endPass(bool aRead)
+{
+	std::vector<float>().swap(_lastDepth);
+
+	_valid = aRead && !_cancelled;
+	if (_valid && _cache)
+	{
+		_cache->write(getCacheArrays());
+	}
+
+	delete _cache;
+	_cache = NULL;
+	return _valid;
+}
+
+
+std::vector< std::vector<float> * > Inundation::getCacheArrays()
+{
+	std::vector< std::vector<float> * > arrays;
+	arrays.push_back(&_arrival);
+	arrays.push_back(&_duration);
+	return arrays;
+}
+
+
+bool Inundation::visit(const SWWReader::FrameData & aFrame)
+{
+	if (_cancelled)
+	{
+		return false;
+	}
+
+	_frame = &aFrame;
+	AccumulateBody body(this);
+	_pool.parallelFor(0, aFrame._numPoints, body);
+	_frame = NULL;
+
+	_lastTime = aFrame._time;
+	++_numFramesDone;
+	return true;
+}
+
+
+void Inundation::accumulate(size_t aBegin, size_t aEnd)
+{
+	const SWWReader::FrameData & frame = *_frame;
+	const bool first = (frame._timestep == 0);
+	const float time = frame._time;
+	const float dt = time - _lastTime;
+
+	for (size_t iv=aBegin; iv<aEnd; iv++)
+	{
+		const float depth = frame._stage[iv] - frame._elevation[iv];
+		const float last = _lastDepth[iv];
+		_lastDepth[iv] = depth;
+
+		const bool wet = depth > _threshold;
+		if (first)
+		{
+			if (wet)
+			{
+				_arrival[iv] = time;
+			}
+			continue;
+		}
+
+		const bool wasWet = last > _threshold;
+		if (!wet && !wasWet)
+		{
+			continue;
+		}
+
+		// where in the step the depth crossed the threshold, if it did
+		float crossing = 0.0f;
+		if (wet != wasWet)
+		{
+			crossing = (_threshold - last) / (depth - last);
+		}
+
+		if (wet && !wasWet)
+		{
+			if (_arrival[iv] < 0.0f)
+			{
+				_arrival[iv] = _lastTime + crossing*dt;
+			}
+			_duration[iv] += (1.0f - crossing)*dt;
+		}
+		else if (!wet)
+		{
+			_duration[iv] += crossing*dt;
+		}
+		else
+		{
+			_duration[iv] += dt;
+		}
+	}
+}
+
+
+bool Inundation::write(const std::string & aFilename, SWWReader * aReader) const
+{
+	FILE * file = fopen(aFilename.c_str(), "w");
+	if (!file)
+	{
+		osg::notify(osg::WARN) << "[Inundation] Unable to write " << aFilename << std::endl;
+		return false;
+	}
+
+	fprintf(file, "x,y,arrival,duration\n");
+	for (size_t iv=0; iv<_arrival.size(); iv++)
+	{
+		// in double, a float northing being good to only half a metre
+		const osg::Vec2d location = aReader->getGeoreferencedVertex(iv);
+		fprintf(file, "%.3f,%.3f,%g,%g\n", location.x(), location.y(), _arrival[iv], _duration[iv]);
+	}
+
+	if (fclose(file) != 0)
+	{
+		osg::notify(osg::WARN) << "[Inundation] Unable to write " << aFilename << std::endl;
+		return false;
+	}
+
+	return true;
+}
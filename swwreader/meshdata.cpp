@@ -0,0 +1,103 @@
+/*
+  MeshData
+
+  The static mesh of an sww file, shared by the readers of runs on the same mesh.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "meshdata.h"
+
+
+MeshData::MeshData(size_t aNumPoints, size_t aNumTriangles) :
+	_numPoints(aNumPoints),
+	_numTriangles(aNumTriangles),
+	_x(new float[aNumPoints]),
+	_y(new float[aNumPoints]),
+	_triangles(new unsigned int[3*aNumTriangles])
+{
+}
+
+
+MeshData::~MeshData()
+{
+	delete [] _x;
+	delete [] _y;
+	delete [] _triangles;
+}
+
+
+void MeshData::build()
+{
+	// loop index
+	size_t iv;
+	// vertex indices
+	unsigned int v1index, v2index, v3index;
+
+	// compute triangle connectivity, a list (indexed by vertex number)
+	// of lists (indices of triangles sharing this vertex)
+	_connectivity = std::vector<triangle_list>(_numPoints);
+	for (iv=0; iv < _numTriangles; iv++)
+	{
+		v1index = _triangles[3*iv+0];
+		v2index = _triangles[3*iv+1];
+		v3index = _triangles[3*iv+2];
+
+		if (v1index<_numPoints)
+		{
+			_connectivity.at(v1index).push_back(iv);
+		}
+
+		if (v2index<_numPoints)
+		{
+			_connectivity.at(v2index).push_back(iv);
+		}
+
+		if (v3index<_numPoints)
+		{
+			_connectivity.at(v3index).push_back(iv);
+		}
+	}
+
+
+	// plan areas, for totals over the domain
+	_triangleAreas.assign(_numTriangles, 0.0f);
+	for (iv=0; iv < _numTriangles; iv++)
+	{
+		v1index = _triangles[3*iv+0];
+		v2index = _triangles[3*iv+1];
+		v3index = _triangles[3*iv+2];
+
+		if (v1index<_numPoints && v2index<_numPoints && v3index<_numPoints)
+		{
+			const double cross = ((double) _x[v2index] - _x[v1index]) * ((double) _y[v3index] - _y[v1index]) -
+								 ((double) _x[v3index] - _x[v1index]) * ((double) _y[v2index] - _y[v1index]);
+			_triangleAreas[iv] = (float) (0.5 * fabs(cross));
+		}
+	}
+
+
+	// spatial index for locating points and picking
+	_triangleGrid.build(_x, _y, _numPoints, _triangles, _numTriangles);
+
+
+	// bedslope index array, triangles array indexes into x, y and z
+	_indices = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, 3*_numTriangles);
+	for (iv=0; iv < 3*_numTriangles; iv++)
+		(*_indices)[iv] = _triangles[iv];
+}
+
+
+bool MeshData::isSameMesh(const MeshData & aOther) const
+{
+	// bitwise, as runs on one mesh write the same values
+	return (_numPoints == aOther._numPoints) &&
+		   (_numTriangles == aOther._numTriangles) &&
+		   (memcmp(_x, aOther._x, _numPoints*sizeof(float)) == 0) &&
+		   (memcmp(_y, aOther._y, _numPoints*sizeof(float)) == 0) &&
+		   (memcmp(_triangles, aOther._triangles, 3*_numTriangles*sizeof(unsigned int)) == 0);
+}
+
@@ -0,0 +1,788 @@
+/*
+  PartitionedSWWReader
+
+  Reads the per-processor sww files of a parallel ANUGA run as one mesh.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <map>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <netcdf.h>
+#include <osg/Notify>
+#include <OpenThreads/ScopedLock>
+
+#include "partitionedswwreader.h"
+
+
+/**
+ * Check that a string is all digits.
+ */
+static bool isNumber(const std::string & aString)
+{
+	return !aString.empty() && (aString.find_first_not_of("0123456789") == std::string::npos);
+}
+
+
+/**
+ * Read the whole of a variable by name.
+ */
+static int getVariable(int aNcid, const char * aName, float * aValues)
+{
+	int varid;
+	int status = nc_inq_varid(aNcid, aName, &varid);
+	return (status == NC_NOERR) ? nc_get_var_float(aNcid, varid, aValues) : status;
+}
+
+
+static int getVariable(int aNcid, const char * aName, int * aValues)
+{
+	int varid;
+	int status = nc_inq_varid(aNcid, aName, &varid);
+	return (status == NC_NOERR) ? nc_get_var_int(aNcid, varid, aValues) : status;
+}
+
+
+/**
+ * Check whether an open file is netcdf-4, stored by HDF5, which can't be read from two
+ * threads at once even in separate files.
+ */
+static bool isNetCDF4(int aNcid)
+{
+#ifdef NC_FORMAT_NETCDF4
+	int format;
+	return (nc_inq_format(aNcid, &format) != NC_NOERR) || (format == NC_FORMAT_NETCDF4) || (format == NC_FORMAT_NETCDF4_CLASSIC);
+#else
+	// a netcdf 3 library only reads netcdf-3 files
+	return false;
+#endif
+}
+
+
+bool PartitionedSWWReader::getPartitionFilenames(const std::string & aFilename, std::vector<std::string> & aFilenames)
+{
+	// <name>_P<k>_<n>.sww
+	const std::string extension = ".sww";
+	if ((aFilename.size() <= extension.size()) ||
+		(aFilename.compare(aFilename.size() - extension.size(), extension.size(), extension) != 0))
+	{
+		return false;
+	}
+
+	const std::string stem = aFilename.substr(0, aFilename.size() - extension.size());
+	const size_t countpos = stem.rfind('_');
+	if ((countpos == std::string::npos) || (countpos == 0))
+	{
+		return false;
+	}
+
+	const size_t procpos = stem.rfind('_', countpos - 1);
+	if (procpos == std::string::npos)
+	{
+		return false;
+	}
+
+	const std::string proc = stem.substr(procpos + 1, countpos - procpos - 1);
+	const std::string count = stem.substr(countpos + 1);
+	if ((proc.size() < 2) || (proc[0] != 'P') || !isNumber(proc.substr(1)) || !isNumber(count))
+	{
+		return false;
+	}
+
+	const int nprocs = atoi(count.c_str());
+	if ((nprocs < 1) || (atoi(proc.c_str() + 1) >= nprocs))
+	{
+		return false;
+	}
+
+	aFilenames.clear();
+	for (int k=0; k<nprocs; k++)
+	{
+		std::ostringstream name;
+		name << stem.substr(0, procpos) << "_P" << k << "_" << count << extension;
+		aFilenames.push_back(name.str());
+	}
+
+	return true;
+}
+
+
+PartitionedSWWReader::PartitionedSWWReader(const std::string & aFilename, unsigned int aNumThreads, MeshData * aSharedMesh, const LoadOptions & aOptions) :
+	SWWReader(aFilename, false, aSharedMesh, true, aOptions),
+	_parallelReads(true),
+	_pool(aNumThreads),
+	_readTimestep(0),
+	_readOut(NULL),
+	_readNumVariables(0)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+
+	// never opened here, the partitions have handles of their own
+	_ncid = -1;
+
+	std::vector<std::string> filenames;
+	if (!getPartitionFilenames(aFilename, filenames))
+	{
+		// a lone file still reads, as one partition
+		filenames.assign(1, aFilename);
+	}
+
+	_partitions.resize(filenames.size());
+	for (size_t p=0; p<filenames.size(); p++)
+	{
+		_partitions[p]._filename = filenames[p];
+	}
+
+	_valid = load();
+}
+
+
+PartitionedSWWReader::~PartitionedSWWReader()
+{
+	// requested frames are read through readStage(), which needs the partitions
+	stopFrameRequests();
+}
+
+
+int PartitionedSWWReader::readPartitionMesh(int aNcid, PartitionMesh & aMesh)
+{
+	aMesh._numVolumes = readDimension(aNcid, "number_of_volumes");
+	aMesh._numPoints = readDimension(aNcid, "number_of_points");
+	if (!aMesh._numVolumes || !aMesh._numPoints || (readDimension(aNcid, "number_of_vertices") != 3))
+	{
+		return NC_EBADDIM;
+	}
+
+	aMesh._x.resize(aMesh._numPoints);
+	aMesh._y.resize(aMesh._numPoints);
+	aMesh._volumes.resize(3*aMesh._numVolumes);
+
+	int status = getVariable(aNcid, "x", &aMesh._x[0]);
+	if (status == NC_NOERR)
+	{
+		status = getVariable(aNcid, "y", &aMesh._y[0]);
+	}
+	if (status == NC_NOERR)
+	{
+		status = getVariable(aNcid, "volumes", &aMesh._volumes[0]);
+	}
+	if (status != NC_NOERR)
+	{
+		return status;
+	}
+
+	// parallel runs flag their ghosts and number their nodes globally, a lone file does neither
+	int varid, ndims, dimid;
+	size_t length = 0;
+	aMesh._full.clear();
+	if (nc_inq_varid(aNcid, "tri_full_flag", &varid) == NC_NOERR)
+	{
+		aMesh._full.resize(aMesh._numVolumes);
+		if ((status = nc_get_var_int(aNcid, varid, &aMesh._full[0])) != NC_NOERR)
+		{
+			return status;
+		}
+	}
+
+	// only numbered per point in smoothed output
+	aMesh._nodes.clear();
+	if ((nc_inq_varid(aNcid, "node_l2g", &varid) == NC_NOERR) &&
+		(nc_inq_varndims(aNcid, varid, &ndims) == NC_NOERR) && (ndims == 1) &&
+		(nc_inq_vardimid(aNcid, varid, &dimid) == NC_NOERR) &&
+		(nc_inq_dimlen(aNcid, dimid, &length) == NC_NOERR) && (length == aMesh._numPoints))
+	{
+		aMesh._nodes.resize(aMesh._numPoints);
+		if ((status = nc_get_var_int(aNcid, varid, &aMesh._nodes[0])) != NC_NOERR)
+		{
+			return status;
+		}
+	}
+
+	// elevation as SWWReader::readMesh, the old format calls it z
+	aMesh._elevationName = "elevation";
+	if (nc_inq_varid(aNcid, "elevation", &varid) != NC_NOERR)
+	{
+		aMesh._elevationName = "z";
+		if ((status = nc_inq_varid(aNcid, "z", &varid)) != NC_NOERR)
+		{
+			return status;
+		}
+	}
+	if ((status = nc_inq_varndims(aNcid, varid, &ndims)) != NC_NOERR)
+	{
+		return status;
+	}
+	aMesh._animated = (ndims == 2);
+
+	aMesh._momentum = (nc_inq_varid(aNcid, "xmomentum", &varid) == NC_NOERR) &&
+					  (nc_inq_varid(aNcid, "ymomentum", &varid) == NC_NOERR);
+
+	if ((status = nc_inq_varid(aNcid, "stage", &varid)) != NC_NOERR)
+	{
+		return status;
+	}
+
+	// a running simulation may be part way through writing the newest timestep
+	const size_t ntimesteps = countCompleteTimesteps(aNcid, readDimension(aNcid, "number_of_timesteps"), aMesh._numPoints);
+	aMesh._times.resize(ntimesteps);
+	if ((status = nc_inq_varid(aNcid, "time", &varid)) != NC_NOERR)
+	{
+		return status;
+	}
+	if (ntimesteps && ((status = readTimes(aNcid, varid, ntimesteps, &aMesh._times[0])) != NC_NOERR))
+	{
+		return status;
+	}
+
+	if ((nc_get_att_double(aNcid, NC_GLOBAL, "xllcorner", &aMesh._xllcorner) != NC_NOERR) ||
+		(nc_get_att_double(aNcid, NC_GLOBAL, "yllcorner", &aMesh._yllcorner) != NC_NOERR))
+	{
+		aMesh._xllcorner = 0.0;
+		aMesh._yllcorner = 0.0;
+	}
+
+	aMesh._netcdf4 = isNetCDF4(aNcid);
+
+	return NC_NOERR;
+}
+
+
+bool PartitionedSWWReader::readMesh()
+{
+	if (!getRegion().isEmpty())
+	{
+		osg::notify(osg::WARN) << "[PartitionedSWWReader] Regions aren't supported for partitioned runs, loading the whole domain" << std::endl;
+	}
+
+	std::vector<PartitionMesh> meshes(_partitions.size());
+	for (size_t p=0; p<_partitions.size(); p++)
+	{
+		int ncid;
+		int status = nc_open(_partitions[p]._filename.c_str(), NC_NOWRITE, &ncid);
+		if (status == NC_NOERR)
+		{
+			status = readPartitionMesh(ncid, meshes[p]);
+			nc_close(ncid);
+		}
+
+		if (status != NC_NOERR)
+		{
+			osg::notify(osg::WARN) << "[PartitionedSWWReader] Unable to read " << _partitions[p]._filename << ": " << nc_strerror(status) << std::endl;
+			return false;
+		}
+	}
+
+	// the partitions of one run agree on how the file is laid out
+	const PartitionMesh & first = meshes[0];
+	bool momentum = true;
+	bool bynode = true;
+	size_t ntimesteps = first._times.size();
+	_parallelReads = true;
+	for (size_t p=0; p<meshes.size(); p++)
+	{
+		if ((meshes[p]._elevationName != first._elevationName) || (meshes[p]._animated != first._animated))
+		{
+			osg::notify(osg::WARN) << "[PartitionedSWWReader] " << _partitions[p]._filename << " doesn't match the other partitions" << std::endl;
+			return false;
+		}
+
+		momentum = momentum && meshes[p]._momentum;
+		bynode = bynode && !meshes[p]._nodes.empty();
+		_parallelReads = _parallelReads && !meshes[p]._netcdf4;
+
+		// only as far as every processor has written
+		ntimesteps = std::min(ntimesteps, meshes[p]._times.size());
+	}
+
+	// weld the full triangles of each partition into one mesh
+	std::vector<float> px, py;
+	std::vector<unsigned int> volumes;
+	std::map<int, unsigned int> nodevertices;
+	std::map<std::pair<float, float>, unsigned int> placevertices;
+	size_t nghosts = 0;
+
+	_vertexPartition.clear();
+	_vertexPoint.clear();
+	for (size_t p=0; p<meshes.size(); p++)
+	{
+		const PartitionMesh & mesh = meshes[p];
+		Partition & partition = _partitions[p];
+		partition._numPoints = mesh._numPoints;
+		partition._numVolumes = mesh._numVolumes;
+		partition._points.clear();
+		partition._vertices.clear();
+
+		// into the georeference of the first partition
+		const float xshift = (float) (mesh._xllcorner - first._xllcorner);
+		const float yshift = (float) (mesh._yllcorner - first._yllcorner);
+
+		std::vector<int> global(mesh._numPoints, -1);
+		for (size_t it=0; it<mesh._numVolumes; it++)
+		{
+			if (!mesh._full.empty() && !mesh._full[it])
+			{
+				nghosts++;
+				continue;
+			}
+
+			for (int k=0; k<3; k++)
+			{
+				const int point = mesh._volumes[3*it+k];
+				if ((point < 0) || ((size_t) point >= mesh._numPoints))
+				{
+					osg::notify(osg::WARN) << "[PartitionedSWWReader] " << partition._filename << " has a triangle out of bounds" << std::endl;
+					return false;
+				}
+
+				if (global[point] < 0)
+				{
+					const float x = mesh._x[point] + xshift;
+					const float y = mesh._y[point] + yshift;
+
+					// shared with a partition before this one
+					if (bynode)
+					{
+						std::map<int, unsigned int>::const_iterator found = nodevertices.find(mesh._nodes[point]);
+						if (found != nodevertices.end())
+						{
+							global[point] = found->second;
+						}
+					}
+					else
+					{
+						std::map<std::pair<float, float>, unsigned int>::const_iterator found = placevertices.find(std::make_pair(x, y));
+						if (found != placevertices.end())
+						{
+							global[point] = found->second;
+						}
+					}
+
+					if (global[point] < 0)
+					{
+						global[point] = px.size();
+						px.push_back(x);
+						py.push_back(y);
+						partition._points.push_back(point);
+						partition._vertices.push_back(global[point]);
+						_vertexPartition.push_back(p);
+						_vertexPoint.push_back(point);
+
+						if (bynode)
+						{
+							nodevertices[mesh._nodes[point]] = global[point];
+						}
+					}
+				}
+
+				volumes.push_back(global[point]);
+			}
+		}
+
+		// matched by position only across partitions, so unsmoothed output keeps its
+		// separate vertices within each
+		if (!bynode)
+		{
+			for (size_t i=0; i<partition._points.size(); i++)
+			{
+				placevertices.insert(std::make_pair(std::make_pair(px[partition._vertices[i]], py[partition._vertices[i]]), partition._vertices[i]));
+			}
+		}
+	}
+
+	if (volumes.empty())
+	{
+		osg::notify(osg::WARN) << "[PartitionedSWWReader] No full triangles in any partition" << std::endl;
+		return false;
+	}
+
+	_npoints = px.size();
+	_nvolumes = volumes.size() / 3;
+	_nvertices = 3;
+	_ntimesteps = ntimesteps;
+	_elevationName = first._elevationName;
+	_elevationAnimated = first._animated;
+	_xllcorner = first._xllcorner;
+	_yllcorner = first._yllcorner;
+
+	// allocation of variable arrays as SWWReader::readMesh, the destructor frees them
+	_mesh = new MeshData(_npoints, _nvolumes);
+	_px = _mesh->getX();
+	_py = _mesh->getY();
+	_pvolumes = _mesh->getTriangles();
+	_pz = new float[_npoints];
+	_ptime = new float[_ntimesteps];
+	_pstage = new float[_npoints];
+	if (momentum)
+	{
+		_pxmomentum = new float[_npoints];
+		_pymomentum = new float[_npoints];
+	}
+
+	std::copy(px.begin(), px.end(), _px);
+	std::copy(py.begin(), py.end(), _py);
+	std::copy(first._times.begin(), first._times.begin() + _ntimesteps, _ptime);
+	std::copy(volumes.begin(), volumes.end(), _pvolumes);
+
+	if (!applyTimeWindow())
+	{
+		return false;
+	}
+
+	osg::notify(osg::INFO) << "[PartitionedSWWReader] " << _partitions.size() << " partitions, " << nghosts << " ghost triangles dropped" << std::endl;
+	osg::notify(osg::INFO) << "[PartitionedSWWReader] number of volumes: " << _nvolumes << std::endl;
+	osg::notify(osg::INFO) << "[PartitionedSWWReader] number of points: " << _npoints << std::endl;
+	osg::notify(osg::INFO) << "[PartitionedSWWReader] number of timesteps: " << _ntimesteps << std::endl;
+
+	return true;
+}
+
+
+bool PartitionedSWWReader::readStage(unsigned int aTimestep, float * aStage, float * aXMomentum, float * aYMomentum)
+{
+	const char * names[3] = { "stage", "xmomentum", "ymomentum" };
+	float * const out[3] = { aStage, aXMomentum, aYMomentum };
+	return readPartitions(getFileTimestep(aTimestep), names, out, 3);
+}
+
+
+bool PartitionedSWWReader::readElevation(unsigned int aTimestep, float * aElevation)
+{
+	const char * names[1] = { _elevationName.c_str() };
+	float * const out[1] = { aElevation };
+	return readPartitions(getFileTimestep(aTimestep), names, out, 1);
+}
+
+
+bool PartitionedSWWReader::readPartitions(unsigned int aTimestep, const char * const * aNames, float * const * aOut, int aNumVariables)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+
+	// opened here, as opening touches the library's list of files
+	int status = NC_NOERR;
+	size_t nopen = 0;
+	for (; (nopen<_partitions.size()) && (status == NC_NOERR); nopen++)
+	{
+		Partition & partition = _partitions[nopen];
+		status = nc_open(partition._filename.c_str(), NC_NOWRITE, &partition._ncid);
+		if (status != NC_NOERR)
+		{
+			break;
+		}
+
+		for (int var=0; (var<aNumVariables) && (status == NC_NOERR); var++)
+		{
+			if (!aOut[var])
+			{
+				continue;
+			}
+
+			int ndims = 0;
+			status = nc_inq_varid(partition._ncid, aNames[var], &partition._varids[var]);
+			if (status == NC_NOERR)
+			{
+				status = nc_inq_varndims(partition._ncid, partition._varids[var], &ndims);
+			}
+			partition._perTimestep[var] = (ndims == 2);
+		}
+	}
+
+	if (status == NC_NOERR)
+	{
+		_readTimestep = aTimestep;
+		_readOut = aOut;
+		_readNumVariables = aNumVariables;
+
+		ReadBody body(this);
+		if (_parallelReads)
+		{
+			_pool.parallelFor(0, _partitions.size(), body);
+		}
+		else
+		{
+			body(0, _partitions.size());
+		}
+
+		_readOut = NULL;
+	}
+
+	for (size_t p=0; p<nopen; p++)
+	{
+		if (status == NC_NOERR)
+		{
+			status = _partitions[p]._status;
+		}
+		nc_close(_partitions[p]._ncid);
+	}
+
+	if (status != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[PartitionedSWWReader] Unable to read timestep " << aTimestep << ": " << nc_strerror(status) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+void PartitionedSWWReader::readRange(size_t aBegin, size_t aEnd)
+{
+	for (size_t p=aBegin; p<aEnd; p++)
+	{
+		Partition & partition = _partitions[p];
+		partition._status = NC_NOERR;
+		partition._buffer.resize(partition._numPoints);
+
+		for (int var=0; (var<_readNumVariables) && (partition._status == NC_NOERR); var++)
+		{
+			float * out = _readOut[var];
+			if (!out)
+			{
+				continue;
+			}
+
+			// one timestep's row, or the whole of a static variable
+			size_t start[2], count[2];
+			start[0] = _readTimestep;
+			start[1] = 0;
+			count[0] = 1;
+			count[1] = partition._numPoints;
+			const int offset = partition._perTimestep[var] ? 0 : 1;
+
+			partition._status = nc_get_vara_float(partition._ncid, partition._varids[var], start + offset, count + offset, &partition._buffer[0]);
+			if (partition._status != NC_NOERR)
+			{
+				break;
+			}
+
+			// each global vertex comes from one partition only, so the threads never
+			// write the same value
+			const float * buffer = &partition._buffer[0];
+			for (size_t i=0; i<partition._points.size(); i++)
+			{
+				out[partition._vertices[i]] = buffer[partition._points[i]];
+			}
+		}
+	}
+}
+
+
+bool PartitionedSWWReader::readCompleteTimes(std::vector<float> & aTimes, bool & aPartial)
+{
+	aPartial = false;
+
+	// the same meshes, at least one with more timesteps than were loaded
+	size_t complete = 0;
+	size_t written = 0;
+	bool grown = false;
+	for (size_t p=0; p<_partitions.size(); p++)
+	{
+		const Partition & partition = _partitions[p];
+		int ncid;
+		if (nc_open(partition._filename.c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+		{
+			return false;
+		}
+
+		const size_t ntimesteps = readDimension(ncid, "number_of_timesteps");
+		const bool same = (readDimension(ncid, "number_of_volumes") == partition._numVolumes) &&
+						  (readDimension(ncid, "number_of_points") == partition._numPoints) &&
+						  (ntimesteps >= _fileNumTimesteps);
+		if (same)
+		{
+			// only as far as every processor has written
+			const size_t ncomplete = countCompleteTimesteps(ncid, ntimesteps, partition._numPoints);
+			complete = (p == 0) ? ncomplete : std::min(complete, ncomplete);
+			written = std::max(written, ntimesteps);
+			grown = grown || (ntimesteps > _fileNumTimesteps);
+		}
+		nc_close(ncid);
+
+		if (!same)
+		{
+			return false;
+		}
+	}
+
+	if (!grown)
+	{
+		return false;
+	}
+	aPartial = (complete < written);
+
+	// the times of the first partition, which every other shares
+	int ncid, timeid;
+	if (nc_open(_partitions[0]._filename.c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+	{
+		return false;
+	}
+
+	aTimes.resize(complete);
+	const bool read = (nc_inq_varid(ncid, "time", &timeid) == NC_NOERR) &&
+					  (!complete || (readTimes(ncid, timeid, complete, &aTimes[0]) == NC_NOERR));
+	nc_close(ncid);
+
+	return read;
+}
+
+
+int PartitionedSWWReader::readSeries(const char * aVariable, size_t aFirstTimestep, size_t aNumTimesteps, const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries)
+{
+	aSeries.resize(aVertices.size() * aNumTimesteps);
+
+	// the points wanted from each partition, sorted, with the vertex each is for; copied
+	// under the lock as a reload replaces the mapping
+	typedef std::vector< std::pair<unsigned int, size_t> > PointList;
+	std::vector<PointList> wanted;
+	std::vector<std::string> filenames;
+	size_t first, stride;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+
+		first = getFileTimestep(aFirstTimestep);
+		stride = _options.timeWindow.getStride();
+
+		wanted.resize(_partitions.size());
+		for (size_t i=0; i<aVertices.size(); i++)
+		{
+			const unsigned int vertex = aVertices[i];
+			if (vertex >= _vertexPartition.size())
+			{
+				return NC_EINVALCOORDS;
+			}
+			wanted[_vertexPartition[vertex]].push_back(std::make_pair(_vertexPoint[vertex], i));
+		}
+
+		for (size_t p=0; p<_partitions.size(); p++)
+		{
+			filenames.push_back(_partitions[p]._filename);
+		}
+	}
+
+	std::vector<unsigned int> points;
+	std::vector<float> series;
+	for (size_t p=0; p<wanted.size(); p++)
+	{
+		if (wanted[p].empty())
+		{
+			continue;
+		}
+
+		std::sort(wanted[p].begin(), wanted[p].end());
+		points.clear();
+		for (size_t j=0; j<wanted[p].size(); j++)
+		{
+			points.push_back(wanted[p][j].first);
+		}
+
+		int ncid, varid, status;
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+			status = nc_open(filenames[p].c_str(), NC_NOWRITE, &ncid);
+			if (status != NC_NOERR)
+			{
+				return status;
+			}
+			status = nc_inq_varid(ncid, aVariable, &varid);
+		}
+
+		if (status == NC_NOERR)
+		{
+			status = readVertexSeries(ncid, varid, first, aNumTimesteps, stride, points, series);
+		}
+
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+			nc_close(ncid);
+		}
+
+		if (status != NC_NOERR)
+		{
+			return status;
+		}
+
+		for (size_t j=0; j<wanted[p].size(); j++)
+		{
+			std::copy(series.begin() + j*aNumTimesteps, series.begin() + (j+1)*aNumTimesteps, aSeries.begin() + wanted[p][j].second*aNumTimesteps);
+		}
+	}
+
+	return NC_NOERR;
+}
+
+
+bool PartitionedSWWReader::readFrames(FrameVisitor & aVisitor, bool aLowPriority)
+{
+	// as SWWReader::readFrames, take what's needed up front
+	size_t npoints, ntimesteps;
+	bool momentum, animated;
+	std::vector<float> times;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+
+		if (!_valid || !_ptime)
+		{
+			return false;
+		}
+
+		npoints = _npoints;
+		ntimesteps = _ntimesteps;
+		momentum = (_pxmomentum && _pymomentum);
+		animated = _elevationAnimated;
+		times.assign(_ptime, _ptime + _ntimesteps);
+	}
+
+	if (!npoints || !ntimesteps)
+	{
+		return true;
+	}
+
+	std::vector<float> stage(npoints);
+	std::vector<float> xmomentum(momentum ? npoints : 0);
+	std::vector<float> ymomentum(momentum ? npoints : 0);
+	std::vector<float> elevation(npoints);
+
+	// a timestep at a time, each from all the partitions at once
+	bool read = true;
+	bool stopped = false;
+	for (size_t t=0; (t<ntimesteps) && !stopped; t++)
+	{
+		if (aLowPriority)
+		{
+			giveWayToFrameLoads();
+		}
+
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+
+			// a reload since the pass started leaves nothing to match the frames to
+			read = (_npoints == npoints) &&
+				   readStage(t, &stage[0], momentum ? &xmomentum[0] : NULL, momentum ? &ymomentum[0] : NULL) &&
+				   ((t > 0 && !animated) || readElevation(t, &elevation[0]));
+		}
+		if (!read)
+		{
+			break;
+		}
+
+		FrameData frame;
+		frame._timestep = t;
+		frame._time = times[t];
+		frame._numPoints = npoints;
+		frame._stage = &stage[0];
+		frame._xmomentum = momentum ? &xmomentum[0] : NULL;
+		frame._ymomentum = momentum ? &ymomentum[0] : NULL;
+		frame._elevation = &elevation[0];
+
+		stopped = !aVisitor.visit(frame);
+	}
+
+	if (!read)
+	{
+		osg::notify(osg::WARN) << "[PartitionedSWWReader] Unable to read frames" << std::endl;
+		return false;
+	}
+
+	return !stopped;
+}
@@ -0,0 +1,275 @@
+/*
+  PreviewFrames
+
+  Every timestep of an sww file at a coarse resolution, for stepping through quickly.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <osg/Math>
+#include <osg/Notify>
+
+#include "sidecarcache.h"
+#include "previewframes.h"
+
+// sidecar of an sww file is named by adding this
+#define PREVIEW_CACHE_SUFFIX ".preview"
+
+// bump the version whenever the layout or meaning of the cache changes
+static const char PREVIEW_CACHE_MAGIC[8] = { 'S', 'W', 'W', 'P', 'R', 'V', '0', '1' };
+
+// a cell no vertex falls in
+static const unsigned int PREVIEW_NO_VERTEX = 0xffffffff;
+
+
+/**
+ * A triangle of the clustered mesh, ordered by its corners whatever their winding, then
+ * by the triangle of the mesh it came from.
+ */
+struct ClusteredTriangle
+{
+	unsigned int _key[3];	/**< Corners, ascending */
+	unsigned int _corners[3];	/**< In the winding of the triangle it came from */
+	size_t _from;
+
+	bool operator<(const ClusteredTriangle & aOther) const
+	{
+		for (int i=0; i<3; i++)
+		{
+			if (_key[i] != aOther._key[i])
+			{
+				return _key[i] < aOther._key[i];
+			}
+		}
+		return _from < aOther._from;
+	}
+
+	bool sameCorners(const ClusteredTriangle & aOther) const
+	{
+		return (_key[0] == aOther._key[0]) && (_key[1] == aOther._key[1]) && (_key[2] == aOther._key[2]);
+	}
+};
+
+
+PreviewFrames::PreviewFrames(size_t aMaxBytes) :
+	_maxBytes(aMaxBytes),
+	_cellsAcross(0),
+	_momentum(false),
+	_valid(false),
+	_fromCache(false),
+	_numFrames(0)
+{
+}
+
+
+std::string PreviewFrames::getCacheFilename(const std::string & aFilename)
+{
+	return aFilename + PREVIEW_CACHE_SUFFIX;
+}
+
+
+float PreviewFrames::getProgress() const
+{
+	return _numFrames ? (float) (unsigned int) _numFramesDone / _numFrames : 0.0f;
+}
+
+
+bool PreviewFrames::compute(SWWReader * aReader)
+{
+	_valid = false;
+	_fromCache = false;
+	_cancelled.exchange(0);
+	_numFramesDone.exchange(0);
+	_numFrames = aReader->getNumberOfTimesteps();
+	_momentum = aReader->hasMomentum();
+
+	// the mesh as loaded now, kept should the file change during the pass
+	osg::ref_ptr<MeshData> mesh = aReader->getMesh();
+	if (!mesh.valid())
+	{
+		return false;
+	}
+
+	// as fine a grid as lets every frame be held
+	const size_t narrays = _momentum ? 3 : 1;
+	const double cells = (double) _maxBytes / (osg::maximum(_numFrames, 1u) * narrays * sizeof(float));
+	_cellsAcross = osg::clampBetween((unsigned int) sqrt(cells), (unsigned int) PREVIEW_MIN_CELLS, (unsigned int) PREVIEW_MAX_CELLS);
+	decimate(mesh.get());
+
+	const size_t nvalues = _vertices.size() * _numFrames;
+	if (nvalues == 0)
+	{
+		_valid = true;
+		return true;
+	}
+
+	SidecarCache cache(aReader->getFilename(), PREVIEW_CACHE_SUFFIX, PREVIEW_CACHE_MAGIC, (float) _cellsAcross);
+	// a cache holds the whole run, a region or window is computed afresh
+	const bool stamped = aReader->isWholeRun() && cache.stamp(nvalues);
+
+	if (stamped && cache.read(getCacheArrays()))
+	{
+		_valid = true;
+		_fromCache = true;
+		_numFramesDone.exchange(_numFrames);
+		return true;
+	}
+
+	_depth.assign(nvalues, 0.0f);
+	if (_momentum)
+	{
+		_xmomentum.assign(nvalues, 0.0f);
+		_ymomentum.assign(nvalues, 0.0f);
+	}
+
+	// behind frames being loaded for the render thread, as nobody waits on the whole pass
+	if (!aReader->readFrames(*this, true))
+	{
+		return false;
+	}
+
+	_valid = true;
+	if (stamped)
+	{
+		cache.write(getCacheArrays());
+	}
+
+	osg::notify(osg::INFO) << "[PreviewFrames] " << _numFrames << " frames of " << _vertices.size() << " vertices and "
+						   << _triangles.size() / 3 << " triangles" << std::endl;
+
+	return true;
+}
+
+
+bool PreviewFrames::visit(const SWWReader::FrameData & aFrame)
+{
+	if (_cancelled)
+	{
+		return false;
+	}
+
+	// the file may have grown since the pass began
+	if (aFrame._timestep >= _numFrames)
+	{
+		return true;
+	}
+
+	const size_t nvertices = _vertices.size();
+	const size_t offset = aFrame._timestep * nvertices;
+	for (size_t i=0; i<nvertices; i++)
+	{
+		const unsigned int iv = _vertices[i];
+		_depth[offset + i] = aFrame._stage[iv] - aFrame._elevation[iv];
+	}
+
+	if (_momentum && aFrame._xmomentum && aFrame._ymomentum)
+	{
+		for (size_t i=0; i<nvertices; i++)
+		{
+			_xmomentum[offset + i] = aFrame._xmomentum[_vertices[i]];
+			_ymomentum[offset + i] = aFrame._ymomentum[_vertices[i]];
+		}
+	}
+
+	// frames come in order, so this one and all before it are now ready
+	++_numFramesDone;
+	return true;
+}
+
+
+void PreviewFrames::decimate(MeshData * aMesh)
+{
+	_vertices.clear();
+	_triangles.clear();
+
+	const size_t npoints = aMesh->getNumberOfPoints();
+	const size_t ntriangles = aMesh->getNumberOfTriangles();
+	const float * x = aMesh->getX();
+	const float * y = aMesh->getY();
+	const unsigned int * triangles = aMesh->getTriangles();
+	if (npoints == 0)
+	{
+		return;
+	}
+
+	float xmin = FLT_MAX, xmax = -FLT_MAX, ymin = FLT_MAX, ymax = -FLT_MAX;
+	for (size_t iv=0; iv<npoints; iv++)
+	{
+		xmin = osg::minimum(xmin, x[iv]);
+		xmax = osg::maximum(xmax, x[iv]);
+		ymin = osg::minimum(ymin, y[iv]);
+		ymax = osg::maximum(ymax, y[iv]);
+	}
+
+	// square cells, _cellsAcross along the longer side
+	float size = osg::maximum(xmax - xmin, ymax - ymin) / _cellsAcross;
+	if (size <= 0.0f)
+	{
+		size = 1.0f;
+	}
+	const unsigned int columns = osg::minimum((unsigned int) ((xmax - xmin) / size) + 1, _cellsAcross);
+	const unsigned int rows = osg::minimum((unsigned int) ((ymax - ymin) / size) + 1, _cellsAcross);
+
+	// the first vertex in each cell stands for it, so the vertices come out ascending
+	std::vector<unsigned int> cellOf(npoints);
+	std::vector<unsigned int> previewOf(columns * rows, PREVIEW_NO_VERTEX);
+	for (size_t iv=0; iv<npoints; iv++)
+	{
+		const unsigned int column = osg::minimum((unsigned int) ((x[iv] - xmin) / size), columns - 1);
+		const unsigned int row = osg::minimum((unsigned int) ((y[iv] - ymin) / size), rows - 1);
+		const unsigned int cell = column + row * columns;
+		cellOf[iv] = cell;
+		if (previewOf[cell] == PREVIEW_NO_VERTEX)
+		{
+			previewOf[cell] = _vertices.size();
+			_vertices.push_back(iv);
+		}
+	}
+
+	// triangles left with three different corners, once each
+	std::vector<ClusteredTriangle> clustered;
+	for (size_t it=0; it<ntriangles; it++)
+	{
+		ClusteredTriangle triangle;
+		for (int i=0; i<3; i++)
+		{
+			triangle._corners[i] = previewOf[cellOf[triangles[3*it+i]]];
+			triangle._key[i] = triangle._corners[i];
+		}
+		std::sort(triangle._key, triangle._key + 3);
+		if ((triangle._key[0] == triangle._key[1]) || (triangle._key[1] == triangle._key[2]))
+		{
+			continue;
+		}
+
+		triangle._from = it;
+		clustered.push_back(triangle);
+	}
+	std::sort(clustered.begin(), clustered.end());
+
+	_triangles.reserve(3 * clustered.size());
+	for (size_t it=0; it<clustered.size(); it++)
+	{
+		if ((it > 0) && clustered[it].sameCorners(clustered[it-1]))
+		{
+			continue;
+		}
+		_triangles.insert(_triangles.end(), clustered[it]._corners, clustered[it]._corners + 3);
+	}
+}
+
+
+std::vector< std::vector<float> * > PreviewFrames::getCacheArrays()
+{
+	std::vector< std::vector<float> * > arrays;
+	arrays.push_back(&_depth);
+	if (_momentum)
+	{
+		arrays.push_back(&_xmomentum);
+		arrays.push_back(&_ymomentum);
+	}
+	return arrays;
+}
@@ -0,0 +1,153 @@
+/*
+  Region
+
+  Part of a domain, a box or a polygon in georeferenced coordinates.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdlib.h>
+#include <osg/Math>
+
+#include "region.h"
+
+
+Region::Region() :
+	_xmin(0.0),
+	_ymin(0.0),
+	_xmax(0.0),
+	_ymax(0.0)
+{
+}
+
+
+bool Region::parse(const std::string & aSpec, Region & aRegion)
+{
+	// comma separated numbers, and nothing else
+	std::vector<double> values;
+	const char * p = aSpec.c_str();
+	while (*p)
+	{
+		char * end;
+		const double value = strtod(p, &end);
+		if (end == p)
+		{
+			return false;
+		}
+		values.push_back(value);
+
+		p = end;
+		if (*p == ',')
+		{
+			p++;
+			if (!*p)
+			{
+				return false;
+			}
+		}
+		else if (*p)
+		{
+			return false;
+		}
+	}
+
+	if (values.size() == 4)
+	{
+		if ((values[0] >= values[2]) || (values[1] >= values[3]))
+		{
+			return false;
+		}
+		aRegion.setBox(values[0], values[1], values[2], values[3]);
+		return true;
+	}
+
+	if ((values.size() >= 6) && (values.size() % 2 == 0))
+	{
+		std::vector<osg::Vec2d> corners;
+		for (size_t i=0; i<values.size(); i+=2)
+		{
+			corners.push_back(osg::Vec2d(values[i], values[i+1]));
+		}
+		aRegion.setPolygon(corners);
+		return true;
+	}
+
+	return false;
+}
+
+
+void Region::setBox(double aXMin, double aYMin, double aXMax, double aYMax)
+{
+	std::vector<osg::Vec2d> corners;
+	corners.push_back(osg::Vec2d(aXMin, aYMin));
+	corners.push_back(osg::Vec2d(aXMax, aYMin));
+	corners.push_back(osg::Vec2d(aXMax, aYMax));
+	corners.push_back(osg::Vec2d(aXMin, aYMax));
+	setPolygon(corners);
+}
+
+
+void Region::setPolygon(const std::vector<osg::Vec2d> & aCorners)
+{
+	_corners = aCorners;
+	if (_corners.empty())
+	{
+		return;
+	}
+
+	_xmin = _xmax = _corners[0].x();
+	_ymin = _ymax = _corners[0].y();
+	for (size_t i=1; i<_corners.size(); i++)
+	{
+		_xmin = osg::minimum(_xmin, _corners[i].x());
+		_xmax = osg::maximum(_xmax, _corners[i].x());
+		_ymin = osg::minimum(_ymin, _corners[i].y());
+		_ymax = osg::maximum(_ymax, _corners[i].y());
+	}
+}
+
+
+void Region::clear()
+{
+	_corners.clear();
+}
+
+
+bool Region::contains(double aX, double aY) const
+{
+	if (_corners.empty())
+	{
+		return true;
+	}
+
+	if ((aX < _xmin) || (aX > _xmax) || (aY < _ymin) || (aY > _ymax))
+	{
+		return false;
+	}
+
+	// crossings of a ray to the right, a box being a polygon like any other
+	bool inside = false;
+	const size_t n = _corners.size();
+	for (size_t i=0, j=n-1; i<n; j=i++)
+	{
+		const osg::Vec2d & a = _corners[i];
+		const osg::Vec2d & b = _corners[j];
+
+		// on an edge counts as inside
+		const double cross = (b.x() - a.x()) * (aY - a.y()) - (b.y() - a.y()) * (aX - a.x());
+		if ((cross == 0.0) &&
+			(aX >= osg::minimum(a.x(), b.x())) && (aX <= osg::maximum(a.x(), b.x())) &&
+			(aY >= osg::minimum(a.y(), b.y())) && (aY <= osg::maximum(a.y(), b.y())))
+		{
+			return true;
+		}
+
+		if (((a.y() > aY) != (b.y() > aY)) &&
+			(aX < (b.x() - a.x()) * (aY - a.y()) / (b.y() - a.y()) + a.x()))
+		{
+			inside = !inside;
+		}
+	}
+
+	return inside;
+}
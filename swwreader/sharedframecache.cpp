@@ -0,0 +1,622 @@
+/*
+  SharedFrameCache
+
+  Timesteps of an sww file shared between viewers on one host.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <set>
+#include <osg/Notify>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+	#define SHARED_FRAME_POSIX
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <limits.h>
+	#include <signal.h>
+	#include <stdlib.h>
+	#include <time.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+
+#if defined(__linux__)
+	// where the segments can be listed, to find stale ones
+	#define SHARED_FRAME_DIRECTORY "/dev/shm"
+	#include <dirent.h>
+#endif
+
+#include "sharedframecache.h"
+
+// segment names, short enough for OS X's limit of 31 characters
+#define SHARED_FRAME_PREFIX "anugaviewer-"
+
+// longest path to the sww file kept in a segment, longer ones aren't shared
+#define SHARED_FRAME_MAX_PATH 1024
+
+// slots start on a cache line, their frame after a line of their own
+#define SHARED_FRAME_ALIGN 64
+
+// how long a viewer waits for another to finish creating a segment, and how old
+// a segment has to be before one never finished is taken to be abandoned
+#define SHARED_FRAME_INIT_WAIT_USEC 1000
+#define SHARED_FRAME_INIT_WAITS 1000
+#define SHARED_FRAME_INIT_SECONDS 10
+
+// bump the version whenever the layout of a segment changes
+static const char SHARED_FRAME_MAGIC[8] = { 'S', 'W', 'W', 'S', 'H', 'M', '0', '2' };
+
+enum
+{
+	IDENTITY_DEVICE = 0,
+	IDENTITY_INODE,
+	IDENTITY_SIZE,
+	IDENTITY_MODIFICATION_TIME,
+	IDENTITY_NUM_OF
+};
+
+
+/**
+ * Start of a segment, followed by its slots.
+ */
+struct SharedFrameCache::Header
+{
+	char _magic[8];
+	long long _identity[IDENTITY_NUM_OF];	/**< Of the file when the segment was created */
+	unsigned long long _selection;	/**< Hash of the file's points in a frame, 0 for all */
+	unsigned int _numPoints;
+	unsigned int _numArrays;
+	unsigned int _numSlots;
+	volatile int _ready;	/**< Set once the creator has filled in the rest */
+	volatile int _viewers[SHARED_FRAME_MAX_VIEWERS];	/**< Process ids, 0 for a free place */
+	char _filename[SHARED_FRAME_MAX_PATH];	/**< Absolute, to check the file from anywhere */
+};
+
+
+/**
+ * Start of a slot, followed by its frame one array after another.
+ */
+struct SharedFrameCache::Slot
+{
+	volatile unsigned int _sequence;	/**< Odd while being written, 0 while empty */
+	volatile unsigned int _timestep;
+};
+
+
+// segments mapped by this process, let go of at exit as readers are never deleted
+static std::set<SharedFrameCache *> s_open;
+static OpenThreads::Mutex s_openMutex;
+static bool s_exitRegistered = false;
+
+
+static size_t align(size_t aBytes)
+{
+	return (aBytes + SHARED_FRAME_ALIGN - 1) / SHARED_FRAME_ALIGN * SHARED_FRAME_ALIGN;
+}
+
+
+#ifdef SHARED_FRAME_POSIX
+
+/**
+ * Get what identifies a file's contents without reading them.
+ * @param aStat if not NULL, set to the whole stat of the file
+ */
+static bool stampFile(const char * aFilename, long long * aIdentity, struct stat * aStat = NULL)
+{
+	struct stat buf;
+	if (stat(aFilename, &buf) != 0)
+	{
+		return false;
+	}
+	if (aStat)
+	{
+		*aStat = buf;
+	}
+
+	aIdentity[IDENTITY_DEVICE] = buf.st_dev;
+	aIdentity[IDENTITY_INODE] = buf.st_ino;
+	aIdentity[IDENTITY_SIZE] = buf.st_size;
+	aIdentity[IDENTITY_MODIFICATION_TIME] = buf.st_mtime;
+	return true;
+}
+
+
+static bool isAlive(int aPid)
+{
+	// a process of another user can't be signalled but is still there
+	return (aPid > 0) && ((kill(aPid, 0) == 0) || (errno == EPERM));
+}
+
+
+/**
+ * FNV-1a, carrying on from aHash.
+ */
+static unsigned long long hashBytes(const void * aBytes, size_t aLength, unsigned long long aHash = 14695981039346656037ULL)
+{
+	const unsigned char * bytes = (const unsigned char *) aBytes;
+	for (size_t i=0; i<aLength; i++)
+	{
+		aHash = (aHash ^ bytes[i]) * 1099511628211ULL;
+	}
+	return aHash;
+}
+
+
+/**
+ * Name a segment by hashing what it holds, collisions are caught by the header.
+ */
+static std::string getSegmentName(const long long * aIdentity, size_t aNumPoints, unsigned int aNumArrays, unsigned long long aSelection)
+{
+	unsigned long long key[IDENTITY_NUM_OF + 3];
+	for (int i=0; i<IDENTITY_NUM_OF; i++)
+	{
+		key[i] = aIdentity[i];
+	}
+	key[IDENTITY_NUM_OF] = aNumPoints;
+	key[IDENTITY_NUM_OF + 1] = aNumArrays;
+	key[IDENTITY_NUM_OF + 2] = aSelection;
+
+	const unsigned long long hash = hashBytes(key, sizeof(key));
+
+	char name[32];
+	sprintf(name, "/" SHARED_FRAME_PREFIX "%016llx", hash);
+	return name;
+}
+
+
+bool SharedFrameCache::isStale(const std::string & aName)
+{
+	int fd = shm_open(aName.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	bool stale = false;
+	struct stat buf;
+	if (fstat(fd, &buf) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	const bool old = (time(NULL) - buf.st_mtime > SHARED_FRAME_INIT_SECONDS);
+	if (buf.st_size < (off_t) sizeof(Header))
+	{
+		// its creator died before sizing it
+		close(fd);
+		return old;
+	}
+
+	void * base = mmap(NULL, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED)
+	{
+		return false;
+	}
+
+	const Header * header = (const Header *) base;
+	if (!header->_ready)
+	{
+		// or before filling it in
+		stale = old;
+	}
+	else if (memcmp(header->_magic, SHARED_FRAME_MAGIC, sizeof(SHARED_FRAME_MAGIC)) == 0)
+	{
+		stale = true;
+		for (int i=0; (i<SHARED_FRAME_MAX_VIEWERS) && stale; i++)
+		{
+			stale = !isAlive(header->_viewers[i]);
+		}
+
+		char filename[SHARED_FRAME_MAX_PATH];
+		memcpy(filename, header->_filename, sizeof(filename));
+		filename[sizeof(filename) - 1] = '\0';
+
+		long long identity[IDENTITY_NUM_OF];
+		if (!stampFile(filename, identity) || (memcmp(identity, header->_identity, sizeof(identity)) != 0))
+		{
+			stale = true;
+		}
+	}
+
+	munmap(base, sizeof(Header));
+	return stale;
+}
+
+#endif
+
+
+SharedFrameCache::SharedFrameCache() :
+	_base(NULL),
+	_bytes(0),
+	_header(NULL),
+	_numPoints(0),
+	_numArrays(0),
+	_numSlots(0),
+	_slotBytes(0),
+	_writable(false),
+	_viewer(-1)
+{
+}
+
+
+SharedFrameCache::~SharedFrameCache()
+{
+#ifdef SHARED_FRAME_POSIX
+	if (_base)
+	{
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_openMutex);
+			s_open.erase(this);
+		}
+
+		// the last viewer out removes it, those that have it mapped keep their mapping
+		if (detach())
+		{
+			shm_unlink(_name.c_str());
+		}
+		munmap(_base, _bytes);
+	}
+#endif
+}
+
+
+void SharedFrameCache::detachAll()
+{
+#ifdef SHARED_FRAME_POSIX
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_openMutex);
+	for (std::set<SharedFrameCache *>::iterator it = s_open.begin(); it != s_open.end(); ++it)
+	{
+		if ((*it)->detach())
+		{
+			shm_unlink((*it)->_name.c_str());
+		}
+	}
+#endif
+}
+
+
+SharedFrameCache * SharedFrameCache::open(const std::string & aFilename, size_t aNumPoints, unsigned int aNumArrays, size_t aMaxBytes,
+										   const std::vector<unsigned int> * aSelection)
+{
+#ifdef SHARED_FRAME_POSIX
+	removeStale();
+
+	char path[PATH_MAX];
+	long long identity[IDENTITY_NUM_OF];
+	struct stat file;
+	if (!realpath(aFilename.c_str(), path) || (strlen(path) >= SHARED_FRAME_MAX_PATH) ||
+		!stampFile(path, identity, &file) || (aNumPoints == 0) || (aNumArrays == 0))
+	{
+		return NULL;
+	}
+
+	const size_t slotBytes = align(sizeof(Slot)) + align(aNumPoints * aNumArrays * sizeof(float));
+	const size_t numSlots = aMaxBytes / slotBytes;
+	if (numSlots == 0)
+	{
+		return NULL;
+	}
+
+	// viewers of different parts of a file keep apart
+	unsigned long long selection = 0;
+	if (aSelection && !aSelection->empty())
+	{
+		selection = hashBytes(&(*aSelection)[0], aSelection->size() * sizeof(unsigned int));
+	}
+
+	osg::ref_ptr<SharedFrameCache> cache = new SharedFrameCache;
+	cache->_name = getSegmentName(identity, aNumPoints, aNumArrays, selection);
+	if (!cache->map(path, identity, selection, file.st_uid, file.st_mode, aNumPoints, aNumArrays, numSlots))
+	{
+		osg::notify(osg::INFO) << "[SharedFrameCache] Not sharing frames of " << aFilename << std::endl;
+		return NULL;
+	}
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_openMutex);
+		s_open.insert(cache.get());
+		if (!s_exitRegistered)
+		{
+			atexit(detachAll);
+			s_exitRegistered = true;
+		}
+	}
+
+	osg::notify(osg::INFO) << "[SharedFrameCache] Sharing " << cache->_numSlots << " frames of " << aFilename << " in " << cache->_name << std::endl;
+	return cache.release();
+#else
+	return NULL;
+#endif
+}
+
+
+unsigned int SharedFrameCache::removeStale()
+{
+	unsigned int removed = 0;
+#if defined(SHARED_FRAME_POSIX) && defined(SHARED_FRAME_DIRECTORY)
+	DIR * dir = opendir(SHARED_FRAME_DIRECTORY);
+	if (!dir)
+	{
+		return 0;
+	}
+
+	const size_t prefix = strlen(SHARED_FRAME_PREFIX);
+	struct dirent * entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (strncmp(entry->d_name, SHARED_FRAME_PREFIX, prefix) != 0)
+		{
+			continue;
+		}
+
+		// other users' segments can't be removed, but can't be in the way either
+		const std::string name = std::string("/") + entry->d_name;
+		if (isStale(name) && (shm_unlink(name.c_str()) == 0))
+		{
+			osg::notify(osg::INFO) << "[SharedFrameCache] Removed stale " << name << std::endl;
+			removed++;
+		}
+	}
+	closedir(dir);
+#endif
+	return removed;
+}
+
+
+bool SharedFrameCache::map(const std::string & aFilename, const long long * aIdentity, unsigned long long aSelection,
+						   unsigned int aOwner, unsigned int aMode, size_t aNumPoints, unsigned int aNumArrays, unsigned int aNumSlots)
+{
+#ifdef SHARED_FRAME_POSIX
+	_numPoints = aNumPoints;
+	_numArrays = aNumArrays;
+	_slotBytes = align(sizeof(Slot)) + align(aNumPoints * aNumArrays * sizeof(float));
+
+	// readable by the other users who can read the file, so they share it too without
+	// being able to spoil it, and by no one who can't
+	const mode_t mode = S_IRUSR | S_IWUSR | (aMode & (S_IRGRP | S_IROTH));
+	bool created = false;
+	int fd = shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, mode);
+	if (fd >= 0)
+	{
+		created = true;
+		_writable = true;
+		_bytes = align(sizeof(Header)) + aNumSlots * _slotBytes;
+
+		// past the umask, and zero filled on a filesystem that only allocates pages written
+		if ((fchmod(fd, mode) != 0) || (ftruncate(fd, _bytes) != 0))
+		{
+			close(fd);
+			shm_unlink(_name.c_str());
+			return false;
+		}
+	}
+	else if (errno == EEXIST)
+	{
+		_writable = true;
+		fd = shm_open(_name.c_str(), O_RDWR, 0);
+		if ((fd < 0) && (errno == EACCES))
+		{
+			_writable = false;
+			fd = shm_open(_name.c_str(), O_RDONLY, 0);
+		}
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		// made by this user, or by the file's owner who could change the file anyway;
+		// anyone else's could hold frames that aren't the file's
+		struct stat buf;
+		if ((fstat(fd, &buf) != 0) || ((buf.st_uid != geteuid()) && (buf.st_uid != (uid_t) aOwner)))
+		{
+			osg::notify(osg::WARN) << "[SharedFrameCache] Segment " << _name << " isn't owned by this user or the file's, not sharing frames" << std::endl;
+			close(fd);
+			return false;
+		}
+
+		// sized by its creator straight after creating it
+		for (int i=0; ; i++)
+		{
+			if (fstat(fd, &buf) != 0 || i >= SHARED_FRAME_INIT_WAITS)
+			{
+				close(fd);
+				return false;
+			}
+			if (buf.st_size >= (off_t) align(sizeof(Header)))
+			{
+				break;
+			}
+			OpenThreads::Thread::microSleep(SHARED_FRAME_INIT_WAIT_USEC);
+		}
+		_bytes = buf.st_size;
+	}
+	else
+	{
+		return false;
+	}
+
+	_base = mmap(NULL, _bytes, PROT_READ | (_writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+	close(fd);
+	if (_base == MAP_FAILED)
+	{
+		_base = NULL;
+		if (created)
+		{
+			shm_unlink(_name.c_str());
+		}
+		return false;
+	}
+	_header = (Header *) _base;
+
+	if (created)
+	{
+		memcpy(_header->_magic, SHARED_FRAME_MAGIC, sizeof(_header->_magic));
+		memcpy(_header->_identity, aIdentity, sizeof(_header->_identity));
+		_header->_selection = aSelection;
+		_header->_numPoints = aNumPoints;
+		_header->_numArrays = aNumArrays;
+		_header->_numSlots = aNumSlots;
+		strncpy(_header->_filename, aFilename.c_str(), sizeof(_header->_filename) - 1);
+		_header->_viewers[0] = getpid();
+		_viewer = 0;
+
+		// everything else visible before the flag
+		__sync_synchronize();
+		_header->_ready = 1;
+		_numSlots = aNumSlots;
+		return true;
+	}
+
+	for (int i=0; !_header->_ready; i++)
+	{
+		if (i >= SHARED_FRAME_INIT_WAITS)
+		{
+			return false;
+		}
+		OpenThreads::Thread::microSleep(SHARED_FRAME_INIT_WAIT_USEC);
+	}
+	__sync_synchronize();
+
+	// whatever budget its creator had, as long as the slots fit the mapping
+	_numSlots = _header->_numSlots;
+	if ((memcmp(_header->_magic, SHARED_FRAME_MAGIC, sizeof(_header->_magic)) != 0) ||
+		(memcmp(_header->_identity, aIdentity, sizeof(_header->_identity)) != 0) ||
+		(_header->_selection != aSelection) ||
+		(_header->_numPoints != aNumPoints) || (_header->_numArrays != aNumArrays) ||
+		(_numSlots == 0) || (align(sizeof(Header)) + _numSlots * _slotBytes != _bytes))
+	{
+		return false;
+	}
+
+	attach();
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+void SharedFrameCache::attach()
+{
+#ifdef SHARED_FRAME_POSIX
+	if (!_writable)
+	{
+		return;
+	}
+
+	const int pid = getpid();
+	for (int i=0; i<SHARED_FRAME_MAX_VIEWERS; i++)
+	{
+		if (__sync_bool_compare_and_swap(&_header->_viewers[i], 0, pid))
+		{
+			_viewer = i;
+			return;
+		}
+	}
+#endif
+}
+
+
+bool SharedFrameCache::detach()
+{
+#ifdef SHARED_FRAME_POSIX
+	if (_viewer < 0)
+	{
+		// not counted, so not the one to remove it
+		return false;
+	}
+
+	__sync_bool_compare_and_swap(&_header->_viewers[_viewer], getpid(), 0);
+	_viewer = -1;
+
+	for (int i=0; i<SHARED_FRAME_MAX_VIEWERS; i++)
+	{
+		if (isAlive(_header->_viewers[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+SharedFrameCache::Slot * SharedFrameCache::getSlot(unsigned int aTimestep) const
+{
+	return (Slot *) ((char *) _base + align(sizeof(Header)) + (aTimestep % _numSlots) * _slotBytes);
+}
+
+
+bool SharedFrameCache::find(unsigned int aTimestep, float * const * aArrays) const
+{
+#ifdef SHARED_FRAME_POSIX
+	const Slot * slot = getSlot(aTimestep);
+	const unsigned int sequence = slot->_sequence;
+	if ((sequence == 0) || (sequence & 1) || (slot->_timestep != aTimestep))
+	{
+		return false;
+	}
+	__sync_synchronize();
+
+	const float * frame = (const float *) ((const char *) slot + align(sizeof(Slot)));
+	for (unsigned int i=0; i<_numArrays; i++)
+	{
+		if (aArrays[i])
+		{
+			memcpy(aArrays[i], frame + i * _numPoints, _numPoints * sizeof(float));
+		}
+	}
+
+	// torn if a writer took the slot meanwhile
+	__sync_synchronize();
+	return (slot->_sequence == sequence);
+#else
+	return false;
+#endif
+}
+
+
+void SharedFrameCache::insert(unsigned int aTimestep, const float * const * aArrays)
+{
+#ifdef SHARED_FRAME_POSIX
+	if (!_writable)
+	{
+		return;
+	}
+
+	Slot * slot = getSlot(aTimestep);
+	const unsigned int sequence = slot->_sequence;
+	if ((sequence & 1) || ((sequence != 0) && (slot->_timestep == aTimestep)))
+	{
+		// being written, or already there
+		return;
+	}
+
+	// a writer that dies here leaves the slot odd, and so unused, for the segment's life
+	if (!__sync_bool_compare_and_swap(&slot->_sequence, sequence, sequence + 1))
+	{
+		return;
+	}
+
+	slot->_timestep = aTimestep;
+	float * frame = (float *) ((char *) slot + align(sizeof(Slot)));
+	for (unsigned int i=0; i<_numArrays; i++)
+	{
+		memcpy(frame + i * _numPoints, aArrays[i], _numPoints * sizeof(float));
+	}
+
+	__sync_synchronize();
+	slot->_sequence = sequence + 2;
+#endif
+}
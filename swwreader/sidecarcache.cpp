@@ -0,0 +1,165 @@
+/*
+  SidecarCache
+
+  Per-vertex results of a pass over an sww file, saved next to it.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <osg/Notify>
+
+#include "sidecarcache.h"
+
+
+SidecarCache::SidecarCache(const std::string & aFilename, const std::string & aSuffix, const char * aMagic, float aParameter) :
+	_swwFilename(aFilename),
+	_cacheFilename(aFilename + aSuffix),
+	_parameter(aParameter),
+	_stamped(false)
+{
+	memcpy(_magic, aMagic, sizeof(_magic));
+	memset(&_stamp, 0, sizeof(_stamp));
+}
+
+
+void SidecarCache::addSource(const std::string & aFilename)
+{
+	_sources.push_back(aFilename);
+}
+
+
+bool SidecarCache::stampHeader(size_t aNumPoints, Header & aHeader) const
+{
+	struct stat buf;
+	if (stat(_swwFilename.c_str(), &buf) != 0)
+	{
+		return false;
+	}
+
+	// zeroed first, headers are compared byte for byte
+	memset(&aHeader, 0, sizeof(aHeader));
+	memcpy(aHeader._magic, _magic, sizeof(aHeader._magic));
+	aHeader._modificationTime = buf.st_mtime;
+	aHeader._size = buf.st_size;
+	aHeader._numPoints = aNumPoints;
+	aHeader._parameter = _parameter;
+	aHeader._numSources = _sources.size();
+
+	return true;
+}
+
+
+bool SidecarCache::stampSources(std::vector<SourceStamp> & aStamps) const
+{
+	aStamps.resize(_sources.size());
+	for (size_t i=0; i<_sources.size(); i++)
+	{
+		struct stat buf;
+		if (stat(_sources[i].c_str(), &buf) != 0)
+		{
+			return false;
+		}
+
+		// zeroed first, compared byte for byte as the header is
+		memset(&aStamps[i], 0, sizeof(SourceStamp));
+		aStamps[i]._modificationTime = buf.st_mtime;
+		aStamps[i]._size = buf.st_size;
+	}
+
+	return true;
+}
+
+
+bool SidecarCache::stamp(size_t aNumPoints)
+{
+	_stamped = stampHeader(aNumPoints, _stamp) && stampSources(_sourceStamps);
+	return _stamped;
+}
+
+
+bool SidecarCache::read(const std::vector< std::vector<float> * > & aArrays)
+{
+	if (!_stamped)
+	{
+		return false;
+	}
+
+	// the file as it is now, not as it was when stamped
+	Header expected;
+	std::vector<SourceStamp> sources;
+	if (!stampHeader(_stamp._numPoints, expected) || !stampSources(sources))
+	{
+		return false;
+	}
+	expected._numArrays = aArrays.size();
+
+	FILE * file = fopen(_cacheFilename.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	const size_t npoints = expected._numPoints;
+	Header header;
+	bool ok = (fread(&header, sizeof(header), 1, file) == 1) && (memcmp(&header, &expected, sizeof(header)) == 0);
+	for (size_t i=0; ok && (i<sources.size()); i++)
+	{
+		SourceStamp source;
+		ok = (fread(&source, sizeof(source), 1, file) == 1) && (memcmp(&source, &sources[i], sizeof(source)) == 0);
+	}
+	for (size_t i=0; ok && (i<aArrays.size()); i++)
+	{
+		aArrays[i]->resize(npoints);
+		ok = (npoints == 0) || (fread(&(*aArrays[i])[0], sizeof(float), npoints, file) == npoints);
+	}
+
+	fclose(file);
+
+	if (!ok)
+	{
+		osg::notify(osg::INFO) << "[SidecarCache] " << _cacheFilename << " is out of date, recomputing" << std::endl;
+	}
+
+	return ok;
+}
+
+
+void SidecarCache::write(const std::vector< std::vector<float> * > & aArrays)
+{
+	if (!_stamped)
+	{
+		return;
+	}
+
+	FILE * file = fopen(_cacheFilename.c_str(), "wb");
+	if (!file)
+	{
+		osg::notify(osg::INFO) << "[SidecarCache] Unable to write " << _cacheFilename << std::endl;
+		return;
+	}
+
+	Header header = _stamp;
+	header._numArrays = aArrays.size();
+
+	const size_t npoints = header._numPoints;
+	bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+	for (size_t i=0; ok && (i<_sourceStamps.size()); i++)
+	{
+		ok = (fwrite(&_sourceStamps[i], sizeof(SourceStamp), 1, file) == 1);
+	}
+	for (size_t i=0; ok && (i<aArrays.size()); i++)
+	{
+		ok = (aArrays[i]->size() == npoints) &&
+			 ((npoints == 0) || (fwrite(&(*aArrays[i])[0], sizeof(float), npoints, file) == npoints));
+	}
+
+	if ((fclose(file) != 0) || !ok)
+	{
+		// don't leave a partial cache to be trusted next time
+		osg::notify(osg::INFO) << "[SidecarCache] Unable to write " << _cacheFilename << std::endl;
+		remove(_cacheFilename.c_str());
+	}
+}
@@ -10,8 +10,13 @@
 #include <cstdlib>
 #include <string>
 #include <fstream>
+#include <algorithm>
 #include <netcdf.h>
 #include <osg/Notify>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Thread>
 
 #include <osgDB/Registry>
 #include <osgDB/ReadFile>
@@ -19,6 +24,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <sys/timeb.h>
+#else
+#include <sys/time.h>
+#endif
 #include <gdal_priv.h>
 
 #define SAFE_DELETE_ARRAY(x) {if (x) { delete[](x); x=NULL;	}}
@@ -43,6 +55,71 @@
 #define max(x, y) ((x>y) ? x:y)
 #endif
 
+// vertex timeseries closer than this many points apart in the file are read as one block
+#define SERIES_READ_MAX_GAP 256
+
+// most values read in one timeseries block
+#define SERIES_READ_MAX_BLOCK (4*1024*1024)
+
+// a read reporting its progress does so about this many times, in chunks of no fewer
+// timesteps than SERIES_PROGRESS_MIN_CHUNK
+#define SERIES_PROGRESS_STEPS 16
+#define SERIES_PROGRESS_MIN_CHUNK 64
+
+// most values of each quantity read at once by a pass over all the frames
+#define FRAME_READ_MAX_BLOCK (1024*1024)
+
+// as FRAME_READ_MAX_BLOCK, for low priority passes, so a frame load waits less on each read
+#define FRAME_READ_LOW_PRIORITY_BLOCK (256*1024)
+
+// how long a low priority pass sleeps at a time while a frame load is waiting
+#define FRAME_READ_YIELD_USEC 1000
+
+// newest records checked for being partly written by a running simulation
+#define APPEND_CHECK_RECORDS 2
+
+// a timestep still being written is looked at again after this, milliseconds, and given
+// up on after this many looks with none finished, eg. when the run was killed
+#define APPEND_PARTIAL_RECHECK_MS 1000
+#define APPEND_PARTIAL_RECHECKS 30
+
+// vertices of a region this close in the file are read as one range, the points between
+// them included, and no range is wider than the span
+#define REGION_READ_MAX_GAP 64
+#define REGION_READ_MAX_SPAN (64*1024)
+
+// marks a point no triangle of the region uses
+#define REGION_UNUSED ((unsigned int) -1)
+
+// netcdf fills a new record with this until each of its variables is written
+#ifndef NC_FILL_FLOAT
+#define NC_FILL_FLOAT (9.9692099683868690e+36f)
+#endif
+
+// memory given over to recently read frames
+#define FRAME_CACHE_MAX_BYTES ((size_t) 128*1024*1024)
+
+// the netcdf library isn't thread safe, every call into it holds this lock, as does
+// anything that replaces the loaded mesh
+static OpenThreads::Mutex s_netcdfMutex(OpenThreads::Mutex::MUTEX_RECURSIVE);
+
+// frame loads for display waiting on s_netcdfMutex, low priority passes give way to them
+static OpenThreads::Atomic s_framesWaiting;
+
+OpenThreads::Mutex & SWWReader::getNetCDFMutex()
+{
+	return s_netcdfMutex;
+}
+
+
+void SWWReader::giveWayToFrameLoads()
+{
+	while (s_framesWaiting)
+	{
+		OpenThreads::Thread::microSleep(FRAME_READ_YIELD_USEC);
+	}
+}
+
 #define getRange(aMin, aMax, x) { aMin = min(aMin, x);	aMax = max(aMax, x);	} 
 
 #if 0
@@ -83,20 +160,43 @@ inline void Math_NormalizeFast(osg::Vec3 & aVec)
 
 
 // only constructor, requires netcdf file
-SWWReader::SWWReader(const std::string& filename) :
+SWWReader::SWWReader(const std::string& filename, bool aLoad, MeshData * aSharedMesh, bool aWatch, const LoadOptions & aOptions) :
+	_options(aOptions),
 	_valid(false),
+	_fileNumVolumes(0),
+	_fileNumPoints(0),
+	_fileNumTimesteps(0),
+	_partialRechecks(0),
+	_timeFirst(0),
 	_px(NULL),
 	_py(NULL),
 	_pz(NULL),
 	_ptime(NULL),
+	_pstage(NULL),
+	_pxmomentum(NULL),
+	_pymomentum(NULL),
+	_pvolumes(NULL),
 	_xoffset(0),
 	_yoffset(0),
 	_zoffset(0),
-	_elevationAnimated(false)
+	_boundsFixed(false),
+	_elevationAnimated(false),
+	_appendTime(0.0),
+	_colourQuantity(DerivedQuantity::DQ_MOMENTUM),
+	_frameCacheBytes(FRAME_CACHE_MAX_BYTES),
+	_scheduler(NULL),
+	_sharedMesh(aSharedMesh)
 {
 PROFILE_BEGIN
 
-	_fileChanged.watch(filename);
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+
+	// from a thread of its own, so refresh() costs nothing until the file changes;
+	// unwatched, it costs nothing until told of one
+	if (aWatch)
+	{
+		_fileChanged.watchAsync(filename);
+	}
 
 	// state initialization
 	_state.bedslopetexturefilename = NULL;
@@ -104,7 +204,7 @@ PROFILE_BEGIN
 	// netcdf filename
 	_state.swwfilename = new std::string(filename);
 
-	if (load())
+	if (aLoad && load())
 	{
 		_valid = true;
 	}
@@ -116,6 +216,10 @@ PROFILE_BEGIN
 
 SWWReader::~SWWReader()
 {
+	// requests being read hold the lock
+	stopFrameRequests();
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
 	_status.push_back( nc_close(_ncid) );
 	clear();
 }
@@ -201,16 +305,17 @@ osg::ref_ptr<osg::Vec2Array> SWWReader::getBedslopeTextureCoords()
 
 bool SWWReader::loadBedslopeVertexArray(unsigned int aIndex)
 {
-	// netcdf open
-	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
-	if (this->_statusHasError())
+	// counted while waiting, so background passes stand aside
+	++s_framesWaiting;
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+	--s_framesWaiting;
+
+	float * pz = _pz;
+	if (!readElevation(aIndex, pz))
 	{
 		return false;
 	}
 
-	float * pz = loadBedslopeZ(aIndex);
-	assert(pz);
-
 	getBedslopeBoundingVolume(pz);
 
 	// bedslope vertex array, shifting and scaling vertices to unit cube
@@ -242,7 +347,6 @@ bool SWWReader::loadBedslopeVertexArray(unsigned int aIndex)
 		if ((v1index >= _npoints) || (v2index >= _npoints) || (v3index >= _npoints))
 		{
 			// data out of bounds
-			_status.push_back( nc_close(_ncid) );
 			return false;
 		}
 
@@ -259,14 +363,6 @@ bool SWWReader::loadBedslopeVertexArray(unsigned int aIndex)
 		_bedslopecentroids->push_back( (v1+v2+v3)/3.0 );
 	}
 
-	_status.push_back( nc_close(_ncid) );
-
-	if (_statusHasError())
-	{
-		return false;
-	}
-
-
 	return true;
 }
 
@@ -275,46 +371,31 @@ bool SWWReader::loadStageVertexArray(unsigned int index)
 {
 	PROFILE_BEGIN
 
-	assert(_bedslopevertices);
+	// counted while waiting, so background passes stand aside
+	++s_framesWaiting;
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+	--s_framesWaiting;
 
-	size_t start[2], count[2], iv;
-	const ptrdiff_t stride[2] = {1,1};
-	start[0] = index;
-	start[1] = 0;
-	count[0] = 1;
-	count[1] = _npoints;
+	assert(_bedslopevertices);
 
-	// netcdf open
-	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
-	if (this->_statusHasError())
-	{
-		return false;
-	}
+	size_t iv;
 
-	// --- Check that the stage data hasn't shrunk
-	size_t npoints = 0;
-	_status.push_back( nc_inq_dimlen(_ncid, _npointsid, &npoints) );
-	if (_statusHasError() || (npoints != _npoints))
+	// cached, perhaps read ahead by requestFrame(), or else read now
+	osg::ref_ptr<FrameCache::Frame> frame = loadFrame(index);
+	if (!frame.valid())
 	{
-		// Our indices will not be out of bounds
-		osg::notify(osg::FATAL) << "File changes have made it invalid! Please wait." <<  std::endl;
 		return false;
 	}
 
-		// empty array for storing list of steep triangles
-		osg::ref_ptr<osg::IntArray> steeptri = new osg::IntArray;
-
-	// stage heights from netcdf file (x and y are same as bedslope)
-	_status.push_back(nc_get_vars_float (_ncid, _stageid, start, count, stride, _pstage));
-
+	std::copy(frame->_stage.begin(), frame->_stage.end(), _pstage);
 	if (_pxmomentum && _pymomentum)
 	{
-		// stage momentum from netcdf file (x and y are same as bedslope)
-		_status.push_back(nc_get_vars_float (_ncid, _xmomentumid, start, count, stride, _pxmomentum));
-		_status.push_back(nc_get_vars_float (_ncid, _ymomentumid, start, count, stride, _pymomentum));
+		std::copy(frame->_xmomentum.begin(), frame->_xmomentum.end(), _pxmomentum);
+		std::copy(frame->_ymomentum.begin(), frame->_ymomentum.end(), _pymomentum);
 	}
 
-	_status.push_back( nc_close(_ncid) );
+	// empty array for storing list of steep triangles
+	osg::ref_ptr<osg::IntArray> steeptri = new osg::IntArray;
 
 	// load stage vertex array, scaling and shifting vertices to lie in the unit cube
 	_stagevertices = new osg::Vec3Array;
@@ -373,6 +454,10 @@ bool SWWReader::loadStageVertexArray(unsigned int index)
 	// where a = (alphamax-alphamin)/(hmax-hmin)
 	float alpha, height, alphascale;
 	alphascale = (_state.alphamax - _state.alphamin) / (_state.heightmax - _state.heightmin);
+
+	// colour by the chosen quantity, only it is computed and it is kept with the frame
+	const float * quantity = frame->getDerived(_colourQuantity, _pz);
+	const float quantityscale = 1.0f / DerivedQuantity::getScale(_colourQuantity);
 	_stagecolors = new osg::Vec4Array;
 	_stagecolors->reserve(_npoints);
 	for (iv=0; iv < _npoints; iv++)
@@ -391,9 +476,9 @@ bool SWWReader::loadStageVertexArray(unsigned int index)
 				alpha = _state.alphamax;
 		}
 
-	  if (_pxmomentum && _pymomentum)
+	  if (quantity)
 	  {
-		float intens = min(1, sqrt(_pxmomentum[iv]*_pxmomentum[iv]+_pymomentum[iv]*_pymomentum[iv])/2);
+		float intens = min(1, quantity[iv]*quantityscale);
 		_stagecolors->push_back( osg::Vec4( 1.0f-intens, (0.5f-fabs(intens - 0.5f))*2, intens, alpha ) );
 	  }
 	  else
@@ -424,15 +509,16 @@ bool SWWReader::loadStageVertexArray(unsigned int index)
 	_stagevertexnormals = new osg::Vec3Array;
 	_stagevertexnormals->reserve(_npoints);
 
+	const std::vector<triangle_list> & connectivity = _mesh->getConnectivity();
 	int num_shared_triangles, triangle_index;
 	for (iv=0; iv < _npoints; iv++)
 	{
 		nrm.set(0,0,0);
-		num_shared_triangles = _connectivity.at(iv).size();	// There may be 2-7 triangles sharing a vertex
+		num_shared_triangles = connectivity.at(iv).size();	// There may be 2-7 triangles sharing a vertex
 
 		for (int i=0; i<num_shared_triangles; i++ )
 		{
-			triangle_index = _connectivity.at(iv).at(i);
+			triangle_index = connectivity.at(iv).at(i);
 			nrm += _stageprimitivenormals->at(triangle_index);
 		}
 
@@ -453,222 +539,1004 @@ bool SWWReader::loadStageVertexArray(unsigned int index)
 }
 
 
+bool SWWReader::readStage(unsigned int aTimestep, float * aStage, float * aXMomentum, float * aYMomentum)
+{
+	// netcdf open
+	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
+	if (this->_statusHasError())
+	{
+		return false;
+	}
+
+	// --- Check that the stage data hasn't shrunk
+	size_t npoints = 0;
+	_status.push_back( nc_inq_dimlen(_ncid, _npointsid, &npoints) );
+	if (_statusHasError() || (npoints != _fileNumPoints))
+	{
+		// Our indices will not be out of bounds
+		osg::notify(osg::FATAL) << "File changes have made it invalid! Please wait." <<  std::endl;
+		return false;
+	}
+
+	// stage heights from netcdf file (x and y are same as bedslope)
+	const size_t timestep = getFileTimestep(aTimestep);
+	_status.push_back( readPoints(_ncid, _stageid, timestep, 1, 1, _npoints, _regionPoints, _regionRanges, aStage) );
+
+	if (aXMomentum && aYMomentum)
+	{
+		// stage momentum from netcdf file (x and y are same as bedslope)
+		_status.push_back( readPoints(_ncid, _xmomentumid, timestep, 1, 1, _npoints, _regionPoints, _regionRanges, aXMomentum) );
+		_status.push_back( readPoints(_ncid, _ymomentumid, timestep, 1, 1, _npoints, _regionPoints, _regionRanges, aYMomentum) );
+	}
+
+	_status.push_back( nc_close(_ncid) );
+
+	return !_statusHasError();
+}
+
+
+bool SWWReader::getStageVelocity(const unsigned int * aVertices, size_t aCount, float * aU, float * aV)
+{
+	if (!_pxmomentum || !_pymomentum)
+	{
+		return false;
+	}
+
+	DerivedQuantity::computeVelocity(aCount, aVertices, _pstage, _pz, _pxmomentum, _pymomentum, aU, aV);
+	return true;
+}
+
+
 bool SWWReader::getTimeSeries(unsigned int aPolyIndex, TimeSeriesType aPlotType, osg::ref_ptr<osg::FloatArray> aData)
 {
-	PROFILE_BEGIN
+	if (aPolyIndex >= _nvolumes)
+	{
+		return false;
+	}
 
-	// we could get an average of 3 plots here, but it's probably overkill
-	int stage_index = _pvolumes[aPolyIndex*3];
+	// series at the centroid, an even blend of the three vertices
+	float x = 0.0, y = 0.0;
+	for (int k=0; k<3; k++)
+	{
+		x += _px[_pvolumes[3*aPolyIndex+k]];
+		y += _py[_pvolumes[3*aPolyIndex+k]];
+	}
 
+	return getTimeSeries(x/3.0f + _xllcorner, y/3.0f + _yllcorner, aPlotType, aData);
+}
 
-	size_t start[2], count[2];
-	const ptrdiff_t stride[2] = {1,1};
-	start[0] = 0;
-	start[1] = stage_index;
-	count[0] = _ntimesteps;
-	count[1] = 1;
 
-	// netcdf open
-	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
-		if (this->_statusHasError()) return false;
+bool SWWReader::getTimeSeries(double aX, double aY, TimeSeriesType aPlotType, osg::ref_ptr<osg::FloatArray> aData)
+{
+	std::vector<osg::Vec2d> points(1, osg::Vec2d(aX, aY));
+	std::vector< osg::ref_ptr<osg::FloatArray> > series;
+
+	if (!getTimeSeries(points, aPlotType, series) || series[0]->empty())
+	{
+		return false;
+	}
+
+	aData->assign(series[0]->begin(), series[0]->end());
+	return true;
+}
 
-	aData->resize(count[0]);
 
-	switch (aPlotType)
+bool SWWReader::getTimeSeries(const std::vector<osg::Vec2d> & aPoints, TimeSeriesType aPlotType, std::vector< osg::ref_ptr<osg::FloatArray> > & aData,
+							  SeriesProgress * aProgress)
+{
+	PROFILE_BEGIN
+
+	const unsigned int npoints = aPoints.size();
+	std::vector<int> triangles(npoints);
+	std::vector<unsigned int> trianglevertices(3*npoints);
+	std::vector<osg::Vec3> weights(npoints);
+	std::vector<unsigned int> vertices;
+
+	// take what the read needs from the mesh up front, the file is read without
+	// holding the lock for long so this may run on a background thread
+	size_t ntimesteps;
+	const bool momentum = (aPlotType == TSTYPE_MOMENTUM_MAGNITUDE);
+	const char * xname = momentum ? "xmomentum" : "stage";
 	{
-		case TSTYPE_MOMENTUM_MAGNITUDE:
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+
+		if (!_pvolumes)
+		{
+			return false;
+		}
+
+		// every vertex any of the points depends on
+		for (unsigned int i=0; i<npoints; i++)
 		{
-			if (!_pxmomentum || !_pymomentum)
+			triangles[i] = locate(aPoints[i].x(), aPoints[i].y(), &weights[i]);
+			if (triangles[i] >= 0)
 			{
-				break;
+				for (int k=0; k<3; k++)
+				{
+					trianglevertices[3*i+k] = _pvolumes[3*triangles[i]+k];
+					vertices.push_back(trianglevertices[3*i+k]);
+				}
 			}
+		}
 
-			osg::ref_ptr<osg::FloatArray> xmom = new osg::FloatArray;
-			osg::ref_ptr<osg::FloatArray> ymom = new osg::FloatArray;
+		ntimesteps = _ntimesteps;
 
-			xmom->resize(count[0]);
-			ymom->resize(count[0]);
+		if (momentum && (!_pxmomentum || !_pymomentum))
+		{
+			// no momentum in this file, series stay zero
+			vertices.clear();
+		}
+	}
+
+	std::sort(vertices.begin(), vertices.end());
+	vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+	aData.resize(npoints);
+	for (unsigned int i=0; i<npoints; i++)
+	{
+		aData[i] = new osg::FloatArray;
+		if (triangles[i] >= 0)
+		{
+			aData[i]->resize(ntimesteps);
+		}
+	}
+
+	if (vertices.empty())
+	{
+		return true;
+	}
+
+	// all at once, or in chunks of timesteps when someone is watching
+	size_t chunk = ntimesteps;
+	if (aProgress)
+	{
+		chunk = max(ntimesteps / SERIES_PROGRESS_STEPS, (size_t) SERIES_PROGRESS_MIN_CHUNK);
+	}
+
+	std::vector<float> xseries, yseries;
+	std::vector<float> ymom(chunk);
+	int status = NC_NOERR;
+	bool cancelled = false;
+	for (size_t first=0; first<ntimesteps; first+=chunk)
+	{
+		const size_t count = min(chunk, ntimesteps - first);
 
-			// momentum from netcdf file (x and y are same as bedslope)
-			_status.push_back(nc_get_vars_float (_ncid, _xmomentumid, start, count, stride, (float*)xmom->getDataPointer()));
-			_status.push_back(nc_get_vars_float (_ncid, _ymomentumid, start, count, stride, (float*)ymom->getDataPointer()));
+		status = readSeries(xname, first, count, vertices, xseries);
+		if (momentum && (status == NC_NOERR))
+		{
+			status = readSeries("ymomentum", first, count, vertices, yseries);
+		}
+		if (status != NC_NOERR)
+		{
+			break;
+		}
 
-			for (int i=0; i<(int)aData->size(); i++)
+		for (unsigned int i=0; i<npoints; i++)
+		{
+			if (triangles[i] < 0)
 			{
-				aData->at(i) = sqrt(xmom->at(i)*xmom->at(i)+ymom->at(i)*ymom->at(i));
+				continue;
 			}
-			
 
-			break;
+			float * out = (float*)aData[i]->getDataPointer() + first;
+			interpolateSeries(vertices, xseries, count, &trianglevertices[3*i], weights[i], out);
+
+			if (momentum)
+			{
+				// magnitude of the interpolated momentum vector
+				interpolateSeries(vertices, yseries, count, &trianglevertices[3*i], weights[i], &ymom[0]);
+				for (size_t t=0; t<count; t++)
+				{
+					out[t] = sqrt(out[t]*out[t] + ymom[t]*ymom[t]);
+				}
+			}
 		}
 
-		case TSTYPE_STAGE:
-		default:
+		if (aProgress && !aProgress->progress(aData, first + count))
 		{
-			// stage heights from netcdf file (x and y are same as bedslope)
-			_status.push_back(nc_get_vars_float (_ncid, _stageid, start, count, stride, (float*)aData->getDataPointer()));
+			cancelled = true;
 			break;
 		}
 	}
 
-	_status.push_back( nc_close(_ncid) );
-
-	if (_statusHasError())
+	if (status != NC_NOERR)
 	{
+		osg::notify(osg::WARN) << "[SWWReader] Unable to read timeseries: " << nc_strerror(status) << std::endl;
 		return false;
 	}
 
 	PROFILE_END
 
-	return true;
+	return !cancelled;
 }
 
 
-
-bool SWWReader::_statusHasError()
+int SWWReader::readSeries(const char * aVariable, size_t aFirstTimestep, size_t aNumTimesteps, const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries)
 {
-	bool haserror = false;  // assume success, trap failure
-
-	std::vector<int>::iterator iter;
-	for (iter=_status.begin(); iter != _status.end(); iter++)
+	// own file handle and status, leaving the reader's to the render thread
+	int ncid, varid, status;
+	size_t first, stride;
+	std::vector<unsigned int> points(aVertices);
 	{
-		if (*iter != NC_NOERR)
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+		first = getFileTimestep(aFirstTimestep);
+		stride = _options.timeWindow.getStride();
+
+		// to the file's points, still in order as the region keeps the file's order;
+		// under the lock, as a reload rebuilds the region
+		if (!_regionPoints.empty())
 		{
-			osg::notify(osg::FATAL) << "Error: " << nc_strerror(*iter) <<  std::endl;
-			haserror = true;
-			nc_close(_ncid);
-			break;
+			for (size_t i=0; i<points.size(); i++)
+			{
+				if (points[i] >= _regionPoints.size())
+				{
+					return NC_EINVALCOORDS;
+				}
+				points[i] = _regionPoints[points[i]];
+			}
+		}
+
+		status = nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &ncid);
+		if (status != NC_NOERR)
+		{
+			return status;
 		}
+		status = nc_inq_varid(ncid, aVariable, &varid);
 	}
 
-	// on return start gathering result values afresh
-	_status.clear();
+	if (status == NC_NOERR)
+	{
+		status = readVertexSeries(ncid, varid, first, aNumTimesteps, stride, points, aSeries);
+	}
 
-	return haserror;
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+	nc_close(ncid);
+	return status;
 }
 
 
-bool SWWReader::refresh()
+int SWWReader::readVertexSeries(int aNcid, int aVarID, size_t aFirstTimestep, size_t aNumTimesteps, size_t aStride,
+								const std::vector<unsigned int> & aVertices, std::vector<float> & aSeries)
 {
-	if (_fileChanged.isChanged())
+	const size_t nvertices = aVertices.size();
+	aSeries.resize(nvertices * aNumTimesteps);
+	if (!aNumTimesteps)
 	{
-		clear();
-		return load();
+		return NC_NOERR;
 	}
 
-	return true;
-}
+	// widest block of points read at once, so very long runs don't need huge buffers
+	size_t maxspan = SERIES_READ_MAX_BLOCK / aNumTimesteps;
+	if (maxspan < 1)
+	{
+		maxspan = 1;
+	}
 
+	std::vector<float> block;
+	size_t i = 0;
+	while (i < nvertices)
+	{
+		// grow the block while the next vertex is close, reading a few unwanted points
+		// between them is cheaper than a separate strided read
+		const unsigned int first = aVertices[i];
+		size_t j = i + 1;
+		while ((j < nvertices) && (aVertices[j] - aVertices[j-1] <= SERIES_READ_MAX_GAP) && (aVertices[j] - first < maxspan))
+		{
+			j++;
+		}
 
-void SWWReader::clear()
-{
-	_valid = false;
+		size_t span = aVertices[j-1] - first + 1;
+		size_t start[2], count[2];
+		ptrdiff_t stride[2];
+		start[0] = aFirstTimestep;
+		start[1] = first;
+		count[0] = aNumTimesteps;
+		count[1] = span;
+		stride[0] = aStride;
+		stride[1] = 1;
 
-	SAFE_DELETE_ARRAY(_pxmomentum);
-	SAFE_DELETE_ARRAY(_pymomentum);
-	SAFE_DELETE_ARRAY(_px);
-	SAFE_DELETE_ARRAY(_py);
-	SAFE_DELETE_ARRAY(_pz);
-	SAFE_DELETE_ARRAY(_ptime);
-	SAFE_DELETE_ARRAY(_pvolumes);
-	SAFE_DELETE_ARRAY(_pstage);
+		block.resize(aNumTimesteps * span);
+
+		// one block at a time, so the render thread never waits on more than one read
+		int status;
+		{
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+			status = nc_get_vars_float(aNcid, aVarID, start, count, stride, &block[0]);
+		}
+		if (status != NC_NOERR)
+		{
+			return status;
+		}
+
+		for (size_t k=i; k<j; k++)
+		{
+			const size_t column = aVertices[k] - first;
+			for (size_t t=0; t<aNumTimesteps; t++)
+			{
+				aSeries[k*aNumTimesteps + t] = block[t*span + column];
+			}
+		}
+
+		i = j;
+	}
+
+	return NC_NOERR;
 }
 
 
-bool SWWReader::load()
+void SWWReader::interpolateSeries(const std::vector<unsigned int> & aVertices, const std::vector<float> & aSeries, size_t aNumTimesteps,
+								  const unsigned int * aTriangle, const osg::Vec3 & aWeights, float * aOut)
 {
-	if (!_state.swwfilename)
+	const float * series[3];
+	for (int k=0; k<3; k++)
 	{
-		return false;
+		size_t index = std::lower_bound(aVertices.begin(), aVertices.end(), aTriangle[k]) - aVertices.begin();
+		series[k] = &aSeries[index * aNumTimesteps];
 	}
 
-	// netcdf open
-	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
-	if (this->_statusHasError())
+	for (size_t t=0; t<aNumTimesteps; t++)
 	{
-		return false;
+		aOut[t] = aWeights[0]*series[0][t] + aWeights[1]*series[1][t] + aWeights[2]*series[2][t];
 	}
+}
 
-	// dimension ids
-	_status.push_back( nc_inq_dimid(_ncid, "number_of_volumes", &_nvolumesid) );
-	_status.push_back( nc_inq_dimid(_ncid, "number_of_vertices", &_nverticesid) );
-	_status.push_back( nc_inq_dimid(_ncid, "number_of_points", &_npointsid) );
-	_status.push_back( nc_inq_dimid(_ncid, "number_of_timesteps", &_ntimestepsid) );
-	if (this->_statusHasError()) return false;
-
-	// dimension values
-	_status.push_back( nc_inq_dimlen(_ncid, _nvolumesid, &_nvolumes) );
-	_status.push_back( nc_inq_dimlen(_ncid, _nverticesid, &_nvertices) );
-	_status.push_back( nc_inq_dimlen(_ncid, _npointsid, &_npoints) );
-	_status.push_back( nc_inq_dimlen(_ncid, _ntimestepsid, &_ntimesteps) );
-	if (this->_statusHasError()) return false;
 
-	// variable ids
-	_status.push_back( nc_inq_varid (_ncid, "x", &_xid) );
-	_status.push_back( nc_inq_varid (_ncid, "y", &_yid) );
 
-	if (nc_inq_varid (_ncid, "elevation", &_zid) != NC_NOERR)
-	{
-		// If we failed to find the elevation var, this is likely to be an old-style file.
-		osg::notify(osg::INFO) << "[SWWReader] Warning: variable 'elevation' not found. Trying old format 'z' instead." << std::endl;
-		_status.push_back( nc_inq_varid (_ncid, "z", &_zid) );
-	}
-	else
+bool SWWReader::FrameVisitorList::visit(const FrameData & aFrame)
+{
+	for (size_t i=0; i<_visitors.size(); )
 	{
-		// now we check for multiple bedslope frames
-		int num_dims;
-		_status.push_back(nc_inq_varndims(_ncid, _zid, &num_dims));
-		if (num_dims == 2)
+		if (_visitors[i]->visit(aFrame))
 		{
-			osg::notify(osg::INFO) << "[SWWReader] Animated elevation data found. " << std::endl;
-			_elevationAnimated = true;
+			i++;
 		}
 		else
 		{
-			osg::notify(osg::INFO) << "[SWWReader] Static elevation data only. " <<  std::endl;
-			assert(num_dims == 1 && "Wrong num of dimensions for elevation data - unknown file format!");
+			_visitors.erase(_visitors.begin() + i);
 		}
-
-		_status.push_back( NC_NOERR );
 	}
 
-	_status.push_back( nc_inq_varid (_ncid, "volumes", &_volumesid) );
-	_status.push_back( nc_inq_varid (_ncid, "time", &_timeid) );
-	_status.push_back( nc_inq_varid (_ncid, "stage", &_stageid) );
+	return !_visitors.empty();
+}
+
+
+
+bool SWWReader::readFrames(FrameVisitor & aVisitor, bool aLowPriority)
+{
+	PROFILE_BEGIN
+
+	// as for getTimeSeries, take what's needed up front and read with a handle of our own
+	std::string filename;
+	size_t npoints, ntimesteps, timefirst, timestride;
+	int stageid, xmomentumid, ymomentumid, zid;
+	bool momentum, animated;
+	std::vector<float> times;
+	std::vector<unsigned int> points;
+	std::vector<PointRange> ranges;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+
+		if (!_valid || !_ptime)
+		{
+			return false;
+		}
+
+		filename = *_state.swwfilename;
+		npoints = _npoints;
+		ntimesteps = _ntimesteps;
+		stageid = _stageid;
+		xmomentumid = _xmomentumid;
+		ymomentumid = _ymomentumid;
+		zid = _zid;
+		momentum = (_pxmomentum && _pymomentum);
+		animated = _elevationAnimated;
+		times.assign(_ptime, _ptime + _ntimesteps);
+		timefirst = _timeFirst;
+		timestride = _options.timeWindow.getStride();
+		points = _regionPoints;
+		ranges = _regionRanges;
+	}
+
+	if (!npoints || !ntimesteps)
+	{
+		return true;
+	}
+
+	int ncid, status;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+		status = nc_open(filename.c_str(), NC_NOWRITE, &ncid);
+	}
+	if (status != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[SWWReader] Unable to read frames: " << nc_strerror(status) << std::endl;
+		return false;
+	}
+
+	// whole timesteps, as many as fit a block, so the reads walk the records in order;
+	// the ranges of a region are read into a block of their own
+	size_t widest = npoints;
+	for (size_t r=0; r<ranges.size(); r++)
+	{
+		widest = max(widest, ranges[r]._count);
+	}
+	const size_t maxblock = aLowPriority ? FRAME_READ_LOW_PRIORITY_BLOCK : FRAME_READ_MAX_BLOCK;
+	const size_t blocksteps = max(maxblock / widest, (size_t) 1);
+	const size_t blocksize = blocksteps * npoints;
+
+	std::vector<float> stage(blocksize);
+	std::vector<float> xmomentum(momentum ? blocksize : 0);
+	std::vector<float> ymomentum(momentum ? blocksize : 0);
+	std::vector<float> elevation(animated ? blocksize : npoints);
+
+	if (!animated)
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+		status = readPoints(ncid, zid, 0, 0, 1, npoints, points, ranges, &elevation[0]);
+	}
+
+	bool stopped = false;
+	for (size_t first=0; (first<ntimesteps) && (status == NC_NOERR) && !stopped; first+=blocksteps)
+	{
+		const size_t nsteps = min(blocksteps, ntimesteps - first);
+
+		// a variable at a time, so the render thread never waits on more than one read
+		const int varids[4] = { stageid, xmomentumid, ymomentumid, zid };
+		float * buffers[4] = { &stage[0], momentum ? &xmomentum[0] : NULL, momentum ? &ymomentum[0] : NULL, animated ? &elevation[0] : NULL };
+		for (int var=0; (var<4) && (status == NC_NOERR); var++)
+		{
+			if (!buffers[var])
+			{
+				continue;
+			}
+
+			if (aLowPriority)
+			{
+				giveWayToFrameLoads();
+			}
+
+			OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+			status = readPoints(ncid, varids[var], timefirst + first*timestride, nsteps, timestride, npoints, points, ranges, buffers[var]);
+		}
+		if (status != NC_NOERR)
+		{
+			break;
+		}
+
+		for (size_t t=0; t<nsteps; t++)
+		{
+			const size_t offset = t * npoints;
+
+			FrameData frame;
+			frame._timestep = first + t;
+			frame._time = times[first + t];
+			frame._numPoints = npoints;
+			frame._stage = &stage[offset];
+			frame._xmomentum = momentum ? &xmomentum[offset] : NULL;
+			frame._ymomentum = momentum ? &ymomentum[offset] : NULL;
+			frame._elevation = animated ? &elevation[offset] : &elevation[0];
+
+			if (!aVisitor.visit(frame))
+			{
+				stopped = true;
+				break;
+			}
+		}
+	}
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+		nc_close(ncid);
+	}
+
+	if (status != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[SWWReader] Unable to read frames: " << nc_strerror(status) << std::endl;
+		return false;
+	}
+
+	PROFILE_END
+
+	return !stopped;
+}
+
+
+bool SWWReader::readFrame(unsigned int aTimestep, std::vector<float> & aStage, std::vector<float> & aElevation)
+{
+	// counted while waiting, as a frame load is
+	++s_framesWaiting;
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+	--s_framesWaiting;
+
+	if (!_valid || (aTimestep >= _ntimesteps))
+	{
+		return false;
+	}
+
+	aStage.resize(_npoints);
+	aElevation.resize(_npoints);
+	return readStage(aTimestep, &aStage[0], NULL, NULL) && readElevation(aTimestep, &aElevation[0]);
+}
+
+
+osg::ref_ptr<FrameCache::Frame> SWWReader::loadFrame(unsigned int aTimestep)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+
+	if (!_valid || (aTimestep >= _ntimesteps))
+	{
+		return NULL;
+	}
+
+	// recently read, refresh() has already dropped it if the file changed since
+	osg::ref_ptr<FrameCache::Frame> frame = _frameCache.find(aTimestep);
+	if (frame.valid())
+	{
+		return frame;
+	}
+
+	frame = new FrameCache::Frame(aTimestep);
+	frame->_stage.resize(_npoints);
+	if (hasMomentum())
+	{
+		frame->_xmomentum.resize(_npoints);
+		frame->_ymomentum.resize(_npoints);
+	}
+	float * arrays[3] = { &frame->_stage[0],
+						  frame->_xmomentum.empty() ? NULL : &frame->_xmomentum[0],
+						  frame->_ymomentum.empty() ? NULL : &frame->_ymomentum[0] };
+
+	// decoded by another viewer, or else read here and offered to the others
+	if (!_sharedCache.valid() || !_sharedCache->find(getFileTimestep(aTimestep), arrays))
+	{
+		// a failed read is neither drawn nor cached
+		if (!readStage(aTimestep, arrays[0], arrays[1], arrays[2]))
+		{
+			return NULL;
+		}
+
+		if (_sharedCache.valid())
+		{
+			_sharedCache->insert(getFileTimestep(aTimestep), arrays);
+		}
+	}
+
+	_frameCache.insert(frame.get());
+	return frame;
+}
+
+
+osg::ref_ptr<FrameRequest> SWWReader::requestFrame(unsigned int aTimestep, int aPriority)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_schedulerMutex);
+	if (!_scheduler)
+	{
+		_scheduler = new FrameScheduler(this);
+	}
+	return _scheduler->request(aTimestep, aPriority);
+}
+
+
+void SWWReader::stopFrameRequests()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_schedulerMutex);
+	delete _scheduler;
+	_scheduler = NULL;
+}
+
+
+bool SWWReader::_statusHasError()
+{
+	bool haserror = false;  // assume success, trap failure
+
+	std::vector<int>::iterator iter;
+	for (iter=_status.begin(); iter != _status.end(); iter++)
+	{
+		if (*iter != NC_NOERR)
+		{
+			osg::notify(osg::FATAL) << "Error: " << nc_strerror(*iter) <<  std::endl;
+			haserror = true;
+			nc_close(_ncid);
+			break;
+		}
+	}
+
+	// on return start gathering result values afresh
+	_status.clear();
+
+	return haserror;
+}
+
+
+bool SWWReader::refresh()
+{
+	// only a flag test, called every frame
+	if (!_fileChanged.isChanged())
+	{
+		return true;
+	}
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(s_netcdfMutex);
+
+	// usually a running simulation writing another timestep
+	if (appendTimesteps())
+	{
+		return true;
+	}
+
+	clear();
+	_valid = load();
+	return _valid;
+}
+
+
+size_t SWWReader::countCompleteTimesteps(int aNcid, size_t aNumTimesteps, size_t aNumPoints)
+{
+	static const char * names[4] = { "time", "stage", "xmomentum", "ymomentum" };
+
+	std::vector<float> values(max(aNumPoints, (size_t) 1));
+	size_t complete = aNumTimesteps;
+	while ((complete > 0) && (aNumTimesteps - complete < APPEND_CHECK_RECORDS))
+	{
+		bool written = true;
+		for (int var=0; (var<4) && written; var++)
+		{
+			int varid;
+			if (nc_inq_varid(aNcid, names[var], &varid) != NC_NOERR)
+			{
+				// momentum is optional
+				continue;
+			}
+
+			// time has one value a record, the others one per point
+			const size_t n = var ? aNumPoints : 1;
+			size_t start[2], count[2];
+			start[0] = complete-1;
+			start[1] = 0;
+			count[0] = 1;
+			count[1] = n;
+
+			written = (nc_get_vara_float(aNcid, varid, start, count, &values[0]) == NC_NOERR) &&
+					  (std::find(values.begin(), values.begin() + n, (float) NC_FILL_FLOAT) == values.begin() + n);
+		}
+
+		if (written)
+		{
+			break;
+		}
+		complete--;
+	}
+
+	return complete;
+}
+
+
+int SWWReader::readTimes(int aNcid, int aTimeid, size_t aNumTimesteps, float * aTimes)
+{
+	if (aNumTimesteps == 0)
+	{
+		return NC_NOERR;
+	}
+
+	size_t start = 0;
+	return nc_get_vara_float(aNcid, aTimeid, &start, &aNumTimesteps, aTimes);
+}
+
+
+/**
+ * Get the modification time of a file, to the best resolution the platform gives.
+ * @return seconds since 1970, 0 if the file can't be read
+ */
+static double getModificationTime(const std::string & aFilename)
+{
+	struct stat buf;
+	if (stat(aFilename.c_str(), &buf) != 0)
+	{
+		return 0.0;
+	}
+
+#if defined(__linux__)
+	return buf.st_mtim.tv_sec + buf.st_mtim.tv_nsec * 1.0e-9;
+#else
+	return (double) buf.st_mtime;
+#endif
+}
+
+
+/**
+ * Get the wall clock time, as getModificationTime().
+ */
+static double getWallClockTime()
+{
+#ifdef WIN32
+	struct _timeb now;
+	_ftime(&now);
+	return now.time + now.millitm * 1.0e-3;
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec * 1.0e-6;
+#endif
+}
+
+
+float SWWReader::getAppendAge()
+{
+	if (_appendTime <= 0.0)
+	{
+		return -1.0f;
+	}
+
+	return (float) (getWallClockTime() - _appendTime);
+}
+
+
+size_t SWWReader::readDimension(int aNcid, const char * aName)
+{
+	int dimid;
+	size_t length = 0;
+	if ((nc_inq_dimid(aNcid, aName, &dimid) != NC_NOERR) || (nc_inq_dimlen(aNcid, dimid, &length) != NC_NOERR))
+	{
+		return 0;
+	}
+	return length;
+}
+
+
+bool SWWReader::readCompleteTimes(std::vector<float> & aTimes, bool & aPartial)
+{
+	aPartial = false;
+
+	int ncid;
+	if (nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+	{
+		return false;
+	}
+
+	size_t ntimesteps = readDimension(ncid, "number_of_timesteps");
+	bool appended = (readDimension(ncid, "number_of_volumes") == _fileNumVolumes) &&
+					(readDimension(ncid, "number_of_vertices") == _nvertices) &&
+					(readDimension(ncid, "number_of_points") == _fileNumPoints) &&
+					(ntimesteps > _fileNumTimesteps);
+
+	if (appended)
+	{
+		// the newest may be still being written, and is taken on by a later refresh
+		const size_t complete = countCompleteTimesteps(ncid, ntimesteps, _fileNumPoints);
+		aPartial = (complete < ntimesteps);
+		ntimesteps = complete;
+
+		int timeid;
+		aTimes.resize(ntimesteps);
+		appended = (nc_inq_varid(ncid, "time", &timeid) == NC_NOERR) &&
+				   (readTimes(ncid, timeid, ntimesteps, &aTimes[0]) == NC_NOERR);
+	}
+
+	nc_close(ncid);
+	return appended;
+}
+
+
+bool SWWReader::hasTimesLoaded(const std::vector<float> & aFileTimes) const
+{
+	if (aFileTimes.size() < _fileNumTimesteps)
+	{
+		return false;
+	}
+
+	for (size_t t=0; t<_ntimesteps; t++)
+	{
+		if (aFileTimes[getFileTimestep(t)] != _ptime[t])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+bool SWWReader::appendTimesteps()
+{
+	if (!_valid || !_ptime)
+	{
+		return false;
+	}
+
+	// the same mesh with more timesteps, those already read unchanged; a rerun starts
+	// again with fewer, so is reloaded
+	std::vector<float> times;
+	bool partial;
+	if (!readCompleteTimes(times, partial) || !hasTimesLoaded(times))
+	{
+		return false;
+	}
+
+	// its last write may leave the file looking just as it does now, when polled, so it
+	// is looked at again; not every frame though, as this read is on the render thread
+	if (times.size() != _fileNumTimesteps)
+	{
+		_partialRechecks = 0;
+	}
+	if (partial && (_partialRechecks < APPEND_PARTIAL_RECHECKS))
+	{
+		_partialRechecks++;
+		_fileChanged.recheckAfter(APPEND_PARTIAL_RECHECK_MS);
+	}
+
+	if (times.size() == _fileNumTimesteps)
+	{
+		// nothing complete yet
+		return true;
+	}
+
+	// as far into the window as the file now goes, from the same first timestep
+	_fileNumTimesteps = times.size();
+	const size_t ntimesteps = _options.timeWindow.getCount(&times[0], times.size(), _timeFirst);
+	if (ntimesteps == _ntimesteps)
+	{
+		// past the end of the window
+		return true;
+	}
+
+	// mesh, connectivity, bedslope and the frames already cached all stay as they are
+	float * ptime = new float[ntimesteps];
+	for (size_t t=0; t<ntimesteps; t++)
+	{
+		ptime[t] = times[getFileTimestep(t)];
+	}
+	delete [] _ptime;
+	_ptime = ptime;
+	_ntimesteps = ntimesteps;
+	_appendTime = getModificationTime(*_state.swwfilename);
+
+	osg::notify(osg::INFO) << "[SWWReader] number of timesteps grew to " << _ntimesteps << std::endl;
+
+	return true;
+}
+
+
+void SWWReader::clear()
+{
+	_valid = false;
+
+	_frameCache.clear();
+	_sharedCache = NULL;
+
+	SAFE_DELETE_ARRAY(_pxmomentum);
+	SAFE_DELETE_ARRAY(_pymomentum);
+	SAFE_DELETE_ARRAY(_pz);
+	SAFE_DELETE_ARRAY(_ptime);
+	SAFE_DELETE_ARRAY(_pstage);
+
+	// freed with the mesh, once no other run shares it
+	_px = NULL;
+	_py = NULL;
+	_pvolumes = NULL;
+	_mesh = NULL;
+	_bedslopeindices = NULL;
+	_regionPoints.clear();
+	_regionRanges.clear();
+}
+
+
+bool SWWReader::readHeader(bool & aMomentum)
+{
+	if (!_state.swwfilename)
+	{
+		return false;
+	}
+
+	// netcdf open
+	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
+	if (this->_statusHasError())
+	{
+		return false;
+	}
+
+	// dimension ids
+	_status.push_back( nc_inq_dimid(_ncid, "number_of_volumes", &_nvolumesid) );
+	_status.push_back( nc_inq_dimid(_ncid, "number_of_vertices", &_nverticesid) );
+	_status.push_back( nc_inq_dimid(_ncid, "number_of_points", &_npointsid) );
+	_status.push_back( nc_inq_dimid(_ncid, "number_of_timesteps", &_ntimestepsid) );
+	if (this->_statusHasError()) return false;
+
+	// dimension values
+	_status.push_back( nc_inq_dimlen(_ncid, _nvolumesid, &_nvolumes) );
+	_status.push_back( nc_inq_dimlen(_ncid, _nverticesid, &_nvertices) );
+	_status.push_back( nc_inq_dimlen(_ncid, _npointsid, &_npoints) );
+	_status.push_back( nc_inq_dimlen(_ncid, _ntimestepsid, &_ntimesteps) );
+	if (this->_statusHasError()) return false;
+
+	// variable ids
+	_status.push_back( nc_inq_varid (_ncid, "x", &_xid) );
+	_status.push_back( nc_inq_varid (_ncid, "y", &_yid) );
+
+	if (nc_inq_varid (_ncid, "elevation", &_zid) != NC_NOERR)
+	{
+		// If we failed to find the elevation var, this is likely to be an old-style file.
+		osg::notify(osg::INFO) << "[SWWReader] Warning: variable 'elevation' not found. Trying old format 'z' instead." << std::endl;
+		_status.push_back( nc_inq_varid (_ncid, "z", &_zid) );
+	}
+	else
+	{
+		// now we check for multiple bedslope frames
+		int num_dims;
+		_status.push_back(nc_inq_varndims(_ncid, _zid, &num_dims));
+		if (num_dims == 2)
+		{
+			osg::notify(osg::INFO) << "[SWWReader] Animated elevation data found. " << std::endl;
+			_elevationAnimated = true;
+		}
+		else
+		{
+			osg::notify(osg::INFO) << "[SWWReader] Static elevation data only. " <<  std::endl;
+			assert(num_dims == 1 && "Wrong num of dimensions for elevation data - unknown file format!");
+		}
+
+		_status.push_back( NC_NOERR );
+	}
+
+	_status.push_back( nc_inq_varid (_ncid, "volumes", &_volumesid) );
+	_status.push_back( nc_inq_varid (_ncid, "time", &_timeid) );
+	_status.push_back( nc_inq_varid (_ncid, "stage", &_stageid) );
 	if (this->_statusHasError())
 	{
 		return false;
 	}
 
+	// a running simulation may be part way through writing the newest timestep
+	_ntimesteps = countCompleteTimesteps(_ncid, _ntimesteps, _npoints);
+
 	// --- Look for momentum data
-	if ((nc_inq_varid (_ncid, "xmomentum", &_xmomentumid) != NC_NOERR) ||
-		(nc_inq_varid (_ncid, "ymomentum", &_ymomentumid) != NC_NOERR)) 
+	aMomentum = (nc_inq_varid (_ncid, "xmomentum", &_xmomentumid) == NC_NOERR) &&
+				(nc_inq_varid (_ncid, "ymomentum", &_ymomentumid) == NC_NOERR);
+	if (!aMomentum)
 	{
 		osg::notify(osg::INFO) << "[SWWReader] No momentum data found." << std::endl;
-		_pxmomentum = NULL;
-		_pymomentum = NULL;
 	}
-	else
+
+	_ptime = new float[_ntimesteps];
+	_status.push_back( readTimes(_ncid, _timeid, _ntimesteps, _ptime) );  // time array
+
+	return !this->_statusHasError();
+}
+
+
+void SWWReader::allocateFrameArrays(bool aMomentum)
+{
+	SAFE_DELETE_ARRAY(_pz);
+	SAFE_DELETE_ARRAY(_pstage);
+	SAFE_DELETE_ARRAY(_pxmomentum);
+	SAFE_DELETE_ARRAY(_pymomentum);
+
+	_pz = new float[_npoints];	// bedslope z
+	_pstage = new float[_npoints];
+	if (aMomentum)
 	{
 		_pxmomentum = new float[_npoints];
 		_pymomentum = new float[_npoints];
 	}
+}
 
 
-	// allocation of variable arrays, destructor responsible for cleanup
-	_px = new float[_npoints];
-	_py = new float[_npoints];
-	_pz = new float[_npoints];	// bedslope z
+bool SWWReader::readMesh()
+{
+	bool momentum;
+	if (!readHeader(momentum))
+	{
+		return false;
+	}
 
-	_ptime = new float[_ntimesteps];
-	_pvolumes = new unsigned int[_nvertices * _nvolumes];
-	_pstage = new float[_npoints];
+	// allocation of variable arrays, destructor responsible for cleanup
+	_mesh = new MeshData(_npoints, _nvolumes);
+	_px = _mesh->getX();
+	_py = _mesh->getY();
+	_pvolumes = _mesh->getTriangles();
+	allocateFrameArrays(momentum);
 
 	// loading variables from netcdf file
 	_status.push_back( nc_get_var_float (_ncid, _xid, _px) );  // x vertices
 	_status.push_back( nc_get_var_float (_ncid, _yid, _py) );  // y vertices
-	
-	_status.push_back( nc_get_var_float (_ncid, _timeid, _ptime) );  // time array
 	_status.push_back( nc_get_var_int (_ncid, _volumesid, (int *) _pvolumes) );  // triangle indices
 
 	if (this->_statusHasError()) return false;
@@ -679,19 +1547,32 @@ bool SWWReader::load()
 	osg::notify(osg::INFO) << "[SWWReader] number of points: " << _npoints <<  std::endl;
 	osg::notify(osg::INFO) << "[SWWReader] number of timesteps: " << _ntimesteps <<  std::endl;
 
+	// attributes before the file is closed, they are read through its handle
+	readAttributes();
+
 	// --- close file, we have finished with it
 	_status.push_back( nc_close(_ncid) );
 
+	// the region is in georeferenced coordinates, so cut once the offset is known
+	_fileNumVolumes = _nvolumes;
+	_fileNumPoints = _npoints;
+	return applyTimeWindow() && applyRegion();
+}
+
+
+void SWWReader::readAttributes()
+{
 	// sww file can optionally contain bedslope texture image filename
 	size_t attlen; // length of text attribute (if it exists)
-	if( nc_inq_attlen(_ncid, NC_GLOBAL, "texture", &attlen) != NC_ENOTATT )
+	if( nc_inq_attlen(_ncid, NC_GLOBAL, "texture", &attlen) == NC_NOERR )
 	{
-		std::string texfilename;
+		// terminated here, it needn't be in the file
+		std::vector<char> text(attlen + 1, '\0');
 		int status;
-		status = nc_get_att_text(_ncid, NC_GLOBAL, "texture", (char*)texfilename.c_str());
+		status = nc_get_att_text(_ncid, NC_GLOBAL, "texture", &text[0]);
 		if( status == NC_NOERR )
 		{
-			texfilename[attlen] = '\0';  // ensure string is terminated, not a requirement for netcdf attributes
+			std::string texfilename(&text[0]);
 			osg::notify(osg::INFO) << "[SWWReader] embedded image filename: " << texfilename <<  std::endl;
 
 			// if sww isn't in current directory, need to prepend sww path to the bedslope texture
@@ -707,8 +1588,8 @@ bool SWWReader::load()
 	}
 
 	// sww file can optionally contain georeference offset
-	int status1 = nc_get_att_float(_ncid, NC_GLOBAL, "xllcorner", &_xllcorner);
-	int status2 = nc_get_att_float(_ncid, NC_GLOBAL, "yllcorner", &_yllcorner);
+	int status1 = nc_get_att_double(_ncid, NC_GLOBAL, "xllcorner", &_xllcorner);
+	int status2 = nc_get_att_double(_ncid, NC_GLOBAL, "yllcorner", &_yllcorner);
 	if( status1 == NC_NOERR && status2 == NC_NOERR)
 	{
 		osg::notify(osg::INFO) << "[SWWReader] xllcorner: " << _xllcorner <<  std::endl;
@@ -719,67 +1600,327 @@ bool SWWReader::load()
 		_xllcorner = 0.0;  // default value
 		_yllcorner = 0.0;
 	}
+}
 
 
-	// alpha-scaling defaults, can be overridden after construction by command line parameters
-	_state.alphamin = DEFAULT_ALPHAMIN;
-	_state.alphamax = DEFAULT_ALPHAMAX;
-	_state.heightmin = DEFAULT_HEIGHTMIN;
-	_state.heightmax = DEFAULT_HEIGHTMAX;
+bool SWWReader::applyTimeWindow()
+{
+	_fileNumTimesteps = _ntimesteps;
+	_timeFirst = 0;
+	if (_options.timeWindow.isEmpty())
+	{
+		return true;
+	}
 
-	// steepness culling default, can be overridden after construction by command line parameter
-	_state.cullangle = DEFAULT_CULLANGLE;
-	_state.culling = DEFAULT_CULLONSTART;
+	_timeFirst = _options.timeWindow.getFirst(_ptime, _ntimesteps);
+	const size_t ntimesteps = _options.timeWindow.getCount(_ptime, _ntimesteps, _timeFirst);
+	if (ntimesteps == 0)
+	{
+		osg::notify(osg::WARN) << "[SWWReader] No timesteps of " << *_state.swwfilename << " are in the window" << std::endl;
+		return false;
+	}
 
-	// loop index
-	size_t iv;
-	// vertex indices
-	unsigned int v1index, v2index, v3index;
+	// only the times of the window kept, in place as each moves no later
+	for (size_t t=0; t<ntimesteps; t++)
+	{
+		_ptime[t] = _ptime[getFileTimestep(t)];
+	}
+	_ntimesteps = ntimesteps;
 
-	// compute triangle connectivity, a list (indexed by vertex number) 
-	// of lists (indices of triangles sharing this vertex)
-	_connectivity = std::vector<triangle_list>(_npoints);
-	for (iv=0; iv < _nvolumes; iv++)
+	osg::notify(osg::INFO) << "[SWWReader] window holds " << _ntimesteps << " of " << _fileNumTimesteps << " timesteps, from "
+						   << _timeFirst << " every " << _options.timeWindow.getStride() << std::endl;
+
+	return true;
+}
+
+
+bool SWWReader::applyRegion()
+{
+	_regionPoints.clear();
+	_regionRanges.clear();
+	if (_options.region.isEmpty())
 	{
-		v1index = _pvolumes[3*iv+0];
-		v2index = _pvolumes[3*iv+1];
-		v3index = _pvolumes[3*iv+2];
+		return true;
+	}
+
+	std::vector<bool> inside(_npoints);
+	for (size_t iv=0; iv<_npoints; iv++)
+	{
+		inside[iv] = _options.region.contains((double) _px[iv] + _xllcorner, (double) _py[iv] + _yllcorner);
+	}
+
+	// triangles with any corner inside, so the region is covered right up to its edge
+	std::vector<unsigned int> triangles;
+	std::vector<unsigned int> vertex(_npoints, REGION_UNUSED);
+	for (size_t it=0; it<_nvolumes; it++)
+	{
+		const unsigned int * corners = &_pvolumes[3*it];
+		if ((corners[0] >= _npoints) || (corners[1] >= _npoints) || (corners[2] >= _npoints))
+		{
+			continue;
+		}
+
+		if (inside[corners[0]] || inside[corners[1]] || inside[corners[2]])
+		{
+			triangles.push_back(it);
+			vertex[corners[0]] = vertex[corners[1]] = vertex[corners[2]] = 0;
+		}
+	}
+
+	if (triangles.empty())
+	{
+		osg::notify(osg::WARN) << "[SWWReader] No triangles of " << *_state.swwfilename << " are in the region" << std::endl;
+		return false;
+	}
+
+	// renumbered in file order, so each frame still reads the file front to back
+	std::vector<unsigned int> points;
+	for (size_t iv=0; iv<_npoints; iv++)
+	{
+		if (vertex[iv] != REGION_UNUSED)
+		{
+			vertex[iv] = points.size();
+			points.push_back(iv);
+		}
+	}
+
+	const size_t npoints = points.size();
+	const size_t nvolumes = triangles.size();
+	osg::ref_ptr<MeshData> mesh = new MeshData(npoints, nvolumes);
+	float * x = mesh->getX();
+	float * y = mesh->getY();
+	for (size_t iv=0; iv<npoints; iv++)
+	{
+		x[iv] = _px[points[iv]];
+		y[iv] = _py[points[iv]];
+	}
+	unsigned int * volumes = mesh->getTriangles();
+	for (size_t it=0; it<nvolumes; it++)
+	{
+		for (int k=0; k<3; k++)
+		{
+			volumes[3*it+k] = vertex[_pvolumes[3*triangles[it]+k]];
+		}
+	}
+
+	// the whole mesh goes
+	setSelection(mesh.get(), points, _pxmomentum != NULL);
+
+	osg::notify(osg::INFO) << "[SWWReader] region holds " << _nvolumes << " of " << _fileNumVolumes << " triangles and " << _npoints << " of " << _fileNumPoints << " points, read in " << _regionRanges.size() << " ranges" << std::endl;
+
+	return true;
+}
 
-		if (v1index<_npoints)
+
+void SWWReader::setSelection(MeshData * aMesh, const std::vector<unsigned int> & aPoints, bool aMomentum)
+{
+	_mesh = aMesh;
+	_px = _mesh->getX();
+	_py = _mesh->getY();
+	_pvolumes = _mesh->getTriangles();
+	_npoints = _mesh->getNumberOfPoints();
+	_nvolumes = _mesh->getNumberOfTriangles();
+	_regionPoints = aPoints;
+	_regionRanges.clear();
+
+	// the arrays read a frame at a time shrink to the selection
+	allocateFrameArrays(aMomentum);
+
+	// nearby points read together, a few unwanted ones being cheaper than another read
+	const size_t npoints = _regionPoints.size();
+	size_t i = 0;
+	while (i < npoints)
+	{
+		const unsigned int first = _regionPoints[i];
+		size_t j = i + 1;
+		while ((j < npoints) && (_regionPoints[j] - _regionPoints[j-1] <= REGION_READ_MAX_GAP) && (_regionPoints[j] - first < REGION_READ_MAX_SPAN))
 		{
-			_connectivity.at(v1index).push_back(iv);
+			j++;
 		}
 
-		if (v2index<_npoints)
+		PointRange range;
+		range._start = first;
+		range._count = _regionPoints[j-1] - first + 1;
+		range._first = i;
+		range._end = j;
+		_regionRanges.push_back(range);
+
+		i = j;
+	}
+}
+
+
+int SWWReader::readPoints(int aNcid, int aVarID, size_t aFirstTimestep, size_t aNumTimesteps, size_t aStride, size_t aNumPoints,
+						  const std::vector<unsigned int> & aPoints, const std::vector<PointRange> & aRanges, float * aOut)
+{
+	// a variable of each timestep has time first, a static one only points
+	const bool records = (aNumTimesteps > 0);
+	const size_t nrows = records ? aNumTimesteps : 1;
+	const int pointdim = records ? 1 : 0;
+	size_t start[2], count[2];
+	ptrdiff_t stride[2];
+	start[0] = aFirstTimestep;
+	count[0] = aNumTimesteps;
+	stride[0] = aStride;
+	stride[pointdim] = 1;
+
+	if (aPoints.empty())
+	{
+		start[pointdim] = 0;
+		count[pointdim] = aNumPoints;
+		return nc_get_vars_float(aNcid, aVarID, start, count, stride, aOut);
+	}
+
+	std::vector<float> block;
+	for (size_t r=0; r<aRanges.size(); r++)
+	{
+		const PointRange & range = aRanges[r];
+		start[pointdim] = range._start;
+		count[pointdim] = range._count;
+		block.resize(nrows * range._count);
+
+		int status = nc_get_vars_float(aNcid, aVarID, start, count, stride, &block[0]);
+		if (status != NC_NOERR)
 		{
-			_connectivity.at(v2index).push_back(iv);
+			return status;
 		}
 
-		if (v3index<_npoints)
+		for (size_t row=0; row<nrows; row++)
 		{
-			_connectivity.at(v3index).push_back(iv);
+			const float * in = &block[row * range._count];
+			float * out = aOut + row * aNumPoints;
+			for (size_t iv=range._first; iv<range._end; iv++)
+			{
+				out[iv] = in[aPoints[iv] - range._start];
+			}
 		}
 	}
 
+	return NC_NOERR;
+}
+
+
+bool SWWReader::load()
+{
+	if (!readMesh())
+	{
+		return false;
+	}
+
+	// as many recent frames as fit the budget, at least two to step between
+	size_t framebytes = _npoints * sizeof(float) * 4;
+	_frameCache.setCapacity(max(2, _frameCacheBytes / max(1, framebytes)));
+
+	// stage, and the momenta if there are any
+	if (_options.sharedCacheBytes)
+	{
+		_sharedCache = SharedFrameCache::open(*_state.swwfilename, _npoints, _pxmomentum ? 3 : 1, _options.sharedCacheBytes, &_regionPoints);
+	}
+
+	// alpha-scaling defaults, can be overridden after construction by command line parameters
+	_state.alphamin = DEFAULT_ALPHAMIN;
+	_state.alphamax = DEFAULT_ALPHAMAX;
+	_state.heightmin = DEFAULT_HEIGHTMIN;
+	_state.heightmax = DEFAULT_HEIGHTMAX;
+
+	// steepness culling default, can be overridden after construction by command line parameter
+	_state.cullangle = DEFAULT_CULLANGLE;
+	_state.culling = DEFAULT_CULLONSTART;
 
-	// bedslope index array, pvolumes array indexes into x, y and z
-	_bedslopeindices = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES, _nvolumes*_nvertices);
-	for (iv=0; iv < _nvolumes*_nvertices; iv++)
-		(*_bedslopeindices)[iv] = _pvolumes[iv];
+	// another run on the same mesh shares its copy, so this run holds only its frames
+	if (_sharedMesh.valid() && _mesh->isSameMesh(*_sharedMesh))
+	{
+		osg::notify(osg::INFO) << "[SWWReader] mesh shared with another run" << std::endl;
+		_mesh = _sharedMesh;
+		_px = _mesh->getX();
+		_py = _mesh->getY();
+		_pvolumes = _mesh->getTriangles();
+	}
+	else
+	{
+		_mesh->build();
+	}
 
+	_bedslopeindices = _mesh->getIndices();
 
 	if (_statusHasError())
 	{
 		return false;
 	}
 
-	// Load initial frame
+	// Load initial frame
 	loadBedslopeVertexArray(0);
 
 	return true;
 }
 
 
+int SWWReader::locate(double aX, double aY, osg::Vec3 * aWeights)
+{
+	if (!_mesh.valid())
+	{
+		return -1;
+	}
+
+	// the offset taken off in double, leaving file units a float holds
+	return _mesh->getTriangleGrid().locate((float) (aX - _xllcorner), (float) (aY - _yllcorner), aWeights);
+}
+
+
+int SWWReader::pick(const osg::Vec3 & aStart, const osg::Vec3 & aEnd, osg::Vec3 * aHit)
+{
+	// undo the normalisation, the index works in file coordinates
+	osg::Vec3d offset(_xoffset, _yoffset, _zoffset);
+	osg::Vec3d center(_xcenter, _ycenter, _zcenter);
+	osg::Vec3d start = (osg::Vec3d(aStart) + center) / _scale + offset;
+	osg::Vec3d end = (osg::Vec3d(aEnd) + center) / _scale + offset;
+
+	double ratio, bestratio = 0.0;
+	int best = -1;
+	if (!_mesh.valid())
+	{
+		return best;
+	}
+
+	const TriangleGrid & grid = _mesh->getTriangleGrid();
+
+	// stage is only valid once a timestep has been loaded
+	if (_stagevertices.valid() && _pstage)
+	{
+		best = grid.intersect(start, end, _pstage, &bestratio);
+	}
+
+	int tri = grid.intersect(start, end, _pz, &ratio);
+	if ((tri >= 0) && ((best < 0) || (ratio < bestratio)))
+	{
+		best = tri;
+		bestratio = ratio;
+	}
+
+	if ((best >= 0) && aHit)
+	{
+		*aHit = aStart + (aEnd - aStart)*bestratio;
+	}
+
+	return best;
+}
+
+
+const std::vector<float> & SWWReader::getTriangleAreas()
+{
+	static const std::vector<float> s_noAreas;
+	return _mesh.valid() ? _mesh->getTriangleAreas() : s_noAreas;
+}
+
+
+osg::Vec3d SWWReader::getGeoreferencedPoint(const osg::Vec3 & aPoint)
+{
+	return osg::Vec3d( (aPoint.x() + _xcenter) / _scale + _xoffset + _xllcorner,
+					   (aPoint.y() + _ycenter) / _scale + _yoffset + _yllcorner,
+					   (aPoint.z() + _zcenter) / _scale + _zoffset );
+}
+
+
 float SWWReader::getTime(unsigned int index)
 {
 	if ((!_ptime) || (index >= getNumberOfTimesteps()))
@@ -792,14 +1933,24 @@ float SWWReader::getTime(unsigned int index)
 }
 
 
+void SWWReader::setBoundingVolume(float aXMin, float aXMax, float aYMin, float aYMax, float aZMin, float aZMax)
+{
+	_boundsFixed = true;
+	applyBoundingVolume(aXMin, aXMax, aYMin, aYMax, aZMin, aZMax);
+}
+
+
 void SWWReader::getBedslopeBoundingVolume(const float * aZ)
 {
-	// bedslope range and resultant scale factors (note, these don't take into
-	// account any xllcorner, yllcorner offsets - used during texture coord assignment)
-	float xmin, xmax, xrange;
-	float ymin, ymax, yrange;
-	float zmin, zmax, zrange;
-	float aspect_ratio;
+	// pieces of a larger mesh keep the scale of the whole
+	if (_boundsFixed)
+	{
+		return;
+	}
+
+	float xmin, xmax;
+	float ymin, ymax;
+	float zmin, zmax;
 
 	assert(aZ);
 
@@ -813,6 +1964,17 @@ void SWWReader::getBedslopeBoundingVolume(const float * aZ)
 		getRange(zmin, zmax, aZ[iv]);
 	}
 
+	applyBoundingVolume(xmin, xmax, ymin, ymax, zmin, zmax);
+}
+
+
+void SWWReader::applyBoundingVolume(float xmin, float xmax, float ymin, float ymax, float zmin, float zmax)
+{
+	// bedslope range and resultant scale factors (note, these don't take into
+	// account any xllcorner, yllcorner offsets - used during texture coord assignment)
+	float xrange, yrange, zrange;
+	float aspect_ratio;
+
 	xrange = xmax - xmin;
 	yrange = ymax - ymin;
 	zrange = zmax - zmin;
@@ -864,43 +2026,46 @@ void SWWReader::getBedslopeBoundingVolume(const float * aZ)
 }
 
 
-float * SWWReader::loadBedslopeZ(unsigned int aTimestep)
+bool SWWReader::readElevation(unsigned int aTimestep, float * aElevation)
 {
-	assert(_pz);
+	assert(aElevation);
+
+	// netcdf open
+	_status.push_back( nc_open(_state.swwfilename->c_str(), NC_NOWRITE, &_ncid) );
+	if (this->_statusHasError())
+	{
+		return false;
+	}
 
 	// --- Check that the stage data hasn't shrunk
 	size_t npoints = 0;
 	_status.push_back( nc_inq_dimlen(_ncid, _npointsid, &npoints) );
-	if (_statusHasError() || (npoints != _npoints))
+	if (_statusHasError() || (npoints != _fileNumPoints))
 	{
 		// Our indices will not be out of bounds
 		osg::notify(osg::FATAL) << "File changes have made it invalid! Please wait." <<  std::endl;
-		return NULL;
+		nc_close(_ncid);
+		return false;
 	}
 
 	if (!_elevationAnimated)
 	{
 		// Static bedslope, never changes
-		_status.push_back( nc_get_var_float (_ncid, _zid, _pz) );
-		return _pz;
+		_status.push_back( readPoints(_ncid, _zid, 0, 0, 1, _npoints, _regionPoints, _regionRanges, aElevation) );
+		_status.push_back( nc_close(_ncid) );
+		return !_statusHasError();
 	}
 
-	size_t start[2], count[2];
-	const ptrdiff_t stride[2] = {1,1};
-	start[0] = aTimestep;
-	start[1] = 0;
-	count[0] = 1;
-	count[1] = _npoints;
-
 	// bedslope elevation from netcdf file
-	_status.push_back(nc_get_vars_float (_ncid, _zid, start, count, stride, _pz));
+	_status.push_back( readPoints(_ncid, _zid, getFileTimestep(aTimestep), 1, 1, _npoints, _regionPoints, _regionRanges, aElevation) );
+	_status.push_back( nc_close(_ncid) );
 
 	if (_statusHasError())
 	{
 		// Our indices will not be out of bounds
 		osg::notify(osg::FATAL) << "Could not load variable bed elevation - check file format." <<  std::endl;
-		return NULL;
+		return false;
 	}
 
-	return _pz;
+	return true;
 }
@@ -0,0 +1,513 @@
+/*
+  TileSet
+
+  The mesh of an sww file cut into spatial tiles, kept in a cache file beside it.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <set>
+#include <algorithm>
+#include <netcdf.h>
+#include <osg/Notify>
+#include <osg/Math>
+#include <OpenThreads/ScopedLock>
+
+#include "tileset.h"
+#include "swwreader.h"
+
+
+// triangles read from the sww at once while cutting
+#define TILESET_READ_TRIANGLES (1024*1024)
+
+// most triangles of the tiles gathered in one pass over the sww
+#define TILESET_BATCH_TRIANGLES (8*1024*1024)
+
+#define TILESET_UNUSED ((unsigned int) -1)
+
+
+static const char s_magic[8] = { 'S', 'W', 'W', 'T', 'I', 'L', '0', '1' };
+
+
+static long long tellFile(FILE * aFile)
+{
+#if defined(_MSC_VER)
+	return _ftelli64(aFile);
+#else
+	return ftello(aFile);
+#endif
+}
+
+
+static bool seekFile(FILE * aFile, long long aOffset)
+{
+#if defined(_MSC_VER)
+	return _fseeki64(aFile, aOffset, SEEK_SET) == 0;
+#else
+	return fseeko(aFile, aOffset, SEEK_SET) == 0;
+#endif
+}
+
+
+template <class T>
+static bool writeArray(FILE * aFile, const std::vector<T> & aArray)
+{
+	return aArray.empty() || (fwrite(&aArray[0], sizeof(T), aArray.size(), aFile) == aArray.size());
+}
+
+
+template <class T>
+static bool readArray(FILE * aFile, size_t aCount, std::vector<T> & aArray)
+{
+	aArray.resize(aCount);
+	return (aCount == 0) || (fread(&aArray[0], sizeof(T), aCount, aFile) == aCount);
+}
+
+
+/**
+ * Cell of a regular grid over the mesh holding a point, clamped to the grid.
+ */
+static unsigned int cellOf(float aX, float aY, const TileSet::TileInfo & aMesh, float aSize, unsigned int aColumns, unsigned int aRows)
+{
+	unsigned int column = (unsigned int) osg::clampBetween((aX - aMesh._xmin) / aSize, 0.0f, (float) (aColumns - 1));
+	unsigned int row = (unsigned int) osg::clampBetween((aY - aMesh._ymin) / aSize, 0.0f, (float) (aRows - 1));
+	return row * aColumns + column;
+}
+
+
+/**
+ * Columns and rows of square cells, a number of them along the longer side.
+ */
+static float gridOf(const TileSet::TileInfo & aMesh, unsigned int aAcross, unsigned int & aColumns, unsigned int & aRows)
+{
+	const float xrange = aMesh._xmax - aMesh._xmin;
+	const float yrange = aMesh._ymax - aMesh._ymin;
+	const float longer = osg::maximum(xrange, yrange);
+	const float size = (longer > 0.0f) ? longer / aAcross : 1.0f;
+
+	aColumns = osg::clampBetween((unsigned int) ceilf(xrange / size), 1u, aAcross);
+	aRows = osg::clampBetween((unsigned int) ceilf(yrange / size), 1u, aAcross);
+	return size;
+}
+
+
+TileSet * TileSet::open(const std::string & aFilename, unsigned int aTilesAcross, unsigned int aOverviewAcross)
+{
+	osg::ref_ptr<TileSet> tiles = new TileSet(aFilename, aTilesAcross, aOverviewAcross);
+	if (!tiles->stamp())
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to find " << aFilename << std::endl;
+		return NULL;
+	}
+
+	if (tiles->read())
+	{
+		return tiles.release();
+	}
+
+	osg::notify(osg::NOTICE) << "[TileSet] Cutting " << aFilename << " into tiles, once" << std::endl;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(SWWReader::getNetCDFMutex());
+	if (!tiles->build())
+	{
+		return NULL;
+	}
+
+	return tiles.release();
+}
+
+
+TileSet::TileSet(const std::string & aFilename, unsigned int aTilesAcross, unsigned int aOverviewAcross) :
+	_swwFilename(aFilename),
+	_cacheFilename(aFilename + ".tiles"),
+	_numTiles(0),
+	_tileSize(1.0f),
+	_fromCache(false)
+{
+	memset(&_header, 0, sizeof(_header));
+	memset(&_mesh, 0, sizeof(_mesh));
+	_header._tilesAcross = osg::clampBetween(aTilesAcross, 1u, (unsigned int) TILESET_MAX_TILES);
+	_header._overviewAcross = osg::maximum(aOverviewAcross, 1u);
+}
+
+
+bool TileSet::stamp()
+{
+	struct stat buf;
+	if (stat(_swwFilename.c_str(), &buf) != 0)
+	{
+		return false;
+	}
+
+	memcpy(_header._magic, s_magic, sizeof(_header._magic));
+	_header._modificationTime = buf.st_mtime;
+	_header._size = buf.st_size;
+
+	return true;
+}
+
+
+size_t TileSet::getTileBytes(unsigned int aTile) const
+{
+	const TileInfo & info = _tiles[aTile];
+	return (size_t) info._numPoints * TILESET_BYTES_PER_POINT + (size_t) info._numTriangles * TILESET_BYTES_PER_TRIANGLE;
+}
+
+
+bool TileSet::read()
+{
+	FILE * file = fopen(_cacheFilename.c_str(), "rb");
+	if (!file)
+	{
+		return false;
+	}
+
+	// everything up to the results of the cut is the stamp
+	Header header;
+	bool ok = (fread(&header, sizeof(header), 1, file) == 1) &&
+			  (memcmp(&header, &_header, (const char *) &_header._numTiles - (const char *) &_header) == 0) &&
+			  readArray(file, header._numTiles + 1, _tiles);
+
+	fclose(file);
+
+	if (!ok)
+	{
+		osg::notify(osg::INFO) << "[TileSet] " << _cacheFilename << " is out of date, cutting again" << std::endl;
+		_tiles.clear();
+		return false;
+	}
+
+	_header = header;
+	_numTiles = header._numTiles;
+	_mesh = header._mesh;
+	_fromCache = true;
+
+	return true;
+}
+
+
+unsigned int TileSet::getTileOf(float aX, float aY) const
+{
+	return cellOf(aX, aY, _mesh, _tileSize, _header._numColumns, _numTiles / _header._numColumns);
+}
+
+
+bool TileSet::build()
+{
+	int ncid;
+	if (nc_open(_swwFilename.c_str(), NC_NOWRITE, &ncid) != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to open " << _swwFilename << std::endl;
+		return false;
+	}
+
+	// the static mesh, less the triangles, with the elevation of the first timestep
+	const size_t npoints = SWWReader::readDimension(ncid, "number_of_points");
+	const size_t nvolumes = SWWReader::readDimension(ncid, "number_of_volumes");
+	int xid, yid, zid, volumesid, zdims = 1;
+	int status = nc_inq_varid(ncid, "x", &xid);
+	if (status == NC_NOERR) status = nc_inq_varid(ncid, "y", &yid);
+	if (status == NC_NOERR) status = nc_inq_varid(ncid, "volumes", &volumesid);
+	if ((status == NC_NOERR) && (nc_inq_varid(ncid, "elevation", &zid) != NC_NOERR)) status = nc_inq_varid(ncid, "z", &zid);
+	if (status == NC_NOERR) status = nc_inq_varndims(ncid, zid, &zdims);
+	if ((status == NC_NOERR) && ((npoints == 0) || (nvolumes == 0)))
+	{
+		osg::notify(osg::WARN) << "[TileSet] No mesh in " << _swwFilename << std::endl;
+		nc_close(ncid);
+		return false;
+	}
+
+	std::vector<float> x, y, z;
+	if (status == NC_NOERR)
+	{
+		x.resize(npoints);
+		y.resize(npoints);
+		z.resize(npoints);
+		size_t start[2] = { 0, 0 };
+		size_t count[2] = { 1, npoints };
+		status = nc_get_var_float(ncid, xid, &x[0]);
+		if (status == NC_NOERR) status = nc_get_var_float(ncid, yid, &y[0]);
+		if (status == NC_NOERR) status = (zdims == 2) ? nc_get_vara_float(ncid, zid, start, count, &z[0]) : nc_get_var_float(ncid, zid, &z[0]);
+	}
+	if (status != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to read the mesh of " << _swwFilename << ": " << nc_strerror(status) << std::endl;
+		nc_close(ncid);
+		return false;
+	}
+
+	_mesh._xmin = _mesh._xmax = x[0];
+	_mesh._ymin = _mesh._ymax = y[0];
+	_mesh._zmin = _mesh._zmax = z[0];
+	for (size_t iv=1; iv<npoints; iv++)
+	{
+		_mesh._xmin = osg::minimum(_mesh._xmin, x[iv]);
+		_mesh._xmax = osg::maximum(_mesh._xmax, x[iv]);
+		_mesh._ymin = osg::minimum(_mesh._ymin, y[iv]);
+		_mesh._ymax = osg::maximum(_mesh._ymax, y[iv]);
+		_mesh._zmin = osg::minimum(_mesh._zmin, z[iv]);
+		_mesh._zmax = osg::maximum(_mesh._zmax, z[iv]);
+	}
+	_mesh._numPoints = npoints;
+	_mesh._numTriangles = nvolumes;
+
+	unsigned int columns, rows;
+	_tileSize = gridOf(_mesh, _header._tilesAcross, columns, rows);
+	_numTiles = columns * rows;
+	_header._numColumns = columns;
+	_tiles.assign(_numTiles + 1, TileInfo());
+
+	// the overview's cells each stand for the first of the file's points in them
+	unsigned int cellcolumns, cellrows;
+	const float cellsize = gridOf(_mesh, _header._overviewAcross, cellcolumns, cellrows);
+	std::vector<unsigned int> cellpoint(cellcolumns * cellrows, TILESET_UNUSED);
+	std::vector<unsigned int> representative(npoints);
+	for (size_t iv=0; iv<npoints; iv++)
+	{
+		unsigned int & first = cellpoint[cellOf(x[iv], y[iv], _mesh, cellsize, cellcolumns, cellrows)];
+		if (first == TILESET_UNUSED)
+		{
+			first = iv;
+		}
+		representative[iv] = first;
+	}
+	cellpoint.clear();
+
+	// one pass counting the triangles of each tile and clustering the overview
+	std::vector<unsigned int> counts(_numTiles, 0);
+	std::vector<unsigned int> overview, overviewtiles;
+	std::set< std::pair<unsigned int, std::pair<unsigned int, unsigned int> > > seen;
+	std::vector<int> volumes;
+	for (size_t first=0; (status == NC_NOERR) && (first<nvolumes); first+=TILESET_READ_TRIANGLES)
+	{
+		size_t start[2] = { first, 0 };
+		size_t count[2] = { osg::minimum((size_t) TILESET_READ_TRIANGLES, nvolumes - first), 3 };
+		volumes.resize(count[0] * 3);
+		status = nc_get_vara_int(ncid, volumesid, start, count, &volumes[0]);
+
+		for (size_t it=0; (status == NC_NOERR) && (it<count[0]); it++)
+		{
+			const unsigned int * corners = (const unsigned int *) &volumes[3*it];
+			if ((corners[0] >= npoints) || (corners[1] >= npoints) || (corners[2] >= npoints))
+			{
+				continue;
+			}
+
+			const unsigned int tile = getTileOf((x[corners[0]] + x[corners[1]] + x[corners[2]]) / 3.0f,
+												(y[corners[0]] + y[corners[1]] + y[corners[2]]) / 3.0f);
+			counts[tile]++;
+
+			unsigned int r[3] = { representative[corners[0]], representative[corners[1]], representative[corners[2]] };
+			if ((r[0] == r[1]) || (r[1] == r[2]) || (r[2] == r[0]))
+			{
+				continue;
+			}
+
+			// each triangle of cells once, whichever way round it was first met
+			unsigned int key[3] = { r[0], r[1], r[2] };
+			std::sort(key, key + 3);
+			if (seen.insert(std::make_pair(key[0], std::make_pair(key[1], key[2]))).second)
+			{
+				overview.insert(overview.end(), r, r + 3);
+				overviewtiles.push_back(tile);
+			}
+		}
+	}
+	seen.clear();
+	representative.clear();
+
+	if (status != NC_NOERR)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to read the triangles of " << _swwFilename << ": " << nc_strerror(status) << std::endl;
+		nc_close(ncid);
+		return false;
+	}
+
+	FILE * file = fopen(_cacheFilename.c_str(), "wb");
+	if (!file)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to write " << _cacheFilename << std::endl;
+		nc_close(ncid);
+		return false;
+	}
+
+	// the table is written last, once the tiles are in place
+	_header._numTiles = _numTiles;
+	_header._mesh = _mesh;
+	bool ok = seekFile(file, sizeof(Header) + sizeof(TileInfo) * _tiles.size()) &&
+			  writeTiles(file, ncid, volumesid, x, y, z, counts) &&
+			  writeTile(file, _numTiles, overview, &overviewtiles, x, y, z) &&
+			  seekFile(file, 0) &&
+			  (fwrite(&_header, sizeof(_header), 1, file) == 1) &&
+			  writeArray(file, _tiles);
+
+	nc_close(ncid);
+
+	if ((fclose(file) != 0) || !ok)
+	{
+		// don't leave a partial cache to be trusted next time
+		osg::notify(osg::WARN) << "[TileSet] Unable to write " << _cacheFilename << std::endl;
+		remove(_cacheFilename.c_str());
+		return false;
+	}
+
+	osg::notify(osg::INFO) << "[TileSet] " << _numTiles << " tiles of " << _swwFilename << ", overview of "
+						   << _tiles[_numTiles]._numTriangles << " of " << nvolumes << " triangles" << std::endl;
+
+	return true;
+}
+
+
+bool TileSet::writeTiles(FILE * aFile, int aNcid, int aVolumesID, const std::vector<float> & aX, const std::vector<float> & aY,
+						 const std::vector<float> & aZ, const std::vector<unsigned int> & aTriangleCounts)
+{
+	const size_t npoints = aX.size();
+	const size_t nvolumes = _mesh._numTriangles;
+
+	std::vector<int> volumes;
+	std::vector< std::vector<unsigned int> > corners;
+	unsigned int begin = 0;
+	while (begin < _numTiles)
+	{
+		// as many tiles as fit in memory gathered from each pass, at least one
+		unsigned int end = begin + 1;
+		size_t batch = aTriangleCounts[begin];
+		while ((end < _numTiles) && (batch + aTriangleCounts[end] <= TILESET_BATCH_TRIANGLES))
+		{
+			batch += aTriangleCounts[end];
+			end++;
+		}
+
+		corners.assign(end - begin, std::vector<unsigned int>());
+		for (unsigned int tile=begin; tile<end; tile++)
+		{
+			corners[tile - begin].reserve(aTriangleCounts[tile] * 3);
+		}
+
+		for (size_t first=0; first<nvolumes; first+=TILESET_READ_TRIANGLES)
+		{
+			size_t start[2] = { first, 0 };
+			size_t count[2] = { osg::minimum((size_t) TILESET_READ_TRIANGLES, nvolumes - first), 3 };
+			volumes.resize(count[0] * 3);
+			if (nc_get_vara_int(aNcid, aVolumesID, start, count, &volumes[0]) != NC_NOERR)
+			{
+				return false;
+			}
+
+			for (size_t it=0; it<count[0]; it++)
+			{
+				const unsigned int * triangle = (const unsigned int *) &volumes[3*it];
+				if ((triangle[0] >= npoints) || (triangle[1] >= npoints) || (triangle[2] >= npoints))
+				{
+					continue;
+				}
+
+				const unsigned int tile = getTileOf((aX[triangle[0]] + aX[triangle[1]] + aX[triangle[2]]) / 3.0f,
+													(aY[triangle[0]] + aY[triangle[1]] + aY[triangle[2]]) / 3.0f);
+				if ((tile >= begin) && (tile < end))
+				{
+					corners[tile - begin].insert(corners[tile - begin].end(), triangle, triangle + 3);
+				}
+			}
+		}
+
+		for (unsigned int tile=begin; tile<end; tile++)
+		{
+			if (!writeTile(aFile, tile, corners[tile - begin], NULL, aX, aY, aZ))
+			{
+				return false;
+			}
+			std::vector<unsigned int>().swap(corners[tile - begin]);
+		}
+
+		begin = end;
+	}
+
+	return true;
+}
+
+
+bool TileSet::writeTile(FILE * aFile, unsigned int aTile, const std::vector<unsigned int> & aCorners,
+						const std::vector<unsigned int> * aTriangleTiles,
+						const std::vector<float> & aX, const std::vector<float> & aY, const std::vector<float> & aZ)
+{
+	// the points used, in file order, so frames read the file front to back
+	std::vector<unsigned int> points(aCorners);
+	std::sort(points.begin(), points.end());
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	std::vector<unsigned int> triangles(aCorners.size());
+	for (size_t k=0; k<aCorners.size(); k++)
+	{
+		triangles[k] = std::lower_bound(points.begin(), points.end(), aCorners[k]) - points.begin();
+	}
+
+	std::vector<float> x(points.size()), y(points.size());
+	TileInfo & info = _tiles[aTile];
+	memset(&info, 0, sizeof(info));
+	for (size_t iv=0; iv<points.size(); iv++)
+	{
+		const unsigned int p = points[iv];
+		x[iv] = aX[p];
+		y[iv] = aY[p];
+		if (iv == 0)
+		{
+			info._xmin = info._xmax = aX[p];
+			info._ymin = info._ymax = aY[p];
+			info._zmin = info._zmax = aZ[p];
+		}
+		info._xmin = osg::minimum(info._xmin, aX[p]);
+		info._xmax = osg::maximum(info._xmax, aX[p]);
+		info._ymin = osg::minimum(info._ymin, aY[p]);
+		info._ymax = osg::maximum(info._ymax, aY[p]);
+		info._zmin = osg::minimum(info._zmin, aZ[p]);
+		info._zmax = osg::maximum(info._zmax, aZ[p]);
+	}
+	info._numPoints = points.size();
+	info._numTriangles = aCorners.size() / 3;
+	info._offset = tellFile(aFile);
+
+	return (info._offset >= 0) &&
+		   writeArray(aFile, points) &&
+		   writeArray(aFile, x) &&
+		   writeArray(aFile, y) &&
+		   writeArray(aFile, triangles) &&
+		   (!aTriangleTiles || writeArray(aFile, *aTriangleTiles));
+}
+
+
+bool TileSet::readTile(unsigned int aTile, Tile & aData) const
+{
+	if (aTile > _numTiles)
+	{
+		return false;
+	}
+
+	FILE * file = fopen(_cacheFilename.c_str(), "rb");
+	if (!file)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to read " << _cacheFilename << std::endl;
+		return false;
+	}
+
+	const TileInfo & info = _tiles[aTile];
+	bool ok = seekFile(file, info._offset) &&
+			  readArray(file, info._numPoints, aData._points) &&
+			  readArray(file, info._numPoints, aData._x) &&
+			  readArray(file, info._numPoints, aData._y) &&
+			  readArray(file, info._numTriangles * 3, aData._triangles) &&
+			  readArray(file, (aTile == _numTiles) ? info._numTriangles : 0, aData._triangleTiles);
+
+	fclose(file);
+
+	if (!ok)
+	{
+		osg::notify(osg::WARN) << "[TileSet] Unable to read tile " << aTile << " of " << _cacheFilename << std::endl;
+	}
+
+	return ok;
+}
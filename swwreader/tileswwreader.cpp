@@ -0,0 +1,125 @@
+/*
+  TileSWWReader
+
+  Reads one tile of the mesh of an sww file, or its overview.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <algorithm>
+#include <netcdf.h>
+#include <osg/Notify>
+#include <OpenThreads/ScopedLock>
+
+#include "tileswwreader.h"
+
+
+TileSWWReader::TileSWWReader(TileSet * aTiles, unsigned int aTile, bool aWatch, const LoadOptions & aOptions) :
+	SWWReader(aTiles->getFilename(), false, NULL, aWatch, aOptions),
+	_tiles(aTiles),
+	_tile(aTile)
+{
+	// every tile scaled as the whole mesh is, so they line up
+	const TileSet::TileInfo & mesh = aTiles->getMeshInfo();
+	setBoundingVolume(mesh._xmin, mesh._xmax, mesh._ymin, mesh._ymax, mesh._zmin, mesh._zmax);
+
+	// many tiles are loaded at once, so each keeps just the frames it is stepping between
+	if (aTile != aTiles->getOverview())
+	{
+		_frameCacheBytes = 0;
+		_options.sharedCacheBytes = 0;
+	}
+
+	_valid = load();
+}
+
+
+bool TileSWWReader::readMesh()
+{
+	// locked only while the sww is open, the mesh coming from the tile cache, so tiles
+	// loading in the background hold up frames being read as little as they can
+	bool momentum;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(getNetCDFMutex());
+		if (!readHeader(momentum))
+		{
+			return false;
+		}
+
+		// the georeference offset too, for tile bounds and picked locations
+		readAttributes();
+		_status.push_back( nc_close(_ncid) );
+		_ncid = -1;
+	}
+
+	if (!getRegion().isEmpty() && (_tile == _tiles->getOverview()))
+	{
+		osg::notify(osg::WARN) << "[TileSWWReader] Regions aren't supported with tiles, the whole mesh is loaded" << std::endl;
+	}
+
+	const TileSet::TileInfo & whole = _tiles->getMeshInfo();
+	if ((_npoints != whole._numPoints) || (_nvolumes != whole._numTriangles))
+	{
+		osg::notify(osg::WARN) << "[TileSWWReader] The mesh of " << *_state.swwfilename << " has changed since it was tiled" << std::endl;
+		return false;
+	}
+	_fileNumPoints = _npoints;
+	_fileNumVolumes = _nvolumes;
+
+	TileSet::Tile tile;
+	if (!_tiles->readTile(_tile, tile) || tile._triangles.empty())
+	{
+		return false;
+	}
+
+	osg::ref_ptr<MeshData> mesh = new MeshData(tile._points.size(), tile._triangles.size() / 3);
+	std::copy(tile._x.begin(), tile._x.end(), mesh->getX());
+	std::copy(tile._y.begin(), tile._y.end(), mesh->getY());
+	std::copy(tile._triangles.begin(), tile._triangles.end(), mesh->getTriangles());
+	setSelection(mesh.get(), tile._points, momentum);
+	_triangleTiles.swap(tile._triangleTiles);
+
+	osg::notify(osg::INFO) << "[TileSWWReader] tile " << _tile << " holds " << _nvolumes << " of " << _fileNumVolumes << " triangles and "
+						   << _npoints << " of " << _fileNumPoints << " points, read in " << _regionRanges.size() << " ranges" << std::endl;
+
+	return applyTimeWindow();
+}
+
+
+osg::DrawElementsUInt * TileSWWReader::hideTiles(const std::vector<bool> & aHidden)
+{
+	if (_triangleTiles.empty())
+	{
+		return _bedslopeindices.get();
+	}
+
+	osg::ref_ptr<osg::DrawElementsUInt> indices = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+	indices->reserve(3 * _nvolumes);
+	for (size_t it=0; it<_triangleTiles.size(); it++)
+	{
+		const unsigned int tile = _triangleTiles[it];
+		if ((tile < aHidden.size()) && aHidden[tile])
+		{
+			continue;
+		}
+
+		indices->push_back(_pvolumes[3*it+0]);
+		indices->push_back(_pvolumes[3*it+1]);
+		indices->push_back(_pvolumes[3*it+2]);
+	}
+
+	_bedslopeindices = indices;
+	return _bedslopeindices.get();
+}
+
+
+osg::BoundingBox TileSWWReader::getTileBounds(unsigned int aTile) const
+{
+	const TileSet::TileInfo & info = _tiles->getTileInfo(aTile);
+	return osg::BoundingBox( (info._xmin - _xoffset) * _scale - _xcenter,
+							 (info._ymin - _yoffset) * _scale - _ycenter,
+							 (info._zmin - _zoffset) * _scale - _zcenter,
+							 (info._xmax - _xoffset) * _scale - _xcenter,
+							 (info._ymax - _yoffset) * _scale - _ycenter,
+							 (info._zmax - _zoffset) * _scale - _zcenter );
+}
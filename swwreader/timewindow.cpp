@@ -0,0 +1,132 @@
+/*
+  TimeWindow
+
+  Part of a run, a range of timesteps and a stride through them.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <stdlib.h>
+
+#include "timewindow.h"
+
+
+TimeWindow::TimeWindow() :
+	_hasStart(false),
+	_hasEnd(false),
+	_start(0.0),
+	_end(0.0),
+	_startSeconds(false),
+	_endSeconds(false),
+	_stride(1)
+{
+}
+
+
+bool TimeWindow::parseBound(const std::string & aSpec, double & aValue, bool & aSeconds)
+{
+	const char * p = aSpec.c_str();
+	char * end;
+	const double value = strtod(p, &end);
+	if ((end == p) || (value < 0.0))
+	{
+		return false;
+	}
+
+	// a timestep is a whole number, a time has its unit
+	if ((*end == 's') && !end[1])
+	{
+		aValue = value;
+		aSeconds = true;
+		return true;
+	}
+
+	if (!*end && (value == (double) (size_t) value))
+	{
+		aValue = value;
+		aSeconds = false;
+		return true;
+	}
+
+	return false;
+}
+
+
+bool TimeWindow::setStart(const std::string & aSpec)
+{
+	if (!parseBound(aSpec, _start, _startSeconds))
+	{
+		return false;
+	}
+	_hasStart = true;
+	return true;
+}
+
+
+bool TimeWindow::setEnd(const std::string & aSpec)
+{
+	if (!parseBound(aSpec, _end, _endSeconds))
+	{
+		return false;
+	}
+	_hasEnd = true;
+	return true;
+}
+
+
+bool TimeWindow::setStride(unsigned int aStride)
+{
+	if (aStride == 0)
+	{
+		return false;
+	}
+	_stride = aStride;
+	return true;
+}
+
+
+size_t TimeWindow::getFirst(const float * aTimes, size_t aNumTimesteps) const
+{
+	if (!_hasStart)
+	{
+		return 0;
+	}
+
+	if (!_startSeconds)
+	{
+		return (_start < aNumTimesteps) ? (size_t) _start : aNumTimesteps;
+	}
+
+	size_t first = 0;
+	while ((first < aNumTimesteps) && (aTimes[first] < _start))
+	{
+		first++;
+	}
+	return first;
+}
+
+
+size_t TimeWindow::getCount(const float * aTimes, size_t aNumTimesteps, size_t aFirst) const
+{
+	if (aFirst >= aNumTimesteps)
+	{
+		return 0;
+	}
+
+	// one past the last timestep taken
+	size_t end = aNumTimesteps;
+	if (_hasEnd && !_endSeconds)
+	{
+		end = (_end + 1 < aNumTimesteps) ? (size_t) _end + 1 : aNumTimesteps;
+	}
+	else if (_hasEnd)
+	{
+		end = aFirst;
+		while ((end < aNumTimesteps) && (aTimes[end] <= _end))
+		{
+			end++;
+		}
+	}
+
+	return (end > aFirst) ? (end - aFirst - 1) / _stride + 1 : 0;
+}
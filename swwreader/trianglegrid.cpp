@@ -0,0 +1,353 @@
+/*
+  TriangleGrid
+
+  A uniform grid spatial index over the triangles of a 2D mesh.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <float.h>
+
+#include "trianglegrid.h"
+
+// points this close outside a triangle, in barycentric terms, still count as inside it
+#define TRIANGLE_EDGE_TOLERANCE 1e-6
+
+
+TriangleGrid::TriangleGrid() :
+	_x(NULL),
+	_y(NULL),
+	_volumes(NULL),
+	_nvolumes(0),
+	_xmin(0),
+	_ymin(0),
+	_cellSize(1),
+	_ncellsX(0),
+	_ncellsY(0)
+{
+}
+
+
+void TriangleGrid::clear()
+{
+	_cellStart.clear();
+	_cellTriangles.clear();
+	_x = _y = NULL;
+	_volumes = NULL;
+	_nvolumes = 0;
+	_ncellsX = _ncellsY = 0;
+}
+
+
+void TriangleGrid::build(const float * aX, const float * aY, unsigned int aNumPoints, const unsigned int * aVolumes, unsigned int aNumVolumes)
+{
+	clear();
+
+	if (!aNumPoints || !aNumVolumes)
+	{
+		return;
+	}
+
+	_x = aX;
+	_y = aY;
+	_volumes = aVolumes;
+	_nvolumes = aNumVolumes;
+
+	double xmin = aX[0], xmax = aX[0];
+	double ymin = aY[0], ymax = aY[0];
+	unsigned int iv;
+	for (iv=1; iv<aNumPoints; iv++)
+	{
+		if (aX[iv] < xmin) xmin = aX[iv];
+		if (aX[iv] > xmax) xmax = aX[iv];
+		if (aY[iv] < ymin) ymin = aY[iv];
+		if (aY[iv] > ymax) ymax = aY[iv];
+	}
+
+	// about one triangle per cell on average
+	double width = xmax - xmin;
+	double height = ymax - ymin;
+	double area = width * height;
+	if (area > 0.0)
+	{
+		_cellSize = sqrt(area / aNumVolumes);
+	}
+	else
+	{
+		// degenerate mesh along a line
+		_cellSize = (width > height ? width : height) / aNumVolumes;
+		if (_cellSize <= 0.0)
+		{
+			_cellSize = 1.0;
+		}
+	}
+
+	_xmin = xmin;
+	_ymin = ymin;
+	_ncellsX = (int) (width / _cellSize) + 1;
+	_ncellsY = (int) (height / _cellSize) + 1;
+
+	// two passes, count then fill, so the lists pack into one array
+	std::vector<unsigned int> count(_ncellsX * _ncellsY + 1, 0);
+
+	for (int pass=0; pass<2; pass++)
+	{
+		for (iv=0; iv<aNumVolumes; iv++)
+		{
+			const unsigned int * tri = aVolumes + 3*iv;
+			if ((tri[0] >= aNumPoints) || (tri[1] >= aNumPoints) || (tri[2] >= aNumPoints))
+			{
+				continue;
+			}
+
+			float txmin = aX[tri[0]], txmax = aX[tri[0]];
+			float tymin = aY[tri[0]], tymax = aY[tri[0]];
+			for (int k=1; k<3; k++)
+			{
+				if (aX[tri[k]] < txmin) txmin = aX[tri[k]];
+				if (aX[tri[k]] > txmax) txmax = aX[tri[k]];
+				if (aY[tri[k]] < tymin) tymin = aY[tri[k]];
+				if (aY[tri[k]] > tymax) tymax = aY[tri[k]];
+			}
+
+			int cx0 = cellX(txmin), cx1 = cellX(txmax);
+			int cy0 = cellY(tymin), cy1 = cellY(tymax);
+			for (int cy=cy0; cy<=cy1; cy++)
+			{
+				for (int cx=cx0; cx<=cx1; cx++)
+				{
+					unsigned int cell = cy*_ncellsX + cx;
+					if (pass == 0)
+					{
+						count[cell]++;
+					}
+					else
+					{
+						_cellTriangles[_cellStart[cell] + count[cell]++] = iv;
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			_cellStart.resize(count.size());
+			unsigned int total = 0;
+			for (unsigned int c=0; c<count.size(); c++)
+			{
+				_cellStart[c] = total;
+				total += count[c];
+				count[c] = 0;
+			}
+			_cellTriangles.resize(total);
+		}
+	}
+}
+
+
+int TriangleGrid::cellX(double aX) const
+{
+	int cx = (int) floor((aX - _xmin) / _cellSize);
+	return (cx < 0) ? 0 : ((cx >= _ncellsX) ? _ncellsX-1 : cx);
+}
+
+
+int TriangleGrid::cellY(double aY) const
+{
+	int cy = (int) floor((aY - _ymin) / _cellSize);
+	return (cy < 0) ? 0 : ((cy >= _ncellsY) ? _ncellsY-1 : cy);
+}
+
+
+bool TriangleGrid::contains(unsigned int aTriangle, double aX, double aY, osg::Vec3 * aWeights) const
+{
+	const unsigned int * tri = _volumes + 3*aTriangle;
+	double x1 = _x[tri[0]], y1 = _y[tri[0]];
+	double x2 = _x[tri[1]], y2 = _y[tri[1]];
+	double x3 = _x[tri[2]], y3 = _y[tri[2]];
+
+	double denom = (y2 - y3)*(x1 - x3) + (x3 - x2)*(y1 - y3);
+	if (denom == 0.0)
+	{
+		return false;
+	}
+
+	double l1 = ((y2 - y3)*(aX - x3) + (x3 - x2)*(aY - y3)) / denom;
+	double l2 = ((y3 - y1)*(aX - x3) + (x1 - x3)*(aY - y3)) / denom;
+	double l3 = 1.0 - l1 - l2;
+
+	if ((l1 < -TRIANGLE_EDGE_TOLERANCE) || (l2 < -TRIANGLE_EDGE_TOLERANCE) || (l3 < -TRIANGLE_EDGE_TOLERANCE))
+	{
+		return false;
+	}
+
+	if (aWeights)
+	{
+		aWeights->set(l1, l2, l3);
+	}
+
+	return true;
+}
+
+
+int TriangleGrid::locate(float aX, float aY, osg::Vec3 * aWeights) const
+{
+	if (!isValid())
+	{
+		return -1;
+	}
+
+	// outside the grid is outside the mesh
+	if ((aX < _xmin) || (aY < _ymin) || (aX > _xmin + _ncellsX*_cellSize) || (aY > _ymin + _ncellsY*_cellSize))
+	{
+		return -1;
+	}
+
+	unsigned int cell = cellY(aY)*_ncellsX + cellX(aX);
+	for (unsigned int i=_cellStart[cell]; i<_cellStart[cell+1]; i++)
+	{
+		if (contains(_cellTriangles[i], aX, aY, aWeights))
+		{
+			return _cellTriangles[i];
+		}
+	}
+
+	return -1;
+}
+
+
+bool TriangleGrid::intersectTriangle(unsigned int aTriangle, const osg::Vec3d & aStart, const osg::Vec3d & aDir, const float * aZ, double & aRatio) const
+{
+	const unsigned int * tri = _volumes + 3*aTriangle;
+	osg::Vec3d v0(_x[tri[0]], _y[tri[0]], aZ[tri[0]]);
+	osg::Vec3d v1(_x[tri[1]], _y[tri[1]], aZ[tri[1]]);
+	osg::Vec3d v2(_x[tri[2]], _y[tri[2]], aZ[tri[2]]);
+
+	// Moller-Trumbore, either side of the triangle
+	osg::Vec3d e1 = v1 - v0;
+	osg::Vec3d e2 = v2 - v0;
+	osg::Vec3d p = aDir ^ e2;
+	double det = e1 * p;
+	if (fabs(det) < DBL_EPSILON)
+	{
+		return false;
+	}
+
+	double inv = 1.0 / det;
+	osg::Vec3d s = aStart - v0;
+	double u = (s * p) * inv;
+	if ((u < -TRIANGLE_EDGE_TOLERANCE) || (u > 1.0 + TRIANGLE_EDGE_TOLERANCE))
+	{
+		return false;
+	}
+
+	osg::Vec3d q = s ^ e1;
+	double v = (aDir * q) * inv;
+	if ((v < -TRIANGLE_EDGE_TOLERANCE) || (u + v > 1.0 + TRIANGLE_EDGE_TOLERANCE))
+	{
+		return false;
+	}
+
+	double t = (e2 * q) * inv;
+	if ((t < 0.0) || (t > 1.0))
+	{
+		return false;
+	}
+
+	aRatio = t;
+	return true;
+}
+
+
+int TriangleGrid::intersect(const osg::Vec3d & aStart, const osg::Vec3d & aEnd, const float * aZ, double * aRatio) const
+{
+	if (!isValid() || !aZ)
+	{
+		return -1;
+	}
+
+	osg::Vec3d dir = aEnd - aStart;
+
+	// clip the segment's x,y extent to the grid
+	double tmin = 0.0, tmax = 1.0;
+	const double lo[2] = { _xmin, _ymin };
+	const double hi[2] = { _xmin + _ncellsX*_cellSize, _ymin + _ncellsY*_cellSize };
+	for (int axis=0; axis<2; axis++)
+	{
+		if (dir[axis] == 0.0)
+		{
+			if ((aStart[axis] < lo[axis]) || (aStart[axis] > hi[axis]))
+			{
+				return -1;
+			}
+			continue;
+		}
+
+		double t0 = (lo[axis] - aStart[axis]) / dir[axis];
+		double t1 = (hi[axis] - aStart[axis]) / dir[axis];
+		if (t0 > t1)
+		{
+			double tmp = t0;	t0 = t1;	t1 = tmp;
+		}
+		if (t0 > tmin) tmin = t0;
+		if (t1 < tmax) tmax = t1;
+	}
+	if (tmin > tmax)
+	{
+		return -1;
+	}
+
+	// walk the cells under the segment in order, grid traversal after Amanatides and Woo
+	osg::Vec3d entry = aStart + dir*tmin;
+	int cx = cellX(entry.x());
+	int cy = cellY(entry.y());
+	int stepX = (dir.x() > 0.0) ? 1 : -1;
+	int stepY = (dir.y() > 0.0) ? 1 : -1;
+	double tnextX = (dir.x() != 0.0) ? (_xmin + (cx + (stepX > 0 ? 1 : 0))*_cellSize - aStart.x()) / dir.x() : DBL_MAX;
+	double tnextY = (dir.y() != 0.0) ? (_ymin + (cy + (stepY > 0 ? 1 : 0))*_cellSize - aStart.y()) / dir.y() : DBL_MAX;
+	double tdeltaX = (dir.x() != 0.0) ? _cellSize / fabs(dir.x()) : DBL_MAX;
+	double tdeltaY = (dir.y() != 0.0) ? _cellSize / fabs(dir.y()) : DBL_MAX;
+
+	int best = -1;
+	double bestRatio = DBL_MAX;
+
+	while ((cx >= 0) && (cx < _ncellsX) && (cy >= 0) && (cy < _ncellsY))
+	{
+		unsigned int cell = cy*_ncellsX + cx;
+		for (unsigned int i=_cellStart[cell]; i<_cellStart[cell+1]; i++)
+		{
+			double ratio;
+			if (intersectTriangle(_cellTriangles[i], aStart, dir, aZ, ratio) && (ratio < bestRatio))
+			{
+				best = _cellTriangles[i];
+				bestRatio = ratio;
+			}
+		}
+
+		// triangles overlapping later cells can't be hit any earlier than this
+		double texit = (tnextX < tnextY) ? tnextX : tnextY;
+		if ((best >= 0 && bestRatio <= texit) || (texit > tmax))
+		{
+			break;
+		}
+
+		if (tnextX < tnextY)
+		{
+			cx += stepX;
+			tnextX += tdeltaX;
+		}
+		else
+		{
+			cy += stepY;
+			tnextY += tdeltaY;
+		}
+	}
+
+	if (best >= 0 && aRatio)
+	{
+		*aRatio = bestRatio;
+	}
+
+	return best;
+}
@@ -0,0 +1,133 @@
+/*
+  WorkerPool
+
+  A fixed set of threads servicing a bounded queue of jobs.
+
+  copyright (C) 2009 Geoscience Australia
+*/
+
+#include <OpenThreads/ScopedLock>
+
+#include "workerpool.h"
+
+
+WorkerPool::WorkerPool(unsigned int aNumThreads, unsigned int aMaxQueued, OpenThreads::Thread::ThreadPriority aPriority) :
+	_maxQueued(aMaxQueued),
+	_running(0),
+	_stopping(false)
+{
+	if (aNumThreads == 0)
+	{
+		// leave a processor for the render loop
+		int nproc = OpenThreads::GetNumberOfProcessors();
+		aNumThreads = (nproc > 1) ? nproc-1 : 1;
+	}
+
+	for (unsigned int i=0; i<aNumThreads; i++)
+	{
+		WorkerThread * thread = new WorkerThread(this);
+		if (aPriority != OpenThreads::Thread::THREAD_PRIORITY_DEFAULT)
+		{
+			thread->setSchedulePriority(aPriority);
+		}
+		_threads.push_back(thread);
+		thread->start();
+	}
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	wait();
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+		_stopping = true;
+		_jobAvailable.broadcast();
+	}
+
+	for (unsigned int i=0; i<_threads.size(); i++)
+	{
+		_threads[i]->join();
+		delete _threads[i];
+	}
+	_threads.clear();
+}
+
+
+void WorkerPool::add(Job * aJob)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	// backpressure, producer waits for the workers to catch up
+	while (_maxQueued && (_queue.size() >= _maxQueued))
+	{
+		_spaceAvailable.wait(&_mutex);
+	}
+
+	_queue.push_back(aJob);
+	_jobAvailable.signal();
+}
+
+
+void WorkerPool::wait()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	while (!_queue.empty() || _running)
+	{
+		_idle.wait(&_mutex);
+	}
+}
+
+
+unsigned int WorkerPool::getNumPending()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	return _queue.size() + _running;
+}
+
+
+WorkerPool::Job * WorkerPool::takeJob()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	while (_queue.empty() && !_stopping)
+	{
+		_jobAvailable.wait(&_mutex);
+	}
+
+	if (_queue.empty())
+	{
+		return NULL;
+	}
+
+	// the caller holds its own reference until the job has run
+	Job * job = _queue.front().get();
+	job->ref();
+	_queue.pop_front();
+	_running++;
+	_spaceAvailable.signal();
+
+	return job;
+}
+
+
+void WorkerPool::jobDone()
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	_running--;
+	_idle.broadcast();
+}
+
+
+void WorkerPool::WorkerThread::run()
+{
+	Job * job;
+	while ((job = _pool->takeJob()) != NULL)
+	{
+		job->run();
+		job->unref();
+		_pool->jobDone();
+	}
+}
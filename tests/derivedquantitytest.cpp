@@ -0,0 +1,86 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <derivedquantity.h>
+
+#include "derivedquantitytest.h"
+
+// allowable difference between two floats to be considered equal
+#define DERIVED_TOLERANCE 0.001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( DerivedQuantityTest );
+
+
+void DerivedQuantityTest::testWet()
+{
+	// 1m and 4m of water over a bed at -1m, flowing at 2m/s
+	const float stage[2] = { 0.0f, 3.0f };
+	const float elevation[2] = { -1.0f, -1.0f };
+	const float xmomentum[2] = { 1.2f, 4.8f };
+	const float ymomentum[2] = { 1.6f, 6.4f };
+	float out[2];
+
+	DerivedQuantity::compute(DerivedQuantity::DQ_MOMENTUM, 2, stage, elevation, xmomentum, ymomentum, out);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, out[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 8.0, out[1], DERIVED_TOLERANCE );
+
+	DerivedQuantity::compute(DerivedQuantity::DQ_VELOCITY, 2, stage, elevation, xmomentum, ymomentum, out);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, out[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, out[1], DERIVED_TOLERANCE );
+
+	// 2 / sqrt(9.8 * h)
+	DerivedQuantity::compute(DerivedQuantity::DQ_FROUDE, 2, stage, elevation, xmomentum, ymomentum, out);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6389, out[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.3194, out[1], DERIVED_TOLERANCE );
+
+	// h * (u + 0.5)
+	DerivedQuantity::compute(DerivedQuantity::DQ_HAZARD, 2, stage, elevation, xmomentum, ymomentum, out);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.5, out[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 10.0, out[1], DERIVED_TOLERANCE );
+}
+
+
+void DerivedQuantityTest::testDry()
+{
+	// dry, below the minimum depth, and stage under the bed
+	const float stage[3] = { -1.0f, -1.0f + DerivedQuantity::getMinDepth()/2, -2.0f };
+	const float elevation[3] = { -1.0f, -1.0f, -1.0f };
+	const float xmomentum[3] = { 0.0f, 1e-4f, 1e-4f };
+	const float ymomentum[3] = { 0.0f, 0.0f, 0.0f };
+	float out[3];
+
+	for (int type = DerivedQuantity::DQ_VELOCITY; type < DerivedQuantity::DQ_NUM_OF; type++)
+	{
+		DerivedQuantity::compute((DerivedQuantity::Type) type, 3, stage, elevation, xmomentum, ymomentum, out);
+		for (int iv = 0; iv < 3; iv++)
+		{
+			CPPUNIT_ASSERT_EQUAL( 0.0f, out[iv] );
+		}
+	}
+}
+
+
+void DerivedQuantityTest::testVelocity()
+{
+	// second vertex is dry, the others flow at 2m/s in 1m and 4m of water
+	const float stage[3] = { 0.0f, -1.0f, 3.0f };
+	const float elevation[3] = { -1.0f, -1.0f, -1.0f };
+	const float xmomentum[3] = { 1.2f, 0.5f, 4.8f };
+	const float ymomentum[3] = { 1.6f, 0.5f, -6.4f };
+	const unsigned int vertices[3] = { 2, 1, 0 };
+	float u[3], v[3];
+
+	DerivedQuantity::computeVelocity(3, vertices, stage, elevation, xmomentum, ymomentum, u, v);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.2, u[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( -1.6, v[0], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, u[1] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, v[1] );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.2, u[2], DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.6, v[2], DERIVED_TOLERANCE );
+
+	// one vertex at a time, dry below the minimum depth as the kernels are
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, DerivedQuantity::speed(1.0f, 1.2f, 1.6f), DERIVED_TOLERANCE );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, DerivedQuantity::speed(DerivedQuantity::getMinDepth()/2, 1e-4f, 0.0f) );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, DerivedQuantity::speed(0.0f, 1.0f, 1.0f) );
+}
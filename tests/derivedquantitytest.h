@@ -0,0 +1,23 @@
+#ifndef DERIVEDQUANTITYTEST_H_
+#define DERIVEDQUANTITYTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+
+
+class DerivedQuantityTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( DerivedQuantityTest );
+	CPPUNIT_TEST( testWet );
+	CPPUNIT_TEST( testDry );
+	CPPUNIT_TEST( testVelocity );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testWet();
+	void testDry();
+	void testVelocity();
+};
+
+#endif // DERIVEDQUANTITYTEST_H_
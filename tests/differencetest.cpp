@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <difference.h>
+
+#include "differencetest.h"
+
+// allowable difference between two floats to be considered equal
+#define DIFFERENCE_TOLERANCE 0.0001
+
+#define DIFFERENCE_BASE "../tests/tests.sww"
+#define DIFFERENCE_RUN "differencetest.sww"
+
+// byte offset of the stage of vertex 5 at the second timestep in tests.sww: the record
+// variables start at 996, 84 bytes a record, the time and then the stage of 20 vertices
+#define DIFFERENCE_PATCH_OFFSET (1000 + 84 + 5*4)
+#define DIFFERENCE_PATCH 0.5f
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( DifferenceTest );
+
+
+/**
+ * Copy tests.sww, raising the stage of one vertex at one timestep.
+ */
+static bool writePatchedCopy()
+{
+	FILE * in = fopen(DIFFERENCE_BASE, "rb");
+	if (!in)
+	{
+		return false;
+	}
+	std::vector<unsigned char> bytes;
+	unsigned char buffer[4096];
+	size_t count;
+	while ((count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		bytes.insert(bytes.end(), buffer, buffer + count);
+	}
+	fclose(in);
+
+	if (bytes.size() < DIFFERENCE_PATCH_OFFSET + 4)
+	{
+		return false;
+	}
+
+	// netcdf floats are big-endian
+	unsigned char * p = &bytes[DIFFERENCE_PATCH_OFFSET];
+	union { float f; unsigned int i; } value;
+	value.i = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	value.f += DIFFERENCE_PATCH;
+	p[0] = value.i >> 24;
+	p[1] = value.i >> 16;
+	p[2] = value.i >> 8;
+	p[3] = value.i;
+
+	FILE * out = fopen(DIFFERENCE_RUN, "wb");
+	if (!out)
+	{
+		return false;
+	}
+	const bool written = (fwrite(&bytes[0], 1, bytes.size(), out) == bytes.size());
+	return (fclose(out) == 0) && written;
+}
+
+
+void DifferenceTest::setUp()
+{
+	CPPUNIT_ASSERT( writePatchedCopy() );
+	_base = new SWWReader(DIFFERENCE_BASE);
+	_run = new SWWReader(DIFFERENCE_RUN, true, _base->getMesh());
+	remove(Difference::getCacheFilename(DIFFERENCE_BASE, DIFFERENCE_RUN).c_str());
+	remove(Difference::getCacheFilename(DIFFERENCE_BASE, DIFFERENCE_BASE).c_str());
+}
+
+
+void DifferenceTest::tearDown()
+{
+	remove(Difference::getCacheFilename(DIFFERENCE_BASE, DIFFERENCE_RUN).c_str());
+	remove(Difference::getCacheFilename(DIFFERENCE_BASE, DIFFERENCE_BASE).c_str());
+	remove(DIFFERENCE_RUN);
+}
+
+
+void DifferenceTest::testSelf()
+{
+	CPPUNIT_ASSERT( _base->isValid() );
+
+	Difference difference(1);
+	CPPUNIT_ASSERT( difference.compute(_base, _base) );
+	CPPUNIT_ASSERT( difference.isValid() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, difference.getProgress(), DIFFERENCE_TOLERANCE );
+
+	for (int q=0; q<Difference::DIFFERENCE_NUM_OF; q++)
+	{
+		const std::vector<float> & maximum = difference.getMaximum((Difference::Quantity) q);
+		CPPUNIT_ASSERT_EQUAL( _base->getNumberOfVertices(), maximum.size() );
+		for (size_t iv=0; iv<maximum.size(); iv++)
+		{
+			CPPUNIT_ASSERT_EQUAL( 0.0f, maximum[iv] );
+		}
+	}
+}
+
+
+void DifferenceTest::testChangedStage()
+{
+	CPPUNIT_ASSERT( _run->isValid() );
+	CPPUNIT_ASSERT( _run->isMeshShared() );
+
+	Difference difference(4);
+	CPPUNIT_ASSERT( difference.compute(_base, _run) );
+
+	const std::vector<float> & stage = difference.getMaximum(Difference::DIFFERENCE_STAGE);
+	const std::vector<float> & depth = difference.getMaximum(Difference::DIFFERENCE_DEPTH);
+	for (size_t iv=0; iv<stage.size(); iv++)
+	{
+		if (iv == 5)
+		{
+			continue;
+		}
+		CPPUNIT_ASSERT_EQUAL( 0.0f, stage[iv] );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, depth[iv] );
+	}
+
+	// vertex 5 is wet, 0.0664 deep, so its depth rises by as much as its stage
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( DIFFERENCE_PATCH, stage[5], DIFFERENCE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, difference.getTimeOfMaximum(Difference::DIFFERENCE_STAGE)[5], DIFFERENCE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( DIFFERENCE_PATCH, depth[5], DIFFERENCE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, difference.getTimeOfMaximum(Difference::DIFFERENCE_DEPTH)[5], DIFFERENCE_TOLERANCE );
+
+	// the other way round, the sign flips
+	Difference reverse(1);
+	remove(Difference::getCacheFilename(DIFFERENCE_RUN, DIFFERENCE_BASE).c_str());
+	CPPUNIT_ASSERT( reverse.compute(_run, _base) );
+	remove(Difference::getCacheFilename(DIFFERENCE_RUN, DIFFERENCE_BASE).c_str());
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( -DIFFERENCE_PATCH, reverse.getMaximum(Difference::DIFFERENCE_STAGE)[5], DIFFERENCE_TOLERANCE );
+}
+
+
+void DifferenceTest::testCache()
+{
+	CPPUNIT_ASSERT( _run->isValid() );
+
+	Difference first(1);
+	CPPUNIT_ASSERT( first.compute(_base, _run) );
+	CPPUNIT_ASSERT( !first.isFromCache() );
+
+	Difference second(1);
+	CPPUNIT_ASSERT( second.compute(_base, _run) );
+	CPPUNIT_ASSERT( second.isFromCache() );
+	for (int q=0; q<Difference::DIFFERENCE_NUM_OF; q++)
+	{
+		Difference::Quantity quantity = (Difference::Quantity) q;
+		CPPUNIT_ASSERT( first.getMaximum(quantity) == second.getMaximum(quantity) );
+		CPPUNIT_ASSERT( first.getTimeOfMaximum(quantity) == second.getTimeOfMaximum(quantity) );
+	}
+}
+
+
+void DifferenceTest::testMismatchedMesh()
+{
+	SWWReader * partition = new SWWReader("../tests/tests_P0_2.sww");
+	CPPUNIT_ASSERT( partition->isValid() );
+	CPPUNIT_ASSERT( !Difference::isComparable(_base, partition) );
+
+	Difference difference(1);
+	CPPUNIT_ASSERT( !difference.compute(_base, partition) );
+	CPPUNIT_ASSERT( !difference.isValid() );
+}
+
+
+void DifferenceTest::testArithmetic()
+{
+	const float stage[4] = { 1.0f, 2.0f, -1.0f, 0.5f };
+	const float elevation[4] = { 0.0f, 2.5f, -2.0f, 0.5f };
+	float out[4];
+
+	Difference::subtract(stage, elevation, out, 4);
+	CPPUNIT_ASSERT_EQUAL( 1.0f, out[0] );
+	CPPUNIT_ASSERT_EQUAL( -0.5f, out[1] );
+	CPPUNIT_ASSERT_EQUAL( 1.0f, out[2] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, out[3] );
+
+	// dry land has no depth
+	Difference::depth(stage, elevation, out, 4);
+	CPPUNIT_ASSERT_EQUAL( 1.0f, out[0] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, out[1] );
+	CPPUNIT_ASSERT_EQUAL( 1.0f, out[2] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, out[3] );
+}
@@ -0,0 +1,35 @@
+#ifndef DIFFERENCETEST_H_
+#define DIFFERENCETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class DifferenceTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( DifferenceTest );
+	CPPUNIT_TEST( testSelf );
+	CPPUNIT_TEST( testChangedStage );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST( testMismatchedMesh );
+	CPPUNIT_TEST( testArithmetic );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testSelf();
+	void testChangedStage();
+	void testCache();
+	void testMismatchedMesh();
+	void testArithmetic();
+
+private:
+	SWWReader* _base;
+	SWWReader* _run;
+};
+
+#endif // DIFFERENCETEST_H_
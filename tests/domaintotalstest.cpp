@@ -0,0 +1,104 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <domaintotals.h>
+
+#include "domaintotalstest.h"
+
+// allowable difference between two floats to be considered equal
+#define DOMAINTOTALS_TOLERANCE 0.0005
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( DomainTotalsTest );
+
+
+void DomainTotalsTest::setUp()
+{
+	_sww = new SWWReader("../tests/tests.sww");
+}
+
+
+void DomainTotalsTest::tearDown()
+{
+}
+
+
+void DomainTotalsTest::testTriangleAreas()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+	CPPUNIT_ASSERT_EQUAL( _sww->getNumberOfTriangles(), _sww->getTriangleAreas().size() );
+
+	// the mesh covers a 2 x 2 square
+	double area = 0.0;
+	for (size_t it=0; it<_sww->getTriangleAreas().size(); it++)
+	{
+		CPPUNIT_ASSERT( _sww->getTriangleAreas()[it] > 0.0f );
+		area += _sww->getTriangleAreas()[it];
+	}
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 4.0, area, DOMAINTOTALS_TOLERANCE );
+}
+
+
+void DomainTotalsTest::testTotals()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	DomainTotals totals(0.001f, 1);
+	CPPUNIT_ASSERT( totals.compute(_sww) );
+	CPPUNIT_ASSERT( totals.isValid() );
+	CPPUNIT_ASSERT_EQUAL( _sww->getNumberOfTimesteps(), totals.getNumFramesDone() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, totals.getProgress(), DOMAINTOTALS_TOLERANCE );
+
+	const std::vector<float> & wetarea = totals.getTotal(DomainTotals::TOTAL_WET_AREA);
+	const std::vector<float> & volume = totals.getTotal(DomainTotals::TOTAL_VOLUME);
+	const std::vector<float> & maxdepth = totals.getTotal(DomainTotals::TOTAL_MAX_DEPTH);
+	CPPUNIT_ASSERT_EQUAL( (size_t) _sww->getNumberOfTimesteps(), volume.size() );
+
+	// all wet at the start, then draining towards vertex 16, whose depths of 0.0500,
+	// 0.2944 and 0.5663 are the deepest at each step
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 4.0, wetarea[0], DOMAINTOTALS_TOLERANCE );
+	CPPUNIT_ASSERT( wetarea[2] < wetarea[1] && wetarea[1] < wetarea[0] );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0500, maxdepth[0], DOMAINTOTALS_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.2944, maxdepth[1], DOMAINTOTALS_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5663, maxdepth[2], DOMAINTOTALS_TOLERANCE );
+
+	// hard-coded from the sww file
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1800, volume[0], DOMAINTOTALS_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1179, volume[1], DOMAINTOTALS_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0811, volume[2], DOMAINTOTALS_TOLERANCE );
+
+	// a deeper wet depth shrinks the wet area, but all the water still counts to the volume
+	DomainTotals deep(0.1f, 1);
+	CPPUNIT_ASSERT( deep.compute(_sww) );
+	const std::vector<float> & deeparea = deep.getTotal(DomainTotals::TOTAL_WET_AREA);
+	const std::vector<float> & deepvolume = deep.getTotal(DomainTotals::TOTAL_VOLUME);
+	CPPUNIT_ASSERT( deeparea[0] < wetarea[0] );
+	for (size_t t=0; t<volume.size(); t++)
+	{
+		CPPUNIT_ASSERT( deeparea[t] <= wetarea[t] );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( volume[t], deepvolume[t], DOMAINTOTALS_TOLERANCE );
+	}
+}
+
+
+void DomainTotalsTest::testThreadsAgree()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	DomainTotals serial(0.001f, 1);
+	DomainTotals parallel(0.001f, 4, true);
+	CPPUNIT_ASSERT( serial.compute(_sww) );
+	CPPUNIT_ASSERT( parallel.compute(_sww) );
+
+	// the parts are summed in any order, so only near enough equal
+	for (int q=0; q<DomainTotals::TOTAL_NUM_OF; q++)
+	{
+		const std::vector<float> & a = serial.getTotal((DomainTotals::Quantity) q);
+		const std::vector<float> & b = parallel.getTotal((DomainTotals::Quantity) q);
+		CPPUNIT_ASSERT_EQUAL( a.size(), b.size() );
+		for (size_t t=0; t<a.size(); t++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( a[t], b[t], DOMAINTOTALS_TOLERANCE );
+		}
+	}
+}
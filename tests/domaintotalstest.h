@@ -0,0 +1,30 @@
+#ifndef DOMAINTOTALSTEST_H_
+#define DOMAINTOTALSTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class DomainTotalsTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( DomainTotalsTest );
+	CPPUNIT_TEST( testTriangleAreas );
+	CPPUNIT_TEST( testTotals );
+	CPPUNIT_TEST( testThreadsAgree );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testTriangleAreas();
+	void testTotals();
+	void testThreadsAgree();
+
+private:
+	SWWReader* _sww;
+};
+
+#endif // DOMAINTOTALSTEST_H_
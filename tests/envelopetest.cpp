@@ -0,0 +1,152 @@
+
+#include <stdio.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <envelope.h>
+#include <inundation.h>
+
+#include "envelopetest.h"
+
+// allowable difference between two floats to be considered equal
+#define ENVELOPE_TOLERANCE 0.001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( EnvelopeTest );
+
+
+void EnvelopeTest::setUp()
+{
+	_sww = new SWWReader("../tests/tests.sww");
+	remove(Envelope::getCacheFilename("../tests/tests.sww").c_str());
+}
+
+
+void EnvelopeTest::tearDown()
+{
+	remove(Envelope::getCacheFilename("../tests/tests.sww").c_str());
+}
+
+
+void EnvelopeTest::testMaxima()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Envelope envelope(1);
+	CPPUNIT_ASSERT( envelope.compute(_sww) );
+	CPPUNIT_ASSERT( envelope.isValid() );
+	CPPUNIT_ASSERT( !envelope.isFromCache() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, envelope.getProgress(), ENVELOPE_TOLERANCE );
+
+	const std::vector<float> & stage = envelope.getMaximum(Envelope::ENVELOPE_STAGE);
+	CPPUNIT_ASSERT_EQUAL( stage.size(), _sww->getNumberOfVertices() );
+
+	// hard-coded stage values from sww file, all falling from the first timestep
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.05, stage[0], ENVELOPE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( -0.116667, stage[4], ENVELOPE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.1021, stage[5], ENVELOPE_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, envelope.getTimeOfMaximum(Envelope::ENVELOPE_STAGE)[5], ENVELOPE_TOLERANCE );
+
+	// depths are never negative, and there is no momentum to give a speed
+	const std::vector<float> & depth = envelope.getMaximum(Envelope::ENVELOPE_DEPTH);
+	const std::vector<float> & speed = envelope.getMaximum(Envelope::ENVELOPE_SPEED);
+	for (size_t iv=0; iv<depth.size(); iv++)
+	{
+		CPPUNIT_ASSERT( depth[iv] >= 0.0f );
+		CPPUNIT_ASSERT_EQUAL( 0.0f, speed[iv] );
+	}
+}
+
+
+void EnvelopeTest::testThreadsAgree()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Envelope serial(1);
+	Envelope parallel(4);
+	CPPUNIT_ASSERT( serial.compute(_sww) );
+	remove(Envelope::getCacheFilename("../tests/tests.sww").c_str());
+	CPPUNIT_ASSERT( parallel.compute(_sww) );
+	CPPUNIT_ASSERT( !parallel.isFromCache() );
+
+	for (int q=0; q<Envelope::ENVELOPE_NUM_OF; q++)
+	{
+		Envelope::Quantity quantity = (Envelope::Quantity) q;
+		CPPUNIT_ASSERT( serial.getMaximum(quantity) == parallel.getMaximum(quantity) );
+		CPPUNIT_ASSERT( serial.getTimeOfMaximum(quantity) == parallel.getTimeOfMaximum(quantity) );
+	}
+}
+
+
+void EnvelopeTest::testCache()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Envelope first(1);
+	CPPUNIT_ASSERT( first.compute(_sww) );
+	CPPUNIT_ASSERT( !first.isFromCache() );
+
+	// the second time round comes from the sidecar, unchanged
+	Envelope second(1);
+	CPPUNIT_ASSERT( second.compute(_sww) );
+	CPPUNIT_ASSERT( second.isFromCache() );
+	for (int q=0; q<Envelope::ENVELOPE_NUM_OF; q++)
+	{
+		Envelope::Quantity quantity = (Envelope::Quantity) q;
+		CPPUNIT_ASSERT( first.getMaximum(quantity) == second.getMaximum(quantity) );
+		CPPUNIT_ASSERT( first.getTimeOfMaximum(quantity) == second.getTimeOfMaximum(quantity) );
+	}
+
+	// a cache that doesn't match is recomputed
+	FILE * file = fopen(Envelope::getCacheFilename("../tests/tests.sww").c_str(), "r+b");
+	CPPUNIT_ASSERT( file );
+	fputs("stale", file);
+	fclose(file);
+
+	Envelope third(1);
+	CPPUNIT_ASSERT( third.compute(_sww) );
+	CPPUNIT_ASSERT( !third.isFromCache() );
+	CPPUNIT_ASSERT( first.getMaximum(Envelope::ENVELOPE_STAGE) == third.getMaximum(Envelope::ENVELOPE_STAGE) );
+}
+
+
+void EnvelopeTest::testSharedPass()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+	const std::string inundationCache = Inundation::getCacheFilename("../tests/tests.sww");
+	remove(inundationCache.c_str());
+
+	Envelope envelope(1);
+	Inundation inundation(0.01f, 1);
+	CPPUNIT_ASSERT( envelope.compute(_sww) );
+	CPPUNIT_ASSERT( inundation.compute(_sww) );
+	remove(Envelope::getCacheFilename("../tests/tests.sww").c_str());
+	remove(inundationCache.c_str());
+
+	// both fed from one pass agree with a pass each
+	Envelope sharedEnvelope(1);
+	Inundation sharedInundation(0.01f, 1);
+	SWWReader::FrameVisitorList pass;
+	CPPUNIT_ASSERT( sharedEnvelope.beginPass(_sww) );
+	pass.add(&sharedEnvelope);
+	CPPUNIT_ASSERT( sharedInundation.beginPass(_sww) );
+	pass.add(&sharedInundation);
+	const bool read = _sww->readFrames(pass);
+	CPPUNIT_ASSERT( sharedEnvelope.endPass(read) );
+	CPPUNIT_ASSERT( sharedInundation.endPass(read) );
+
+	for (int q=0; q<Envelope::ENVELOPE_NUM_OF; q++)
+	{
+		Envelope::Quantity quantity = (Envelope::Quantity) q;
+		CPPUNIT_ASSERT( envelope.getMaximum(quantity) == sharedEnvelope.getMaximum(quantity) );
+		CPPUNIT_ASSERT( envelope.getTimeOfMaximum(quantity) == sharedEnvelope.getTimeOfMaximum(quantity) );
+	}
+	CPPUNIT_ASSERT( inundation.getArrivalTime() == sharedInundation.getArrivalTime() );
+	CPPUNIT_ASSERT( inundation.getDuration() == sharedInundation.getDuration() );
+
+	// and leave their caches written, so the next begins from them
+	Envelope cached(1);
+	CPPUNIT_ASSERT( !cached.beginPass(_sww) );
+	CPPUNIT_ASSERT( cached.isValid() && cached.isFromCache() );
+	remove(inundationCache.c_str());
+}
@@ -0,0 +1,33 @@
+
+#ifndef ENVELOPETEST_H_
+#define ENVELOPETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class EnvelopeTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( EnvelopeTest );
+	CPPUNIT_TEST( testMaxima );
+	CPPUNIT_TEST( testThreadsAgree );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST( testSharedPass );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testMaxima();
+	void testThreadsAgree();
+	void testCache();
+	void testSharedPass();
+
+private:
+	SWWReader* _sww;
+};
+
+#endif // ENVELOPETEST_H_
@@ -0,0 +1,62 @@
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <framecache.h>
+
+#include "framecachetest.h"
+
+// allowable difference between two floats to be considered equal
+#define FRAMECACHE_TOLERANCE 0.001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( FrameCacheTest );
+
+
+void FrameCacheTest::testLeastRecentlyUsed()
+{
+	FrameCache cache(2);
+	cache.insert(new FrameCache::Frame(0));
+	cache.insert(new FrameCache::Frame(1));
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, cache.size() );
+
+	// using 0 leaves 1 the oldest, so it is the one dropped
+	CPPUNIT_ASSERT( cache.find(0) );
+	cache.insert(new FrameCache::Frame(2));
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, cache.size() );
+	CPPUNIT_ASSERT( cache.find(0) );
+	CPPUNIT_ASSERT( !cache.find(1) );
+	CPPUNIT_ASSERT( cache.find(2) );
+
+	// replacing a frame doesn't grow the cache
+	cache.insert(new FrameCache::Frame(2));
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, cache.size() );
+
+	cache.setCapacity(1);
+	CPPUNIT_ASSERT_EQUAL( (size_t) 1, cache.size() );
+	CPPUNIT_ASSERT( cache.find(2) );
+
+	cache.clear();
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, cache.size() );
+	CPPUNIT_ASSERT( !cache.find(2) );
+}
+
+
+void FrameCacheTest::testDerived()
+{
+	const float elevation[1] = { -1.0f };
+
+	osg::ref_ptr<FrameCache::Frame> frame = new FrameCache::Frame(0);
+	frame->_stage.push_back(0.0f);
+
+	// nothing to derive without momentum
+	CPPUNIT_ASSERT( !frame->getDerived(DerivedQuantity::DQ_VELOCITY, elevation) );
+
+	frame->_xmomentum.push_back(1.2f);
+	frame->_ymomentum.push_back(1.6f);
+	const float * velocity = frame->getDerived(DerivedQuantity::DQ_VELOCITY, elevation);
+	CPPUNIT_ASSERT( velocity );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 2.0, velocity[0], FRAMECACHE_TOLERANCE );
+
+	// computed once, then kept
+	CPPUNIT_ASSERT( velocity == frame->getDerived(DerivedQuantity::DQ_VELOCITY, elevation) );
+}
@@ -0,0 +1,21 @@
+#ifndef FRAMECACHETEST_H_
+#define FRAMECACHETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+
+
+class FrameCacheTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( FrameCacheTest );
+	CPPUNIT_TEST( testLeastRecentlyUsed );
+	CPPUNIT_TEST( testDerived );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void testLeastRecentlyUsed();
+	void testDerived();
+};
+
+#endif // FRAMECACHETEST_H_
@@ -0,0 +1,99 @@
+
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <framescheduler.h>
+
+#include "frameschedulertest.h"
+
+// allowable difference between two floats to be considered equal
+#define FRAMESCHEDULER_TOLERANCE 0.001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( FrameSchedulerTest );
+
+
+void FrameSchedulerTest::setUp()
+{
+	_sww = new SWWReader("../tests/tests.sww");
+}
+
+
+void FrameSchedulerTest::testRequest()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	// every timestep at once, the last asked for most urgent
+	const unsigned int ntimesteps = _sww->getNumberOfTimesteps();
+	std::vector< osg::ref_ptr<FrameRequest> > requests;
+	for (unsigned int t=0; t<ntimesteps; t++)
+	{
+		requests.push_back(_sww->requestFrame(t, t));
+	}
+
+	// each as read directly
+	for (unsigned int t=0; t<ntimesteps; t++)
+	{
+		const FrameCache::Frame * frame = requests[t]->wait();
+		CPPUNIT_ASSERT( frame != NULL );
+		CPPUNIT_ASSERT( requests[t]->isDone() );
+		CPPUNIT_ASSERT( !requests[t]->isCancelled() );
+		CPPUNIT_ASSERT_EQUAL( t, frame->_timestep );
+		CPPUNIT_ASSERT( requests[t]->getFrame() == frame );
+
+		std::vector<float> stage, elevation;
+		CPPUNIT_ASSERT( _sww->readFrame(t, stage, elevation) );
+		CPPUNIT_ASSERT_EQUAL( stage.size(), frame->_stage.size() );
+		for (size_t iv=0; iv<stage.size(); iv++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( stage[iv], frame->_stage[iv], FRAMESCHEDULER_TOLERANCE );
+		}
+	}
+}
+
+
+void FrameSchedulerTest::testCached()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	// read ahead into the reader's cache, so loading it doesn't read it again
+	osg::ref_ptr<FrameRequest> request = _sww->requestFrame(1);
+	const FrameCache::Frame * frame = request->wait();
+	CPPUNIT_ASSERT( frame != NULL );
+	CPPUNIT_ASSERT( _sww->loadFrame(1).get() == frame );
+
+	CPPUNIT_ASSERT( _sww->loadStageVertexArray(1) );
+	CPPUNIT_ASSERT_EQUAL( _sww->getNumberOfVertices(), (size_t) _sww->getStageVertexArray()->size() );
+}
+
+
+void FrameSchedulerTest::testCancel()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	// either dropped before it was read, or read in full
+	osg::ref_ptr<FrameRequest> request = _sww->requestFrame(0);
+	request->cancel();
+	const FrameCache::Frame * frame = request->wait();
+	CPPUNIT_ASSERT( request->isDone() );
+	CPPUNIT_ASSERT( request->isCancelled() ? (frame == NULL) : (frame != NULL) );
+
+	// cancelling once read changes nothing
+	request = _sww->requestFrame(0);
+	frame = request->wait();
+	request->cancel();
+	CPPUNIT_ASSERT( !request->isCancelled() );
+	CPPUNIT_ASSERT( request->getFrame() == frame );
+}
+
+
+void FrameSchedulerTest::testOutOfRange()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	osg::ref_ptr<FrameRequest> request = _sww->requestFrame(_sww->getNumberOfTimesteps());
+	CPPUNIT_ASSERT( request->wait() == NULL );
+	CPPUNIT_ASSERT( request->isDone() );
+	CPPUNIT_ASSERT( !request->isCancelled() );
+}
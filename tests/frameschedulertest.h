@@ -0,0 +1,31 @@
+#ifndef FRAMESCHEDULERTEST_H_
+#define FRAMESCHEDULERTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class FrameSchedulerTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( FrameSchedulerTest );
+	CPPUNIT_TEST( testRequest );
+	CPPUNIT_TEST( testCached );
+	CPPUNIT_TEST( testCancel );
+	CPPUNIT_TEST( testOutOfRange );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+
+	void testRequest();
+	void testCached();
+	void testCancel();
+	void testOutOfRange();
+
+private:
+	SWWReader* _sww;
+};
+
+#endif // FRAMESCHEDULERTEST_H_
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <inundation.h>
+
+#include "inundationtest.h"
+
+// allowable difference between two floats to be considered equal
+#define INUNDATION_TOLERANCE 0.005
+
+#define INUNDATION_CSV "inundationtest.csv"
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( InundationTest );
+
+
+void InundationTest::setUp()
+{
+	_sww = new SWWReader("../tests/tests.sww");
+	remove(Inundation::getCacheFilename("../tests/tests.sww").c_str());
+}
+
+
+void InundationTest::tearDown()
+{
+	remove(Inundation::getCacheFilename("../tests/tests.sww").c_str());
+	remove(INUNDATION_CSV);
+}
+
+
+void InundationTest::testMaps()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	// the water drains away, most vertices are wet from the start
+	Inundation shallow(0.01f, 1);
+	CPPUNIT_ASSERT( shallow.compute(_sww) );
+	CPPUNIT_ASSERT( shallow.isValid() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, shallow.getProgress(), INUNDATION_TOLERANCE );
+	CPPUNIT_ASSERT_EQUAL( _sww->getNumberOfVertices(), shallow.getArrivalTime().size() );
+
+	// hard-coded from the depths in the sww file, 0.0500, 0.0149 and 0.0002 at vertex 0,
+	// which drops below the threshold a third of the way through the second step
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, shallow.getArrivalTime()[0], INUNDATION_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.6667, shallow.getDuration()[0], INUNDATION_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.4375, shallow.getDuration()[1], INUNDATION_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, shallow.getDuration()[16], INUNDATION_TOLERANCE );
+
+	// deeper, vertex 16 floods just after the start as its depth goes from 0.0500 to 0.2944
+	Inundation deep(0.06f, 1);
+	CPPUNIT_ASSERT( deep.compute(_sww) );
+	CPPUNIT_ASSERT_EQUAL( Inundation::getNever(), deep.getArrivalTime()[0] );
+	CPPUNIT_ASSERT_EQUAL( 0.0f, deep.getDuration()[0] );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0205, deep.getArrivalTime()[16], INUNDATION_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.9795, deep.getDuration()[16], INUNDATION_TOLERANCE );
+
+	for (size_t iv=0; iv<deep.getDuration().size(); iv++)
+	{
+		CPPUNIT_ASSERT( deep.getDuration()[iv] >= 0.0f );
+		CPPUNIT_ASSERT( deep.getDuration()[iv] <= 1.0f + INUNDATION_TOLERANCE );
+		CPPUNIT_ASSERT( (deep.getArrivalTime()[iv] == Inundation::getNever()) == (deep.getDuration()[iv] == 0.0f) );
+	}
+}
+
+
+void InundationTest::testThreadsAgree()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Inundation serial(0.01f, 1);
+	Inundation parallel(0.01f, 4);
+	CPPUNIT_ASSERT( serial.compute(_sww) );
+	remove(Inundation::getCacheFilename("../tests/tests.sww").c_str());
+	CPPUNIT_ASSERT( parallel.compute(_sww) );
+	CPPUNIT_ASSERT( !parallel.isFromCache() );
+
+	CPPUNIT_ASSERT( serial.getArrivalTime() == parallel.getArrivalTime() );
+	CPPUNIT_ASSERT( serial.getDuration() == parallel.getDuration() );
+}
+
+
+void InundationTest::testCache()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Inundation first(0.01f, 1);
+	CPPUNIT_ASSERT( first.compute(_sww) );
+	CPPUNIT_ASSERT( !first.isFromCache() );
+
+	Inundation second(0.01f, 1);
+	CPPUNIT_ASSERT( second.compute(_sww) );
+	CPPUNIT_ASSERT( second.isFromCache() );
+	CPPUNIT_ASSERT( first.getArrivalTime() == second.getArrivalTime() );
+	CPPUNIT_ASSERT( first.getDuration() == second.getDuration() );
+
+	// the cache only answers for the threshold it was computed with
+	Inundation other(0.06f, 1);
+	CPPUNIT_ASSERT( other.compute(_sww) );
+	CPPUNIT_ASSERT( !other.isFromCache() );
+}
+
+
+void InundationTest::testWrite()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	Inundation inundation(0.01f, 1);
+	CPPUNIT_ASSERT( inundation.compute(_sww) );
+	CPPUNIT_ASSERT( inundation.write(INUNDATION_CSV, _sww) );
+
+	// a header, then a line per vertex
+	FILE * file = fopen(INUNDATION_CSV, "r");
+	CPPUNIT_ASSERT( file );
+	char line[256];
+	size_t lines = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		lines++;
+	}
+	fclose(file);
+	CPPUNIT_ASSERT_EQUAL( _sww->getNumberOfVertices() + 1, lines );
+}
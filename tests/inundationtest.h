@@ -0,0 +1,32 @@
+#ifndef INUNDATIONTEST_H_
+#define INUNDATIONTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class InundationTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( InundationTest );
+	CPPUNIT_TEST( testMaps );
+	CPPUNIT_TEST( testThreadsAgree );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST( testWrite );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testMaps();
+	void testThreadsAgree();
+	void testCache();
+	void testWrite();
+
+private:
+	SWWReader* _sww;
+};
+
+#endif // INUNDATIONTEST_H_
@@ -0,0 +1,117 @@
+#include <cmath>
+#include <vector>
+#include <string>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <swwreader.h>
+#include <partitionedswwreader.h>
+
+#include "partitionedswwreadertest.h"
+
+#define TOLERANCE 0.0001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( PartitionedSWWReaderTest );
+
+
+/**
+ * Find the vertex of a reader at a georeferenced position.
+ */
+static int findVertex(SWWReader * aReader, const osg::Vec2 & aPosition)
+{
+	for (size_t iv=0; iv<aReader->getNumberOfVertices(); iv++)
+	{
+		const osg::Vec2 offset = aReader->getGeoreferencedVertex(iv) - aPosition;
+		if ((fabs(offset.x()) < TOLERANCE) && (fabs(offset.y()) < TOLERANCE))
+		{
+			return iv;
+		}
+	}
+	return -1;
+}
+
+
+void PartitionedSWWReaderTest::setUp()
+{
+	// tests.sww split into two partitions, each with a column of ghost triangles
+	_partitioned = new PartitionedSWWReader("../tests/tests_P1_2.sww", 2);
+	_whole = new SWWReader("../tests/tests.sww");
+}
+
+
+void PartitionedSWWReaderTest::tearDown()
+{
+}
+
+
+void PartitionedSWWReaderTest::testFilenames()
+{
+	std::vector<std::string> names;
+	CPPUNIT_ASSERT( PartitionedSWWReader::getPartitionFilenames("run/model_P2_4.sww", names) );
+	CPPUNIT_ASSERT_EQUAL( names.size(), (size_t)4 );
+	CPPUNIT_ASSERT_EQUAL( names[0], std::string("run/model_P0_4.sww") );
+	CPPUNIT_ASSERT_EQUAL( names[3], std::string("run/model_P3_4.sww") );
+
+	CPPUNIT_ASSERT( !PartitionedSWWReader::getPartitionFilenames("model.sww", names) );
+	CPPUNIT_ASSERT( !PartitionedSWWReader::getPartitionFilenames("model_P4_4.sww", names) );
+	CPPUNIT_ASSERT( !PartitionedSWWReader::getPartitionFilenames("model_P0_4.nc", names) );
+	CPPUNIT_ASSERT( !PartitionedSWWReader::getPartitionFilenames("model_Q0_4.sww", names) );
+}
+
+
+void PartitionedSWWReaderTest::testMesh()
+{
+	CPPUNIT_ASSERT( _partitioned->isValid() );
+	CPPUNIT_ASSERT_EQUAL( _partitioned->getNumberOfPartitions(), 2u );
+
+	// ghosts dropped and the shared column of points welded
+	CPPUNIT_ASSERT_EQUAL( _partitioned->getNumberOfVertices(), _whole->getNumberOfVertices() );
+	CPPUNIT_ASSERT_EQUAL( _partitioned->getNumberOfTimesteps(), 3u );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, _partitioned->getTime(2), TOLERANCE );
+
+	for (size_t iv=0; iv<_whole->getNumberOfVertices(); iv++)
+	{
+		CPPUNIT_ASSERT( findVertex(_partitioned, _whole->getGeoreferencedVertex(iv)) >= 0 );
+	}
+}
+
+
+void PartitionedSWWReaderTest::testStage()
+{
+	CPPUNIT_ASSERT( _partitioned->loadStageVertexArray(1) );
+	CPPUNIT_ASSERT( _whole->loadStageVertexArray(1) );
+
+	osg::ref_ptr<osg::Vec3Array> partitioned = _partitioned->getStageVertexArray();
+	osg::ref_ptr<osg::Vec3Array> whole = _whole->getStageVertexArray();
+	for (size_t iv=0; iv<_partitioned->getNumberOfVertices(); iv++)
+	{
+		const int match = findVertex(_whole, _partitioned->getGeoreferencedVertex(iv));
+		CPPUNIT_ASSERT( match >= 0 );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( whole->at(match).z(), partitioned->at(iv).z(), TOLERANCE );
+	}
+}
+
+
+void PartitionedSWWReaderTest::testTimeSeries()
+{
+	// one point in each partition, and one on the boundary between them
+	std::vector<osg::Vec2> points;
+	points.push_back( osg::Vec2(0.4, 0.1) );
+	points.push_back( osg::Vec2(1.7, 1.2) );
+	points.push_back( osg::Vec2(1.0, 0.5) );
+
+	osg::ref_ptr<osg::FloatArray> expected = new osg::FloatArray;
+	osg::ref_ptr<osg::FloatArray> actual = new osg::FloatArray;
+	for (size_t i=0; i<points.size(); i++)
+	{
+		CPPUNIT_ASSERT( _whole->getTimeSeries(points[i].x(), points[i].y(), SWWReader::TSTYPE_STAGE, expected) );
+		CPPUNIT_ASSERT( _partitioned->getTimeSeries(points[i].x(), points[i].y(), SWWReader::TSTYPE_STAGE, actual) );
+		CPPUNIT_ASSERT_EQUAL( expected->size(), actual->size() );
+		for (size_t t=0; t<expected->size(); t++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( expected->at(t), actual->at(t), TOLERANCE );
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#ifndef PARTITIONEDSWWREADERTEST_H_
+#define PARTITIONEDSWWREADERTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+
+class SWWReader;
+class PartitionedSWWReader;
+
+
+class PartitionedSWWReaderTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( PartitionedSWWReaderTest );
+	CPPUNIT_TEST( testFilenames );
+	CPPUNIT_TEST( testMesh );
+	CPPUNIT_TEST( testStage );
+	CPPUNIT_TEST( testTimeSeries );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testFilenames();
+	void testMesh();
+	void testStage();
+	void testTimeSeries();
+
+private:
+	PartitionedSWWReader * _partitioned;
+	SWWReader * _whole;	/**< The same domain unpartitioned */
+};
+
+#endif // PARTITIONEDSWWREADERTEST_H_
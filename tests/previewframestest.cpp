@@ -0,0 +1,127 @@
+
+#include <stdio.h>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <previewframes.h>
+
+#include "previewframestest.h"
+
+// allowable difference between two floats to be considered equal
+#define PREVIEW_TOLERANCE 0.001
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( PreviewFramesTest );
+
+
+void PreviewFramesTest::setUp()
+{
+	_sww = new SWWReader("../tests/tests.sww");
+	remove(PreviewFrames::getCacheFilename("../tests/tests.sww").c_str());
+}
+
+
+void PreviewFramesTest::tearDown()
+{
+	remove(PreviewFrames::getCacheFilename("../tests/tests.sww").c_str());
+}
+
+
+void PreviewFramesTest::testFrames()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	PreviewFrames preview;
+	CPPUNIT_ASSERT( !preview.isReady(0) );
+	CPPUNIT_ASSERT( preview.compute(_sww) );
+	CPPUNIT_ASSERT( preview.isValid() );
+	CPPUNIT_ASSERT( !preview.isFromCache() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, preview.getProgress(), PREVIEW_TOLERANCE );
+
+	// every timestep, and none beyond
+	const unsigned int ntimesteps = _sww->getNumberOfTimesteps();
+	CPPUNIT_ASSERT( preview.isReady(ntimesteps-1) );
+	CPPUNIT_ASSERT( !preview.isReady(ntimesteps) );
+
+	// depths at the cells' vertices, as read from the file; no momentum in this file
+	const std::vector<unsigned int> & vertices = preview.getVertices();
+	for (unsigned int t=0; t<ntimesteps; t++)
+	{
+		std::vector<float> stage, elevation;
+		CPPUNIT_ASSERT( _sww->readFrame(t, stage, elevation) );
+
+		const float * depth = preview.getDepth(t);
+		for (size_t i=0; i<vertices.size(); i++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( stage[vertices[i]] - elevation[vertices[i]], depth[i], PREVIEW_TOLERANCE );
+		}
+		CPPUNIT_ASSERT( preview.getXMomentum(t) == NULL );
+	}
+}
+
+
+void PreviewFramesTest::testClusteredMesh()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	// the coarsest grid the budget allows
+	PreviewFrames preview(1);
+	CPPUNIT_ASSERT( preview.compute(_sww) );
+	CPPUNIT_ASSERT_EQUAL( (unsigned int) PREVIEW_MIN_CELLS, preview.getCellsAcross() );
+
+	// ascending vertices, at most one per cell
+	const std::vector<unsigned int> & vertices = preview.getVertices();
+	CPPUNIT_ASSERT( !vertices.empty() );
+	CPPUNIT_ASSERT( vertices.size() <= _sww->getNumberOfVertices() );
+	CPPUNIT_ASSERT_EQUAL( 0u, vertices[0] );
+	for (size_t i=1; i<vertices.size(); i++)
+	{
+		CPPUNIT_ASSERT( vertices[i-1] < vertices[i] );
+	}
+
+	// no more triangles than the mesh, each with three different corners
+	const std::vector<unsigned int> & triangles = preview.getTriangles();
+	CPPUNIT_ASSERT( !triangles.empty() );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, triangles.size() % 3 );
+	CPPUNIT_ASSERT( triangles.size() / 3 <= _sww->getNumberOfTriangles() );
+	for (size_t it=0; it<triangles.size(); it+=3)
+	{
+		CPPUNIT_ASSERT( triangles[it] < vertices.size() );
+		CPPUNIT_ASSERT( triangles[it+1] < vertices.size() );
+		CPPUNIT_ASSERT( triangles[it+2] < vertices.size() );
+		CPPUNIT_ASSERT( triangles[it] != triangles[it+1] );
+		CPPUNIT_ASSERT( triangles[it+1] != triangles[it+2] );
+		CPPUNIT_ASSERT( triangles[it] != triangles[it+2] );
+	}
+}
+
+
+void PreviewFramesTest::testCache()
+{
+	CPPUNIT_ASSERT( _sww->isValid() );
+
+	PreviewFrames first;
+	CPPUNIT_ASSERT( first.compute(_sww) );
+	CPPUNIT_ASSERT( !first.isFromCache() );
+
+	// second time round answered from the sidecar, with the same frames
+	PreviewFrames second;
+	CPPUNIT_ASSERT( second.compute(_sww) );
+	CPPUNIT_ASSERT( second.isFromCache() );
+	CPPUNIT_ASSERT( second.isReady(_sww->getNumberOfTimesteps()-1) );
+	CPPUNIT_ASSERT( first.getVertices() == second.getVertices() );
+	CPPUNIT_ASSERT( first.getTriangles() == second.getTriangles() );
+	for (unsigned int t=0; t<_sww->getNumberOfTimesteps(); t++)
+	{
+		for (size_t i=0; i<first.getVertices().size(); i++)
+		{
+			CPPUNIT_ASSERT_EQUAL( first.getDepth(t)[i], second.getDepth(t)[i] );
+		}
+	}
+
+	// a different budget gives a different grid, so the sidecar no longer fits it
+	PreviewFrames coarse(1);
+	CPPUNIT_ASSERT( coarse.compute(_sww) );
+	CPPUNIT_ASSERT( coarse.getCellsAcross() != second.getCellsAcross() );
+	CPPUNIT_ASSERT( !coarse.isFromCache() );
+}
@@ -0,0 +1,30 @@
+#ifndef PREVIEWFRAMESTEST_H_
+#define PREVIEWFRAMESTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+
+
+class PreviewFramesTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( PreviewFramesTest );
+	CPPUNIT_TEST( testFrames );
+	CPPUNIT_TEST( testClusteredMesh );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testFrames();
+	void testClusteredMesh();
+	void testCache();
+
+private:
+	SWWReader* _sww;
+};
+
+#endif // PREVIEWFRAMESTEST_H_
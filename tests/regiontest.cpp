@@ -0,0 +1,224 @@
+#include <math.h>
+#include <algorithm>
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include "regiontest.h"
+
+// allowable difference between two floats to be considered equal
+#define REGION_TOLERANCE 0.0001
+
+#define REGION_FILE "../tests/tests.sww"
+
+// the same run with a georeference offset of 308500, 6189000
+#define REGION_OFFSET_FILE "../tests/offset.sww"
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( RegionTest );
+
+
+void RegionTest::setUp()
+{
+	_full = new SWWReader(REGION_FILE);
+
+	// the left half of the domain, from its own georeferenced vertices
+	double xmin = _full->getGeoreferencedVertex(0).x(), xmax = xmin;
+	double ymin = _full->getGeoreferencedVertex(0).y(), ymax = ymin;
+	for (size_t iv=1; iv<_full->getNumberOfVertices(); iv++)
+	{
+		const osg::Vec2d v = _full->getGeoreferencedVertex(iv);
+		xmin = std::min(xmin, v.x());
+		xmax = std::max(xmax, v.x());
+		ymin = std::min(ymin, v.y());
+		ymax = std::max(ymax, v.y());
+	}
+	_region.setBox(xmin - 1.0, ymin - 1.0, (xmin + xmax) / 2, ymax + 1.0);
+
+	SWWReader::LoadOptions options;
+	options.region = _region;
+	_part = new SWWReader(REGION_FILE, true, NULL, true, options);
+}
+
+
+void RegionTest::tearDown()
+{
+	// readers are never deleted, see SWWReader
+}
+
+
+void RegionTest::testParse()
+{
+	Region region;
+	CPPUNIT_ASSERT( Region::parse("0,0,10,20", region) );
+	CPPUNIT_ASSERT( region.contains(5.0f, 15.0f) );
+	CPPUNIT_ASSERT( !region.contains(11.0f, 15.0f) );
+
+	CPPUNIT_ASSERT( Region::parse("0,0,10,0,0,10", region) );
+	CPPUNIT_ASSERT( region.contains(2.0f, 2.0f) );
+	CPPUNIT_ASSERT( !region.contains(8.0f, 8.0f) );
+
+	// malformed, or a box the wrong way round, leave the region as it was
+	CPPUNIT_ASSERT( !Region::parse("", region) );
+	CPPUNIT_ASSERT( !Region::parse("1,2,3", region) );
+	CPPUNIT_ASSERT( !Region::parse("0,0,10,0,0", region) );
+	CPPUNIT_ASSERT( !Region::parse("0,0,10,a", region) );
+	CPPUNIT_ASSERT( !Region::parse("0,0,10,20,", region) );
+	CPPUNIT_ASSERT( !Region::parse("10,0,0,20", region) );
+	CPPUNIT_ASSERT( region.contains(2.0f, 2.0f) );
+	CPPUNIT_ASSERT( !region.contains(8.0f, 8.0f) );
+}
+
+
+void RegionTest::testContains()
+{
+	Region region;
+	CPPUNIT_ASSERT( region.isEmpty() );
+	CPPUNIT_ASSERT( region.contains(1e6f, -1e6f) );
+
+	// an L shape, its notch outside
+	std::vector<osg::Vec2d> corners;
+	corners.push_back(osg::Vec2d(0, 0));
+	corners.push_back(osg::Vec2d(10, 0));
+	corners.push_back(osg::Vec2d(10, 5));
+	corners.push_back(osg::Vec2d(5, 5));
+	corners.push_back(osg::Vec2d(5, 10));
+	corners.push_back(osg::Vec2d(0, 10));
+	region.setPolygon(corners);
+	CPPUNIT_ASSERT( !region.isEmpty() );
+	CPPUNIT_ASSERT( region.contains(2.0f, 8.0f) );
+	CPPUNIT_ASSERT( region.contains(8.0f, 2.0f) );
+	CPPUNIT_ASSERT( !region.contains(8.0f, 8.0f) );
+	CPPUNIT_ASSERT( !region.contains(-1.0f, 2.0f) );
+
+	// edges and corners are inside
+	CPPUNIT_ASSERT( region.contains(10.0f, 2.0f) );
+	CPPUNIT_ASSERT( region.contains(7.0f, 5.0f) );
+	CPPUNIT_ASSERT( region.contains(0.0f, 0.0f) );
+
+	region.clear();
+	CPPUNIT_ASSERT( region.isEmpty() );
+}
+
+
+void RegionTest::testMesh()
+{
+	CPPUNIT_ASSERT( _part->isValid() );
+	CPPUNIT_ASSERT( _full->getRegionPoints().empty() );
+
+	const std::vector<unsigned int> & points = _part->getRegionPoints();
+	CPPUNIT_ASSERT_EQUAL( _part->getNumberOfVertices(), points.size() );
+	CPPUNIT_ASSERT( points.size() < _full->getNumberOfVertices() );
+	CPPUNIT_ASSERT( _part->getNumberOfTriangles() < _full->getNumberOfTriangles() );
+	CPPUNIT_ASSERT_EQUAL( _full->getNumberOfTimesteps(), _part->getNumberOfTimesteps() );
+
+	// in file order, at the same place
+	for (size_t iv=0; iv<points.size(); iv++)
+	{
+		CPPUNIT_ASSERT( (iv == 0) || (points[iv] > points[iv-1]) );
+		CPPUNIT_ASSERT( _part->getGeoreferencedVertex(iv) == _full->getGeoreferencedVertex(points[iv]) );
+	}
+
+	// every triangle touches the region, and every vertex inside is loaded
+	const unsigned int * triangles = _part->getTriangles();
+	for (size_t it=0; it<_part->getNumberOfTriangles(); it++)
+	{
+		bool touches = false;
+		for (int k=0; k<3; k++)
+		{
+			CPPUNIT_ASSERT( triangles[3*it+k] < points.size() );
+			const osg::Vec2d v = _part->getGeoreferencedVertex(triangles[3*it+k]);
+			touches = touches || _region.contains(v.x(), v.y());
+		}
+		CPPUNIT_ASSERT( touches );
+	}
+	size_t inside = 0;
+	for (size_t iv=0; iv<_full->getNumberOfVertices(); iv++)
+	{
+		const osg::Vec2d v = _full->getGeoreferencedVertex(iv);
+		inside += _region.contains(v.x(), v.y()) ? 1 : 0;
+	}
+	CPPUNIT_ASSERT( inside > 0 );
+	CPPUNIT_ASSERT( inside <= points.size() );
+}
+
+
+void RegionTest::testFrames()
+{
+	const std::vector<unsigned int> & points = _part->getRegionPoints();
+	for (unsigned int t=0; t<_full->getNumberOfTimesteps(); t++)
+	{
+		std::vector<float> fullStage, fullElevation, stage, elevation;
+		CPPUNIT_ASSERT( _full->readFrame(t, fullStage, fullElevation) );
+		CPPUNIT_ASSERT( _part->readFrame(t, stage, elevation) );
+		CPPUNIT_ASSERT_EQUAL( points.size(), stage.size() );
+		CPPUNIT_ASSERT_EQUAL( points.size(), elevation.size() );
+
+		for (size_t iv=0; iv<points.size(); iv++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullStage[points[iv]], stage[iv], REGION_TOLERANCE );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullElevation[points[iv]], elevation[iv], REGION_TOLERANCE );
+		}
+
+		// and the geometry built from them, scaled to the region rather than the domain
+		CPPUNIT_ASSERT( _part->loadStageVertexArray(t) );
+		CPPUNIT_ASSERT_EQUAL( points.size(), (size_t) _part->getStageVertexArray()->size() );
+	}
+}
+
+
+void RegionTest::testTimeSeries()
+{
+	const std::vector<unsigned int> & points = _part->getRegionPoints();
+	const size_t iv = points.size() / 2;
+	const osg::Vec2d v = _part->getGeoreferencedVertex(iv);
+
+	osg::ref_ptr<osg::FloatArray> full = new osg::FloatArray;
+	osg::ref_ptr<osg::FloatArray> part = new osg::FloatArray;
+	CPPUNIT_ASSERT( _full->getTimeSeries(v.x(), v.y(), SWWReader::TSTYPE_STAGE, full) );
+	CPPUNIT_ASSERT( _part->getTimeSeries(v.x(), v.y(), SWWReader::TSTYPE_STAGE, part) );
+	CPPUNIT_ASSERT_EQUAL( full->size(), part->size() );
+	for (size_t t=0; t<full->size(); t++)
+	{
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( (*full)[t], (*part)[t], REGION_TOLERANCE );
+	}
+}
+
+
+void RegionTest::testOutside()
+{
+	// nowhere near the domain
+	SWWReader::LoadOptions options;
+	options.region.setBox(-10.0f, -10.0f, -9.0f, -9.0f);
+	SWWReader * reader = new SWWReader(REGION_FILE, true, NULL, true, options);
+	CPPUNIT_ASSERT( !reader->isValid() );
+}
+
+
+void RegionTest::testGeoreferenced()
+{
+	// the left half again, given as on the command line in absolute coordinates
+	SWWReader::LoadOptions options;
+	CPPUNIT_ASSERT( Region::parse("308499,6188999,308501,6189003", options.region) );
+	SWWReader * reader = new SWWReader(REGION_OFFSET_FILE, true, NULL, true, options);
+	CPPUNIT_ASSERT( reader->isValid() );
+
+	const std::vector<unsigned int> & points = reader->getRegionPoints();
+	CPPUNIT_ASSERT_EQUAL( _part->getRegionPoints().size(), points.size() );
+	for (size_t iv=0; iv<points.size(); iv++)
+	{
+		CPPUNIT_ASSERT_EQUAL( _part->getRegionPoints()[iv], points[iv] );
+
+		// placed to the millimetre, which a float northing isn't
+		const osg::Vec2d v = reader->getGeoreferencedVertex(iv);
+		const osg::Vec2d local = _part->getGeoreferencedVertex(iv);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 308500.0 + local.x(), v.x(), REGION_TOLERANCE );
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( 6189000.0 + local.y(), v.y(), REGION_TOLERANCE );
+	}
+
+	// and the domain's own coordinates are nowhere near it
+	SWWReader::LoadOptions local;
+	local.region = _region;
+	SWWReader * outside = new SWWReader(REGION_OFFSET_FILE, true, NULL, true, local);
+	CPPUNIT_ASSERT( !outside->isValid() );
+}
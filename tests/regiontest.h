@@ -0,0 +1,41 @@
+#ifndef REGIONTEST_H_
+#define REGIONTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+#include <region.h>
+
+
+class RegionTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( RegionTest );
+	CPPUNIT_TEST( testParse );
+	CPPUNIT_TEST( testContains );
+	CPPUNIT_TEST( testMesh );
+	CPPUNIT_TEST( testFrames );
+	CPPUNIT_TEST( testTimeSeries );
+	CPPUNIT_TEST( testOutside );
+	CPPUNIT_TEST( testGeoreferenced );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testParse();
+	void testContains();
+	void testMesh();
+	void testFrames();
+	void testTimeSeries();
+	void testOutside();
+	void testGeoreferenced();
+
+private:
+	SWWReader* _full;
+	SWWReader* _part;
+	Region _region;	/**< Left half of the domain */
+};
+
+#endif // REGIONTEST_H_
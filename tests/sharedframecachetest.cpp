@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <sharedframecache.h>
+#include <swwreader.h>
+
+#include "sharedframecachetest.h"
+
+#define SHARED_SWW "../tests/tests.sww"
+#define SHARED_COPY "sharedframecachetest.sww"
+#define SHARED_POINTS 20
+#define SHARED_BYTES (1024*1024)
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( SharedFrameCacheTest );
+
+
+static bool copyFile(const char * aFrom, const char * aTo)
+{
+	FILE * in = fopen(aFrom, "rb");
+	FILE * out = fopen(aTo, "wb");
+	bool ok = in && out;
+	char buffer[4096];
+	size_t count;
+	while (ok && (count = fread(buffer, 1, sizeof(buffer), in)) > 0)
+	{
+		ok = (fwrite(buffer, 1, count, out) == count);
+	}
+	if (in)
+	{
+		fclose(in);
+	}
+	if (out && (fclose(out) != 0))
+	{
+		ok = false;
+	}
+	return ok;
+}
+
+
+/**
+ * A frame of one array whose values say which timestep it is.
+ */
+static std::vector<float> makeFrame(unsigned int aTimestep)
+{
+	std::vector<float> frame(SHARED_POINTS);
+	for (size_t iv=0; iv<frame.size(); iv++)
+	{
+		frame[iv] = aTimestep + 0.01f * iv;
+	}
+	return frame;
+}
+
+
+void SharedFrameCacheTest::setUp()
+{
+	CPPUNIT_ASSERT( copyFile(SHARED_SWW, SHARED_COPY) );
+}
+
+
+void SharedFrameCacheTest::tearDown()
+{
+	remove(SHARED_COPY);
+}
+
+
+void SharedFrameCacheTest::testShared()
+{
+	osg::ref_ptr<SharedFrameCache> first = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( first.valid() );
+	CPPUNIT_ASSERT( first->isWritable() );
+
+	// as a second viewer opening the same file would
+	osg::ref_ptr<SharedFrameCache> second = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( second.valid() );
+	CPPUNIT_ASSERT_EQUAL( first->getName(), second->getName() );
+
+	std::vector<float> read(SHARED_POINTS);
+	float * out[1] = { &read[0] };
+	CPPUNIT_ASSERT( !second->find(1, out) );
+
+	std::vector<float> frame = makeFrame(1);
+	const float * in[1] = { &frame[0] };
+	first->insert(1, in);
+	CPPUNIT_ASSERT( second->find(1, out) );
+	CPPUNIT_ASSERT( read == frame );
+
+	// a different frame layout is a different segment
+	osg::ref_ptr<SharedFrameCache> momentum = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 3, SHARED_BYTES);
+	CPPUNIT_ASSERT( momentum.valid() );
+	CPPUNIT_ASSERT( momentum->getName() != first->getName() );
+}
+
+
+void SharedFrameCacheTest::testSlots()
+{
+	// room for two frames, timesteps sharing a slot replace each other
+	const size_t slotBytes = 64 + 128;
+	osg::ref_ptr<SharedFrameCache> cache = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, 2 * slotBytes);
+	CPPUNIT_ASSERT( cache.valid() );
+	CPPUNIT_ASSERT_EQUAL( 2u, cache->getNumSlots() );
+
+	std::vector<float> read(SHARED_POINTS);
+	float * out[1] = { &read[0] };
+	for (unsigned int t=0; t<3; t++)
+	{
+		std::vector<float> frame = makeFrame(t);
+		const float * in[1] = { &frame[0] };
+		cache->insert(t, in);
+	}
+
+	CPPUNIT_ASSERT( !cache->find(0, out) );
+	CPPUNIT_ASSERT( cache->find(1, out) );
+	CPPUNIT_ASSERT( read == makeFrame(1) );
+	CPPUNIT_ASSERT( cache->find(2, out) );
+	CPPUNIT_ASSERT( read == makeFrame(2) );
+}
+
+
+void SharedFrameCacheTest::testLastRemoves()
+{
+	std::vector<float> frame = makeFrame(0);
+	const float * in[1] = { &frame[0] };
+	std::vector<float> read(SHARED_POINTS);
+	float * out[1] = { &read[0] };
+
+	osg::ref_ptr<SharedFrameCache> first = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	osg::ref_ptr<SharedFrameCache> second = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( first.valid() && second.valid() );
+	first->insert(0, in);
+
+	// still open in the second
+	first = NULL;
+	first = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( first->find(0, out) );
+
+	// gone with the last, the next starts afresh
+	first = NULL;
+	second = NULL;
+	first = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( first.valid() );
+	CPPUNIT_ASSERT( !first->find(0, out) );
+}
+
+
+void SharedFrameCacheTest::testChangedFile()
+{
+	osg::ref_ptr<SharedFrameCache> before = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( before.valid() );
+
+	// grown, as by a running simulation
+	FILE * file = fopen(SHARED_COPY, "ab");
+	CPPUNIT_ASSERT( file );
+	fputc(0, file);
+	fclose(file);
+
+	osg::ref_ptr<SharedFrameCache> after = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 1, SHARED_BYTES);
+	CPPUNIT_ASSERT( after.valid() );
+	CPPUNIT_ASSERT( after->getName() != before->getName() );
+
+	// the first is still in use here, but no longer matches its file; opening the second
+	// removed it, and it stays mapped
+	CPPUNIT_ASSERT_EQUAL( 0u, SharedFrameCache::removeStale() );
+	std::vector<float> frame = makeFrame(0);
+	const float * in[1] = { &frame[0] };
+	before->insert(0, in);
+	float * out[1] = { &frame[0] };
+	CPPUNIT_ASSERT( before->find(0, out) );
+}
+
+
+void SharedFrameCacheTest::testReaders()
+{
+	SWWReader::LoadOptions options;
+	options.sharedCacheBytes = SHARED_BYTES;
+
+	SWWReader * first = new SWWReader(SHARED_COPY, true, NULL, true, options);
+	SWWReader * second = new SWWReader(SHARED_COPY, true, NULL, true, options);
+	CPPUNIT_ASSERT( first->isValid() && second->isValid() );
+	CPPUNIT_ASSERT( first->getSharedCache() );
+	CPPUNIT_ASSERT_EQUAL( first->getSharedCache()->getName(), second->getSharedCache()->getName() );
+
+	// read by the first, then there for the second without decoding
+	CPPUNIT_ASSERT( first->loadStageVertexArray(2) );
+	std::vector<float> stage(first->getNumberOfVertices());
+	float * out[1] = { &stage[0] };
+	CPPUNIT_ASSERT( second->getSharedCache()->find(2, out) );
+
+	std::vector<float> elevation;
+	std::vector<float> expected;
+	CPPUNIT_ASSERT( first->readFrame(2, expected, elevation) );
+	CPPUNIT_ASSERT( stage == expected );
+
+	CPPUNIT_ASSERT( second->loadStageVertexArray(2) );
+}
+
+
+void SharedFrameCacheTest::testPermissions()
+{
+	// a file only its owner can read, shared with no one else; a layout no other test
+	// uses, so the segment is a new one
+	CPPUNIT_ASSERT( chmod(SHARED_COPY, 0600) == 0 );
+	osg::ref_ptr<SharedFrameCache> cache = SharedFrameCache::open(SHARED_COPY, SHARED_POINTS, 2, SHARED_BYTES);
+	CPPUNIT_ASSERT( cache.valid() );
+
+	int fd = shm_open(cache->getName().c_str(), O_RDONLY, 0);
+	CPPUNIT_ASSERT( fd >= 0 );
+	struct stat buf;
+	CPPUNIT_ASSERT( fstat(fd, &buf) == 0 );
+	close(fd);
+	CPPUNIT_ASSERT_EQUAL( (mode_t) 0600, buf.st_mode & 0777 );
+	CPPUNIT_ASSERT_EQUAL( geteuid(), buf.st_uid );
+}
@@ -0,0 +1,32 @@
+#ifndef SHAREDFRAMECACHETEST_H_
+#define SHAREDFRAMECACHETEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+
+
+class SharedFrameCacheTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( SharedFrameCacheTest );
+	CPPUNIT_TEST( testShared );
+	CPPUNIT_TEST( testSlots );
+	CPPUNIT_TEST( testLastRemoves );
+	CPPUNIT_TEST( testChangedFile );
+	CPPUNIT_TEST( testReaders );
+	CPPUNIT_TEST( testPermissions );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testShared();
+	void testSlots();
+	void testLastRemoves();
+	void testChangedFile();
+	void testReaders();
+	void testPermissions();
+};
+
+#endif // SHAREDFRAMECACHETEST_H_
@@ -2,6 +2,17 @@
 #include <cppunit/CompilerOutputter.h>
 #include <cppunit/extensions/TestFactoryRegistry.h>
 #include <cppunit/ui/text/TestRunner.h>
+#include <fstream>
+#include <iterator>
+
+#ifdef WIN32
+#include <windows.h>
+#define OS_SLEEP_MS(x) Sleep(x);
+#else
+#include <unistd.h>
+#define OS_SLEEP_MS(x) usleep(x*1000);
+#endif
+
 #include "swwreadertest.h"
 
 
@@ -155,8 +166,302 @@ void SWWReaderTest::testBedslopeNormalArray()
 
 
 
+void SWWReaderTest::testLocate()
+{
+    CPPUNIT_ASSERT( _sww->isValid() );
+
+    // triangle 0 is (0.5,0) (0.5,0.667) (0,0), triangle 1 is (0,0.667) (0,0) (0.5,0.667)
+    osg::Vec3 weights;
+    CPPUNIT_ASSERT_EQUAL( _sww->locate(0.4, 0.1, &weights), 0 );
+    CPPUNIT_ASSERT_EQUAL( _sww->locate(0.1, 0.5), 1 );
+    CPPUNIT_ASSERT_EQUAL( _sww->locate(1.9, 1.9), 23 );
+
+    // weights interpolate the vertex positions back to the point
+    CPPUNIT_ASSERT_VEC3_EQUAL( osg::Vec3(0.4, 0.1, 0), osg::Vec3(0.5, 0, 0)*weights[0] + osg::Vec3(0.5, 0.666667, 0)*weights[1] + osg::Vec3(0, 0, 0)*weights[2] );
+
+    // shared vertex lies in one of its triangles
+    CPPUNIT_ASSERT( _sww->locate(0.5, 0.666667) >= 0 );
+
+    // outside the mesh
+    CPPUNIT_ASSERT_EQUAL( _sww->locate(-0.1, 0.5), -1 );
+    CPPUNIT_ASSERT_EQUAL( _sww->locate(3.0, 3.0), -1 );
+}
+
+
+
+void SWWReaderTest::testPick()
+{
+    CPPUNIT_ASSERT( _sww->isValid() );
+
+    osg::ref_ptr<osg::Vec3Array> centroids = _sww->getBedslopeCentroidArray();
+    CPPUNIT_ASSERT( centroids );
+
+    // vertical segment through each centroid hits that bedslope triangle
+    for (unsigned int i=0; i<centroids->size(); i++)
+    {
+        osg::Vec3 c = centroids->at(i);
+        osg::Vec3 hit;
+        CPPUNIT_ASSERT_EQUAL( _sww->pick(c + osg::Vec3(0, 0, 10), c - osg::Vec3(0, 0, 10), &hit), (int)i );
+        CPPUNIT_ASSERT_VEC3_EQUAL( c, hit );
+    }
+
+    // oblique segment from above the mesh hits the first triangle on its way down
+    osg::Vec3 c = centroids->at(7);
+    CPPUNIT_ASSERT_EQUAL( _sww->pick(c + osg::Vec3(0.5, 0.5, 10), c - osg::Vec3(0.5, 0.5, 10)), 7 );
+
+    // segment beside the mesh misses
+    CPPUNIT_ASSERT_EQUAL( _sww->pick(osg::Vec3(2, 2, 10), osg::Vec3(2, 2, -10)), -1 );
+}
+
+
+
+
+void SWWReaderTest::testTimeSeriesAtPoint()
+{
+    CPPUNIT_ASSERT( _sww->isValid() );
+
+    // hard-coded stage values from sww file, at vertices 0 (0,0), 4 (0.5,0) and 5 (0.5,0.667)
+    const float stage0[3] = { 0.05, 0.0149026, 0.000150291 };
+    const float stage4[3] = { -0.116667, -0.135031, -0.152063 };
+    const float stage5[3] = { 0.1021, 0.0664175, 0.0555556 };
+
+    // at a vertex the series is that vertex's
+    osg::ref_ptr<osg::FloatArray> series = new osg::FloatArray;
+    CPPUNIT_ASSERT( _sww->getTimeSeries(0.5, 0.666667, SWWReader::TSTYPE_STAGE, series) );
+    CPPUNIT_ASSERT_EQUAL( series->size(), (size_t)3 );
+    for (unsigned int t=0; t<3; t++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( stage5[t], series->at(t), TOLERANCE );
+
+    // halfway along an edge it's the mean of the two ends
+    CPPUNIT_ASSERT( _sww->getTimeSeries(0.25, 0.0, SWWReader::TSTYPE_STAGE, series) );
+    for (unsigned int t=0; t<3; t++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5*(stage0[t] + stage4[t]), series->at(t), TOLERANCE );
+
+    // many points at once match one at a time, points off the mesh get empty series
+    std::vector<osg::Vec2d> points;
+    points.push_back( osg::Vec2d(0.4, 0.1) );
+    points.push_back( osg::Vec2d(5.0, 5.0) );
+    points.push_back( osg::Vec2d(1.7, 1.2) );
+    std::vector< osg::ref_ptr<osg::FloatArray> > batch;
+    CPPUNIT_ASSERT( _sww->getTimeSeries(points, SWWReader::TSTYPE_STAGE, batch) );
+    CPPUNIT_ASSERT_EQUAL( batch.size(), (size_t)3 );
+    CPPUNIT_ASSERT( batch[1]->empty() );
+
+    for (unsigned int i=0; i<3; i+=2)
+    {
+        CPPUNIT_ASSERT( _sww->getTimeSeries(points[i].x(), points[i].y(), SWWReader::TSTYPE_STAGE, series) );
+        CPPUNIT_ASSERT_EQUAL( batch[i]->size(), (size_t)3 );
+        for (unsigned int t=0; t<3; t++)
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( series->at(t), batch[i]->at(t), TOLERANCE );
+    }
+
+    CPPUNIT_ASSERT( !_sww->getTimeSeries(5.0, 5.0, SWWReader::TSTYPE_STAGE, series) );
+}
+
+
+void SWWReaderTest::testGeoreferencedTimeSeries()
+{
+    // the same run with a georeference offset of 308500, 6189000, asked at real-world coordinates
+    SWWReader * offset = new SWWReader("../tests/offset.sww");
+    CPPUNIT_ASSERT( offset->isValid() );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 308500.5, offset->getGeoreferencedVertex(5).x(), TOLERANCE );
+    CPPUNIT_ASSERT_DOUBLES_EQUAL( 6189000.666667, offset->getGeoreferencedVertex(5).y(), TOLERANCE );
+
+    CPPUNIT_ASSERT_EQUAL( offset->locate(308500.4, 6189000.1), 0 );
+    CPPUNIT_ASSERT_EQUAL( offset->locate(0.4, 0.1), -1 );
+
+    osg::ref_ptr<osg::FloatArray> series = new osg::FloatArray;
+    osg::ref_ptr<osg::FloatArray> local = new osg::FloatArray;
+    CPPUNIT_ASSERT( offset->getTimeSeries(308500.5, 6189000.666667, SWWReader::TSTYPE_STAGE, series) );
+    CPPUNIT_ASSERT( _sww->getTimeSeries(0.5, 0.666667, SWWReader::TSTYPE_STAGE, local) );
+    CPPUNIT_ASSERT_EQUAL( local->size(), series->size() );
+    for (unsigned int t=0; t<series->size(); t++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( local->at(t), series->at(t), TOLERANCE );
+
+    // a gauge file's points, a quarter metre apart, still land in the right triangles
+    std::vector<osg::Vec2d> points;
+    points.push_back( osg::Vec2d(308500.25, 6189000.0) );
+    points.push_back( osg::Vec2d(308500.5, 6189000.0) );
+    std::vector< osg::ref_ptr<osg::FloatArray> > batch;
+    CPPUNIT_ASSERT( offset->getTimeSeries(points, SWWReader::TSTYPE_STAGE, batch) );
+    CPPUNIT_ASSERT( _sww->getTimeSeries(0.25, 0.0, SWWReader::TSTYPE_STAGE, local) );
+    for (unsigned int t=0; t<local->size(); t++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( local->at(t), batch[0]->at(t), TOLERANCE );
+    CPPUNIT_ASSERT( _sww->getTimeSeries(0.5, 0.0, SWWReader::TSTYPE_STAGE, local) );
+    for (unsigned int t=0; t<local->size(); t++)
+        CPPUNIT_ASSERT_DOUBLES_EQUAL( local->at(t), batch[1]->at(t), TOLERANCE );
+
+    // the file's own coordinates are off the mesh
+    CPPUNIT_ASSERT( !offset->getTimeSeries(0.5, 0.666667, SWWReader::TSTYPE_STAGE, series) );
+}
+
+
+// records each progress report, giving up after a set number of them
+class CountingProgress : public SWWReader::SeriesProgress
+{
+public:
+    CountingProgress(unsigned int aLimit) : _limit(aLimit) {}
+
+    virtual bool progress(const std::vector< osg::ref_ptr<osg::FloatArray> > & aData, size_t aNumRead)
+    {
+        _reads.push_back(aNumRead);
+        return _reads.size() < _limit;
+    }
+
+    unsigned int _limit;
+    std::vector<size_t> _reads;
+};
+
+
+void SWWReaderTest::testTimeSeriesProgress()
+{
+    CPPUNIT_ASSERT( _sww->isValid() );
+
+    std::vector<osg::Vec2d> points;
+    points.push_back( osg::Vec2d(0.4, 0.1) );
+    points.push_back( osg::Vec2d(1.7, 1.2) );
+
+    std::vector< osg::ref_ptr<osg::FloatArray> > plain;
+    CPPUNIT_ASSERT( _sww->getTimeSeries(points, SWWReader::TSTYPE_STAGE, plain) );
+
+    // a read being watched gives the same series, reporting when it's done
+    CountingProgress progress(10);
+    std::vector< osg::ref_ptr<osg::FloatArray> > watched;
+    CPPUNIT_ASSERT( _sww->getTimeSeries(points, SWWReader::TSTYPE_STAGE, watched, &progress) );
+    CPPUNIT_ASSERT( !progress._reads.empty() );
+    CPPUNIT_ASSERT_EQUAL( progress._reads.back(), (size_t)3 );
+    for (unsigned int i=0; i<points.size(); i++)
+        for (unsigned int t=0; t<3; t++)
+            CPPUNIT_ASSERT_DOUBLES_EQUAL( plain[i]->at(t), watched[i]->at(t), TOLERANCE );
+
+    // cancelling from the progress report fails the read
+    CountingProgress cancel(1);
+    CPPUNIT_ASSERT( !_sww->getTimeSeries(points, SWWReader::TSTYPE_STAGE, watched, &cancel) );
+    CPPUNIT_ASSERT_EQUAL( cancel._reads.size(), (size_t)1 );
+}
+
+
+
+
+/**
+ * Copy the test file as though only some of its timesteps had been written, by
+ * changing the record count in its netcdf header, as a simulation appending to it does.
+ */
+static bool writeTimesteps(const char * aFilename, unsigned char aNumTimesteps, bool aFillNewRecord = false)
+{
+	std::ifstream in("../tests/tests.sww", std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+	if (data.size() < 8)
+	{
+		return false;
+	}
+
+	// big-endian record count follows the 4 byte magic number
+	data[4] = data[5] = data[6] = 0;
+	data[7] = aNumTimesteps;
+
+	if (aFillNewRecord)
+	{
+		// the test file's last record is followed by zero padding; a record added but
+		// not yet written holds netcdf's big-endian float fill value instead
+		size_t end = data.find_last_not_of('\0') + 1;
+		data.resize((end + 3) / 4 * 4);
+		for (size_t i=0; i<end; i+=4)
+		{
+			data += "\x7c\xf0";
+			data += std::string(2, '\0');
+		}
+	}
+
+	std::ofstream out(aFilename, std::ios::binary | std::ios::trunc);
+	out.write(data.data(), data.size());
+	return out.good();
+}
+
+
+/**
+ * Refresh until the reader has a number of timesteps.
+ * @return false if it didn't within a few seconds
+ */
+static bool refreshUntil(SWWReader * aReader, unsigned int aNumTimesteps)
+{
+	for (int i=0; i<300; i++)
+	{
+		aReader->refresh();
+		if (aReader->getNumberOfTimesteps() == aNumTimesteps)
+		{
+			return true;
+		}
+		OS_SLEEP_MS(10);
+	}
+	return false;
+}
+
+
+void SWWReaderTest::testAppendRefresh()
+{
+	const char * filename = "appendtest.sww";
+	CPPUNIT_ASSERT( writeTimesteps(filename, 2) );
+
+	SWWReader * sww = new SWWReader(filename);
+	CPPUNIT_ASSERT( sww->isValid() );
+	CPPUNIT_ASSERT_EQUAL( 2u, sww->getNumberOfTimesteps() );
+	osg::ref_ptr<osg::DrawElementsUInt> indices = sww->getBedslopeIndexArray();
+
+	// another timestep written, taken on without reloading the mesh
+	OS_SLEEP_MS(1100);	// let timestamp change
+	CPPUNIT_ASSERT( writeTimesteps(filename, 3) );
+	CPPUNIT_ASSERT( refreshUntil(sww, 3) );
+	CPPUNIT_ASSERT( sww->isValid() );
+	CPPUNIT_ASSERT_EQUAL( 1.0f, sww->getTime(2) );
+	CPPUNIT_ASSERT( sww->getBedslopeIndexArray() == indices );
+	CPPUNIT_ASSERT( sww->loadStageVertexArray(2) );
+
+	// fewer timesteps, as when a simulation is rerun, is a full reload
+	OS_SLEEP_MS(1100);
+	CPPUNIT_ASSERT( writeTimesteps(filename, 1) );
+	CPPUNIT_ASSERT( refreshUntil(sww, 1) );
+	CPPUNIT_ASSERT( sww->isValid() );
+	CPPUNIT_ASSERT( sww->getBedslopeIndexArray() != indices );
+}
+
+
+void SWWReaderTest::testPartialTimestep()
+{
+	const char * filename = "appendtest.sww";
+	CPPUNIT_ASSERT( writeTimesteps(filename, 4, true) );
+
+	// the newest record is still fill, so not yet a timestep
+	SWWReader * sww = new SWWReader(filename);
+	CPPUNIT_ASSERT( sww->isValid() );
+	CPPUNIT_ASSERT_EQUAL( 3u, sww->getNumberOfTimesteps() );
+	CPPUNIT_ASSERT_EQUAL( 1.0f, sww->getTime(2) );
+	CPPUNIT_ASSERT( sww->getAppendAge() < 0.0f );
+}
+
+
+void SWWReaderTest::testSharedMesh()
+{
+	// a second run on the same mesh holds no copy of its own
+	SWWReader * run = new SWWReader("../tests/tests.sww", true, _sww->getMesh());
+	CPPUNIT_ASSERT( run->isValid() );
+	CPPUNIT_ASSERT( run->isMeshShared() );
+	CPPUNIT_ASSERT( run->getMesh() == _sww->getMesh() );
+	CPPUNIT_ASSERT( run->getBedslopeIndexArray() == _sww->getBedslopeIndexArray() );
+	CPPUNIT_ASSERT_EQUAL( _sww->locate(1.7, 1.2), run->locate(1.7, 1.2) );
+	CPPUNIT_ASSERT( run->loadStageVertexArray(1) );
+
+	// a different mesh is loaded as its own
+	SWWReader * other = new SWWReader("../tests/tests_P0_2.sww", true, _sww->getMesh());
+	CPPUNIT_ASSERT( other->isValid() );
+	CPPUNIT_ASSERT( !other->isMeshShared() );
+	CPPUNIT_ASSERT( other->getMesh() != _sww->getMesh() );
+}
+
+
 void SWWReaderTest::tearDown()
 {
+	remove("appendtest.sww");
 }
 
 
@@ -44,6 +44,14 @@ class SWWReaderTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testBedslopeIndexArray );
   CPPUNIT_TEST( testBedslopeNormalArray );
   CPPUNIT_TEST( testConnectivity );
+  CPPUNIT_TEST( testLocate );
+  CPPUNIT_TEST( testPick );
+  CPPUNIT_TEST( testTimeSeriesAtPoint );
+  CPPUNIT_TEST( testGeoreferencedTimeSeries );
+  CPPUNIT_TEST( testTimeSeriesProgress );
+  CPPUNIT_TEST( testAppendRefresh );
+  CPPUNIT_TEST( testPartialTimestep );
+  CPPUNIT_TEST( testSharedMesh );
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -57,6 +65,14 @@ public:
   void testBedslopeIndexArray();
   void testBedslopeNormalArray();
   void testConnectivity();
+  void testLocate();
+  void testPick();
+  void testTimeSeriesAtPoint();
+  void testGeoreferencedTimeSeries();
+  void testTimeSeriesProgress();
+  void testAppendRefresh();
+  void testPartialTimestep();
+  void testSharedMesh();
 
 
 private:
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include "tilesettest.h"
+
+// allowable difference between two floats to be considered equal
+#define TILESET_TOLERANCE 0.0001
+
+#define TILESET_FILE "../tests/tests.sww"
+
+// the same run with a georeference offset of 308500, 6189000
+#define TILESET_OFFSET_FILE "../tests/offset.sww"
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( TileSetTest );
+
+
+typedef std::pair<unsigned int, std::pair<unsigned int, unsigned int> > TriangleKey;
+
+/**
+ * A triangle by its three file points, whichever way round.
+ */
+static TriangleKey makeKey(unsigned int aA, unsigned int aB, unsigned int aC)
+{
+	unsigned int k[3] = { aA, aB, aC };
+	std::sort(k, k + 3);
+	return std::make_pair(k[0], std::make_pair(k[1], k[2]));
+}
+
+
+void TileSetTest::setUp()
+{
+	remove(TILESET_FILE ".tiles");
+	_full = new SWWReader(TILESET_FILE);
+	_tiles = TileSet::open(TILESET_FILE, 2, 3);
+}
+
+
+void TileSetTest::tearDown()
+{
+	// readers are never deleted, see SWWReader
+	_tiles = NULL;
+	remove(TILESET_FILE ".tiles");
+	remove(TILESET_OFFSET_FILE ".tiles");
+}
+
+
+void TileSetTest::testTiles()
+{
+	CPPUNIT_ASSERT( _tiles.valid() );
+	CPPUNIT_ASSERT( !_tiles->isFromCache() );
+	CPPUNIT_ASSERT( _tiles->getNumTiles() >= 2 );
+
+	const TileSet::TileInfo & mesh = _tiles->getMeshInfo();
+	CPPUNIT_ASSERT_EQUAL( _full->getNumberOfVertices(), (size_t) mesh._numPoints );
+	CPPUNIT_ASSERT_EQUAL( _full->getNumberOfTriangles(), (size_t) mesh._numTriangles );
+
+	// every triangle of the file in exactly one tile
+	std::map<TriangleKey, int> triangles;
+	const unsigned int * full = _full->getTriangles();
+	for (size_t it=0; it<_full->getNumberOfTriangles(); it++)
+	{
+		triangles[makeKey(full[3*it], full[3*it+1], full[3*it+2])] = 0;
+	}
+
+	for (unsigned int i=0; i<_tiles->getNumTiles(); i++)
+	{
+		TileSet::Tile tile;
+		CPPUNIT_ASSERT( _tiles->readTile(i, tile) );
+		CPPUNIT_ASSERT_EQUAL( (size_t) _tiles->getTileInfo(i)._numPoints, tile._points.size() );
+		CPPUNIT_ASSERT_EQUAL( (size_t) _tiles->getTileInfo(i)._numTriangles * 3, tile._triangles.size() );
+		CPPUNIT_ASSERT( tile._triangleTiles.empty() );
+
+		for (size_t iv=0; iv<tile._points.size(); iv++)
+		{
+			CPPUNIT_ASSERT( (iv == 0) || (tile._points[iv] > tile._points[iv-1]) );
+			CPPUNIT_ASSERT( tile._points[iv] < mesh._numPoints );
+		}
+
+		for (size_t it=0; it<tile._triangles.size(); it+=3)
+		{
+			CPPUNIT_ASSERT( tile._triangles[it] < tile._points.size() );
+			CPPUNIT_ASSERT( tile._triangles[it+1] < tile._points.size() );
+			CPPUNIT_ASSERT( tile._triangles[it+2] < tile._points.size() );
+			std::map<TriangleKey, int>::iterator found = triangles.find(makeKey(tile._points[tile._triangles[it]],
+																			   tile._points[tile._triangles[it+1]],
+																			   tile._points[tile._triangles[it+2]]));
+			CPPUNIT_ASSERT( found != triangles.end() );
+			found->second++;
+		}
+	}
+
+	for (std::map<TriangleKey, int>::const_iterator i=triangles.begin(); i!=triangles.end(); ++i)
+	{
+		CPPUNIT_ASSERT_EQUAL( 1, i->second );
+	}
+
+	// out of range
+	TileSet::Tile tile;
+	CPPUNIT_ASSERT( !_tiles->readTile(_tiles->getOverview() + 1, tile) );
+}
+
+
+void TileSetTest::testOverview()
+{
+	TileSet::Tile overview;
+	CPPUNIT_ASSERT( _tiles->readTile(_tiles->getOverview(), overview) );
+
+	// coarser than the mesh, but not empty
+	const size_t ntriangles = overview._triangles.size() / 3;
+	CPPUNIT_ASSERT( ntriangles > 0 );
+	CPPUNIT_ASSERT( ntriangles < _full->getNumberOfTriangles() );
+	CPPUNIT_ASSERT( overview._points.size() < _full->getNumberOfVertices() );
+	CPPUNIT_ASSERT_EQUAL( ntriangles, overview._triangleTiles.size() );
+
+	for (size_t it=0; it<ntriangles; it++)
+	{
+		CPPUNIT_ASSERT( overview._triangleTiles[it] < _tiles->getNumTiles() );
+		const unsigned int * corners = &overview._triangles[3*it];
+		CPPUNIT_ASSERT( (corners[0] != corners[1]) && (corners[1] != corners[2]) && (corners[2] != corners[0]) );
+	}
+}
+
+
+void TileSetTest::testReaders()
+{
+	CPPUNIT_ASSERT( _full->loadStageVertexArray(1) );
+	osg::ref_ptr<osg::Vec3Array> fullStage = _full->getStageVertexArray();
+	osg::ref_ptr<osg::Vec3Array> fullBedslope = _full->getBedslopeVertexArray();
+
+	size_t triangles = 0;
+	for (unsigned int i=0; i<_tiles->getNumTiles(); i++)
+	{
+		if (_tiles->getTileInfo(i)._numTriangles == 0)
+		{
+			continue;
+		}
+
+		TileSWWReader * tile = new TileSWWReader(_tiles.get(), i, false);
+		CPPUNIT_ASSERT( tile->isValid() );
+		CPPUNIT_ASSERT_EQUAL( _full->getNumberOfTimesteps(), tile->getNumberOfTimesteps() );
+		triangles += tile->getNumberOfTriangles();
+
+		const std::vector<unsigned int> & points = tile->getRegionPoints();
+		CPPUNIT_ASSERT_EQUAL( tile->getNumberOfVertices(), points.size() );
+
+		// scaled as the whole mesh is, so a tile sits where the full mesh has it
+		CPPUNIT_ASSERT( tile->loadStageVertexArray(1) );
+		osg::ref_ptr<osg::Vec3Array> stage = tile->getStageVertexArray();
+		osg::ref_ptr<osg::Vec3Array> bedslope = tile->getBedslopeVertexArray();
+		for (size_t iv=0; iv<points.size(); iv++)
+		{
+			CPPUNIT_ASSERT( tile->getGeoreferencedVertex(iv) == _full->getGeoreferencedVertex(points[iv]) );
+			for (int k=0; k<3; k++)
+			{
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( (*fullStage)[points[iv]][k], (*stage)[iv][k], TILESET_TOLERANCE );
+				CPPUNIT_ASSERT_DOUBLES_EQUAL( (*fullBedslope)[points[iv]][k], (*bedslope)[iv][k], TILESET_TOLERANCE );
+			}
+		}
+
+		// frames read at the tile's points alone
+		std::vector<float> fullStageFrame, fullElevation, stageFrame, elevation;
+		CPPUNIT_ASSERT( _full->readFrame(2, fullStageFrame, fullElevation) );
+		CPPUNIT_ASSERT( tile->readFrame(2, stageFrame, elevation) );
+		CPPUNIT_ASSERT_EQUAL( points.size(), stageFrame.size() );
+		for (size_t iv=0; iv<points.size(); iv++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullStageFrame[points[iv]], stageFrame[iv], TILESET_TOLERANCE );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullElevation[points[iv]], elevation[iv], TILESET_TOLERANCE );
+		}
+
+		// unlike other readers, tiles are dropped again
+		delete tile;
+	}
+	CPPUNIT_ASSERT_EQUAL( _full->getNumberOfTriangles(), triangles );
+}
+
+
+void TileSetTest::testHideTiles()
+{
+	TileSWWReader * overview = new TileSWWReader(_tiles.get(), _tiles->getOverview(), false);
+	CPPUNIT_ASSERT( overview->isValid() );
+	const size_t nindices = 3 * overview->getNumberOfTriangles();
+	CPPUNIT_ASSERT_EQUAL( nindices, (size_t) overview->getBedslopeIndexArray()->size() );
+
+	std::vector<bool> hidden(_tiles->getNumTiles(), false);
+	CPPUNIT_ASSERT_EQUAL( nindices, (size_t) overview->hideTiles(hidden)->size() );
+
+	hidden.assign(_tiles->getNumTiles(), true);
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, (size_t) overview->hideTiles(hidden)->size() );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, (size_t) overview->getBedslopeIndexArray()->size() );
+
+	// some of each
+	hidden[0] = false;
+	const size_t some = overview->hideTiles(hidden)->size();
+	CPPUNIT_ASSERT( some < nindices );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, some % 3 );
+
+	delete overview;
+}
+
+
+void TileSetTest::testCache()
+{
+	// read back as cut
+	osg::ref_ptr<TileSet> cached = TileSet::open(TILESET_FILE, 2, 3);
+	CPPUNIT_ASSERT( cached.valid() );
+	CPPUNIT_ASSERT( cached->isFromCache() );
+	CPPUNIT_ASSERT_EQUAL( _tiles->getNumTiles(), cached->getNumTiles() );
+	for (unsigned int i=0; i<=_tiles->getNumTiles(); i++)
+	{
+		CPPUNIT_ASSERT( memcmp(&_tiles->getTileInfo(i), &cached->getTileInfo(i), sizeof(TileSet::TileInfo)) == 0 );
+
+		TileSet::Tile a, b;
+		CPPUNIT_ASSERT( _tiles->readTile(i, a) );
+		CPPUNIT_ASSERT( cached->readTile(i, b) );
+		CPPUNIT_ASSERT( a._points == b._points );
+		CPPUNIT_ASSERT( a._triangles == b._triangles );
+	}
+
+	// other parameters cut again
+	osg::ref_ptr<TileSet> other = TileSet::open(TILESET_FILE, 1, 3);
+	CPPUNIT_ASSERT( other.valid() );
+	CPPUNIT_ASSERT( !other->isFromCache() );
+	CPPUNIT_ASSERT_EQUAL( 1u, other->getNumTiles() );
+	CPPUNIT_ASSERT_EQUAL( (unsigned int) _full->getNumberOfTriangles(), other->getTileInfo(0)._numTriangles );
+}
+
+
+void TileSetTest::testGeoreferenced()
+{
+	SWWReader * full = new SWWReader(TILESET_OFFSET_FILE);
+	osg::ref_ptr<TileSet> tiles = TileSet::open(TILESET_OFFSET_FILE, 2, 3);
+	CPPUNIT_ASSERT( tiles.valid() );
+
+	// tiles carry the file's offset, as the whole mesh does
+	for (unsigned int i=0; i<tiles->getNumTiles(); i++)
+	{
+		if (tiles->getTileInfo(i)._numTriangles == 0)
+		{
+			continue;
+		}
+
+		TileSWWReader * tile = new TileSWWReader(tiles.get(), i, false);
+		CPPUNIT_ASSERT( tile->isValid() );
+		const std::vector<unsigned int> & points = tile->getRegionPoints();
+		for (size_t iv=0; iv<points.size(); iv++)
+		{
+			CPPUNIT_ASSERT( tile->getGeoreferencedVertex(iv) == full->getGeoreferencedVertex(points[iv]) );
+			CPPUNIT_ASSERT( tile->getGeoreferencedVertex(iv).x() >= 308500.0 );
+		}
+		delete tile;
+	}
+}
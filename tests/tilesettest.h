@@ -0,0 +1,39 @@
+#ifndef TILESETTEST_H_
+#define TILESETTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+#include <tileset.h>
+#include <tileswwreader.h>
+
+
+class TileSetTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( TileSetTest );
+	CPPUNIT_TEST( testTiles );
+	CPPUNIT_TEST( testOverview );
+	CPPUNIT_TEST( testReaders );
+	CPPUNIT_TEST( testHideTiles );
+	CPPUNIT_TEST( testCache );
+	CPPUNIT_TEST( testGeoreferenced );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testTiles();
+	void testOverview();
+	void testReaders();
+	void testHideTiles();
+	void testCache();
+	void testGeoreferenced();
+
+private:
+	SWWReader* _full;
+	osg::ref_ptr<TileSet> _tiles;	/**< Two tiles across, cut afresh */
+};
+
+#endif // TILESETTEST_H_
@@ -0,0 +1,207 @@
+#include <math.h>
+#include <vector>
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include "timewindowtest.h"
+
+// allowable difference between two floats to be considered equal
+#define TIMEWINDOW_TOLERANCE 0.0001
+
+// three timesteps, at 0, 0.5 and 1 seconds
+#define TIMEWINDOW_FILE "../tests/tests.sww"
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( TimeWindowTest );
+
+
+/**
+ * Gathers the timesteps and times a pass visits.
+ */
+class TimesVisitor : public SWWReader::FrameVisitor
+{
+public:
+	virtual bool visit(const SWWReader::FrameData & aFrame)
+	{
+		_timesteps.push_back(aFrame._timestep);
+		_times.push_back(aFrame._time);
+		_stage.push_back(aFrame._stage[5]);
+		return true;
+	}
+
+	std::vector<unsigned int> _timesteps;
+	std::vector<float> _times;
+	std::vector<float> _stage;	/**< Of vertex 5 */
+};
+
+
+/**
+ * Open the test file through a window.
+ */
+static SWWReader * openWindow(const TimeWindow & aWindow)
+{
+	SWWReader::LoadOptions options;
+	options.timeWindow = aWindow;
+	return new SWWReader(TIMEWINDOW_FILE, true, NULL, true, options);
+}
+
+
+void TimeWindowTest::setUp()
+{
+	_full = new SWWReader(TIMEWINDOW_FILE);
+}
+
+
+void TimeWindowTest::tearDown()
+{
+	// readers are never deleted, see SWWReader
+}
+
+
+void TimeWindowTest::testParse()
+{
+	TimeWindow window;
+	CPPUNIT_ASSERT( window.isEmpty() );
+	CPPUNIT_ASSERT( window.setStart("2") );
+	CPPUNIT_ASSERT( window.setEnd("3600.5s") );
+	CPPUNIT_ASSERT( window.setStride(10) );
+	CPPUNIT_ASSERT( !window.isEmpty() );
+	CPPUNIT_ASSERT_EQUAL( 10u, window.getStride() );
+
+	// steps are whole, times have their unit, neither is negative
+	CPPUNIT_ASSERT( !window.setStart("") );
+	CPPUNIT_ASSERT( !window.setStart("2.5") );
+	CPPUNIT_ASSERT( !window.setStart("-1") );
+	CPPUNIT_ASSERT( !window.setStart("10m") );
+	CPPUNIT_ASSERT( !window.setEnd("3600ss") );
+	CPPUNIT_ASSERT( !window.setStride(0) );
+	CPPUNIT_ASSERT_EQUAL( 10u, window.getStride() );
+}
+
+
+void TimeWindowTest::testSelect()
+{
+	const float times[6] = { 0.0f, 10.0f, 20.0f, 30.0f, 40.0f, 50.0f };
+
+	TimeWindow window;
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, window.getFirst(times, 6) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 6, window.getCount(times, 6, 0) );
+
+	CPPUNIT_ASSERT( window.setStart("2") );
+	CPPUNIT_ASSERT( window.setEnd("4") );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, window.getFirst(times, 6) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 3, window.getCount(times, 6, 2) );
+
+	// a growing file fills the window up to its end
+	CPPUNIT_ASSERT_EQUAL( (size_t) 1, window.getCount(times, 3, 2) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, window.getCount(times, 2, 2) );
+
+	// past the end of the file
+	CPPUNIT_ASSERT( window.setStart("7") );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 6, window.getFirst(times, 6) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 0, window.getCount(times, 6, 6) );
+}
+
+
+void TimeWindowTest::testStride()
+{
+	const float times[6] = { 0.0f, 10.0f, 20.0f, 30.0f, 40.0f, 50.0f };
+
+	TimeWindow window;
+	CPPUNIT_ASSERT( window.setStride(2) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 3, window.getCount(times, 6, 0) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 3, window.getCount(times, 5, 0) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, window.getCount(times, 5, 1) );
+
+	// every other timestep of the file: 0 and 1 seconds
+	SWWReader * reader = openWindow(window);
+	CPPUNIT_ASSERT( reader->isValid() );
+	CPPUNIT_ASSERT( !reader->isWholeRun() );
+	CPPUNIT_ASSERT_EQUAL( 2u, reader->getNumberOfTimesteps() );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, reader->getFileTimestep(1) );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0, reader->getTime(0), TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, reader->getTime(1), TIMEWINDOW_TOLERANCE );
+
+	for (unsigned int t=0; t<reader->getNumberOfTimesteps(); t++)
+	{
+		std::vector<float> fullStage, fullElevation, stage, elevation;
+		CPPUNIT_ASSERT( _full->readFrame(reader->getFileTimestep(t), fullStage, fullElevation) );
+		CPPUNIT_ASSERT( reader->readFrame(t, stage, elevation) );
+		CPPUNIT_ASSERT_EQUAL( fullStage.size(), stage.size() );
+		for (size_t iv=0; iv<stage.size(); iv++)
+		{
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullStage[iv], stage[iv], TIMEWINDOW_TOLERANCE );
+			CPPUNIT_ASSERT_DOUBLES_EQUAL( fullElevation[iv], elevation[iv], TIMEWINDOW_TOLERANCE );
+		}
+	}
+
+	// a series has one value per timestep of the window
+	const osg::Vec2 v = reader->getGeoreferencedVertex(5);
+	osg::ref_ptr<osg::FloatArray> full = new osg::FloatArray;
+	osg::ref_ptr<osg::FloatArray> series = new osg::FloatArray;
+	CPPUNIT_ASSERT( _full->getTimeSeries(v.x(), v.y(), SWWReader::TSTYPE_STAGE, full) );
+	CPPUNIT_ASSERT( reader->getTimeSeries(v.x(), v.y(), SWWReader::TSTYPE_STAGE, series) );
+	CPPUNIT_ASSERT_EQUAL( 3u, (unsigned int) full->size() );
+	CPPUNIT_ASSERT_EQUAL( 2u, (unsigned int) series->size() );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( (*full)[0], (*series)[0], TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( (*full)[2], (*series)[1], TIMEWINDOW_TOLERANCE );
+}
+
+
+void TimeWindowTest::testSeconds()
+{
+	// from the first time at or after 0.25 to the last at or before 1
+	TimeWindow window;
+	CPPUNIT_ASSERT( window.setStart("0.25s") );
+	CPPUNIT_ASSERT( window.setEnd("1s") );
+
+	SWWReader * reader = openWindow(window);
+	CPPUNIT_ASSERT( reader->isValid() );
+	CPPUNIT_ASSERT_EQUAL( 2u, reader->getNumberOfTimesteps() );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 1, reader->getFileTimestep(0) );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, reader->getTime(0), TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, reader->getTime(1), TIMEWINDOW_TOLERANCE );
+
+	// the geometry of a frame is that of the file's timestep
+	CPPUNIT_ASSERT( reader->loadStageVertexArray(0) );
+	CPPUNIT_ASSERT( _full->loadStageVertexArray(1) );
+	osg::ref_ptr<osg::Vec3Array> expected = _full->getStageVertexArray();
+	osg::ref_ptr<osg::Vec3Array> actual = reader->getStageVertexArray();
+	CPPUNIT_ASSERT_EQUAL( expected->size(), actual->size() );
+	for (size_t iv=0; iv<actual->size(); iv++)
+	{
+		CPPUNIT_ASSERT_DOUBLES_EQUAL( (*expected)[iv].z(), (*actual)[iv].z(), TIMEWINDOW_TOLERANCE );
+	}
+}
+
+
+void TimeWindowTest::testFrames()
+{
+	TimeWindow window;
+	CPPUNIT_ASSERT( window.setStart("1") );
+
+	SWWReader * reader = openWindow(window);
+	CPPUNIT_ASSERT( reader->isValid() );
+
+	// a pass sees only the window, numbered within it
+	TimesVisitor visitor;
+	CPPUNIT_ASSERT( reader->readFrames(visitor) );
+	CPPUNIT_ASSERT_EQUAL( (size_t) 2, visitor._timesteps.size() );
+	CPPUNIT_ASSERT_EQUAL( 0u, visitor._timesteps[0] );
+	CPPUNIT_ASSERT_EQUAL( 1u, visitor._timesteps[1] );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.5, visitor._times[0], TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 1.0, visitor._times[1], TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0664175, visitor._stage[0], TIMEWINDOW_TOLERANCE );
+	CPPUNIT_ASSERT_DOUBLES_EQUAL( 0.0555556, visitor._stage[1], TIMEWINDOW_TOLERANCE );
+}
+
+
+void TimeWindowTest::testOutside()
+{
+	TimeWindow window;
+	CPPUNIT_ASSERT( window.setStart("5s") );
+	SWWReader * reader = openWindow(window);
+	CPPUNIT_ASSERT( !reader->isValid() );
+
+	CPPUNIT_ASSERT( _full->isWholeRun() );
+}
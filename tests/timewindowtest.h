@@ -0,0 +1,37 @@
+#ifndef TIMEWINDOWTEST_H_
+#define TIMEWINDOWTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+#include <swwreader.h>
+#include <timewindow.h>
+
+
+class TimeWindowTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( TimeWindowTest );
+	CPPUNIT_TEST( testParse );
+	CPPUNIT_TEST( testSelect );
+	CPPUNIT_TEST( testStride );
+	CPPUNIT_TEST( testSeconds );
+	CPPUNIT_TEST( testFrames );
+	CPPUNIT_TEST( testOutside );
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testParse();
+	void testSelect();
+	void testStride();
+	void testSeconds();
+	void testFrames();
+	void testOutside();
+
+private:
+	SWWReader* _full;
+};
+
+#endif // TIMEWINDOWTEST_H_
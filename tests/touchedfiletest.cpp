@@ -53,6 +53,31 @@ void TouchedFileTest::testNoChange()
 	CPPUNIT_ASSERT(!check.isChanged());
 }
 
+void TouchedFileTest::testRecheck()
+{
+	FileChangedCheck check;
+
+	CPPUNIT_ASSERT(check.watch(std::string(s_testFilename)));
+
+	// once only, the file itself unchanged
+	check.recheck();
+	CPPUNIT_ASSERT(check.isChanged());
+	CPPUNIT_ASSERT(!check.isChanged());
+
+	// the only change seen without a file
+	FileChangedCheck none;
+	CPPUNIT_ASSERT(!none.isChanged());
+	none.recheck();
+	CPPUNIT_ASSERT(none.isChanged());
+
+	// a delayed recheck comes due once, after its delay
+	check.recheckAfter(200);
+	CPPUNIT_ASSERT(!check.isChanged());
+	OS_SLEEP_MS(300);
+	CPPUNIT_ASSERT(check.isChanged());
+	CPPUNIT_ASSERT(!check.isChanged());
+}
+
 void TouchedFileTest::testNoExist()
 {
 	FileChangedCheck check;
@@ -97,6 +122,72 @@ void TouchedFileTest::testInstantLengthChange()
 }
 
 
+/**
+ * Wait for a watcher thread to see a change.
+ * @return true if it did within a few seconds
+ */
+static bool waitForChange(FileChangedCheck & aCheck)
+{
+	for (int i=0; i<300; i++)
+	{
+		if (aCheck.isChanged())
+		{
+			return true;
+		}
+		OS_SLEEP_MS(10);
+	}
+	return false;
+}
+
+
+void TouchedFileTest::testAsyncChange()
+{
+	FileChangedCheck check;
+
+	CPPUNIT_ASSERT(check.watchAsync(std::string(s_testFilename)));
+
+	OS_SLEEP_MS(200);
+	CPPUNIT_ASSERT(!check.isChanged());	// File should not have been changed since creation
+
+	const char * txt = "some test text - length has changed.\n";
+	FILE * fh = fopen(s_testFilename, "wt");
+	fwrite(txt, strlen(txt), 1, fh);
+	fclose(fh);
+
+	CPPUNIT_ASSERT(waitForChange(check));	// Seen by inotify, or by polling where it isn't available
+	OS_SLEEP_MS(200);
+	while (check.isChanged())
+	{
+		// a write can arrive as several events, they all clear
+	}
+	CPPUNIT_ASSERT(!check.isChanged());
+}
+
+
+void TouchedFileTest::testAsyncPoll()
+{
+	FileChangedCheck check;
+
+	CPPUNIT_ASSERT(check.watchAsync(std::string(s_testFilename), 100, false));
+	CPPUNIT_ASSERT(!check.isNotifying());
+
+	OS_SLEEP_MS(300);
+	CPPUNIT_ASSERT(!check.isChanged());
+
+	const char * txt = "some test text - length has changed.\n";
+	FILE * fh = fopen(s_testFilename, "wt");
+	fwrite(txt, strlen(txt), 1, fh);
+	fclose(fh);
+
+	CPPUNIT_ASSERT(waitForChange(check));	// Within a poll or two
+	CPPUNIT_ASSERT(!check.isChanged());	// Triggers once
+
+	// deleting the file is a change too
+	remove(s_testFilename);
+	CPPUNIT_ASSERT(waitForChange(check));
+}
+
+
 void TouchedFileTest::tearDown()
 {
 #ifdef WIN32
@@ -17,6 +17,9 @@ class TouchedFileTest : public CppUnit::TestFixture
 	CPPUNIT_TEST( testChange );
 	CPPUNIT_TEST( testInstantLengthChange );
 	CPPUNIT_TEST( testNoExist );
+	CPPUNIT_TEST( testAsyncChange );
+	CPPUNIT_TEST( testAsyncPoll );
+	CPPUNIT_TEST( testRecheck );
 	
 	CPPUNIT_TEST_SUITE_END();
 
@@ -29,6 +32,9 @@ public:
 	void testNoExist();
 	void testInstantLengthChange();
 	void testChange();
+	void testAsyncChange();
+	void testAsyncPoll();
+	void testRecheck();
 
 private:
 
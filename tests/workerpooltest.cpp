@@ -0,0 +1,165 @@
+
+#ifdef WIN32
+#include <windows.h>
+#define OS_SLEEP_MS(x) Sleep(x);
+#else
+#include <unistd.h>
+#define OS_SLEEP_MS(x) usleep(x*1000);
+#endif
+
+#include <vector>
+#include <algorithm>
+#include <OpenThreads/Atomic>
+
+#include <cppunit/extensions/TestFactoryRegistry.h>
+
+#include <workerpool.h>
+
+#include "workerpooltest.h"
+
+
+// Registers the fixture
+CPPUNIT_TEST_SUITE_REGISTRATION( WorkerPoolTest );
+
+
+/**
+ * Counts how many times it, and its siblings, have been run.
+ */
+class CountJob : public WorkerPool::Job
+{
+public:
+	CountJob(OpenThreads::Atomic & aCount, int aSleepMs = 0) : _count(aCount), _sleepMs(aSleepMs) {}
+
+	virtual void run()
+	{
+		if (_sleepMs)
+		{
+			OS_SLEEP_MS(_sleepMs);
+		}
+		++_count;
+	}
+
+private:
+	OpenThreads::Atomic & _count;
+	int _sleepMs;
+};
+
+
+void WorkerPoolTest::setUp()
+{
+}
+
+
+void WorkerPoolTest::tearDown()
+{
+}
+
+
+void WorkerPoolTest::testRunsAllJobs()
+{
+	OpenThreads::Atomic count;
+	WorkerPool pool(4);
+
+	CPPUNIT_ASSERT(pool.getNumThreads() == 4u);
+
+	for (int i=0; i<100; i++)
+	{
+		pool.add(new CountJob(count));
+	}
+	pool.wait();
+
+	CPPUNIT_ASSERT(count == 100u);
+	CPPUNIT_ASSERT(pool.getNumPending() == 0u);
+}
+
+
+void WorkerPoolTest::testBoundedQueue()
+{
+	OpenThreads::Atomic count;
+	WorkerPool pool(1, 2);
+
+	// add() blocks once two jobs are waiting, so the producer can't get ahead
+	for (int i=0; i<10; i++)
+	{
+		pool.add(new CountJob(count, 5));
+		CPPUNIT_ASSERT(pool.getNumPending() <= 3u);	// queued plus the one running
+	}
+	pool.wait();
+
+	CPPUNIT_ASSERT(count == 10u);
+}
+
+
+void WorkerPoolTest::testDestructorDrains()
+{
+	OpenThreads::Atomic count;
+	{
+		WorkerPool pool(2);
+		for (int i=0; i<10; i++)
+		{
+			pool.add(new CountJob(count, 1));
+		}
+	}
+
+	CPPUNIT_ASSERT(count == 10u);
+}
+
+
+/**
+ * Marks each index of a range it is run over.
+ */
+struct MarkBody
+{
+	MarkBody(std::vector<int> & aMarks) : _marks(aMarks) {}
+
+	void operator()(size_t aBegin, size_t aEnd)
+	{
+		for (size_t i=aBegin; i<aEnd; i++)
+		{
+			_marks[i]++;
+		}
+	}
+
+	std::vector<int> & _marks;
+};
+
+
+void WorkerPoolTest::testParallelFor()
+{
+	WorkerPool pool(3);
+
+	// every index visited exactly once, however the range splits
+	for (size_t n=0; n<10; n++)
+	{
+		std::vector<int> marks(n + 5, 0);
+		MarkBody body(marks);
+		pool.parallelFor(5, n + 5, body);
+
+		for (size_t i=0; i<marks.size(); i++)
+		{
+			CPPUNIT_ASSERT_EQUAL( (i < 5) ? 0 : 1, marks[i] );
+		}
+	}
+
+	CPPUNIT_ASSERT(pool.getNumPending() == 0u);
+}
+
+
+void WorkerPoolTest::testLowPriority()
+{
+	// a low priority pool is slower to get the processors, but still runs everything
+	OpenThreads::Atomic count;
+	WorkerPool pool(2, 0, OpenThreads::Thread::THREAD_PRIORITY_LOW);
+	for (int i=0; i<20; i++)
+	{
+		pool.add(new CountJob(count));
+	}
+	pool.wait();
+
+	CPPUNIT_ASSERT(count == 20u);
+
+	std::vector<int> marks(100, 0);
+	MarkBody body(marks);
+	pool.parallelFor(0, marks.size(), body);
+	CPPUNIT_ASSERT( std::count(marks.begin(), marks.end(), 1) == 100 );
+}
@@ -0,0 +1,34 @@
+#ifndef WORKERPOOLTEST_H_
+#define WORKERPOOLTEST_H_
+
+#include <cppunit/extensions/HelperMacros.h>
+#include <cppunit/SourceLine.h>
+#include <cppunit/TestAssert.h>
+
+
+class WorkerPoolTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE( WorkerPoolTest );
+	CPPUNIT_TEST( testRunsAllJobs );
+	CPPUNIT_TEST( testBoundedQueue );
+	CPPUNIT_TEST( testDestructorDrains );
+	CPPUNIT_TEST( testParallelFor );
+	CPPUNIT_TEST( testLowPriority );
+
+	CPPUNIT_TEST_SUITE_END();
+
+public:
+	void setUp();
+	void tearDown();
+
+	void testRunsAllJobs();
+	void testBoundedQueue();
+	void testDestructorDrains();
+	void testParallelFor();
+	void testLowPriority();
+
+private:
+
+};
+
+#endif // WORKERPOOLTEST_H_
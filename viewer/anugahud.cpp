@@ -12,6 +12,16 @@ AnugaHUD::AnugaHUD() :
 	addStatusLine("culling", textnode);
 	addStatusLine("grid", textnode);
 	addStatusLine("filename", textnode);
+	addStatusLine("timeseries", textnode);
+	addStatusLine("gauges", textnode);
+	addStatusLine("envelope", textnode);
+	addStatusLine("colour", textnode);
+	addStatusLine("arrows", textnode);
+	addStatusLine("totals", textnode);
+	addStatusLine("follow", textnode);
+	addStatusLine("run", textnode);
+	addStatusLine("tiles", textnode);
+	addStatusLine("preview", textnode);
 
 	_text_switch->addChild(textnode);
 }
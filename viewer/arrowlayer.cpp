@@ -0,0 +1,328 @@
+/*
+  ArrowLayer class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <float.h>
+#include <algorithm>
+#include <osg/Program>
+#include <osg/Shader>
+#include <osg/Viewport>
+#include <osg/VertexAttribDivisor>
+
+#include "hud.h"
+#include "arrowlayer.h"
+
+// cells across the finest level's grid, each coarser level halves it
+#define ARROW_FINEST_CELLS 1024
+
+// aimed for distance between arrows on screen, pixels
+#define ARROW_SPACING_PIXELS 24.0
+
+// most arrows drawn at once
+#define ARROW_MAX_COUNT 100000
+
+// speed drawn a whole cell long, faster flows are drawn no longer
+#define ARROW_FULL_SPEED 2.0f
+
+// height of the arrows above the water surface, normalised units
+#define ARROW_LIFT 0.002f
+
+// vertex attribute slots of the per-arrow attributes, clear of those OpenGL aliases
+#define ARROW_POSITION_ATTRIB 6
+#define ARROW_DIRECTION_ATTRIB 7
+
+
+// turns, stretches and places each instance of a unit arrow pointing along x
+static const char * s_arrowVertexShader =
+	"#version 120\n"
+	"attribute vec3 arrowPosition;\n"
+	"attribute vec4 arrowDirection;\n"
+	"varying vec4 arrowColour;\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 along = arrowDirection.xy * arrowDirection.z;\n"
+	"	vec2 across = vec2(-along.y, along.x);\n"
+	"	vec3 p = arrowPosition + vec3(along * gl_Vertex.x + across * gl_Vertex.y, 0.0);\n"
+	"	gl_Position = gl_ModelViewProjectionMatrix * vec4(p, 1.0);\n"
+	"	float shade = clamp(arrowDirection.w / 2.0, 0.0, 1.0);\n"
+	"	arrowColour = vec4(1.0, 1.0, 1.0 - 0.8*shade, 1.0);\n"
+	"}\n";
+
+static const char * s_arrowFragmentShader =
+	"#version 120\n"
+	"varying vec4 arrowColour;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_FragColor = arrowColour;\n"
+	"}\n";
+
+
+ArrowLayer::ArrowLayer(SWWReader * aReader) :
+	_sww(aReader),
+	_enabled(false),
+	_numVertices(0),
+	_level(-1)
+{
+	_geode = new osg::Geode;
+	_geode->setNodeMask(0);
+
+	// the instances spread far beyond the one arrow's bound
+	_geode->setCullingActive(false);
+}
+
+
+void ArrowLayer::toggle()
+{
+	_enabled = !_enabled;
+	_geode->setNodeMask(_enabled ? ~0 : 0);
+
+	if (_enabled && !_geometry.valid())
+	{
+		createGeometry();
+	}
+}
+
+
+void ArrowLayer::createGeometry()
+{
+	// shaft then head of an arrow one unit long
+	static const float outline[9][2] =
+	{
+		{ 0.0f, -0.04f }, { 0.65f, -0.04f }, { 0.65f, 0.04f },
+		{ 0.0f, -0.04f }, { 0.65f, 0.04f }, { 0.0f, 0.04f },
+		{ 0.65f, -0.15f }, { 1.0f, 0.0f }, { 0.65f, 0.15f },
+	};
+
+	osg::Vec3Array * mesh = new osg::Vec3Array;
+	for (unsigned int i = 0; i < 9; i++)
+	{
+		mesh->push_back(osg::Vec3(outline[i][0], outline[i][1], 0.0f));
+	}
+
+	_positions = new osg::Vec3Array;
+	_directions = new osg::Vec4Array;
+	_arrows = new osg::DrawArrays(osg::PrimitiveSet::TRIANGLES, 0, mesh->size(), 0);
+
+	_geometry = new osg::Geometry;
+	_geometry->setUseDisplayList(false);
+	_geometry->setUseVertexBufferObjects(true);
+	_geometry->setVertexArray(mesh);
+	_geometry->setVertexAttribArray(ARROW_POSITION_ATTRIB, _positions.get());
+	_geometry->setVertexAttribBinding(ARROW_POSITION_ATTRIB, osg::Geometry::BIND_PER_VERTEX);
+	_geometry->setVertexAttribArray(ARROW_DIRECTION_ATTRIB, _directions.get());
+	_geometry->setVertexAttribBinding(ARROW_DIRECTION_ATTRIB, osg::Geometry::BIND_PER_VERTEX);
+	_geometry->addPrimitiveSet(_arrows.get());
+
+	osg::Program * program = new osg::Program;
+	program->addShader(new osg::Shader(osg::Shader::VERTEX, s_arrowVertexShader));
+	program->addShader(new osg::Shader(osg::Shader::FRAGMENT, s_arrowFragmentShader));
+	program->addBindAttribLocation("arrowPosition", ARROW_POSITION_ATTRIB);
+	program->addBindAttribLocation("arrowDirection", ARROW_DIRECTION_ATTRIB);
+
+	// the per-arrow attributes advance once per instance, not per vertex
+	osg::StateSet * stateset = _geometry->getOrCreateStateSet();
+	stateset->setAttributeAndModes(program, osg::StateAttribute::ON);
+	stateset->setAttribute(new osg::VertexAttribDivisor(ARROW_POSITION_ATTRIB, 1));
+	stateset->setAttribute(new osg::VertexAttribDivisor(ARROW_DIRECTION_ATTRIB, 1));
+	stateset->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+	_geode->addDrawable(_geometry.get());
+}
+
+
+void ArrowLayer::setUpLevels()
+{
+	// level grids cover the mesh
+	osg::ref_ptr<osg::Vec3Array> vertices = _sww->getBedslopeVertexArray();
+	osg::Vec2 lo(FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX);
+	float zlo = FLT_MAX, zhi = -FLT_MAX;
+	for (size_t iv = 0; vertices.valid() && iv < vertices->size(); iv++)
+	{
+		const osg::Vec3 & v = (*vertices)[iv];
+		lo.set(osg::minimum(lo.x(), v.x()), osg::minimum(lo.y(), v.y()));
+		hi.set(osg::maximum(hi.x(), v.x()), osg::maximum(hi.y(), v.y()));
+		zlo = osg::minimum(zlo, v.z());
+		zhi = osg::maximum(zhi, v.z());
+	}
+	_origin = lo;
+	_extent = hi - lo;
+	_centre.set((lo.x()+hi.x())/2, (lo.y()+hi.y())/2, (zlo+zhi)/2);
+
+	float finest = osg::maximum(_extent.x(), _extent.y()) / ARROW_FINEST_CELLS;
+	_levels.clear();
+	for (unsigned int cells = ARROW_FINEST_CELLS; cells > 0; cells /= 2)
+	{
+		Level level;
+		level._spacing = finest * (ARROW_FINEST_CELLS / cells);
+		level._built = false;
+		_levels.push_back(level);
+	}
+	_numVertices = vertices.valid() ? vertices->size() : 0;
+	_level = -1;
+}
+
+
+void ArrowLayer::buildLevel(unsigned int aLevel)
+{
+	Level & level = _levels[aLevel];
+	if (level._built)
+	{
+		return;
+	}
+	level._built = true;
+
+	osg::ref_ptr<osg::Vec3Array> vertices = _sww->getBedslopeVertexArray();
+	if (!vertices.valid() || level._spacing <= 0.0f)
+	{
+		return;
+	}
+
+	unsigned int cols = (unsigned int) (_extent.x() / level._spacing) + 1;
+	unsigned int rows = (unsigned int) (_extent.y() / level._spacing) + 1;
+	std::vector<int> nearest(cols*rows, -1);
+	std::vector<float> distance(cols*rows, FLT_MAX);
+
+	for (size_t iv = 0; iv < vertices->size(); iv++)
+	{
+		float x = ((*vertices)[iv].x() - _origin.x()) / level._spacing;
+		float y = ((*vertices)[iv].y() - _origin.y()) / level._spacing;
+		unsigned int col = osg::minimum((unsigned int) x, cols-1);
+		unsigned int row = osg::minimum((unsigned int) y, rows-1);
+
+		float dx = x - col - 0.5f;
+		float dy = y - row - 0.5f;
+		float d = dx*dx + dy*dy;
+
+		unsigned int cell = row*cols + col;
+		if (d < distance[cell])
+		{
+			distance[cell] = d;
+			nearest[cell] = iv;
+		}
+	}
+
+	for (size_t cell = 0; cell < nearest.size(); cell++)
+	{
+		if (nearest[cell] >= 0)
+		{
+			level._vertices.push_back(nearest[cell]);
+		}
+	}
+	std::sort(level._vertices.begin(), level._vertices.end());
+}
+
+
+unsigned int ArrowLayer::chooseLevel(osg::Camera * aCamera)
+{
+	// size of a pixel at the middle of the mesh
+	double pixel = 0.0;
+	double fovy, aspect, znear, zfar;
+	if (aCamera && aCamera->getViewport() && aCamera->getProjectionMatrixAsPerspective(fovy, aspect, znear, zfar))
+	{
+		osg::Vec3 eye = aCamera->getInverseViewMatrix().getTrans();
+		double distance = (eye - _centre).length();
+		pixel = 2.0 * distance * tan(osg::DegreesToRadians(fovy) / 2.0) / aCamera->getViewport()->height();
+	}
+
+	unsigned int chosen = 0;
+	while (chosen+1 < _levels.size() && _levels[chosen]._spacing < ARROW_SPACING_PIXELS * pixel)
+	{
+		chosen++;
+	}
+
+	// coarser still if there would be too many
+	buildLevel(chosen);
+	while (chosen+1 < _levels.size() && _levels[chosen]._vertices.size() > ARROW_MAX_COUNT)
+	{
+		chosen++;
+		buildLevel(chosen);
+	}
+
+	return chosen;
+}
+
+
+void ArrowLayer::fillGlyphs(size_t aBegin, size_t aEnd)
+{
+	const Level & level = _levels[_level];
+	if (!_sww->getStageVelocity(&level._vertices[aBegin], aEnd - aBegin, &_u[aBegin], &_v[aBegin]))
+	{
+		std::fill(_u.begin() + aBegin, _u.begin() + aEnd, 0.0f);
+		std::fill(_v.begin() + aBegin, _v.begin() + aEnd, 0.0f);
+	}
+
+	for (size_t i = aBegin; i < aEnd; i++)
+	{
+		float speed = sqrtf(_u[i]*_u[i] + _v[i]*_v[i]);
+		float length = level._spacing * osg::minimum(speed / ARROW_FULL_SPEED, 1.0f);
+
+		// still or dry water gets a zero length arrow, which draws nothing
+		(*_positions)[i] = (*_frame)[level._vertices[i]] + osg::Vec3(0.0f, 0.0f, ARROW_LIFT);
+		if (speed > 0.0f)
+		{
+			(*_directions)[i].set(_u[i] / speed, _v[i] / speed, length, speed);
+		}
+		else
+		{
+			(*_directions)[i].set(1.0f, 0.0f, 0.0f, 0.0f);
+		}
+	}
+}
+
+
+void ArrowLayer::update(osg::Camera * aCamera, HeadsUpDisplay * aHUD)
+{
+	if (!_enabled)
+	{
+		return;
+	}
+
+	osg::ref_ptr<osg::Vec3Array> frame = _sww->getStageVertexArray();
+	if (!frame.valid())
+	{
+		return;
+	}
+
+	if (frame->size() != _numVertices)
+	{
+		// first use, or the file has changed under us
+		setUpLevels();
+		if (frame->size() != _numVertices)
+		{
+			return;
+		}
+	}
+
+	int level = chooseLevel(aCamera);
+	if (level == _level && frame == _frame)
+	{
+		return;
+	}
+
+	// a new frame, or a new level, refill every arrow
+	_level = level;
+	_frame = frame;
+
+	size_t count = _levels[_level]._vertices.size();
+	_positions->resize(count);
+	_directions->resize(count);
+	_u.resize(count);
+	_v.resize(count);
+
+	GlyphBody body(this);
+	_pool.parallelFor(0, count, body);
+
+	_positions->dirty();
+	_directions->dirty();
+	_arrows->setNumInstances(count);
+	_geometry->dirtyBound();
+
+	char status[32];
+	sprintf(status, "%u", (unsigned int) count);
+	aHUD->setStatus("arrows", status);
+}
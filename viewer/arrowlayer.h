@@ -0,0 +1,127 @@
+/*
+    ArrowLayer class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef ARROWLAYER_H
+#define ARROWLAYER_H
+
+#include <vector>
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/Geometry>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class HeadsUpDisplay;
+
+/**
+ * Arrows showing the direction and speed of the flow over the water surface.
+ *
+ * Every arrow is an instance of one small mesh, drawn with a single instanced draw
+ * call; a vertex shader places, turns and stretches each one from two per-instance
+ * attributes, so the cost per arrow is two vertex attributes rather than geometry.
+ *
+ * Arrows sit on a set of vertices thinned to about one per grid cell. The cells
+ * double in size from level to level, each level's vertices are chosen on first use,
+ * and the level is picked from the camera so arrows stay a roughly constant distance
+ * apart on screen, and never more than a fixed number of them are drawn. The arrow
+ * attributes are refilled for each new frame, split across a pool of threads.
+ */
+class ArrowLayer
+{
+public:
+	ArrowLayer(SWWReader * aReader);
+
+	/**
+	 * Show or hide the arrows.
+	 */
+	void toggle();
+
+	bool isEnabled() const	{	return _enabled;	}
+
+	/**
+	 * Refit the arrows to the loaded frame and the camera. Call once per frame, after
+	 * the water surface has loaded its frame.
+	 */
+	void update(osg::Camera * aCamera, HeadsUpDisplay * aHUD);
+
+	/**
+	 * Get the arrows, drawn in the reader's normalised coordinates.
+	 */
+	osg::Geode * get()	{	return _geode.get();	}
+
+protected:
+
+	/**
+	 * Vertices thinned to at most one per cell of a grid.
+	 */
+	struct Level
+	{
+		float _spacing;	/**< Cell size, normalised units */
+		bool _built;
+		std::vector<unsigned int> _vertices;	/**< Ascending, so reads of the frame stay in order */
+	};
+
+	/**
+	 * Runs fillGlyphs() for a parallelFor.
+	 */
+	struct GlyphBody
+	{
+		GlyphBody(ArrowLayer * aLayer) : _layer(aLayer) {}
+		void operator()(size_t aBegin, size_t aEnd)	{	_layer->fillGlyphs(aBegin, aEnd);	}
+		ArrowLayer * _layer;
+	};
+
+	/**
+	 * Size the level grids to the mesh, choosing no vertices yet.
+	 */
+	void setUpLevels();
+
+	/**
+	 * Choose the vertices of a level, the one nearest the centre of each cell.
+	 */
+	void buildLevel(unsigned int aLevel);
+
+	/**
+	 * Pick the finest level whose arrows are far enough apart on screen and few enough.
+	 */
+	unsigned int chooseLevel(osg::Camera * aCamera);
+
+	/**
+	 * Fill the attributes of a range of arrows from the loaded frame.
+	 */
+	void fillGlyphs(size_t aBegin, size_t aEnd);
+
+	/**
+	 * Create the one arrow mesh and the shader that instances it.
+	 */
+	void createGeometry();
+
+protected:
+	SWWReader * _sww;
+	WorkerPool _pool;
+	bool _enabled;
+
+	osg::ref_ptr<osg::Geode> _geode;
+	osg::ref_ptr<osg::Geometry> _geometry;
+	osg::ref_ptr<osg::DrawArrays> _arrows;
+	osg::ref_ptr<osg::Vec3Array> _positions;	/**< Per arrow, its tail */
+	osg::ref_ptr<osg::Vec4Array> _directions;	/**< Per arrow, unit direction, length and speed */
+
+	std::vector<Level> _levels;
+	size_t _numVertices;	/**< Of the mesh the levels were set up for */
+	osg::Vec2 _origin;	/**< Corner of the level grids, normalised units */
+	osg::Vec2 _extent;
+	osg::Vec3 _centre;
+
+	int _level;	/**< Level shown, -1 before the first update */
+	osg::ref_ptr<osg::Vec3Array> _frame;	/**< Stage the arrows were filled from */
+	std::vector<float> _u;	/**< Velocity of each arrow, filled with its attributes */
+	std::vector<float> _v;
+};
+
+#endif  // ARROWLAYER_H
@@ -13,7 +13,7 @@
 
 
 // constructor
-BedSlope::BedSlope(SWWReader* sww)
+BedSlope::BedSlope(SWWReader* sww, osg::Texture2D * aSharedTexture)
 	: MeshObject("bedslope"),
 	_loaded(false)
 {
@@ -24,7 +24,12 @@ BedSlope::BedSlope(SWWReader* sww)
 
     // bedslope texture
 	_texture = false;
-	if( sww->hasBedslopeTexture() )
+	if( sww->hasBedslopeTexture() && aSharedTexture )
+	{
+	    _texture = true;
+		texture = aSharedTexture;
+	}
+	else if( sww->hasBedslopeTexture() )
 	{
 	    _texture = true;
 		texture = new osg::Texture2D;
@@ -50,6 +55,7 @@ BedSlope::BedSlope(SWWReader* sww)
 	_stateset->setAttributeAndModes( _material, osg::StateAttribute::ON | osg::StateAttribute::OVERRIDE );
 	_stateset->setMode( GL_BLEND, osg::StateAttribute::ON );
 	_stateset->setMode( GL_LIGHTING, osg::StateAttribute::ON );
+	_bedslopeTexture = texture;
 	if (texture)
 	{
 		_stateset->setTextureAttributeAndModes( 0, texture, osg::StateAttribute::ON );
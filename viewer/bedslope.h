@@ -16,6 +16,7 @@
 #include <swwreader.h>
 #include <osg/Geode>
 #include <osg/Material>
+#include <osg/Texture2D>
 #include <osg/StateAttribute>
 
 #include "meshobject.h"
@@ -28,7 +29,12 @@ class BedSlope : public MeshObject
 
 public:
 
-    BedSlope(SWWReader *sww);
+	/**
+	 * @param aSharedTexture texture to use rather than loading the reader's, for surfaces
+	 * of one file that come and go
+	 */
+    BedSlope(SWWReader *sww, osg::Texture2D * aSharedTexture = NULL);
+    virtual ~BedSlope(){;}	// public, tile surfaces are dropped again
     osg::Geode* get(){ return _node; }
     //osg::BoundingBox getBound(){ return _geom->getBound(); }
     osg::BoundingBox getBound(){ return _geom->Drawable::getBoundingBox(); }
@@ -46,11 +52,15 @@ public:
 	 */
 	void onRefreshTextured(bool aIsTextured);
 
+	/**
+	 * Get the bedslope texture, NULL if the reader has none.
+	 */
+	osg::Texture2D * getTexture()	{	return _bedslopeTexture.get();	}
+
 protected:
 
     osg::Material* _material;
-
-    virtual ~BedSlope(){;}
+	osg::ref_ptr<osg::Texture2D> _bedslopeTexture;
     bool _texture;
 	bool _loaded;
 
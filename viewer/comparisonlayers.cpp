@@ -0,0 +1,134 @@
+/*
+  ComparisonLayers class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <osgDB/FileNameUtils>
+
+#include "hud.h"
+#include "comparisonlayers.h"
+
+
+ComparisonLayers::ComparisonLayers(SWWReader * aReader, BedSlope * aBedslope, WaterSurface * aWater) :
+	_switch(new osg::Switch),
+	_shown(0),
+	_dirty(true)
+{
+	Run run;
+	run._sww = aReader;
+	run._bedslope = aBedslope;
+	run._water = aWater;
+	_runs.push_back(run);
+
+	osg::Group * group = new osg::Group;
+	group->addChild(aBedslope->get());
+	group->addChild(aWater->get());
+	_switch->addChild(group, true);
+}
+
+
+void ComparisonLayers::addRun(SWWReader * aReader)
+{
+	Run run;
+	run._sww = aReader;
+	run._bedslope = new BedSlope(aReader);
+	run._water = new WaterSurface(aReader);
+	_runs.push_back(run);
+
+	osg::Group * group = new osg::Group;
+	group->addChild(run._bedslope->get());
+	group->addChild(run._water->get());
+	_switch->addChild(group, false);
+
+	_dirty = true;
+}
+
+
+void ComparisonLayers::cycle()
+{
+	_shown = (_shown + 1) % _runs.size();
+	_switch->setSingleChildOn(_shown);
+	_dirty = true;
+}
+
+
+void ComparisonLayers::setTextured(bool aIsTextured)
+{
+	for (size_t i=1; i<_runs.size(); i++)
+	{
+		_runs[i]._bedslope->onRefreshTextured(aIsTextured);
+	}
+}
+
+
+void ComparisonLayers::update(float aTime, HeadsUpDisplay * aHUD)
+{
+	if (_dirty)
+	{
+		_dirty = false;
+
+		// which of how many, and the file it's from
+		char status[32];
+		sprintf(status, "%u of %u, ", _shown + 1, (unsigned int) _runs.size());
+		aHUD->setStatus("run", std::string(status) + osgDB::getSimpleFileName(_runs[_shown]._sww->getFilename()));
+	}
+
+	// the first run's surfaces are the caller's to update
+	if (_shown == 0)
+	{
+		return;
+	}
+
+	const Run & first = _runs[0];
+	const Run & run = _runs[_shown];
+
+	// at the time of the first run, as near as this one's timesteps allow
+	unsigned int timestep = findTimestep(run._sww, aTime);
+	run._water->setTimeStep(timestep);
+	run._bedslope->setTimeStep(timestep);
+
+	// looking the same as the first, so only the data differs between them
+	run._water->setWireframe(first._water->getWireframe());
+	run._bedslope->setWireframe(first._bedslope->getWireframe());
+	run._water->setCulling(first._water->getCulling());
+	run._water->setColourQuantity(first._sww->getColourQuantity());
+
+	run._water->update();
+	run._bedslope->update();
+}
+
+
+unsigned int ComparisonLayers::findTimestep(SWWReader * aReader, float aTime)
+{
+	const unsigned int ntimesteps = aReader->getNumberOfTimesteps();
+	if (ntimesteps == 0)
+	{
+		return 0;
+	}
+
+	// first timestep at or after the time, times only increase
+	unsigned int lo = 0, hi = ntimesteps - 1;
+	while (lo < hi)
+	{
+		unsigned int mid = (lo + hi) / 2;
+		if (aReader->getTime(mid) < aTime)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	// or the one before it, if nearer
+	if ((lo > 0) && (aTime - aReader->getTime(lo-1) < aReader->getTime(lo) - aTime))
+	{
+		lo--;
+	}
+
+	return lo;
+}
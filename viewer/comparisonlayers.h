@@ -0,0 +1,96 @@
+/*
+    ComparisonLayers class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef COMPARISONLAYERS_H
+#define COMPARISONLAYERS_H
+
+#include <vector>
+#include <osg/Switch>
+#include <osg/ref_ptr>
+
+#include <swwreader.h>
+
+#include "bedslope.h"
+#include "watersurface.h"
+
+class HeadsUpDisplay;
+
+/**
+ * Several runs of one domain, scenarios on the same mesh, shown one at a time in
+ * place of each other and played in step.
+ *
+ * The first run is the viewer's own bedslope and water surface. Each run added gets
+ * a bedslope and water surface of its own under a switch, and cycle() moves between
+ * them. The run shown is kept at its timestep nearest the time of the first run, so
+ * runs written at different intervals still line up, and takes the first run's
+ * wireframe, culling and colouring. Runs not shown load no frames.
+ *
+ * Readers opened with the first run's mesh share it, so each added run costs only
+ * its own elevation and frames.
+ */
+class ComparisonLayers
+{
+public:
+	/**
+	 * @param aReader reader of the first run
+	 * @param aBedslope the first run's bedslope, updated by the caller
+	 * @param aWater the first run's water surface, updated by the caller
+	 */
+	ComparisonLayers(SWWReader * aReader, BedSlope * aBedslope, WaterSurface * aWater);
+
+	/**
+	 * Add a run, not shown until cycled to.
+	 */
+	void addRun(SWWReader * aReader);
+
+	unsigned int getNumberOfRuns() const	{	return _runs.size();	}
+
+	/**
+	 * Show the next run, after the last going back to the first.
+	 */
+	void cycle();
+
+	/**
+	 * Set the bedslope texturing of every run.
+	 */
+	void setTextured(bool aIsTextured);
+
+	/**
+	 * Bring the run shown to a time and the first run's settings, and tell the HUD which
+	 * it is. Call once per frame, after the first run's surfaces are set up.
+	 * @param aTime time shown by the first run, seconds
+	 */
+	void update(float aTime, HeadsUpDisplay * aHUD);
+
+	/**
+	 * Get the switch holding every run's surfaces, drawn in the first run's normalised
+	 * coordinates.
+	 */
+	osg::Switch * get()	{	return _switch.get();	}
+
+protected:
+
+	/**
+	 * Find the timestep of a run nearest a time.
+	 */
+	static unsigned int findTimestep(SWWReader * aReader, float aTime);
+
+	struct Run
+	{
+		SWWReader * _sww;
+		BedSlope * _bedslope;
+		WaterSurface * _water;
+	};
+
+protected:
+	std::vector<Run> _runs;	/**< The first is the viewer's own */
+	osg::ref_ptr<osg::Switch> _switch;	/**< One child per run */
+	unsigned int _shown;
+	bool _dirty;	/**< HUD needs the run shown again */
+};
+
+#endif  // COMPARISONLAYERS_H
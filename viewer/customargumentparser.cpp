@@ -107,6 +107,27 @@ void CustomArgumentParser::SetUsage()
 	usage.addCommandLineOption("-alphamax <float 0-1>", "Maximum transparency clamp value");
 	usage.addCommandLineOption("-lightpos <float>,<float>,<float>", "x,y,z of bedslope directional light (z is up, default is 1, 1, 1)");
 	usage.addCommandLineOption("-movie <dirname>", "Save numbered images to named directory and quit");
+	usage.addCommandLineOption("-headless <width>x<height>", "Render frames offscreen at this resolution, save them and quit");
+	usage.addCommandLineOption("-steps <first>,<last>", "Range of timesteps rendered by -headless (default all)");
+	usage.addCommandLineOption("-stream <file|\"|command\">", "Save frames to one video stream instead of numbered images");
+	usage.addCommandLineOption("-streamformat <y4m|rgb|ppm>", "Stream format (default from -stream file extension, else y4m)");
+	usage.addCommandLineOption("-fps <rate>", "Stream frames per second (default 25)");
+	usage.addCommandLineOption("-timescale <seconds>", "Simulation seconds per second of stream (default one frame per timestep)");
+	usage.addCommandLineOption("-inundation <file>", "Write the inundation arrival time and duration at each vertex as CSV and quit");
+	usage.addCommandLineOption("-inundationdepth <float>", "Depth above which a vertex is inundated (default 0.01)");
+	usage.addCommandLineOption("-diff <file>", "Another run of the same mesh, its difference from this one shown by the envelope layers");
+	usage.addCommandLineOption("-diffout <file>", "Write the greatest depth and stage difference of the -diff run at each vertex as CSV and quit");
+	usage.addCommandLineOption("-follow", "Keep to the newest complete timestep as a running simulation writes them");
+	usage.addCommandLineOption("-followloop <N>", "Follow, looping over the newest N timesteps");
+	usage.addCommandLineOption("-compare <file>", "Another run on the same mesh, shown in place of the first with 'v' and played in step (repeatable)");
+	usage.addCommandLineOption("-sharedcache <MB>", "Share up to this many megabytes of decoded frames with other viewers of the same file on this host");
+	usage.addCommandLineOption("-roi <region>", "Load only the triangles in xmin,ymin,xmax,ymax or the polygon x1,y1,x2,y2,x3,y3,... in georeferenced coordinates");
+	usage.addCommandLineOption("-tstart <step|time>", "Load only from this timestep, or the first at or after this many seconds such as 3600s");
+	usage.addCommandLineOption("-tend <step|time>", "Load only up to this timestep, or the last at or before this many seconds");
+	usage.addCommandLineOption("-tstride <int>", "Load only every this many timesteps of the window");
+	usage.addCommandLineOption("-outofcore <MB>", "Cut a mesh too large to load into tiles, loading those in view within this many megabytes");
+	usage.addCommandLineOption("-tiles <count>", "Tiles along the longer side of the mesh out of core (default 32)");
+	usage.addCommandLineOption("-previewmb <MB>", "Memory for coarse frames shown while stepping by hand, 0 for none (default 64)");
 	usage.addCommandLineOption("-loop", "Repeated (looped) playback of .swm files");
 	usage.addCommandLineOption("-nosky", "Omit background sky");
 	usage.addCommandLineOption("-cullangle <float angle 0-90>", "Cull triangles steeper than this value");
@@ -0,0 +1,427 @@
+/*
+  EnvelopeLayer class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <osg/Notify>
+#include <OpenThreads/ScopedLock>
+
+#include "hud.h"
+#include "watersurface.h"
+#include "envelopelayer.h"
+
+#define ENVELOPE_WET_DEPTH 0.001	// metres, shallower vertices are left transparent
+#define ENVELOPE_AGREE 0.001	// metres, runs closer than this are left transparent
+
+
+static const char * s_layerNames[EnvelopeLayer::LAYER_NUM_OF] = { "max depth", "max speed", "max stage", "arrival time", "duration",
+																"max depth difference", "max stage difference", "depth difference", "stage difference" };
+static const char * s_layerUnits[EnvelopeLayer::LAYER_NUM_OF] = { "m", "m/s", "m", "s", "s", "m", "m", "m", "m" };
+
+
+/**
+ * Compute the envelope and inundation maps, and the difference from the second run if
+ * there is one, or load them from their caches.
+ */
+class EnvelopeLayer::ComputeJob : public WorkerPool::Job
+{
+public:
+	ComputeJob(EnvelopeLayer * aOwner) : _owner(aOwner) {}
+
+	virtual void run()
+	{
+		SWWReader * sww = _owner->_sww;
+		Envelope * envelope = _owner->_envelope;
+		Inundation * inundation = _owner->_inundation;
+		Difference * difference = _owner->_difference;
+
+		// those not answered from their caches share one pass over the file
+		SWWReader::FrameVisitorList pass;
+		const bool envelopePass = envelope->beginPass(sww);
+		if (envelopePass)
+		{
+			pass.add(envelope);
+		}
+		const bool inundationPass = inundation->beginPass(sww);
+		if (inundationPass)
+		{
+			pass.add(inundation);
+		}
+		const bool differencePass = difference && difference->beginPass(sww, _owner->_run);
+		if (differencePass)
+		{
+			pass.add(difference);
+		}
+
+		const bool read = !pass.empty() && sww->readFrames(pass);
+		if (envelopePass)
+		{
+			envelope->endPass(read);
+		}
+		if (inundationPass)
+		{
+			inundation->endPass(read);
+		}
+		if (differencePass)
+		{
+			difference->endPass();
+		}
+
+		if (!envelope->isValid())
+		{
+			osg::notify(osg::WARN) << "[EnvelopeLayer] Could not compute the envelope of " << sww->getFilename() << std::endl;
+		}
+		if (!inundation->isValid())
+		{
+			osg::notify(osg::WARN) << "[EnvelopeLayer] Could not compute the inundation of " << sww->getFilename() << std::endl;
+		}
+		if (difference && !difference->isValid())
+		{
+			osg::notify(osg::WARN) << "[EnvelopeLayer] Could not compute the difference of " << _owner->_run->getFilename() << " from " << sww->getFilename() << std::endl;
+		}
+		_owner->_finished.exchange(1);
+	}
+
+private:
+	EnvelopeLayer * _owner;
+};
+
+
+/**
+ * Read both runs at one timestep and take their difference, off the render thread.
+ */
+class EnvelopeLayer::ReadJob : public WorkerPool::Job
+{
+public:
+	ReadJob(EnvelopeLayer * aOwner, unsigned int aTimestep) : _owner(aOwner), _timestep(aTimestep) {}
+
+	virtual void run()
+	{
+		std::vector<float> difference[Difference::DIFFERENCE_NUM_OF];
+		std::vector<float> stage, elevation, runstage, runelevation;
+		if (_owner->_sww->readFrame(_timestep, stage, elevation) && _owner->_run->readFrame(_timestep, runstage, runelevation) &&
+			(runstage.size() == stage.size()) && !stage.empty())
+		{
+			const size_t npoints = stage.size();
+			difference[Difference::DIFFERENCE_STAGE].resize(npoints);
+			Difference::subtract(&runstage[0], &stage[0], &difference[Difference::DIFFERENCE_STAGE][0], npoints);
+
+			Difference::depth(&stage[0], &elevation[0], &stage[0], npoints);
+			Difference::depth(&runstage[0], &runelevation[0], &runstage[0], npoints);
+			difference[Difference::DIFFERENCE_DEPTH].resize(npoints);
+			Difference::subtract(&runstage[0], &stage[0], &difference[Difference::DIFFERENCE_DEPTH][0], npoints);
+		}
+
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_owner->_readMutex);
+		for (int q=0; q<Difference::DIFFERENCE_NUM_OF; q++)
+		{
+			_owner->_readDifference[q].swap(difference[q]);
+		}
+		_owner->_readTimestep = _timestep;
+		_owner->_readDone = true;
+		_owner->_reading = false;
+	}
+
+private:
+	EnvelopeLayer * _owner;
+	unsigned int _timestep;
+};
+
+
+EnvelopeLayer::EnvelopeLayer(SWWReader * aReader, float aInundationDepth) :
+	_sww(aReader),
+	_inundationDepth(aInundationDepth),
+	_envelope(NULL),
+	_inundation(NULL),
+	_run(NULL),
+	_difference(NULL),
+	_pool(1),
+	_layer(-1),
+	_dirty(false),
+	_timestep(0),
+	_differenceTimestep(0),
+	_hasTimestepDifference(false),
+	_readTimestep(0),
+	_reading(false),
+	_readDone(false)
+{
+}
+
+
+EnvelopeLayer::~EnvelopeLayer()
+{
+	if (_envelope)
+	{
+		_envelope->cancel();
+		_inundation->cancel();
+		if (_difference)
+		{
+			_difference->cancel();
+		}
+		_pool.wait();
+		delete _envelope;
+		delete _inundation;
+		delete _difference;
+	}
+}
+
+
+void EnvelopeLayer::cycle()
+{
+	_layer++;
+	if ((_layer >= LAYER_NUM_OF) || ((_layer >= LAYER_MAX_DEPTH_DIFFERENCE) && !_run))
+	{
+		_layer = -1;
+	}
+	_dirty = true;
+
+	if (_layer >= 0 && !_envelope)
+	{
+		_envelope = new Envelope;
+		_inundation = new Inundation(_inundationDepth);
+		if (_run)
+		{
+			_difference = new Difference;
+		}
+		_pool.add(new ComputeJob(this));
+	}
+}
+
+
+void EnvelopeLayer::update(WaterSurface * aWater, HeadsUpDisplay * aHUD, unsigned int aTimestep)
+{
+	const bool finished = (_finished != 0);
+
+	if (_layer >= 0 && !finished)
+	{
+		float progress = _envelope->getProgress() + _inundation->getProgress();
+		if (_difference)
+		{
+			progress = (progress + _difference->getProgress()) / 3;
+		}
+		else
+		{
+			progress /= 2;
+		}
+
+		char status[32];
+		sprintf(status, "computing %d%%", (int) (100 * progress));
+		if (_status != status)
+		{
+			_status = status;
+			aHUD->setStatus("envelope", _status);
+		}
+		return;
+	}
+
+	// the layers of one timestep follow the animation, keeping the last colours while
+	// the next timestep is read
+	if ((_layer >= LAYER_DEPTH_DIFFERENCE) && !(_hasTimestepDifference && (_differenceTimestep == aTimestep)))
+	{
+		if (!takeTimestepDifference(aTimestep))
+		{
+			return;
+		}
+		_dirty = true;
+	}
+
+	if (!_dirty)
+	{
+		return;
+	}
+	_dirty = false;
+	_timestep = aTimestep;
+
+	// the difference doesn't need the envelope, each one is computed whether the others fail or not
+	bool valid;
+	if (_layer >= LAYER_MAX_DEPTH_DIFFERENCE)
+	{
+		valid = _difference && _difference->isValid();
+	}
+	else
+	{
+		valid = _envelope && _envelope->isValid() &&
+				((_layer < LAYER_ARRIVAL) || _inundation->isValid());
+	}
+
+	float lo = 0.0f;
+	float hi = 0.0f;
+	osg::Vec4Array * colours = NULL;
+	if (_layer >= LAYER_MAX_DEPTH_DIFFERENCE && valid)
+	{
+		colours = createDifferenceColours((Layer) _layer, hi);
+		lo = -hi;
+		valid = (colours != NULL);
+	}
+	else if (_layer >= 0 && valid)
+	{
+		colours = createColours((Layer) _layer, lo, hi);
+	}
+
+	if (_layer < 0)
+	{
+		aWater->setColourLayer(NULL);
+		_status = "off";
+
+		// back to the legend of the animated colours
+		DerivedQuantity::Type quantity = _sww->getColourQuantity();
+		aHUD->setIntensityScale(DerivedQuantity::getName(quantity), 0.0f, DerivedQuantity::getScale(quantity), DerivedQuantity::getUnits(quantity), true);
+	}
+	else if (!valid)
+	{
+		aWater->setColourLayer(NULL);
+		_status = "unavailable";
+	}
+	else
+	{
+		aWater->setColourLayer(colours);
+		_status = s_layerNames[_layer];
+
+		aHUD->setIntensityScale(s_layerNames[_layer], lo, hi, s_layerUnits[_layer]);
+		aHUD->setShowIntensityScale(true);
+	}
+	aHUD->setStatus("envelope", _status);
+}
+
+
+osg::Vec4Array * EnvelopeLayer::createColours(Layer aLayer, float & aMin, float & aMax)
+{
+	const std::vector<float> * value = NULL;
+	switch (aLayer)
+	{
+		case LAYER_MAX_DEPTH:	value = &_envelope->getMaximum(Envelope::ENVELOPE_DEPTH);	break;
+		case LAYER_MAX_SPEED:	value = &_envelope->getMaximum(Envelope::ENVELOPE_SPEED);	break;
+		case LAYER_MAX_STAGE:	value = &_envelope->getMaximum(Envelope::ENVELOPE_STAGE);	break;
+		case LAYER_ARRIVAL:		value = &_inundation->getArrivalTime();	break;
+		case LAYER_DURATION:	value = &_inundation->getDuration();	break;
+		default:	assert(0);	break;
+	}
+
+	// where the water reached, by depth for the envelope and by arrival for inundation
+	const std::vector<float> & depth = _envelope->getMaximum(Envelope::ENVELOPE_DEPTH);
+	const std::vector<float> & arrival = _inundation->getArrivalTime();
+	const bool inundation = (aLayer >= LAYER_ARRIVAL);
+	const size_t npoints = value->size();
+	std::vector<bool> wet(npoints);
+	for (size_t iv = 0; iv < npoints; iv++)
+	{
+		wet[iv] = inundation ? (arrival[iv] != Inundation::getNever()) : (depth[iv] > ENVELOPE_WET_DEPTH);
+	}
+
+	// scale to the range over the wetted area, depth, speed and duration from zero
+	float lo = 0.0f;
+	float hi = 0.0f;
+	bool first = true;
+	for (size_t iv = 0; iv < npoints; iv++)
+	{
+		if (wet[iv])
+		{
+			if (first)
+			{
+				lo = hi = (*value)[iv];
+				first = false;
+			}
+			lo = osg::minimum(lo, (*value)[iv]);
+			hi = osg::maximum(hi, (*value)[iv]);
+		}
+	}
+	if (aLayer != LAYER_MAX_STAGE && aLayer != LAYER_ARRIVAL)
+	{
+		lo = 0.0f;
+	}
+	aMin = lo;
+	aMax = hi;
+	const float range = (hi > lo) ? hi - lo : 1.0f;
+	const float alpha = _sww->getAlphaMax();
+
+	// same ramp as the momentum colouring, red to green to blue
+	osg::Vec4Array * colours = new osg::Vec4Array;
+	colours->reserve(npoints);
+	for (size_t iv = 0; iv < npoints; iv++)
+	{
+		float intens = osg::clampBetween(((*value)[iv] - lo) / range, 0.0f, 1.0f);
+		colours->push_back(osg::Vec4(1.0f-intens, (0.5f-fabs(intens - 0.5f))*2, intens, wet[iv] ? alpha : 0.0f));
+	}
+
+	return colours;
+}
+
+
+bool EnvelopeLayer::takeTimestepDifference(unsigned int aTimestep)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_readMutex);
+
+	if (_readDone && (_readTimestep == aTimestep))
+	{
+		for (int q=0; q<Difference::DIFFERENCE_NUM_OF; q++)
+		{
+			_timestepDifference[q].swap(_readDifference[q]);
+		}
+		_differenceTimestep = aTimestep;
+		_hasTimestepDifference = true;
+		_readDone = false;
+		return true;
+	}
+
+	// one read at a time, of the timestep shown when the last one finished
+	if (!_reading)
+	{
+		_reading = true;
+		_readDone = false;
+		_pool.add(new ReadJob(this, aTimestep));
+	}
+	return false;
+}
+
+
+osg::Vec4Array * EnvelopeLayer::createDifferenceColours(Layer aLayer, float & aMax)
+{
+	const std::vector<float> * value = NULL;
+	switch (aLayer)
+	{
+		case LAYER_MAX_DEPTH_DIFFERENCE:	value = &_difference->getMaximum(Difference::DIFFERENCE_DEPTH);	break;
+		case LAYER_MAX_STAGE_DIFFERENCE:	value = &_difference->getMaximum(Difference::DIFFERENCE_STAGE);	break;
+		case LAYER_DEPTH_DIFFERENCE:	value = &_timestepDifference[Difference::DIFFERENCE_DEPTH];	break;
+		case LAYER_STAGE_DIFFERENCE:	value = &_timestepDifference[Difference::DIFFERENCE_STAGE];	break;
+		default:	assert(0);	break;
+	}
+	if (value->empty())
+	{
+		return NULL;
+	}
+
+	const size_t npoints = value->size();
+	float largest = 0.0f;
+	for (size_t iv = 0; iv < npoints; iv++)
+	{
+		largest = osg::maximum(largest, (float) fabs((*value)[iv]));
+	}
+	aMax = largest;
+	const float range = (largest > 0.0f) ? largest : 1.0f;
+	const float alpha = _sww->getAlphaMax();
+
+	// diverging ramp, blue where the run is lower through white to red where it is higher
+	osg::Vec4Array * colours = new osg::Vec4Array;
+	colours->reserve(npoints);
+	for (size_t iv = 0; iv < npoints; iv++)
+	{
+		const float intens = osg::clampBetween((*value)[iv] / range, -1.0f, 1.0f);
+		const float fade = 1.0f - fabs(intens);
+		const float a = (fabs((*value)[iv]) > ENVELOPE_AGREE) ? alpha : 0.0f;
+		if (intens < 0.0f)
+		{
+			colours->push_back(osg::Vec4(fade, fade, 1.0f, a));
+		}
+		else
+		{
+			colours->push_back(osg::Vec4(1.0f, fade, fade, a));
+		}
+	}
+
+	return colours;
+}
@@ -0,0 +1,139 @@
+/*
+    EnvelopeLayer class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef ENVELOPELAYER_H
+#define ENVELOPELAYER_H
+
+#include <vector>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+#include <osg/Array>
+
+#include <swwreader.h>
+#include <envelope.h>
+#include <inundation.h>
+#include <difference.h>
+#include <workerpool.h>
+
+class HeadsUpDisplay;
+class WaterSurface;
+
+/**
+ * Colours the water surface by a summary of the whole run, in place of the animated
+ * colours: the maximum depth, speed or stage reached, or when the water first arrived
+ * and how long it stayed.
+ *
+ * Given a second run of the same mesh, four more layers show how it differs from this
+ * one, run less this: the greatest difference in depth and in stage at each vertex, and
+ * the difference at the displayed timestep, which plays with the animation. These are
+ * coloured blue where the run is lower and red where it is higher, and left clear where
+ * the two agree.
+ *
+ * The summaries are computed on a background thread the first time a layer is shown,
+ * or loaded from their sidecar caches, while the surface keeps its usual colours. The
+ * frames of the layers that play with the animation are read on the same thread, the
+ * last timestep's colours staying until the next one's are in.
+ * The HUD colour bar is relabelled as the layer's legend.
+ */
+class EnvelopeLayer
+{
+public:
+	enum Layer
+	{
+		LAYER_MAX_DEPTH = 0,
+		LAYER_MAX_SPEED,
+		LAYER_MAX_STAGE,
+		LAYER_ARRIVAL,	/**< First time deeper than the inundation depth */
+		LAYER_DURATION,	/**< Time spent deeper than the inundation depth */
+		LAYER_MAX_DEPTH_DIFFERENCE,	/**< Greatest depth difference from the second run */
+		LAYER_MAX_STAGE_DIFFERENCE,	/**< Greatest stage difference from the second run */
+		LAYER_DEPTH_DIFFERENCE,	/**< Depth difference at the displayed timestep */
+		LAYER_STAGE_DIFFERENCE,	/**< Stage difference at the displayed timestep */
+		LAYER_NUM_OF
+	};
+
+	/**
+	 * Constructor
+	 * @param aReader file summarised
+	 * @param aInundationDepth depth above which a vertex counts as inundated, metres
+	 */
+	EnvelopeLayer(SWWReader * aReader, float aInundationDepth);
+	~EnvelopeLayer();
+
+	/**
+	 * Set the run the difference layers compare against, before the first cycle().
+	 * Without one those layers are skipped.
+	 * @param aRun a run of the same mesh with the same output times
+	 */
+	void setDifferenceRun(SWWReader * aRun)	{	_run = aRun;	}
+
+	/**
+	 * Show the next layer, and after the last turn them off again.
+	 */
+	void cycle();
+
+	/**
+	 * Apply the layer to the surface once it is ready. Call once per frame.
+	 * @param aTimestep timestep displayed, for the layers that play with the animation
+	 */
+	void update(WaterSurface * aWater, HeadsUpDisplay * aHUD, unsigned int aTimestep);
+
+protected:
+
+	class ComputeJob;
+	class ReadJob;
+
+	/**
+	 * Colour ramp of a layer over the domain, transparent where the water never reached.
+	 * @param aMin set to the value at the bottom of the ramp
+	 * @param aMax set to the value at the top of the ramp
+	 */
+	osg::Vec4Array * createColours(Layer aLayer, float & aMin, float & aMax);
+
+	/**
+	 * Take the difference between the runs at a timestep once it has been read, or have
+	 * it read in the background if it isn't being already.
+	 * @return false until it has been read
+	 */
+	bool takeTimestepDifference(unsigned int aTimestep);
+
+	/**
+	 * Colour ramp of a difference layer, symmetric about no difference, transparent where
+	 * the runs agree.
+	 * @param aMax set to the size of the largest difference, the ramp runs from -aMax to aMax
+	 * @return NULL if the timestep couldn't be read from both runs
+	 */
+	osg::Vec4Array * createDifferenceColours(Layer aLayer, float & aMax);
+
+protected:
+	SWWReader * _sww;
+	float _inundationDepth;
+	Envelope * _envelope;	/**< Created on first use */
+	Inundation * _inundation;	/**< Created on first use */
+	SWWReader * _run;	/**< Compared against by the difference layers, NULL for none */
+	Difference * _difference;	/**< Created on first use, with a run */
+	WorkerPool _pool;	/**< One thread, runs the compute */
+	OpenThreads::Atomic _finished;	/**< The compute has returned */
+	int _layer;	/**< Layer shown, -1 for off */
+	bool _dirty;	/**< Surface or HUD needs updating */
+	unsigned int _timestep;	/**< Timestep of the colours shown */
+	std::string _status;
+
+	// difference at one timestep, each quantity empty if it couldn't be read
+	std::vector<float> _timestepDifference[Difference::DIFFERENCE_NUM_OF];
+	unsigned int _differenceTimestep;
+	bool _hasTimestepDifference;
+
+	// handed back by the read, under _readMutex
+	OpenThreads::Mutex _readMutex;
+	std::vector<float> _readDifference[Difference::DIFFERENCE_NUM_OF];
+	unsigned int _readTimestep;
+	bool _reading;	/**< A read is queued or running */
+	bool _readDone;	/**< _readDifference holds _readTimestep */
+};
+
+#endif  // ENVELOPELAYER_H
@@ -0,0 +1,229 @@
+/*
+  FrameCapture class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+#include <osg/BufferObject>
+#include <osg/GLExtensions>
+#include <osg/GraphicsContext>
+#include <osg/Notify>
+#include <osgDB/WriteFile>
+#include <OpenThreads/ScopedLock>
+
+#include "framecapture.h"
+
+// frames waiting for an encoder thread, per thread, before capture blocks
+#define ENCODER_QUEUE_PER_THREAD 2
+
+
+/**
+ * Encode and write one captured frame.
+ */
+class FrameCapture::WriteImageJob : public WorkerPool::Job
+{
+public:
+	WriteImageJob(const FrameCapture * aCapture, osg::Image * aImage, const std::string & aFilename) :
+		_capture(const_cast<FrameCapture*>(aCapture)),
+		_image(aImage),
+		_filename(aFilename)
+	{
+	}
+
+	virtual void run()
+	{
+		if (osgDB::writeImageFile(*_image, _filename))
+		{
+			_capture->frameWritten();
+		}
+		else
+		{
+			osg::notify(osg::WARN) << "[FrameCapture] Unable to write " << _filename << std::endl;
+		}
+	}
+
+private:
+	FrameCapture * _capture;
+	osg::ref_ptr<osg::Image> _image;
+	std::string _filename;
+};
+
+
+FrameCapture::FrameCapture(const std::string & aFilePrefix, const std::string & aExtension, unsigned int aNumThreads) :
+	_prefix(aFilePrefix),
+	_extension(aExtension),
+	_pool(NULL),
+	_requestedTime(-1.0),
+	_current(0),
+	_nextSequence(0),
+	_width(0),
+	_height(0),
+	_start(0),
+	_last(0)
+{
+	_pbo[0] = _pbo[1] = 0;
+	_pending[0] = _pending[1] = false;
+	_sequence[0] = _sequence[1] = 0;
+	_time[0] = _time[1] = -1.0;
+
+	if (aNumThreads == 0)
+	{
+		// leave a processor for the render loop
+		int nproc = OpenThreads::GetNumberOfProcessors();
+		aNumThreads = (nproc > 1) ? nproc-1 : 1;
+	}
+
+	_pool = new WorkerPool(aNumThreads, aNumThreads*ENCODER_QUEUE_PER_THREAD);
+}
+
+
+FrameCapture::~FrameCapture()
+{
+	delete _pool;	// waits for queued frames
+	_pool = NULL;
+}
+
+
+void FrameCapture::finish(osgViewer::Viewer & aViewer)
+{
+	// the last readback is collected at the end of the next frame
+	if (_inflight)
+	{
+		aViewer.frame();
+	}
+
+	_pool->wait();
+}
+
+
+double FrameCapture::getThroughput()
+{
+	if (!_written || !_start)
+	{
+		return 0.0;
+	}
+
+	osg::Timer_t last;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_lastMutex);
+		last = _last;
+	}
+
+	double seconds = osg::Timer::instance()->delta_s(_start, last);
+	return (seconds > 0.0) ? _written / seconds : 0.0;
+}
+
+
+void FrameCapture::frameWritten()
+{
+	++_written;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_lastMutex);
+	_last = osg::Timer::instance()->tick();
+}
+
+
+void FrameCapture::submit(osg::Image * aImage, unsigned int aContextID, unsigned int aSequence, double /*aTime*/) const
+{
+	char suffix[64];
+	sprintf(suffix, "_%u_%u.", aContextID, aSequence);
+
+	// blocks here while the encoders are behind
+	_pool->add(new WriteImageJob(this, aImage, _prefix + suffix + _extension));
+}
+
+
+void FrameCapture::operator()(osg::RenderInfo & aRenderInfo) const
+{
+	osg::State * state = aRenderInfo.getState();
+	osg::GraphicsContext * gc = state->getGraphicsContext();
+	if (!gc || !gc->getTraits())
+	{
+		return;
+	}
+
+	const int width = gc->getTraits()->width;
+	const int height = gc->getTraits()->height;
+	const unsigned int contextID = state->getContextID();
+	const bool requested = (_requested.exchange(0) > 0);
+	const double time = _requestedTime;
+
+	if (requested && !_start)
+	{
+		_start = osg::Timer::instance()->tick();
+	}
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadBuffer(gc->getTraits()->doubleBuffer ? GL_BACK : GL_FRONT);
+
+	osg::GLExtensions * ext = osg::GLExtensions::Get(contextID, true);
+	if (!ext->isPBOSupported)
+	{
+		// synchronous fallback, stalls until the frame is finished
+		if (requested)
+		{
+			osg::ref_ptr<osg::Image> image = new osg::Image;
+			image->readPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE);
+			submit(image.get(), contextID, _nextSequence++, time);
+		}
+		return;
+	}
+
+	// collect the readback issued last frame, its transfer has had a whole frame to complete
+	unsigned int previous = 1 - _current;
+	if (_pending[previous])
+	{
+		ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbo[previous]);
+		const unsigned char * src = (const unsigned char *)ext->glMapBuffer(GL_PIXEL_PACK_BUFFER_ARB, GL_READ_ONLY_ARB);
+		if (src)
+		{
+			osg::ref_ptr<osg::Image> image = new osg::Image;
+			image->allocateImage(_width, _height, 1, GL_RGB, GL_UNSIGNED_BYTE);
+			memcpy(image->data(), src, image->getTotalSizeInBytes());
+			ext->glUnmapBuffer(GL_PIXEL_PACK_BUFFER_ARB);
+
+			submit(image.get(), contextID, _sequence[previous], _time[previous]);
+		}
+		_pending[previous] = false;
+		--_inflight;
+	}
+
+	// (re)allocate both buffers when the window size changes
+	if ((width != _width) || (height != _height) || !_pbo[0])
+	{
+		if (_pbo[0])
+		{
+			ext->glDeleteBuffers(2, _pbo);
+		}
+
+		ext->glGenBuffers(2, _pbo);
+		for (int i=0; i<2; i++)
+		{
+			ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbo[i]);
+			ext->glBufferData(GL_PIXEL_PACK_BUFFER_ARB, width*height*3, NULL, GL_STREAM_READ);
+		}
+
+		_width = width;
+		_height = height;
+	}
+
+	// start an asynchronous readback of this frame, returns without waiting for the data
+	if (requested)
+	{
+		ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, _pbo[_current]);
+		glReadPixels(0, 0, _width, _height, GL_RGB, GL_UNSIGNED_BYTE, 0);
+		_pending[_current] = true;
+		_sequence[_current] = _nextSequence++;
+		_time[_current] = time;
+		++_inflight;
+	}
+
+	ext->glBindBuffer(GL_PIXEL_PACK_BUFFER_ARB, 0);
+
+	_current = previous;
+}
@@ -0,0 +1,129 @@
+/*
+    FrameCapture class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <string>
+#include <osg/Camera>
+#include <osg/Image>
+#include <osg/Timer>
+#include <osgViewer/Viewer>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+
+#include <workerpool.h>
+
+/**
+ * Captures rendered frames to numbered image files without stalling the frame loop.
+ *
+ * Installed as the camera's post draw callback. Pixels are read back into one of two
+ * pixel buffer objects, and collected from it a frame later once the transfer has
+ * completed, so the GPU is never waited on. Collected frames are encoded and written by a
+ * pool of worker threads. Files may be finished out of order but are named by their capture
+ * sequence number. When the disk can't keep up the encoder queue fills and the draw
+ * thread waits for it, which bounds memory use.
+ *
+ * Falls back to a synchronous glReadPixels if pixel buffer objects are not supported.
+ *
+ * Usage
+ *
+ * osg::ref_ptr<FrameCapture> capture = new FrameCapture("screenshots/frame", "jpg");
+ * viewer.getCamera()->setPostDrawCallback(capture.get());
+ * while (!viewer.done())
+ * {
+ *     capture->captureNextFrame();
+ *     viewer.frame();
+ * }
+ * capture->finish(viewer);
+ */
+class FrameCapture : public osg::Camera::DrawCallback
+{
+public:
+	/**
+	 * Constructor
+	 * @param aFilePrefix path and name prefix of the image files, "_<context>_<number>.<ext>" is appended
+	 * @param aExtension image file type, any format osgDB can write
+	 * @param aNumThreads number of encoder threads, 0 for one less than the number of processors
+	 */
+	FrameCapture(const std::string & aFilePrefix, const std::string & aExtension, unsigned int aNumThreads = 0);
+
+	/**
+	 * Capture the frame about to be rendered.
+	 * @param aTime simulation time the frame shows, negative if it has none
+	 */
+	void captureNextFrame(double aTime = -1.0)	{	_requestedTime = aTime; ++_requested;	}
+
+	/**
+	 * Collect any readback still in flight and wait for all frames to be written.
+	 * The readback of the last captured frame completes during one extra frame render.
+	 * @param aViewer viewer to render the extra frame with
+	 */
+	virtual void finish(osgViewer::Viewer & aViewer);
+
+	/**
+	 * Get the number of frames written to disk so far.
+	 */
+	unsigned int getNumWritten()	{	return _written;	}
+
+	/**
+	 * Get the capture throughput, from the first capture to the latest frame written.
+	 * @return frames written per second
+	 */
+	double getThroughput();
+
+	/**
+	 * Readback and handoff, called by osg at the end of drawing the camera.
+	 */
+	virtual void operator()(osg::RenderInfo & aRenderInfo) const;
+
+protected:
+
+	virtual ~FrameCapture();
+
+	/**
+	 * Hand a collected frame to the encoder pool.
+	 * @param aImage captured pixels
+	 * @param aContextID graphics context the frame was captured from
+	 * @param aSequence capture sequence number of the frame
+	 * @param aTime simulation time of the frame, negative if it has none
+	 */
+	virtual void submit(osg::Image * aImage, unsigned int aContextID, unsigned int aSequence, double aTime) const;
+
+	/**
+	 * Called by the encoder threads as each frame is written.
+	 */
+	void frameWritten();
+
+	class WriteImageJob;
+
+protected:
+	std::string _prefix;
+	std::string _extension;
+
+	WorkerPool * _pool;	/**< Encoder threads */
+
+	mutable OpenThreads::Atomic _requested;	/**< Captures requested for the next frame */
+	double _requestedTime;	/**< Simulation time of the next frame */
+	OpenThreads::Atomic _written;	/**< Frames written to disk */
+	mutable OpenThreads::Atomic _inflight;	/**< Readbacks not yet collected */
+
+	// readback state, only touched from the draw thread
+	mutable GLuint _pbo[2];
+	mutable unsigned int _sequence[2];	/**< Sequence number of the frame in each buffer */
+	mutable double _time[2];	/**< Simulation time of the frame in each buffer */
+	mutable bool _pending[2];	/**< Buffer holds a readback that hasn't been collected */
+	mutable unsigned int _current;	/**< Buffer the next readback goes into */
+	mutable unsigned int _nextSequence;
+	mutable int _width, _height;
+
+	mutable osg::Timer_t _start;	/**< Time of the first capture */
+	osg::Timer_t _last;	/**< Time the latest frame was written, under _lastMutex */
+	OpenThreads::Mutex _lastMutex;	/**< Encoder threads finish frames at once */
+};
+
+#endif  // FRAMECAPTURE_H
@@ -0,0 +1,273 @@
+/*
+  GaugePanel class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/LineWidth>
+#include <osg/Point>
+#include <osg/StateSet>
+#include <OpenThreads/ScopedLock>
+
+#include "hud.h"
+#include "gaugepanel.h"
+
+// marker height above and below the gauge point, in normalised units
+#define MARKER_ABOVE 0.08f
+#define MARKER_BELOW 0.02f
+
+static const osg::Vec4 s_gaugeColours[] =
+{
+	osg::Vec4(0.85, 0.1, 0.1, 1.0),
+	osg::Vec4(0.1, 0.6, 0.1, 1.0),
+	osg::Vec4(0.1, 0.3, 0.9, 1.0),
+	osg::Vec4(0.9, 0.5, 0.0, 1.0),
+	osg::Vec4(0.6, 0.1, 0.7, 1.0),
+	osg::Vec4(0.0, 0.6, 0.6, 1.0),
+};
+static const unsigned int s_numGaugeColours = sizeof(s_gaugeColours)/sizeof(s_gaugeColours[0]);
+
+
+/**
+ * Extract the series at a set of gauge locations in one batch.
+ */
+class GaugePanel::ExtractJob : public WorkerPool::Job
+{
+public:
+	ExtractJob(GaugePanel * aPanel, unsigned int aGeneration, SWWReader::TimeSeriesType aType, const std::vector<osg::Vec2d> & aLocations) :
+		_panel(aPanel),
+		_generation(aGeneration),
+		_type(aType),
+		_locations(aLocations)
+	{
+	}
+
+	virtual void run()
+	{
+		std::vector< osg::ref_ptr<osg::FloatArray> > series;
+		if (!_panel->_sww->getTimeSeries(_locations, _type, series))
+		{
+			// reported all the same, so the gauges aren't left waiting
+			series.assign(_locations.size(), osg::ref_ptr<osg::FloatArray>());
+		}
+		_panel->extracted(_generation, _locations, series);
+	}
+
+private:
+	GaugePanel * _panel;
+	unsigned int _generation;
+	SWWReader::TimeSeriesType _type;
+	std::vector<osg::Vec2d> _locations;
+};
+
+
+GaugePanel::GaugePanel(SWWReader * aReader, unsigned int aMaxGauges) :
+	_sww(aReader),
+	_maxGauges(aMaxGauges),
+	_nextColour(0),
+	_plotType(SWWReader::TSTYPE_STAGE),
+	_markers(new osg::Group),
+	_pool(1),
+	_generation(0),
+	_dirty(false)
+{
+	osg::StateSet * stateset = _markers->getOrCreateStateSet();
+	stateset->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+	stateset->setAttributeAndModes(new osg::LineWidth(3.0f), osg::StateAttribute::ON);
+	stateset->setAttributeAndModes(new osg::Point(8.0f), osg::StateAttribute::ON);
+	_markers->setName("gauges");
+}
+
+
+GaugePanel::~GaugePanel()
+{
+	// results would come back to a deleted panel
+	_pool.wait();
+}
+
+
+void GaugePanel::addGauge(const osg::Vec3 & aPoint)
+{
+	if (_gauges.size() >= _maxGauges)
+	{
+		// oldest makes way
+		_markers->removeChild(_gauges.front()._marker.get());
+		_gauges.erase(_gauges.begin());
+	}
+
+	osg::Vec3d location = _sww->getGeoreferencedPoint(aPoint);
+
+	Gauge gauge;
+	gauge._point = aPoint;
+	gauge._location.set(location.x(), location.y());
+	gauge._colour = s_gaugeColours[_nextColour++ % s_numGaugeColours];
+	gauge._queued = false;
+	gauge._failed = false;
+	gauge._marker = createMarker(aPoint, gauge._colour);
+	_markers->addChild(gauge._marker.get());
+	_gauges.push_back(gauge);
+
+	_dirty = true;
+	extract();
+}
+
+
+void GaugePanel::clear()
+{
+	_markers->removeChildren(0, _markers->getNumChildren());
+	_gauges.clear();
+	_generation++;
+	_dirty = true;
+}
+
+
+void GaugePanel::setPlotType(SWWReader::TimeSeriesType aType)
+{
+	if (aType == _plotType)
+	{
+		return;
+	}
+
+	_plotType = aType;
+	_generation++;
+
+	for (unsigned int i=0; i<_gauges.size(); i++)
+	{
+		_gauges[i]._series = NULL;
+		_gauges[i]._queued = false;
+		_gauges[i]._failed = false;
+	}
+
+	_dirty = true;
+	extract();
+}
+
+
+void GaugePanel::extract()
+{
+	std::vector<osg::Vec2d> locations;
+	for (unsigned int i=0; i<_gauges.size(); i++)
+	{
+		if (!_gauges[i]._series.valid() && !_gauges[i]._queued)
+		{
+			locations.push_back(_gauges[i]._location);
+			_gauges[i]._queued = true;
+			_gauges[i]._failed = false;
+		}
+	}
+
+	if (!locations.empty())
+	{
+		_pool.add(new ExtractJob(this, _generation, _plotType, locations));
+	}
+}
+
+
+void GaugePanel::extracted(unsigned int aGeneration, const std::vector<osg::Vec2d> & aLocations, std::vector< osg::ref_ptr<osg::FloatArray> > & aSeries)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	for (unsigned int i=0; i<aLocations.size(); i++)
+	{
+		Result result;
+		result._generation = aGeneration;
+		result._location = aLocations[i];
+		result._series = aSeries[i];
+		_results.push_back(result);
+	}
+}
+
+
+void GaugePanel::update(HeadsUpDisplay * aHUD)
+{
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+		for (unsigned int r=0; r<_results.size(); r++)
+		{
+			if (_results[r]._generation != _generation)
+			{
+				continue;	// plot type changed or gauges cleared since it was queued
+			}
+
+			for (unsigned int i=0; i<_gauges.size(); i++)
+			{
+				if (!_gauges[i]._series.valid() && (_gauges[i]._location == _results[r]._location))
+				{
+					// a failed read is queued again by the next extract()
+					_gauges[i]._series = _results[r]._series;
+					_gauges[i]._failed = !_results[r]._series.valid();
+					_gauges[i]._queued = !_gauges[i]._failed;
+					_dirty = true;
+				}
+			}
+		}
+		_results.clear();
+	}
+
+	if (!_dirty)
+	{
+		return;
+	}
+	_dirty = false;
+
+	std::vector< osg::ref_ptr<osg::FloatArray> > series;
+	std::vector<osg::Vec4> colours;
+	bool failed = false, loading = false;
+	for (unsigned int i=0; i<_gauges.size(); i++)
+	{
+		if (_gauges[i]._series.valid())
+		{
+			series.push_back(_gauges[i]._series);
+			colours.push_back(_gauges[i]._colour);
+		}
+		failed = failed || _gauges[i]._failed;
+		loading = loading || (!_gauges[i]._series.valid() && _gauges[i]._queued);
+	}
+
+	if (failed)
+	{
+		aHUD->setStatus("gauges", "read failed");
+	}
+	else if (loading)
+	{
+		aHUD->setStatus("gauges", "loading");
+	}
+	else
+	{
+		char count[32];
+		sprintf(count, "%u", (unsigned int) _gauges.size());
+		aHUD->setStatus("gauges", _gauges.empty() ? std::string("none") : std::string(count));
+	}
+
+	aHUD->setGaugeData(series, colours, _sww->getTime(_sww->getNumberOfTimesteps()-1));
+}
+
+
+osg::Node * GaugePanel::createMarker(const osg::Vec3 & aPoint, const osg::Vec4 & aColour)
+{
+	osg::Geometry * geometry = new osg::Geometry;
+
+	osg::Vec3Array * vertices = new osg::Vec3Array;
+	vertices->push_back(aPoint - osg::Vec3(0, 0, MARKER_BELOW));
+	vertices->push_back(aPoint + osg::Vec3(0, 0, MARKER_ABOVE));
+	geometry->setVertexArray(vertices);
+
+	osg::Vec4Array * colours = new osg::Vec4Array;
+	colours->push_back(aColour);
+	geometry->setColorArray(colours);
+	geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+
+	// post with a dot on top
+	geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, 2));
+	geometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 1, 1));
+
+	osg::Geode * geode = new osg::Geode;
+	geode->addDrawable(geometry);
+
+	return geode;
+}
@@ -0,0 +1,120 @@
+/*
+    GaugePanel class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef GAUGEPANEL_H
+#define GAUGEPANEL_H
+
+#include <vector>
+#include <osg/Group>
+#include <OpenThreads/Mutex>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class HeadsUpDisplay;
+
+/**
+ * A set of gauges pinned to points on the mesh.
+ *
+ * Each gauge has a coloured marker in the 3D view and its timeseries overlaid on the HUD
+ * graph. Series are extracted on a background thread, all outstanding gauges in one
+ * batched read, and kept until the gauges or the plotted quantity change, so pinning a
+ * gauge never waits on the file.
+ */
+class GaugePanel
+{
+public:
+	/**
+	 * Constructor
+	 * @param aReader file the gauges read from
+	 * @param aMaxGauges most gauges pinned at once, the oldest is dropped to make room
+	 */
+	GaugePanel(SWWReader * aReader, unsigned int aMaxGauges = 6);
+	~GaugePanel();
+
+	/**
+	 * Pin a gauge.
+	 * @param aPoint gauge location in the reader's normalised coordinates, ie. a pick hit
+	 */
+	void addGauge(const osg::Vec3 & aPoint);
+
+	/**
+	 * Remove all gauges.
+	 */
+	void clear();
+
+	/**
+	 * Choose the quantity plotted, re-extracting every gauge if it changes.
+	 */
+	void setPlotType(SWWReader::TimeSeriesType aType);
+
+	/**
+	 * Pass newly extracted series, and whether any couldn't be read, on to the HUD.
+	 * Call once per frame.
+	 */
+	void update(HeadsUpDisplay * aHUD);
+
+	/**
+	 * Get the markers, drawn in the reader's normalised coordinates.
+	 */
+	osg::Group * getMarkers()	{	return _markers.get();	}
+
+	unsigned int getNumGauges()	{	return _gauges.size();	}
+
+protected:
+
+	struct Gauge
+	{
+		osg::Vec3 _point;	/**< Normalised coordinates */
+		osg::Vec2d _location;	/**< Georeferenced x, y, in double to keep a northing to the millimetre */
+		osg::Vec4 _colour;
+		osg::ref_ptr<osg::FloatArray> _series;	/**< NULL until extracted */
+		bool _queued;	/**< An extraction has been queued for it */
+		bool _failed;	/**< Its last extraction couldn't be read, it is tried again with the next */
+		osg::ref_ptr<osg::Node> _marker;
+	};
+
+	class ExtractJob;
+
+	/**
+	 * Queue a background read of the gauges that have no series yet.
+	 */
+	void extract();
+
+	/**
+	 * Called by the extraction thread with its results, a NULL series for each gauge of
+	 * a read that failed.
+	 */
+	void extracted(unsigned int aGeneration, const std::vector<osg::Vec2d> & aLocations, std::vector< osg::ref_ptr<osg::FloatArray> > & aSeries);
+
+	osg::Node * createMarker(const osg::Vec3 & aPoint, const osg::Vec4 & aColour);
+
+protected:
+	SWWReader * _sww;
+	unsigned int _maxGauges;
+	unsigned int _nextColour;
+	SWWReader::TimeSeriesType _plotType;
+
+	std::vector<Gauge> _gauges;
+	osg::ref_ptr<osg::Group> _markers;
+
+	WorkerPool _pool;	/**< One thread, extractions run in order */
+	unsigned int _generation;	/**< Bumped whenever queued results become stale */
+	bool _dirty;	/**< HUD needs the series again */
+
+	// results handed back from the extraction thread
+	OpenThreads::Mutex _mutex;
+	struct Result
+	{
+		unsigned int _generation;
+		osg::Vec2d _location;
+		osg::ref_ptr<osg::FloatArray> _series;
+	};
+	std::vector<Result> _results;
+};
+
+#endif  // GAUGEPANEL_H
@@ -21,6 +21,11 @@
 #include "hud.h"
 
 #define DEF_HUD_COLOUR   0.8, 0.8, 0.8, 1.0
+
+// small graphs down the right of the screen, beside the main graph
+#define SIDEGRAPH_WIDTH 344
+#define SIDEGRAPH_HEIGHT 80
+#define SIDEGRAPH_SPACING 180
 osg::Vec4 COLORBAR_TEXT_COL(0.8, 0.8, 0.8, 1.0);
 
 
@@ -30,7 +35,9 @@ osg::Vec4 COLORBAR_TEXT_COL(0.8, 0.8, 0.8, 1.0);
 
 // constructor
 HeadsUpDisplay::HeadsUpDisplay()
-	: _linegraph(NULL),
+	: _gaugetimelength(0),
+	_cursor(0),
+	_linegraph(NULL),
 	_font(NULL),
 	_status_pos(256, 32),
 	_status_visible(true),
@@ -66,6 +73,7 @@ HeadsUpDisplay::HeadsUpDisplay()
    _dirtytime = true;
 
    _dirtytimeseries = false;
+   _graphdata._numsamples = 0;
 
    // state
    osg::StateSet *state = _projection->getOrCreateStateSet();
@@ -88,17 +96,22 @@ HeadsUpDisplay::HeadsUpDisplay()
 
 
    {
-		osgText::Text* intensityscale = addText(osg::Vec3(48,300,0), *_font);
-		intensityscale->setText("> 2.0");
-		intensityscale->setColor(COLORBAR_TEXT_COL);
-		intensity_scale_node->addDrawable(intensityscale);
+		_intensity_title = addText(osg::Vec3(30,320,0), *_font);
+		_intensity_title->setColor(COLORBAR_TEXT_COL);
+		intensity_scale_node->addDrawable(_intensity_title);
+   }
+
+   {
+		_intensity_max = addText(osg::Vec3(48,300,0), *_font);
+		_intensity_max->setColor(COLORBAR_TEXT_COL);
+		intensity_scale_node->addDrawable(_intensity_max);
    }
 
    {
-		osgText::Text* intensityscale = addText(osg::Vec3(48,300-256,0), *_font);
-		intensityscale->setText("0.0");
-		intensityscale->setColor(COLORBAR_TEXT_COL);
-		intensity_scale_node->addDrawable(intensityscale);
+		_intensity_min = addText(osg::Vec3(48,300-256,0), *_font);
+		_intensity_min->setColor(COLORBAR_TEXT_COL);
+		intensity_scale_node->addDrawable(_intensity_min);
+		setIntensityScale("momentum", 0.0, 2.0, "m^2/s", true);
    }
 	intensity_scale_node->addDrawable(IntensityBar_Create(osg::Vec3(30,300,0), 16, 256));
 	_intensity_scale_switch->addChild(intensity_scale_node);
@@ -121,6 +134,11 @@ HeadsUpDisplay::~HeadsUpDisplay()
 		delete _linegraph;
 		_linegraph = NULL;
 	}
+
+	for (unsigned int g=0; g<_sidegraphs.size(); g++)
+	{
+		delete _sidegraphs[g]._graph;
+	}
 }
 
 
@@ -204,24 +222,93 @@ void HeadsUpDisplay::update()
 
    if (_dirtytimeseries)
    {
-		if (_linegraph)
-		{
-			_xfm->removeChild(_linegraph->getGeode());
-			delete(_linegraph);
-			_linegraph = NULL;
-		}
+		// picked series in black, pinned gauges in their own colours
+		std::vector<const osg::FloatArray*> series;
+		std::vector<osg::Vec4> colours;
+		std::string title("Gauges");
+		float timelength = _gaugetimelength;
+		unsigned int numsamples = 0;
 
 		osg::FloatArray * fa = _graphdata._data.get();
 		if (fa && fa->size()>1)
 		{
-			// If there is new data, show it.
+			series.push_back(fa);
+			colours.push_back(osg::Vec4(0.0, 0.0, 0.0, 1.0));
+			title = _graphdata._title;
+			timelength = _graphdata._timelength;
+			numsamples = _graphdata._numsamples;
+		}
+
+		for (unsigned int i=0; i<_gaugedata.size(); i++)
+		{
+			if (_gaugedata[i].valid() && _gaugedata[i]->size()>1)
+			{
+				series.push_back(_gaugedata[i].get());
+				colours.push_back(_gaugecolours[i]);
+			}
+		}
+
+		if (!series.empty() && !_linegraph)
+		{
+			// built on first use, then refilled in place
 			_linegraph = new LineGraph;
-			_xfm->addChild(_linegraph->setUpScene(_graphdata._title, fa, _graphdata._timelength, osg::Vec3(16.0f, ORTHO2D_HEIGHT*0.66f-24.0f, 0), osg::Vec2(ORTHO2D_WIDTH - 400, 400)));
+			_xfm->addChild(_linegraph->create(osg::Vec3(16.0f, ORTHO2D_HEIGHT*0.66f-24.0f, 0), osg::Vec2(ORTHO2D_WIDTH - 400, 400)));
+		}
+
+		if (_linegraph)
+		{
+			// If there is new data, show it.
+			_linegraph->setData(title, series, colours, timelength, numsamples);
+			_linegraph->getGeode()->setNodeMask(series.empty() ? 0 : ~0);
 		}
 
 		_dirtytimeseries = false;
    }
 
+	if (_linegraph)
+	{
+		// cheap, moves the cursor and changes the readouts only if the time has
+		_linegraph->setCursor(_cursor);
+	}
+
+	for (unsigned int g=0; g<_sidegraphs.size(); g++)
+	{
+		SideGraphData & side = _sidegraphs[g];
+		if (side._dirty)
+		{
+			osg::FloatArray * fa = side._series._data.get();
+			const bool hasData = fa && fa->size()>1;
+
+			if (hasData && !side._graph)
+			{
+				side._graph = new LineGraph;
+				_xfm->addChild(side._graph->create(osg::Vec3(ORTHO2D_WIDTH - SIDEGRAPH_WIDTH - 16.0f, ORTHO2D_HEIGHT*0.66f-24.0f - g*SIDEGRAPH_SPACING, 0),
+												   osg::Vec2(SIDEGRAPH_WIDTH, SIDEGRAPH_HEIGHT)));
+			}
+
+			if (side._graph)
+			{
+				std::vector<const osg::FloatArray*> series;
+				std::vector<osg::Vec4> colours;
+				if (hasData)
+				{
+					series.push_back(fa);
+					colours.push_back(osg::Vec4(0.0, 0.0, 0.0, 1.0));
+				}
+				side._graph->setUnits(side._units);
+				side._graph->setData(side._series._title, series, colours, side._series._timelength, side._series._numsamples);
+				side._graph->getGeode()->setNodeMask(hasData ? ~0 : 0);
+			}
+
+			side._dirty = false;
+		}
+
+		if (side._graph)
+		{
+			side._graph->setCursor(_cursor);
+		}
+	}
+
 	if (_status_visible_dirty)
 	{
 		_status_visible_dirty = false;
@@ -236,12 +323,56 @@ void HeadsUpDisplay::update()
 	}
 }
 
-void HeadsUpDisplay::setTimeSeriesData(osg::ref_ptr<osg::FloatArray> aData, float aTimeLength, std::string aTitle)
+void HeadsUpDisplay::setTimeSeriesData(osg::ref_ptr<osg::FloatArray> aData, float aTimeLength, std::string aTitle, unsigned int aNumSamples)
 {
 	_dirtytimeseries = true;
 	_graphdata._data = aData;
 	_graphdata._timelength = aTimeLength;
 	_graphdata._title = aTitle;
+	_graphdata._numsamples = aNumSamples;
+}
+
+
+void HeadsUpDisplay::setGaugeData(const std::vector< osg::ref_ptr<osg::FloatArray> > & aData, const std::vector<osg::Vec4> & aColours, float aTimeLength)
+{
+	_dirtytimeseries = true;
+	_gaugedata = aData;
+	_gaugecolours = aColours;
+	_gaugetimelength = aTimeLength;
+}
+
+
+void HeadsUpDisplay::setSideGraph(unsigned int aIndex, const std::string & aTitle, osg::ref_ptr<osg::FloatArray> aData, const std::string & aUnits,
+								  float aTimeLength, unsigned int aNumSamples)
+{
+	if (aIndex >= _sidegraphs.size())
+	{
+		SideGraphData none;
+		none._series._timelength = 0;
+		none._series._numsamples = 0;
+		none._graph = NULL;
+		none._dirty = false;
+		_sidegraphs.resize(aIndex+1, none);
+	}
+
+	SideGraphData & side = _sidegraphs[aIndex];
+	side._series._data = aData;
+	side._series._title = aTitle;
+	side._series._timelength = aTimeLength;
+	side._series._numsamples = aNumSamples;
+	side._units = aUnits;
+	side._dirty = true;
+}
+
+
+void HeadsUpDisplay::setIntensityScale(const std::string & aTitle, float aMin, float aMax, const std::string & aUnits, bool aClamped)
+{
+	char label[64];
+	sprintf(label, "%s%.3g %s", aClamped ? "> " : "", aMax, aUnits.c_str());
+	_intensity_max->setText(label);
+	sprintf(label, "%.3g", aMin);
+	_intensity_min->setText(label);
+	_intensity_title->setText(aTitle);
 }
 
 
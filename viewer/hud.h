@@ -45,6 +45,16 @@ public:
 		virtual void setStatus(const std::string & aField, const std::string & aStatus);
 
 		virtual void setShowIntensityScale(bool aSet)	{ if (aSet) _intensity_scale_switch->setAllChildrenOn(); else _intensity_scale_switch->setAllChildrenOff();	}
+
+		/**
+		 * Relabel the colour bar for the quantity it shows.
+		 * @param aTitle name of the quantity
+		 * @param aMin value at the bottom of the bar
+		 * @param aMax value at the top of the bar
+		 * @param aUnits units of the quantity, empty if dimensionless
+		 * @param aClamped values above aMax are shown in the top colour
+		 */
+		virtual void setIntensityScale(const std::string & aTitle, float aMin, float aMax, const std::string & aUnits, bool aClamped = false);
 		
 		/**
 		 * Set the HUD text as visible or invisible
@@ -71,8 +81,33 @@ public:
 		/**
 		 * Set time series data.
 		 * @param aData 1D timeseries array.
+		 * @param aNumSamples full length of a series still being read, 0 if aData is complete
+		 */
+		void setTimeSeriesData(osg::ref_ptr<osg::FloatArray> aData, float aTimeLength, std::string aTitle, unsigned int aNumSamples = 0);
+
+		/**
+		 * Set the series of pinned gauges, overlaid on the graph with any picked series.
+		 * @param aData one series per gauge
+		 * @param aColours line colour of each gauge
 		 */
-		void setTimeSeriesData(osg::ref_ptr<osg::FloatArray> aData, float aTimeLength, std::string aTitle);
+		void setGaugeData(const std::vector< osg::ref_ptr<osg::FloatArray> > & aData, const std::vector<osg::Vec4> & aColours, float aTimeLength);
+
+		/**
+		 * Move the graph's time cursor.
+		 * @param aFraction position along the time axis, 0 to 1
+		 */
+		void setTimeCursor(float aFraction)	{	_cursor = aFraction;	}
+
+		/**
+		 * Set the series of one of the small graphs down the right of the screen, which
+		 * follow the same time cursor as the main graph.
+		 * @param aIndex graph, counting down from the top
+		 * @param aData series, NULL to hide the graph
+		 * @param aUnits units of the values
+		 * @param aNumSamples samples the time axis spans, more than aData while it is still being computed
+		 */
+		void setSideGraph(unsigned int aIndex, const std::string & aTitle, osg::ref_ptr<osg::FloatArray> aData, const std::string & aUnits,
+						  float aTimeLength, unsigned int aNumSamples);
 
 protected:
 	/**
@@ -98,6 +133,15 @@ protected:
 		osg::ref_ptr<osg::FloatArray> _data;
 		float _timelength;
 		std::string _title;
+		unsigned int _numsamples;
+	};
+
+	struct SideGraphData
+	{
+		TimeseriesGraphData _series;
+		std::string _units;
+		class LineGraph * _graph;	/**< Built on first use */
+		bool _dirty;
 	};
 
 	struct StatusData
@@ -111,10 +155,18 @@ protected:
 
 
 	TimeseriesGraphData _graphdata;
+	std::vector< osg::ref_ptr<osg::FloatArray> > _gaugedata;
+	std::vector<osg::Vec4> _gaugecolours;
+	float _gaugetimelength;
+	float _cursor;	/**< Time cursor position, 0 to 1 */
 	class LineGraph * _linegraph;
+	std::vector<SideGraphData> _sidegraphs;
 
     osg::Projection* _projection;
 	osg::Switch * _intensity_scale_switch;
+	osgText::Text * _intensity_title;	/**< Quantity the colour bar shows */
+	osgText::Text * _intensity_max;	/**< Value at the top of the colour bar */
+	osgText::Text * _intensity_min;	/**< Value at the bottom of the colour bar */
 	osg::Switch * _text_switch;	/**< Switch text off and on */
     osgText::Text* _titletext;
     osgText::Text* _timetext;
@@ -13,9 +13,19 @@ KeyboardEventHandler::KeyboardEventHandler( int nTimesteps, float tps)	:
 	_return_origin(false),
 	_wireframeMode(WF_NONE),
 	_gridMode(GM_NONE),
+	_colourQuantity(DerivedQuantity::DQ_MOMENTUM),
 	_picked_poly(-1),
 	_mouseclicked(false),
-	_shift_held(false)
+	_pingauge(false),
+	_cleargauges(false),
+	_cycleenvelope(false),
+	_togglearrows(false),
+	_toggletotals(false),
+	_cyclerun(false),
+	_shift_held(false),
+	_sww(NULL),
+	_follow(false),
+	_followWindow(0)
 {
    _paused = DEF_PAUSED_START;
    _direction = 1;
@@ -42,6 +52,14 @@ void KeyboardEventHandler::getAppUsage(osg::ApplicationUsage& usage)
     usage.addKeyboardMouseBinding("g","Toggle grid");
     usage.addKeyboardMouseBinding("i","Toggle information HUD");
 	usage.addKeyboardMouseBinding("w","Cycle wireframe modes");
+	usage.addKeyboardMouseBinding("q","Cycle the quantity the water is coloured by");
+	usage.addKeyboardMouseBinding("p","Pin a gauge at the shift-clicked point");
+	usage.addKeyboardMouseBinding("u","Remove all gauges");
+	usage.addKeyboardMouseBinding("e","Cycle maximum depth, speed and stage layers");
+	usage.addKeyboardMouseBinding("a","Toggle flow direction arrows");
+	usage.addKeyboardMouseBinding("m","Toggle graphs of wet area, water volume and peak depth over time");
+	usage.addKeyboardMouseBinding("n","Toggle following the newest timestep of a growing file");
+	usage.addKeyboardMouseBinding("v","Show the next run of those compared");
     usage.addKeyboardMouseBinding("1","Toggle recording.");
     usage.addKeyboardMouseBinding("2","Toggle playback of recorded information");
     usage.addKeyboardMouseBinding("3","Save recorded macro to \"movie.swm\"");
@@ -145,6 +163,15 @@ bool KeyboardEventHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIAc
 					return true;
 				}
 
+				case 'q':
+				{
+					int cq = int(_colourQuantity);
+					cq++;
+					cq %= int(DerivedQuantity::DQ_NUM_OF);
+					_colourQuantity = (DerivedQuantity::Type)cq;
+					return true;
+				}
+
 				case osgGA::GUIEventAdapter::KEY_Right:
 					if( _paused )
 					{
@@ -184,6 +211,34 @@ bool KeyboardEventHandler::handle(const osgGA::GUIEventAdapter& ea, osgGA::GUIAc
 					g_hud->setVisible(!g_hud->isVisible());
 					return true;
 
+				case 'p':
+					_pingauge = true;
+					return true;
+
+				case 'u':
+					_cleargauges = true;
+					return true;
+
+				case 'e':
+					_cycleenvelope = true;
+					return true;
+
+				case 'a':
+					_togglearrows = true;
+					return true;
+
+				case 'm':
+					_toggletotals = true;
+					return true;
+
+				case 'n':
+					setFollow(!_follow, _followWindow);
+					return true;
+
+				case 'v':
+					_cyclerun = true;
+					return true;
+
 				case '1':
 					_togglerecording = true;
 					return true;
@@ -211,6 +266,24 @@ void KeyboardEventHandler::setTime( float time)
 {
    //std::cout << "setTime: " << time << std::endl;
    //std::cout << "setTime: " << _tps << std::endl;
+   if( _follow && !isPaused() )
+   {
+	   if( _followWindow <= 1 )
+	   {
+		   // newest timestep as soon as the file has it, rather than at the next tick
+		   _timestep = _ntimesteps-1;
+	   }
+	   else if( time - _prevtime > 1.0/_tps )
+	   {
+		   // loop over the newest timesteps, the window moving on as the file grows
+		   _prevtime = time;
+		   int first = _ntimesteps - _followWindow;
+		   if( first < 0 ) first = 0;
+		   _timestep = (_timestep < first || _timestep >= _ntimesteps-1) ? first : _timestep+1;
+	   }
+	   return;
+   }
+
    if( !isPaused()  &&  time - _prevtime > 1.0/_tps )
    {
 	   // If we are in freerunning mode, this code will kick in and advance the timestep automatically
@@ -228,6 +301,34 @@ void KeyboardEventHandler::setTime( float time)
 }
 
 
+void KeyboardEventHandler::setNumTimesteps(int aNumTimesteps)
+{
+	if (aNumTimesteps <= 0 || aNumTimesteps == _ntimesteps)
+	{
+		return;
+	}
+
+	// grown by a running simulation, or reloaded shorter
+	_ntimesteps = aNumTimesteps;
+	if (_timestep >= _ntimesteps)
+	{
+		_timestep = _ntimesteps-1;
+	}
+}
+
+
+void KeyboardEventHandler::setFollow(bool aFollow, int aWindow)
+{
+	_follow = aFollow;
+	_followWindow = (aWindow > 0) ? aWindow : 0;
+	if (_follow)
+	{
+		_paused = false;
+		_timestep = _ntimesteps-1;
+	}
+}
+
+
 bool KeyboardEventHandler::toggleCulling()
 {
    if( _toggleculling )
@@ -275,28 +376,26 @@ bool KeyboardEventHandler::toggleSave()
 // Perform a pick operation.
 int KeyboardEventHandler::pick( const double x, const double y, osgViewer::Viewer* viewer )
 {
-	if (!viewer->getSceneData())
+	if (!_sww || !_model.valid())
 	{
 		// Nothing to pick.
 		return -1;
 	}
 
-	osgUtil::LineSegmentIntersector* picker = new osgUtil::LineSegmentIntersector(
-						osgUtil::Intersector::PROJECTION, x, y);
-
-	osgUtil::IntersectionVisitor iv( picker );
-	viewer->getCamera()->accept( iv );
+	// unproject the mouse position to a segment through the view volume
+	osg::Camera * camera = viewer->getCamera();
+	osg::Matrixd inverseVP = osg::Matrixd::inverse( camera->getViewMatrix() * camera->getProjectionMatrix() );
+	osg::Vec3d nearpoint = osg::Vec3d(x, y, -1.0) * inverseVP;
+	osg::Vec3d farpoint = osg::Vec3d(x, y, 1.0) * inverseVP;
 
-	if (picker->containsIntersections())
+	// into the model's coordinates, which undoes the vertical scale
+	osg::MatrixList worldmatrices = _model->getWorldMatrices();
+	if (worldmatrices.empty())
 	{
-		osgUtil::LineSegmentIntersector::Intersection intersection = picker->getFirstIntersection();
-
-		if (intersection.nodePath.back()->getName() == "watersurface")
-		{
-			// only care if the water surface was clicked
-			return intersection.primitiveIndex;
-		}
+		return -1;
 	}
+	osg::Matrixd worldToModel = osg::Matrixd::inverse( worldmatrices.front() );
 
-	return -1;
+	// stage or bedslope, whichever is hit first, so dry land can be picked too
+	return _sww->pick( nearpoint * worldToModel, farpoint * worldToModel, &_picked_point );
 }
\ No newline at end of file
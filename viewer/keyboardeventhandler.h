@@ -9,6 +9,7 @@
 #define KEYBOARDEVENTHANDLER_H
 
 #include <project.h>
+#include <swwreader.h>
 #include <osgGA/GUIEventHandler>
 #include <osgViewer/Viewer>
 
@@ -29,14 +30,42 @@ public:
     virtual bool toggleCulling();
     virtual bool toggleRecording();
 	virtual GridMode getGridMode()	{	return _gridMode;	}
+	virtual DerivedQuantity::Type getColourQuantity()	{	return _colourQuantity;	}
     virtual bool togglePlayback();
     virtual bool toggleSave();
 	virtual bool checkWriteFrame() { bool curr = _writeframe; _writeframe = false; return curr;	}
 	virtual bool checkReturnOrigin() { bool curr = _return_origin; _return_origin = false; return curr;	}
 	virtual bool checkMouseClicked() { bool curr = _mouseclicked; _mouseclicked = false; return curr;	}
+	virtual bool checkPinGauge() { bool curr = _pingauge; _pingauge = false; return curr;	}
+	virtual bool checkClearGauges() { bool curr = _cleargauges; _cleargauges = false; return curr;	}
+	virtual bool checkCycleEnvelope() { bool curr = _cycleenvelope; _cycleenvelope = false; return curr;	}
+	virtual bool checkToggleArrows() { bool curr = _togglearrows; _togglearrows = false; return curr;	}
+	virtual bool checkCycleRun() { bool curr = _cyclerun; _cyclerun = false; return curr;	}
+	virtual bool checkToggleTotals() { bool curr = _toggletotals; _toggletotals = false; return curr;	}
 	virtual int	 getSelectedPoly()	{ return _picked_poly;	}
+	virtual osg::Vec3 getSelectedPoint()	{ return _picked_point;	}	/**< Where the selected poly was clicked, in the reader's normalised coordinates */
     virtual int	 getTimestep(){return (unsigned int) _timestep;}
 
+	/**
+	 * Change the number of timesteps stepped through, as the file grows.
+	 */
+	virtual void setNumTimesteps(int aNumTimesteps);
+
+	/**
+	 * Keep to the newest timestep as the file grows, while not paused.
+	 * @param aFollow follow the newest timestep
+	 * @param aWindow loop over this many of the newest timesteps at the playback rate, 0 to show only the newest
+	 */
+	virtual void setFollow(bool aFollow, int aWindow = 0);
+	virtual bool isFollowing()	{	return _follow;	}
+
+	/**
+	 * Set the mesh that shift-clicks pick triangles from.
+	 * @param aReader reader holding the mesh and its spatial index
+	 * @param aModel node whose children are drawn in the reader's normalised coordinates
+	 */
+	void setPickTarget(SWWReader * aReader, osg::Node * aModel)	{	_sww = aReader;	_model = aModel;	}
+
 	/**
 	 * Set time in seconds
 	 */
@@ -49,8 +78,8 @@ public:
 
 private:
 	/**
-	 * pick out a piece of geometry from the scene
-	 * @return index of water polygon that was clicked on
+	 * pick a triangle of the mesh under the mouse
+	 * @return index of the triangle that was clicked on, -1 for none
 	 */
 	int pick(const double x, const double y, osgViewer::Viewer* viewer);
 
@@ -67,11 +96,23 @@ private:
 	bool _return_origin;
 	WireframeMode _wireframeMode;	/**< Wireframe mode */
 	GridMode _gridMode;
+	DerivedQuantity::Type _colourQuantity;	/**< Quantity the water is coloured by */
 	int _picked_poly;	/**< Which polygon was picked by the mouse. */
+	osg::Vec3 _picked_point;	/**< Point on the polygon that was picked. */
 	bool _mouseclicked;
+	bool _pingauge;	/**< Pin a gauge at the selected point */
+	bool _cleargauges;
+	bool _cycleenvelope;	/**< Show the next envelope layer */
+	bool _togglearrows;	/**< Show or hide the flow arrows */
+	bool _toggletotals;	/**< Show or hide the domain totals graphs */
+	bool _cyclerun;	/**< Show the next of the runs compared */
 	bool _shift_held;	/**< Is the shift key held down. */
 	bool _toggleplayback;
 	bool _togglesave;
+	SWWReader * _sww;	/**< Mesh to pick from */
+	osg::ref_ptr<osg::Node> _model;	/**< Transform the mesh is drawn under */
+	bool _follow;	/**< Keep to the newest timesteps */
+	int _followWindow;	/**< Newest timesteps looped over while following */
 };
 
 #endif  // KEYBOARDEVENTHANDLER_H
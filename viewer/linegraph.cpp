@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iomanip>
 #include <stdio.h>
+#include <float.h>
 
 #include <osg/io_utils>
 #include <osg/Export>
@@ -21,9 +22,17 @@ static const char * FONT_NAME = "fonts/arial.ttf";
 
 static const float MAXMIN_ROUNDING = 10.0f;	//Rounding of Y scale 1 is to 0dp, 10 is to 1dp
 static const char *PRECISION = "%0.2f m";	// Formatting string for precision
+static const float CHARACTER_SIZE = 20.0f;
+static const float BACKGROUND_MARGIN = 12.0f;
+static const float READOUT_WIDTH = 80.0f;	// Room left for a readout left of the cursor
+static const unsigned int UNITS_GRID_LINES = 10;	// Horizontal grid lines of a graph with units
 
 LineGraph::LineGraph():
-	_geode(NULL)
+	_numSamples(0),
+	_minY(0),
+	_rangeY(1),
+	_cursorFraction(0),
+	_readoutDirty(false)
 {
 }
 
@@ -50,160 +59,301 @@ osg::Geometry* LineGraph::createBackgroundRectangle(const osg::Vec3& pos, const
     geometry->setColorArray(colors);
     geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
 
-    osg::DrawElementsUInt *base =  new osg::DrawElementsUInt(osg::PrimitiveSet::QUADS,0);
-    base->push_back(0);
-    base->push_back(1);
-    base->push_back(2);
-    base->push_back(3);
-
-    geometry->addPrimitiveSet(base);
+    geometry->addPrimitiveSet(new osg::DrawArrays(osg::PrimitiveSet::QUADS, 0, 4));
 
     return geometry;
 }
 
 
-osg::Geode * LineGraph::setUpScene(const std::string & aLabel, const osg::FloatArray * aData, float aTimeLength, const osg::Vec3 & aPos, const osg::Vec2 & aSize)
+osgText::Text* LineGraph::createLabel(const osg::Vec3& pos, float size, const osg::Vec4& colour)
 {
-	assert(!_geode);
+	// one font for every label, rather than a reload per label
+	static osg::ref_ptr<osgText::Font> font = osgText::readFontFile(FONT_NAME);
 
-    const float characterSize = 20.0f;
+	osgText::Text * text = new osgText::Text;
+	text->setDataVariance(osg::Object::DYNAMIC);
+	text->setColor(colour);
+	text->setFont(font.get());
+	text->setCharacterSize(size);
+	text->setPosition(pos);
 
-    // rescale to put the data to be graphed between 0 and 1
-    osg::FloatArray *normalised_data = NULL; 
-    
-    if (aData)
-    {
-        normalised_data = new osg::FloatArray(*aData, osg::CopyOp::DEEP_COPY_ALL);
-    }
+	_geode->addDrawable(text);
+
+	return text;
+}
+
+
+osg::Geode * LineGraph::create(const osg::Vec3 & aPos, const osg::Vec2 & aSize)
+{
+	assert(!_geode.valid());
 
 	_geode = new osg::Geode;
+	_geode->setName("linegraph");
 
 	osg::Vec3 pos = aPos;
     osg::Vec4 backgroundColor(1.0, 1.0, 1.0f, 1.0);
     osg::Vec4 graphColour(0.0, 0.0, 0.0f, 1.0);
 	osg::Vec4 lineColour(0.2, 0.2, 0.5f, 1.0);
+	osg::Vec4 cursorColour(0.8, 0.1, 0.1f, 1.0);
 
 	// --- label
-    {
-		osg::ref_ptr<osgText::Text> graphLabel = new osgText::Text;
-        _geode->addDrawable( graphLabel.get() );
+	_label = createLabel(pos, CHARACTER_SIZE, graphColour);
+	pos.y() -= CHARACTER_SIZE*1.5f;
+
+	_graphPos = pos;
+	_graphSize.set(aSize.x() - BACKGROUND_MARGIN*2, aSize.y() - BACKGROUND_MARGIN*2);
+
+	// drawn only while there is data
+	_background = createBackgroundRectangle(pos + osg::Vec3(-BACKGROUND_MARGIN, BACKGROUND_MARGIN+CHARACTER_SIZE*3.0f, 0),
+			aSize.x(), aSize.y()+ CHARACTER_SIZE*4.5f, backgroundColor);
+	_geode->addDrawable(_background.get());
+
+	// lines
+	_grid = createGraphGrid(lineColour);
+	_geode->addDrawable(_grid.get());
+
+	// graph labels
+	_maxLabel = createLabel(pos + osg::Vec3(0, 5.0f, 0), CHARACTER_SIZE/1.5f, graphColour);
+	_minLabel = createLabel(pos + osg::Vec3(0, - aSize.y(), 0), CHARACTER_SIZE/1.5f, graphColour);
+	_timeLabel = createLabel(pos + osg::Vec3(aSize.x() - BACKGROUND_MARGIN*2 - 80, -aSize.y(), 0), CHARACTER_SIZE/1.5f, graphColour);
+
+	// time cursor, moved in place by setCursor()
+	_cursor = new osg::Geometry;
+	_cursor->setUseDisplayList(false);
+	_cursor->setDataVariance(osg::Object::DYNAMIC);
+	osg::Vec3Array * vertices = new osg::Vec3Array(2);
+	_cursor->setVertexArray(vertices);
+	osg::Vec4Array * colours = new osg::Vec4Array;
+	colours->push_back(cursorColour);
+	_cursor->setColorArray(colours);
+	_cursor->setColorBinding(osg::Geometry::BIND_OVERALL);
+	_cursor->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, 0));
+	_geode->addDrawable(_cursor.get());
+
+	std::vector<const osg::FloatArray*> none;
+	setData("", none, std::vector<osg::Vec4>(), 0);
+
+	return _geode.get();
+}
 
-        graphLabel->setColor(graphColour);
-        graphLabel->setFont(FONT_NAME);
-        graphLabel->setCharacterSize(characterSize);
-        graphLabel->setPosition(pos);
-        graphLabel->setText(aLabel);
 
-        pos.y() -= characterSize*1.5f;
-    }
+osg::Geode * LineGraph::setUpScene(const std::string & aLabel, const osg::FloatArray * aData, float aTimeLength, const osg::Vec3 & aPos, const osg::Vec2 & aSize)
+{
+	create(aPos, aSize);
 
-    float backgroundMargin = 12;
+	std::vector<const osg::FloatArray*> data;
+	std::vector<osg::Vec4> colours;
 
 	if (aData)
 	{
-		_geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, backgroundMargin+characterSize*3.0f, 0),
-				aSize.x(), aSize.y()+ characterSize*4.5f, backgroundColor) );
+		data.push_back(aData);
+		colours.push_back(osg::Vec4(0.0, 0.0, 0.0f, 1.0));
 	}
 
-	float max_y = 0;
-	float min_y = 99999;
+	setData(aLabel, data, colours, aTimeLength);
+
+	return _geode.get();
+}
+
+
+void LineGraph::setData(const std::string & aLabel, const std::vector<const osg::FloatArray*> & aData, const std::vector<osg::Vec4> & aColours, float aTimeLength,
+						unsigned int aNumSamples)
+{
+	assert(_geode.valid());
+	assert(aData.size() == aColours.size());
 
-    if (aData)
+	_series.clear();
+	_numSamples = aNumSamples;
+	std::vector<osg::Vec4> colours;
+	for (unsigned int s=0; s<aData.size(); s++)
 	{
-		for(unsigned int i=0; i<aData->size(); ++i)
+		if (aData[s] && aData[s]->size() > 1)
 		{
-			float v = ceil(aData->at(i)*MAXMIN_ROUNDING)/MAXMIN_ROUNDING;
+			_series.push_back(aData[s]);
+			colours.push_back(aColours[s]);
+			_numSamples = osg::maximum(_numSamples, (unsigned int) aData[s]->size());
+		}
+	}
+
+	const bool hasData = !_series.empty();
+
+	_label->setText(aLabel);
+
+	const bool metres = _units.empty();
+	float max_y = metres ? 0 : -FLT_MAX;
+	float min_y = metres ? 99999 : FLT_MAX;
+
+	// one scale for all the series
+	for (unsigned int s=0; s<_series.size(); s++)
+	{
+		const osg::FloatArray * data = _series[s].get();
+		for(unsigned int i=0; i<data->size(); ++i)
+		{
+			float v = metres ? ceil(data->at(i)*MAXMIN_ROUNDING)/MAXMIN_ROUNDING : data->at(i);
 			max_y = osg::maximum(v, max_y);
 
-			float low = floor(aData->at(i)*MAXMIN_ROUNDING)/MAXMIN_ROUNDING;
+			float low = metres ? floor(data->at(i)*MAXMIN_ROUNDING)/MAXMIN_ROUNDING : data->at(i);
 			min_y = osg::minimum(low, min_y);
 		}
+	}
 
-        float range_y = osg::maximum(max_y-min_y, 0.0001f);
+	if (!metres && !hasData)
+	{
+		min_y = max_y = 0;
+	}
 
-        for(unsigned int i=0; i<aData->size(); ++i)
-        {
-            // Normalise the data between min and max
-            normalised_data->at(i) = (aData->at(i)-min_y)/range_y;   
-            assert((normalised_data->at(i) >=0.0f) && (normalised_data->at(i) <=1.0f));
-        }
+	_minY = min_y;
+	_rangeY = osg::maximum(max_y-min_y, 0.0001f);
 
+	static_cast<osg::DrawArrays*>(_background->getPrimitiveSet(0))->setCount(hasData ? 4 : 0);
+	_background->dirtyDisplayList();
+	static_cast<osg::DrawArrays*>(_cursor->getPrimitiveSet(0))->setCount(hasData ? 2 : 0);
 
-		// lines
-		_geode->addDrawable(createGraphGrid(pos + osg::Vec3(0, 0, 0),
-				aSize.x() - backgroundMargin*2, aSize.y() - backgroundMargin*2, lineColour, 20, (max_y-min_y)*MAXMIN_ROUNDING*2) );
+	if (metres)
+	{
+		updateGraphGrid(20, hasData ? (unsigned int) ((max_y-min_y)*MAXMIN_ROUNDING*2 + 0.5f) : 20);
+	}
+	else
+	{
+		updateGraphGrid(20, UNITS_GRID_LINES);
+	}
 
+	// graph, reusing the line strips of the last data
+	for (unsigned int s=0; s<_series.size(); s++)
+	{
+		if (s == _lines.size())
+		{
+			osg::Geometry * geometry = new osg::Geometry;
+			geometry->setUseDisplayList(false);
+			geometry->setUseVertexBufferObjects(true);
+			geometry->setDataVariance(osg::Object::DYNAMIC);
+			geometry->setVertexArray(new osg::Vec3Array);
+			geometry->setColorArray(new osg::Vec4Array(1));
+			geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+			geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINE_STRIP, 0, 0));
+			_geode->addDrawable(geometry);
+			_lines.push_back(geometry);
+
+			_readouts.push_back(createLabel(osg::Vec3(), CHARACTER_SIZE/1.5f, osg::Vec4()));
+			_readoutText.push_back("");
+		}
 
-		// graph labels
-		osg::ref_ptr<osgText::Text> graphLabel = new osgText::Text;
-        _geode->addDrawable( graphLabel.get() );
+		osg::Vec4Array * lineColours = static_cast<osg::Vec4Array*>(_lines[s]->getColorArray());
+		(*lineColours)[0] = colours[s];
+		lineColours->dirty();
+		updateGraphGeometry(_lines[s].get(), _series[s].get());
 
-		char label[32];
-		sprintf(label, PRECISION, min_y + range_y);
+		_readouts[s]->setColor(colours[s]);
+	}
 
-        graphLabel->setColor(graphColour);
-        graphLabel->setFont(FONT_NAME);
-        graphLabel->setCharacterSize(characterSize/1.5f);
-        graphLabel->setPosition(pos + osg::Vec3(0, 5.0f, 0));
-        graphLabel->setText(label);
-    }
+	for (unsigned int s=_series.size(); s<_lines.size(); s++)
+	{
+		static_cast<osg::DrawArrays*>(_lines[s]->getPrimitiveSet(0))->setCount(0);
+		_readouts[s]->setText("");
+		_readoutText[s].clear();
+	}
+
+	char label[64];
+	if (hasData)
+	{
+		formatValue(min_y + _rangeY, label);
+		_maxLabel->setText(label);
+	}
 	else
 	{
-		// lines
-		_geode->addDrawable(createGraphGrid(pos + osg::Vec3(0, 0, 0),
-				aSize.x() - backgroundMargin*2, aSize.y() - backgroundMargin*2, lineColour, 20, 20) );
+		_maxLabel->setText("");
 	}
 
-    {
-		// graph label for min y
-		char label[32];
-		sprintf(label, PRECISION, min_y);
-        
-		osg::ref_ptr<osgText::Text> graphLabel = new osgText::Text;
-        _geode->addDrawable( graphLabel.get() );
-
-        graphLabel->setColor(graphColour);
-        graphLabel->setFont(FONT_NAME);
-        graphLabel->setCharacterSize(characterSize/1.5f);
-        graphLabel->setPosition(pos + osg::Vec3(0, - aSize.y(), 0));
-        graphLabel->setText(label);
-    }
+	formatValue(min_y, label);
+	_minLabel->setText(label);
 
-    {
-		// graph labels
-		osg::ref_ptr<osgText::Text> graphLabel = new osgText::Text;
-        _geode->addDrawable( graphLabel.get() );
-
-		char label[32];
-		sprintf(label, "%0.2f sec", aTimeLength);
-
-        graphLabel->setColor(graphColour);
-        graphLabel->setFont(FONT_NAME);
-        graphLabel->setCharacterSize(characterSize/1.5f);
-        graphLabel->setPosition(pos + osg::Vec3(aSize.x() - backgroundMargin*2 - 80, -aSize.y(), 0));
-        graphLabel->setText(label);
-    }
+	sprintf(label, "%0.2f sec", aTimeLength);
+	_timeLabel->setText(label);
 
-	if (aData)
+	_readoutDirty = true;
+	setCursor(_cursorFraction);
+}
+
+
+void LineGraph::setCursor(float aFraction)
+{
+	if (!_cursor.valid())
 	{
-		// graph
-		_geode->addDrawable(createGraphGeometry(pos + osg::Vec3(0, 0, 0),
-				aSize.x() - backgroundMargin*2, aSize.y() - backgroundMargin*2, graphColour, normalised_data) );
+		return;
 	}
 
-	_geode->setName("linegraph");
+	aFraction = osg::clampBetween(aFraction, 0.0f, 1.0f);
+	if (aFraction == _cursorFraction && !_readoutDirty)
+	{
+		return;
+	}
+	_cursorFraction = aFraction;
+	_readoutDirty = false;
+
+	osg::Vec3Array * vertices = static_cast<osg::Vec3Array*>(_cursor->getVertexArray());
+	(*vertices)[0] = _graphPos + osg::Vec3(aFraction*_graphSize.x(), 0, 0);
+	(*vertices)[1] = _graphPos + osg::Vec3(aFraction*_graphSize.x(), -_graphSize.y(), 0);
+	vertices->dirty();
+	_cursor->dirtyBound();
 
-	return _geode;
+	// readouts beside the cursor, on its left near the end of the axis
+	float x = aFraction*_graphSize.x() + (aFraction > 0.85f ? -READOUT_WIDTH : 6.0f);
+
+	for (unsigned int s=0; s<_series.size(); s++)
+	{
+		const osg::FloatArray * data = _series[s].get();
+		double index = aFraction * (_numSamples-1);
+		unsigned int i = (unsigned int) index;
+
+		char label[64];
+		label[0] = '\0';
+		if (i < data->size())
+		{
+			float value = data->at(i);
+			if (i+1 < data->size())
+			{
+				value += (data->at(i+1) - value) * (float) (index - i);
+			}
+			formatValue(value, label);
+		}
+
+		if (_readoutText[s] != label)
+		{
+			_readoutText[s] = label;
+			_readouts[s]->setText(_readoutText[s]);
+		}
+		_readouts[s]->setPosition(_graphPos + osg::Vec3(x, -(s+1)*CHARACTER_SIZE*0.8f, 0));
+	}
 }
 
 
-osg::Geometry* LineGraph::createGraphGrid(const osg::Vec3& pos, const float width, const float height, osg::Vec4& color, float aXCount, float aYCount)
+osg::Geometry* LineGraph::createGraphGrid(const osg::Vec4& color)
 {
     osg::Geometry* geometry = new osg::Geometry;
-    osg::Vec3Array* vertices = new osg::Vec3Array;
+	geometry->setUseDisplayList(false);
+	geometry->setDataVariance(osg::Object::DYNAMIC);
+    geometry->setVertexArray(new osg::Vec3Array);
 
-    geometry->setVertexArray(vertices);
-    vertices->reserve(aXCount*2 + aYCount*2);
+    osg::Vec4Array* colors = new osg::Vec4Array;
+    colors->push_back(color);
+    geometry->setColorArray(colors);
+    geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, 0));
+
+    return geometry;
+}
+
+
+void LineGraph::updateGraphGrid(unsigned int aXCount, unsigned int aYCount)
+{
+	const osg::Vec3 & pos = _graphPos;
+	const float width = _graphSize.x();
+	const float height = _graphSize.y();
+
+	osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(_grid->getVertexArray());
+	vertices->clear();
+    vertices->reserve(aXCount*2 + aYCount*2 + 4);
 
 	for(unsigned int i=0; i<=aXCount; ++i)
     {
@@ -215,48 +365,105 @@ osg::Geometry* LineGraph::createGraphGrid(const osg::Vec3& pos, const float widt
 
 	for(unsigned int i=0; i<=aYCount; ++i)
     {
-		float ypos = -(float(i)/float(aYCount))*height;
+		float ypos = aYCount ? -(float(i)/float(aYCount))*height : 0.0f;
 
         vertices->push_back(pos+osg::Vec3(0, ypos, 0.0));
         vertices->push_back(pos+osg::Vec3(width, ypos, 0.0));
     }
 
-    osg::Vec4Array* colors = new osg::Vec4Array;
-    colors->push_back(color);
-    geometry->setColorArray(colors);
-    geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+	vertices->dirty();
+	static_cast<osg::DrawArrays*>(_grid->getPrimitiveSet(0))->setCount(vertices->size());
+	_grid->dirtyBound();
+}
 
-    geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINES, 0, vertices->size()));
 
-    return geometry;
+osg::Vec3 LineGraph::plotPoint(unsigned int aIndex, float aValue) const
+{
+	float x = _graphSize.x() * float(aIndex) / float(_numSamples-1);
+	float y = (aValue-_minY)/_rangeY * _graphSize.y();
+
+	return _graphPos + osg::Vec3(x, y - _graphSize.y(), 0.0);
 }
 
 
-osg::Geometry* LineGraph::createGraphGeometry(const osg::Vec3& pos, float width, float height, const osg::Vec4& colour, const osg::FloatArray * aData)
+void LineGraph::formatValue(float aValue, char * aLabel) const
 {
-	assert(aData);
+	if (_units.empty())
+	{
+		sprintf(aLabel, PRECISION, aValue);
+	}
+	else
+	{
+		sprintf(aLabel, "%.4g %.32s", aValue, _units.c_str());
+	}
+}
 
-	osg::Geometry* geometry = new osg::Geometry;
-    osg::Vec3Array* vertices = new osg::Vec3Array;
 
-    geometry->setVertexArray(vertices);
-    vertices->reserve(aData->size());
+void LineGraph::updateGraphGeometry(osg::Geometry * aGeometry, const osg::FloatArray * aData)
+{
+	assert(aData && aData->size() > 1);
 
-	float step = width/float(aData->size()-1);
+	osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(aGeometry->getVertexArray());
+	vertices->clear();
 
-	for(unsigned int i=0; i<aData->size(); ++i)
-    {
-        vertices->push_back(pos+osg::Vec3(step*float(i), aData->at(i)*height-height, 0.0));
-    }
+	const unsigned int nsamples = aData->size();
+	const unsigned int ncolumns = (unsigned int) osg::maximum(_graphSize.x(), 1.0f);
 
-    osg::Vec4Array* colours = new osg::Vec4Array;
-    colours->push_back(colour);
-    geometry->setColorArray(colours);
-    geometry->setColorBinding(osg::Geometry::BIND_OVERALL);
+	if (_numSamples <= ncolumns*4)
+	{
+		vertices->reserve(nsamples);
+		for (unsigned int i=0; i<nsamples; ++i)
+		{
+			vertices->push_back(plotPoint(i, aData->at(i)));
+		}
+	}
+	else
+	{
+		// M4: the first, lowest, highest and last sample of each column, in sample
+		// order, so the extremes and the joins between columns are drawn exactly
+		vertices->reserve(ncolumns*4);
 
-    geometry->addPrimitiveSet(new osg::DrawArrays(GL_LINE_STRIP, 0, aData->size()));
+		unsigned int first = 0;
+		for (unsigned int c=0; (c<ncolumns) && (first<nsamples); c++)
+		{
+			unsigned int end = osg::minimum((unsigned int) ((double) (c+1) * _numSamples / ncolumns), nsamples);
+			if (end <= first)
+			{
+				continue;
+			}
+
+			unsigned int lowest = first, highest = first;
+			for (unsigned int i=first+1; i<end; i++)
+			{
+				if (aData->at(i) < aData->at(lowest))	lowest = i;
+				if (aData->at(i) > aData->at(highest))	highest = i;
+			}
+
+			unsigned int a = osg::minimum(lowest, highest);
+			unsigned int b = osg::maximum(lowest, highest);
+			unsigned int last = end - 1;
+
+			vertices->push_back(plotPoint(first, aData->at(first)));
+			if (a != first)
+			{
+				vertices->push_back(plotPoint(a, aData->at(a)));
+			}
+			if (b != a && b != first)
+			{
+				vertices->push_back(plotPoint(b, aData->at(b)));
+			}
+			if (last != b && last != first)
+			{
+				vertices->push_back(plotPoint(last, aData->at(last)));
+			}
+
+			first = end;
+		}
+	}
 
-    return geometry;
+	vertices->dirty();
+	static_cast<osg::DrawArrays*>(aGeometry->getPrimitiveSet(0))->setCount(vertices->size());
+	aGeometry->dirtyBound();
 }
 
 
@@ -1,8 +1,19 @@
 #ifndef LINEGRAPH_H_
 #define LINEGRAPH_H_
 
+#include <vector>
+#include <osg/Geometry>
+#include <osgText/Text>
+
 /**
- * Class to show a line graph of a 1D array.
+ * Class to show a line graph of one or more 1D arrays.
+ *
+ * The graph's drawables are built once by create() and reused: setData() refills
+ * their vertices and changes the label text in place, and setCursor() only moves the
+ * cursor and its value readout, so it is cheap enough to call every frame.
+ * Series longer than a few samples per column of the plot are decimated to the first,
+ * lowest, highest and last sample of each column (M4), which draws the same picture
+ * as the full series.
  */
 class LineGraph
 {
@@ -10,29 +21,100 @@ public:
 	LineGraph();
 
 	/**
-	 * Setup the linegraph geometry description
-     * @aMinY the minimum Y value on the graph - this will be subtracted from
-     *        all data
+	 * Build the graph, empty until setData() is called.
+	 * @param aPos top left of the graph
+	 * @param aSize width and height of the plotting area
+	 */
+	osg::Geode * create(const osg::Vec3 & aPos, const osg::Vec2 & aSize);
+
+	/**
+	 * Replace the plotted series, reusing the existing geometry.
+	 * The arrays are referenced for the cursor readout, not copied.
+	 * @param aLabel title above the graph
+	 * @param aData series to plot, all the same length, overlaid on one scale
+	 * @param aColours line colour of each series
+	 * @param aTimeLength time at the end of the time axis, seconds
+	 * @param aNumSamples samples the time axis spans, 0 for the longest series; more
+	 *        leaves room to the right of series still being read
+	 */
+	void setData(const std::string & aLabel, const std::vector<const osg::FloatArray*> & aData, const std::vector<osg::Vec4> & aColours, float aTimeLength,
+				 unsigned int aNumSamples = 0);
+
+	/**
+	 * Create and fill the graph in one go, for graphs that never change.
+	 * @param aData series to plot, NULL for an empty grid
 	 */
 	osg::Geode * setUpScene(const std::string & aLabel, const osg::FloatArray * aData, float aTimeLength, const osg::Vec3 & aPos, const osg::Vec2 & aSize);
 
+	/**
+	 * Label values with these units, on a scale fitted to the data, rather than in
+	 * metres on a scale rounded to 0.1 m. For series far from a metre or so in size.
+	 * @param aUnits units shown after each value
+	 */
+	void setUnits(const std::string & aUnits)	{	_units = aUnits;	}
+
+	/**
+	 * Move the time cursor and update the value readout of each series.
+	 * @param aFraction position along the time axis, 0 to 1
+	 */
+	void setCursor(float aFraction);
+
 	/**
 	 * Get the linegraph's geode
 	 */
-	osg::Geode * getGeode()	{	return _geode;	}
+	osg::Geode * getGeode()	{	return _geode.get();	}
 
 protected:
 
 	osg::Geometry* createBackgroundRectangle(const osg::Vec3& pos, const float width, const float height, osg::Vec4& color);
-	osg::Geometry* createGraphGrid(const osg::Vec3& pos, const float width, const float height, osg::Vec4& color, float aXCount, float aYCount);
-    
-    /**
-     *  Create the actual graphed data.
-     */
-	osg::Geometry* createGraphGeometry(const osg::Vec3& pos, float width, float height, const osg::Vec4& colour, const osg::FloatArray * aData);
+	osg::Geometry* createGraphGrid(const osg::Vec4& color);
+	osgText::Text* createLabel(const osg::Vec3& pos, float size, const osg::Vec4& colour);
+
+	/**
+	 * Refill the grid lines for a new scale.
+	 */
+	void updateGraphGrid(unsigned int aXCount, unsigned int aYCount);
+
+	/**
+	 * Refill a line strip with a series, decimating it to the plot's columns.
+	 */
+	void updateGraphGeometry(osg::Geometry * aGeometry, const osg::FloatArray * aData);
+
+	/**
+	 * Point on the plot of a sample.
+	 */
+	osg::Vec3 plotPoint(unsigned int aIndex, float aValue) const;
+
+	/**
+	 * Label text of a value.
+	 * @param aLabel receives the text, at least 64 characters
+	 */
+	void formatValue(float aValue, char * aLabel) const;
 
 protected:
-	osg::Geode * _geode;
+	osg::ref_ptr<osg::Geode> _geode;
+	osg::Vec3 _graphPos;	/**< Top left of the plotting area */
+	osg::Vec2 _graphSize;
+
+	osg::ref_ptr<osg::Geometry> _background;
+	osg::ref_ptr<osg::Geometry> _grid;
+	osg::ref_ptr<osg::Geometry> _cursor;	/**< Vertical line at the current time */
+	osg::ref_ptr<osgText::Text> _label;
+	osg::ref_ptr<osgText::Text> _maxLabel;
+	osg::ref_ptr<osgText::Text> _minLabel;
+	osg::ref_ptr<osgText::Text> _timeLabel;
+
+	std::vector< osg::ref_ptr<osg::Geometry> > _lines;	/**< One per series, kept for reuse when there are fewer */
+	std::vector< osg::ref_ptr<osgText::Text> > _readouts;	/**< Value of each series at the cursor */
+	std::vector<std::string> _readoutText;	/**< Last text of each readout, to skip unchanged updates */
+
+	std::vector< osg::ref_ptr<const osg::FloatArray> > _series;
+	unsigned int _numSamples;	/**< Samples along the time axis */
+	float _minY;
+	float _rangeY;
+	float _cursorFraction;
+	bool _readoutDirty;
+	std::string _units;	/**< Empty for metres on a rounded scale */
 };
 
 /**
@@ -14,6 +14,7 @@
 #include <osg/Notify>
 #include <osg/PositionAttitudeTransform>
 #include <osg/StateAttribute>
+#include <osg/Timer>
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgViewer/ViewerEventHandlers> 
@@ -28,17 +29,36 @@
 
 #include <project.h>
 #include <swwreader.h>
+#include <partitionedswwreader.h>
 #include <bedslope.h>
 #include <keyboardeventhandler.h>
 #include <directionallight.h>
 #include <state.h>
 #include <watersurface.h>
 #include <customargumentparser.h>
+#include <inundation.h>
+#include <difference.h>
+#include <region.h>
+#include <timewindow.h>
+#include <tileset.h>
+#include <tileswwreader.h>
 
 #include "skybox.h"
 #include "anugahud.h"
 #include "linegraph.h"
 #include "customviewer.h"
+#include "offscreencontext.h"
+#include "framecapture.h"
+#include "streamcapture.h"
+#include "gaugepanel.h"
+#include "pickseries.h"
+#include "envelopelayer.h"
+#include "arrowlayer.h"
+#include "totalspanel.h"
+#include "comparisonlayers.h"
+#include "tilepager.h"
+#include "previewlayer.h"
+#include "readahead.h"
 
 // prototypes
 extern const char* version();
@@ -50,6 +70,20 @@ static const char * S_VIEWER_TITLE = "ANUGA Viewer";
 AnugaHUD * g_hud = NULL;
 
 
+/**
+ * Open an sww file, or all the partitions of a parallel run as one domain.
+ * @param aOptions what part of the run to load
+ * @param aMesh mesh of another run, shared if the file has the same one
+ */
+static SWWReader * openReader(const std::string & aFilename, const SWWReader::LoadOptions & aOptions, MeshData * aMesh = NULL)
+{
+   std::vector<std::string> partitions;
+   if (PartitionedSWWReader::getPartitionFilenames(aFilename, partitions))
+	  return new PartitionedSWWReader(aFilename, 0, aMesh, aOptions);
+   return new SWWReader(aFilename, true, aMesh, true, aOptions);
+}
+
+
 int main( int argc, char **argv )
 {
    // use an ArgumentParser object to manage the program arguments.
@@ -72,6 +106,20 @@ int main( int argc, char **argv )
    bool loop = false;
    std::string moviedir("screenshots");	// default screenshot directory
 
+   // headless rendering into an offscreen surface, for batch movie export
+   bool headless = false;
+   int headlesswidth = 0, headlessheight = 0;
+   std::string headlessres;
+   if( arguments.read("-headless", headlessres) )
+   {
+	  if( !OffscreenContext::parseResolution(headlessres, headlesswidth, headlessheight) )
+	  {
+		 std::cout << "Invalid headless resolution \"" << headlessres << "\", expected <width>x<height> ... quitting" << std::endl;
+		 return 1;
+	  }
+	  headless = true;
+   }
+
    if( arguments.isSWM() )
    {
 	  playbackmode = true;
@@ -90,6 +138,21 @@ int main( int argc, char **argv )
 	  playbackmode = false;
 	  savemovie = false;
 	  loop = true;  // playback in none macro mode should loop (otherwise you don't get a chance to save)
+	  arguments.read("-movie", moviedir);
+   }
+
+   // frames can go to one video stream, a file or "|command", instead of numbered images
+   std::string streamtarget;
+   if( arguments.read("-stream", streamtarget) )
+   {
+	  savemovie = true;
+   }
+
+   // headless mode always writes frames and quits at the end of the sequence
+   if( headless )
+   {
+	  savemovie = true;
+	  loop = false;
    }
 
    // setup screenshot location
@@ -121,7 +184,62 @@ int main( int argc, char **argv )
 	  std::cout << "Require last argument be an .sww/.swm file ... quitting" << std::endl;
 	  return 1; 
    }
-   SWWReader *sww = new SWWReader(swwfile);
+
+   // frames decoded once between viewers of the same file on this host
+   SWWReader::LoadOptions loadoptions;
+   int sharedcachemb;
+   if( arguments.read("-sharedcache", sharedcachemb) && sharedcachemb > 0 ) loadoptions.sharedCacheBytes = (size_t) sharedcachemb*1024*1024;
+
+   // only part of a very large domain, every run loaded cut the same way
+   std::string roi;
+   if( arguments.read("-roi", roi) && !Region::parse(roi, loadoptions.region) )
+   {
+	  std::cout << "Invalid region \"" << roi << "\", expected xmin,ymin,xmax,ymax or x1,y1,x2,y2,x3,y3,... ... quitting" << std::endl;
+	  return 1;
+   }
+
+   // only part of a long run, numbered from its first timestep; every run loaded the same
+   TimeWindow & window = loadoptions.timeWindow;
+   std::string tstart, tend;
+   unsigned int tstride;
+   if( (arguments.read("-tstart", tstart) && !window.setStart(tstart)) ||
+	   (arguments.read("-tend", tend) && !window.setEnd(tend)) ||
+	   (arguments.read("-tstride", tstride) && !window.setStride(tstride)) )
+   {
+	  std::cout << "Invalid timestep window, expected a timestep or a time in seconds such as 3600s, and a stride of 1 or more ... quitting" << std::endl;
+	  return 1;
+   }
+
+   // a mesh too large to load whole, cut into tiles once and paged in by view within a memory budget
+   int outofcoremb = 0;
+   unsigned int tilesacross;
+   if( !arguments.read("-tiles", tilesacross) ) tilesacross = TILESET_DEFAULT_TILES;
+   TileSWWReader *overview = NULL;
+   SWWReader *sww;
+   if( arguments.read("-outofcore", outofcoremb) && outofcoremb > 0 )
+   {
+	  std::vector<std::string> partitions;
+	  if( PartitionedSWWReader::getPartitionFilenames(swwfile, partitions) )
+	  {
+		 std::cout << "The partitions of a parallel run can't be loaded out of core ... quitting" << std::endl;
+		 return 1;
+	  }
+
+	  osg::ref_ptr<TileSet> tiles = TileSet::open(swwfile, tilesacross);
+	  if( !tiles.valid() )
+	  {
+		 std::cout << "Unable to cut " << swwfile << " into tiles ... quitting" << std::endl;
+		 return 1;
+	  }
+	  std::cout << "Tiles " << (tiles->isFromCache() ? "read from " : "written to ") << tiles->getCacheFilename() << std::endl;
+
+	  overview = new TileSWWReader(tiles.get(), tiles->getOverview(), true, loadoptions);
+	  sww = overview;
+   }
+   else
+   {
+	  sww = openReader(swwfile, loadoptions);
+   }
    if (sww->isValid() == false)
    {
 	  std::cout << "Unable to load " << swwfile << " ... is this really an .sww file?" << std::endl;
@@ -150,6 +268,116 @@ int main( int argc, char **argv )
    if( arguments.read("-alphamax",tmpfloat) ) sww->setAlphaMax( tmpfloat );
    if( arguments.read("-cullangle",tmpfloat) ) sww->setCullAngle( tmpfloat );
 
+   // live monitor of a running simulation, at its newest complete timestep or looping over the newest few
+   int followwindow = 0;
+   bool follow = arguments.read("-follow");
+   if( arguments.read("-followloop", followwindow) && followwindow > 0 ) follow = true;
+
+   // inundation arrival and duration maps for batch post-processing, written without opening a window
+   float inundationdepth;
+   if( !arguments.read("-inundationdepth", inundationdepth) || inundationdepth < 0.0 ) inundationdepth = DEF_INUNDATION_DEPTH;
+   std::string inundationfile;
+   if( arguments.read("-inundation", inundationfile) )
+   {
+	  Inundation inundation(inundationdepth);
+	  if( !inundation.compute(sww) || !inundation.write(inundationfile, sww) )
+	  {
+		 std::cout << "Unable to write inundation maps to " << inundationfile << " ... quitting" << std::endl;
+		 return 1;
+	  }
+	  std::cout << "Inundation maps written to " << inundationfile << std::endl;
+	  return 0;
+   }
+
+   // another run on the same mesh, its difference from this one mapped with 'e' or written without opening a window
+   SWWReader *diffrun = NULL;
+   std::string difffile;
+   if( arguments.read("-diff", difffile) )
+   {
+	  if( overview )
+	  {
+		 std::cout << "-diff can't be used out of core ... quitting" << std::endl;
+		 return 1;
+	  }
+	  diffrun = openReader(difffile, loadoptions, sww->getMesh());
+	  if( diffrun->isValid() == false )
+	  {
+		 std::cout << "Unable to load " << difffile << " ... is this really an .sww file?" << std::endl;
+		 return 1;
+	  }
+	  if( !Difference::isComparable(sww, diffrun) )
+	  {
+		 std::cout << difffile << " can't be compared with " << swwfile << " ... quitting" << std::endl;
+		 return 1;
+	  }
+   }
+   std::string diffoutfile;
+   if( arguments.read("-diffout", diffoutfile) )
+   {
+	  Difference difference;
+	  if( !diffrun || !difference.compute(sww, diffrun) || !difference.write(diffoutfile, sww) )
+	  {
+		 std::cout << "Unable to write differences to " << diffoutfile << " ... quitting" << std::endl;
+		 return 1;
+	  }
+	  std::cout << "Differences written to " << diffoutfile << std::endl;
+	  return 0;
+   }
+
+   // a file still being written may not have a whole timestep yet, and there is no range to render
+   if( headless && sww->getNumberOfTimesteps() == 0 )
+   {
+	  std::cout << swwfile << " has no complete timesteps to render ... quitting" << std::endl;
+	  return 1;
+   }
+
+   // timestep range rendered in headless mode when not playing back a macro
+   unsigned int firststep = 0, laststep = sww->getNumberOfTimesteps() ? sww->getNumberOfTimesteps()-1 : 0;
+   std::string stepsstr;
+   if( arguments.read("-steps", stepsstr) )
+   {
+	  unsigned int first, last;
+	  if( sscanf( stepsstr.c_str(), "%u,%u", &first, &last ) == 2 && first <= last && first <= laststep )
+	  {
+		 firststep = first;
+		 laststep = osg::minimum(last, laststep);
+	  }
+	  else osg::notify(osg::WARN) << "Invalid timestep range \"" << stepsstr << "\"" << std::endl;
+   }
+
+   // movie frames are read back asynchronously and written by a pool of encoder threads
+   osg::ref_ptr<FrameCapture> capture;
+   StreamCapture * streamcapture = NULL;
+   if( !streamtarget.empty() )
+   {
+	  std::string streamformat(streamtarget);
+	  arguments.read("-streamformat", streamformat);
+
+	  // by default one stream frame per average timestep, uneven timesteps are paced to match
+	  double fps, timescale;
+	  if( !arguments.read("-fps", fps) || fps <= 0.0 ) fps = 25.0;
+	  if( !arguments.read("-timescale", timescale) || timescale < 0.0 )
+	  {
+		 unsigned int nsteps = sww->getNumberOfTimesteps();
+		 timescale = nsteps > 1 ? fps * (sww->getTime(nsteps-1) - sww->getTime(0)) / (nsteps-1) : 0.0;
+	  }
+
+	  streamcapture = new StreamCapture(streamtarget, StreamCapture::formatFromString(streamformat), fps, timescale);
+	  capture = streamcapture;
+	  if( !streamcapture->open() )
+	  {
+		 return 1;
+	  }
+   }
+   else
+   {
+	  capture = new FrameCapture(moviedir+"/frame", "jpg");
+   }
+   if( savemovie )
+   {
+	  viewer.getCamera()->setPostDrawCallback( capture.get() );
+   }
+
    std::string bedslopetexture;
    if( arguments.read("-texture",bedslopetexture) ) sww->setBedslopeTexture( bedslopetexture );
 
@@ -169,6 +397,54 @@ int main( int argc, char **argv )
    // Water geometry
    WaterSurface* water = new WaterSurface(sww);
 
+   // other runs on the same mesh, shown in place of this one with 'v' and played in step
+   ComparisonLayers runs(sww, bedslope, water);
+   std::string comparefile;
+   while( arguments.read("-compare", comparefile) )
+   {
+	  if( overview )
+	  {
+		 std::cout << "-compare can't be used out of core ... quitting" << std::endl;
+		 return 1;
+	  }
+	  SWWReader *run = openReader(comparefile, loadoptions, sww->getMesh());
+	  if( run->isValid() == false )
+	  {
+		 std::cout << "Unable to load " << comparefile << " ... is this really an .sww file?" << std::endl;
+		 return 1;
+	  }
+	  if( !run->isMeshShared() )
+	  {
+		 std::cout << comparefile << " has a different mesh from " << swwfile << ", loaded separately" << std::endl;
+	  }
+
+	  run->setSwollenDir( sww->getSwollenDir() );
+	  run->setHeightMin( sww->getHeightMin() );
+	  run->setHeightMax( sww->getHeightMax() );
+	  run->setAlphaMin( sww->getAlphaMin() );
+	  run->setAlphaMax( sww->getAlphaMax() );
+	  run->setCullAngle( sww->getCullAngle() );
+	  if( !bedslopetexture.empty() ) run->setBedslopeTexture( bedslopetexture );
+	  runs.addRun(run);
+   }
+
+   // tiles in view drawn over the overview, loaded in the background
+   TilePager *pager = NULL;
+   if( overview )
+   {
+	  pager = new TilePager(overview, bedslope, water, (size_t) outofcoremb*1024*1024, bedslopetexture);
+   }
+
+   // coarse frames of every timestep, shown while stepping by hand until the steps stop
+   int previewmb;
+   if( !arguments.read("-previewmb", previewmb) || previewmb < 0 ) previewmb = PREVIEW_DEFAULT_BYTES/(1024*1024);
+   PreviewLayer *preview = NULL;
+   if( previewmb > 0 && !headless )
+   {
+	  preview = new PreviewLayer(sww, water, (size_t) previewmb*1024*1024);
+	  if( pager ) preview->addFullSurface( pager->get() );
+   }
+
    // Heads Up Display (text overlay)
    g_hud = new AnugaHUD();
    g_hud->setTitle(S_VIEWER_TITLE);
@@ -178,6 +454,16 @@ int main( int argc, char **argv )
 	g_hud->setStatus("filename", swwfile);
 	g_hud->setStatus("culling", water->getCulling() ? "on" : "off");
 	g_hud->setStatus("wireframe", "off");
+	g_hud->setStatus("timeseries", "none");
+	g_hud->setStatus("gauges", "none");
+	g_hud->setStatus("envelope", "off");
+	g_hud->setStatus("colour", DerivedQuantity::getName(sww->getColourQuantity()));
+	g_hud->setStatus("arrows", "off");
+	g_hud->setStatus("totals", "off");
+	g_hud->setStatus("follow", follow ? "waiting" : "off");
+	g_hud->setStatus("run", "1 of 1");
+	g_hud->setStatus("tiles", pager ? "loading" : "off");
+	g_hud->setStatus("preview", "off");
 
    // Lighting
    DirectionalLight* light = new DirectionalLight(rootStateSet);
@@ -197,8 +483,9 @@ int main( int argc, char **argv )
    rootnode->addChild( g_hud->get() );
    rootnode->addChild( light->get() );
    rootnode->addChild(model);
-   model->addChild( bedslope->get() );
-   model->addChild( water->get() );
+   model->addChild( runs.get() );
+   if( pager ) model->addChild( pager->get() );
+   if( preview ) model->addChild( preview->get() );
 
 	// Load the initial frame so we can get grid extents
 	sww->loadBedslopeVertexArray(0);
@@ -209,6 +496,27 @@ int main( int argc, char **argv )
 	grid_switch->setAllChildrenOff();
 	model->addChild(grid_switch);
 
+	// gauges pinned with 'p', markers drawn with the mesh
+	GaugePanel gauges(sww);
+	model->addChild(gauges.getMarkers());
+
+	// series of the shift-clicked point, read in the background
+	PickSeries pickseries(sww);
+
+	// frames about to be shown, read in the background while the current one is drawn
+	ReadAhead readahead(sww);
+
+	// maximum depth, speed and stage, arrival time and duration layers, cycled with 'e'
+	EnvelopeLayer envelope(sww, inundationdepth);
+	envelope.setDifferenceRun(diffrun);
+
+	// flow direction arrows, toggled with 'a'
+	ArrowLayer arrows(sww);
+	model->addChild(arrows.get());
+
+	// wet area, volume and peak depth graphs, toggled with 'm', totalled at low priority
+	TotalsPanel totals(sww);
+
    // allow vertical scaling from command line parameter
    model->setScale( osg::Vec3(1.0, 1.0, vscale) );
 
@@ -263,6 +571,11 @@ int main( int argc, char **argv )
 
 	// register additional event handler
 	KeyboardEventHandler* event_handler = new KeyboardEventHandler(sww->getNumberOfTimesteps(), tps);
+	event_handler->setPickTarget(sww, model);
+	if( follow )
+	{
+		event_handler->setFollow(true, followwindow);
+	}
 	viewer.addEventHandler(event_handler);
 
 	// add the help handler
@@ -274,23 +587,67 @@ int main( int argc, char **argv )
 	// add the stats handler
 	viewer.addEventHandler(new osgViewer::StatsHandler);
 
-	// create the windows and run the threads.
-	viewer.realize();
+	// create the windows (or offscreen surface) and run the threads.
+	OffscreenContext offscreen;
+	if( headless )
+	{
+		if( !offscreen.setUp(viewer, headlesswidth, headlessheight) )
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		viewer.realize();
+	}
 
 	unsigned int timestep = 0;
+	unsigned int shownstep = 0;	// differs from timestep while a preview stands in for it
+	unsigned int headlessstep = firststep;
+
+	// per-frame wall time report for headless batch runs
+	osg::Timer_t headlessstart = osg::Timer::instance()->tick();
+	unsigned int headlessframes = 0;
+
+	// newest timestep count whose latency the HUD shows, 0 when not following
+	unsigned int followshown = 0;
 
 	while( !viewer.done() )
 	{
-		if( !playbackmode )
+		// wall time of the whole frame, loading the timestep included
+		osg::Timer_t framestart = osg::Timer::instance()->tick();
+
+		if( headless && !playbackmode )
+		{
+			// step through the requested timestep range, one frame each
+			timestep = headlessstep;
+			shownstep = timestep;
+			readahead.update(timestep, shownstep, true);
+			water->setTimeStep(timestep);
+			bedslope->setTimeStep(timestep);
+			g_hud->setTime( sww->getTime(timestep) );
+
+			headlessstep++;
+			if( headlessstep > laststep )
+			{
+				viewer.setDone(true);
+			}
+		}
+		else if( !playbackmode )
 		{
 			 // current time in seconds
 			 double time = viewer.getFrameStamp()->getReferenceTime();
 
 			 event_handler->setTime( time );
-			 timestep = event_handler->getTimestep();
+			 shownstep = event_handler->getTimestep();
+
+			 // stepping by hand shows the preview, the full frame is read once the steps stop
+			 bool stepping = event_handler->isPaused() && !event_handler->isFollowing() && !savemovie;
+			 timestep = preview ? preview->update(shownstep, stepping, time, g_hud) : shownstep;
+			 readahead.update(timestep, shownstep, !event_handler->isPaused());
 			 water->setTimeStep(timestep);
 			 bedslope->setTimeStep(timestep);
-			 g_hud->setTime( sww->getTime(timestep) );
+			 g_hud->setTime( sww->getTime(shownstep) );
 
 			// these methods do their own dirty checking
 			water->setWireframe((event_handler->getWireframeMode() & WF_WATER) > 0);
@@ -306,18 +663,60 @@ int main( int argc, char **argv )
 			GridMode ge = event_handler->getGridMode();
 			viewer.setGrid(grid_switch, ge);
 
-			if (event_handler->checkMouseClicked())
+			// 'q' changes the quantity the water is coloured by, and the colour bar with it
+			DerivedQuantity::Type quantity = event_handler->getColourQuantity();
+			if (quantity != sww->getColourQuantity())
 			{
-				int sp = event_handler->getSelectedPoly();
-
-				osg::ref_ptr<osg::FloatArray> time_series = new osg::FloatArray;
+				water->setColourQuantity(quantity);
+				g_hud->setStatus("colour", DerivedQuantity::getName(quantity));
+				g_hud->setIntensityScale(DerivedQuantity::getName(quantity), 0.0f, DerivedQuantity::getScale(quantity), DerivedQuantity::getUnits(quantity), true);
+			}
 
-				if (sp >= 0)
+			if (event_handler->checkMouseClicked())
+			{
+				if (event_handler->getSelectedPoly() >= 0)
 				{
-					sww->getTimeSeries(sp, ssm->getTextureEnabled() ? SWWReader::TSTYPE_STAGE : SWWReader::TSTYPE_MOMENTUM_MAGNITUDE, time_series);
+					// series at the clicked point, not just the nearest vertex
+					pickseries.request(event_handler->getSelectedPoint(),
+									   ssm->getTextureEnabled() ? SWWReader::TSTYPE_STAGE : SWWReader::TSTYPE_MOMENTUM_MAGNITUDE,
+									   ssm->getTextureEnabled() ? std::string("Stage Timeseries") : std::string("Momentum Timeseries"));
 				}
+				else
+				{
+					pickseries.clear();
+				}
+			}
+
+			// 'p' pins the selected point, 'u' removes all pins
+			gauges.setPlotType(ssm->getTextureEnabled() ? SWWReader::TSTYPE_STAGE : SWWReader::TSTYPE_MOMENTUM_MAGNITUDE);
+			if (event_handler->checkPinGauge() && event_handler->getSelectedPoly() >= 0)
+			{
+				gauges.addGauge(event_handler->getSelectedPoint());
+			}
+			if (event_handler->checkClearGauges())
+			{
+				gauges.clear();
+			}
 
-				g_hud->setTimeSeriesData(time_series, sww->getTime(sww->getNumberOfTimesteps()-1), ssm->getTextureEnabled() ? std::string("Stage Timeseries") : std::string("Momentum Timeseries"));
+			if (event_handler->checkCycleEnvelope())
+			{
+				envelope.cycle();
+			}
+
+			if (event_handler->checkToggleArrows())
+			{
+				arrows.toggle();
+				g_hud->setStatus("arrows", arrows.isEnabled() ? "on" : "off");
+			}
+
+			if (event_handler->checkToggleTotals())
+			{
+				totals.toggle();
+			}
+
+			if (event_handler->checkCycleRun())
+			{
+				runs.cycle();
 			}
 			
 
@@ -372,6 +771,8 @@ int main( int argc, char **argv )
 		{
 			// in playback mode
 			State state = statelist.at( playback_index );
+			timestep = state.getTimestep();
+			shownstep = timestep;
 			water->setTimeStep( state.getTimestep() );
 			bedslope->setTimeStep( state.getTimestep() );
 			water->setWireframe((state.getWireframe() & WF_WATER) > 0);
@@ -434,7 +835,7 @@ int main( int argc, char **argv )
 
 		if (savemovie)
 		{
-			cap_handler->captureNextFrame(viewer);
+			capture->captureNextFrame( sww->getTime(timestep) );
 		}
 
 		// Toggle sky and update bed texture if we have toggled texturing
@@ -446,23 +847,104 @@ int main( int argc, char **argv )
 			{
 				sky_switch->setAllChildrenOn();
 				bedslope->onRefreshTextured(true);
+				runs.setTextured(true);
+				if (pager) pager->setTextured(true);
 			}
 			else
 			{
 				sky_switch->setAllChildrenOff();
 				bedslope->onRefreshTextured(false);
+				runs.setTextured(false);
+				if (pager) pager->setTextured(false);
 			}
 		}
 		tex_enabled_last = tex_enabled;
 
+		// graph cursor follows the displayed timestep
+		pickseries.update(g_hud);
+		gauges.update(g_hud);
+		envelope.update(water, g_hud, timestep);
+		totals.update(g_hud);
+		unsigned int nsteps = sww->getNumberOfTimesteps();
+		g_hud->setTimeCursor(nsteps > 1 ? shownstep / (float) (nsteps-1) : 0.0f);
+
 		// scene-graph updates
 		water->update();
 		bedslope->update();
+		runs.update(sww->getTime(timestep), g_hud);
+		if (pager) pager->update(viewer.getCamera(), timestep, g_hud);
+		arrows.update(viewer.getCamera(), g_hud);
+
+		// the file may have grown, or been rewritten, whatever the timestep; only a flag
+		// test unless it has changed
+		osg::ref_ptr<osg::DrawElementsUInt> indices = sww->getBedslopeIndexArray();
+		sww->refresh();
+		if( sww->getBedslopeIndexArray() != indices )
+		{
+			// loaded afresh, not just timesteps appended
+			water->dirtyData();
+			bedslope->dirtyData();
+		}
+		event_handler->setNumTimesteps(sww->getNumberOfTimesteps());
 		g_hud->update();
 
 		// fire off the cull and draw traversals of the scene.
 		viewer.frame();
+
+		// disk to screen latency, once each newly written timestep has been drawn
+		if( !event_handler->isFollowing() || playbackmode )
+		{
+			if( followshown )
+			{
+				g_hud->setStatus("follow", "off");
+			}
+			followshown = 0;
+		}
+		else if( timestep+1 == sww->getNumberOfTimesteps() && timestep+1 != followshown )
+		{
+			followshown = timestep+1;
+			char followstr[64];
+			float age = sww->getAppendAge();
+			if( age < 0.0f )
+			{
+				sprintf( followstr, "step %u, waiting", timestep );
+			}
+			else
+			{
+				sprintf( followstr, "step %u, %.2f s behind", timestep, age );
+			}
+			g_hud->setStatus("follow", followstr);
+		}
+
+		if( headless )
+		{
+			double ms = osg::Timer::instance()->delta_m( framestart, osg::Timer::instance()->tick() );
+			std::cout << "frame " << headlessframes << ": " << ms << " ms" << std::endl;
+			headlessframes++;
+		}
 	}
-	
+
+	if( savemovie )
+	{
+		// collect the last readback and wait for the encoders
+		capture->finish(viewer);
+		std::cout << "Captured " << capture->getNumWritten() << " frames at " << capture->getThroughput() << " fps" << std::endl;
+		if( streamcapture )
+		{
+			std::cout << "Wrote " << streamcapture->getNumStreamFrames() << " stream frames to " << streamtarget << std::endl;
+		}
+	}
+
+	if( headless && headlessframes > 0 )
+	{
+		double s = osg::Timer::instance()->delta_s( headlessstart, osg::Timer::instance()->tick() );
+		std::cout << "Rendered " << headlessframes << " frames to " << moviedir << " in " << s << " s ("
+				  << 1000.0*s/headlessframes << " ms/frame)" << std::endl;
+	}
+
+	// loads in progress finish before the readers go
+	delete preview;
+	delete pager;
+
    return 0;
 }
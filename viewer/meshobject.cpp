@@ -52,6 +52,15 @@ void MeshObject::setTimeStep(unsigned int ts)
 }
 
 
+void MeshObject::refreshIndices()
+{
+	if (_geom->getNumPrimitiveSets())
+	{
+		_geom->setPrimitiveSet(0, _sww->getBedslopeIndexArray().get());
+	}
+}
+
+
 void MeshObject::setWireframe(bool value)
 {
    if( value != _wireframe )
@@ -66,6 +66,17 @@ class MeshObject
 		 */
 		void setTimeStep( unsigned int aTs );
 
+		/**
+		 * Draw the reader's current triangle list, after it has changed without the
+		 * data changing.
+		 */
+		void refreshIndices();
+
+		/**
+		 * Rebuild the mesh at the next update, eg. after the file has been reloaded.
+		 */
+		void dirtyData()	{	_dirtydata = true;	}
+
 	protected:
 		osg::StateSet* _stateset;
 		osg::Geode* _node;
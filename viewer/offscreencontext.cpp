@@ -0,0 +1,110 @@
+/*
+  OffscreenContext class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <osg/GraphicsContext>
+#include <osg/Notify>
+
+#include "offscreencontext.h"
+
+
+OffscreenContext::OffscreenContext()
+#ifdef USE_OSMESA
+	: _context(NULL),
+	_buffer(NULL)
+#endif
+{
+}
+
+
+OffscreenContext::~OffscreenContext()
+{
+#ifdef USE_OSMESA
+	if (_context)
+	{
+		OSMesaDestroyContext(_context);
+		_context = NULL;
+	}
+
+	delete[] _buffer;
+	_buffer = NULL;
+#endif
+}
+
+
+bool OffscreenContext::parseResolution(const std::string & aString, int & aWidth, int & aHeight)
+{
+	if (sscanf(aString.c_str(), "%dx%d", &aWidth, &aHeight) != 2)
+	{
+		return false;
+	}
+
+	return (aWidth > 0) && (aHeight > 0);
+}
+
+
+bool OffscreenContext::setUp(osgViewer::Viewer& aViewer, int aWidth, int aHeight)
+{
+	// render everything from the one thread, the context is only ever current there
+	aViewer.setThreadingModel(osgViewer::Viewer::SingleThreaded);
+
+#ifdef USE_OSMESA
+	// software rasteriser drawing into our own RGBA buffer
+	_context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+	if (!_context)
+	{
+		osg::notify(osg::FATAL) << "[OffscreenContext] Unable to create OSMesa context." << std::endl;
+		return false;
+	}
+
+	_buffer = new unsigned char[aWidth * aHeight * 4];
+	if (!OSMesaMakeCurrent(_context, _buffer, GL_UNSIGNED_BYTE, aWidth, aHeight))
+	{
+		osg::notify(osg::FATAL) << "[OffscreenContext] Unable to make OSMesa context current." << std::endl;
+		return false;
+	}
+
+	// rows are stored bottom-up, as glReadPixels expects
+	OSMesaPixelStore(OSMESA_Y_UP, 1);
+
+	// OSMesa context stays current for the lifetime of the viewer, osg only sees an embedded window
+	aViewer.setUpViewerAsEmbeddedInWindow(0, 0, aWidth, aHeight);
+#else
+	osg::ref_ptr<osg::GraphicsContext::Traits> traits = new osg::GraphicsContext::Traits;
+	traits->x = 0;
+	traits->y = 0;
+	traits->width = aWidth;
+	traits->height = aHeight;
+	traits->red = 8;
+	traits->green = 8;
+	traits->blue = 8;
+	traits->alpha = 8;
+	traits->depth = 24;
+	traits->windowDecoration = false;
+	traits->doubleBuffer = true;
+	traits->pbuffer = true;
+
+	osg::ref_ptr<osg::GraphicsContext> gc = osg::GraphicsContext::createGraphicsContext(traits.get());
+	if (!gc.valid())
+	{
+		osg::notify(osg::FATAL) << "[OffscreenContext] Unable to create pbuffer. "
+				<< "Without a display, rebuild with 'make OSMESA=1' for software rendering." << std::endl;
+		return false;
+	}
+
+	osg::Camera * camera = aViewer.getCamera();
+	camera->setGraphicsContext(gc.get());
+	camera->setViewport(new osg::Viewport(0, 0, aWidth, aHeight));
+	camera->setProjectionMatrixAsPerspective(30.0, double(aWidth)/double(aHeight), 1.0, 10000.0);
+	camera->setDrawBuffer(GL_BACK);
+	camera->setReadBuffer(GL_BACK);
+#endif
+
+	aViewer.realize();
+
+	return true;
+}
@@ -0,0 +1,62 @@
+/*
+    OffscreenContext class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef OFFSCREENCONTEXT_H
+#define OFFSCREENCONTEXT_H
+
+#include <osgViewer/Viewer>
+
+#ifdef USE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+/**
+ * Renders the viewer into an offscreen surface instead of a window, for batch
+ * movie export on machines without a display.
+ *
+ * When built with OSMESA=1 the scene is rendered by the OSMesa software rasteriser
+ * into a buffer in main memory, so no X server or GPU is required. Otherwise a
+ * pbuffer is requested from the windowing system.
+ *
+ * Usage
+ *
+ * OffscreenContext offscreen;
+ * if (offscreen.setUp(viewer, 1280, 720))
+ * {
+ *     while (!viewer.done()) viewer.frame();
+ * }
+ */
+class OffscreenContext
+{
+public:
+	OffscreenContext();
+	~OffscreenContext();
+
+	/**
+	 * Attach an offscreen surface of the given size to the viewer's master camera
+	 * and realize the viewer. Must be called in place of viewer.realize().
+	 * @param aViewer viewer to render offscreen
+	 * @param aWidth surface width in pixels
+	 * @param aHeight surface height in pixels
+	 * @return false if no offscreen surface could be created
+	 */
+	bool setUp(osgViewer::Viewer& aViewer, int aWidth, int aHeight);
+
+	/**
+	 * Parse a resolution string of the form <width>x<height>.
+	 * @return false if the string is malformed or either dimension is not positive
+	 */
+	static bool parseResolution(const std::string & aString, int & aWidth, int & aHeight);
+
+private:
+#ifdef USE_OSMESA
+	OSMesaContext _context;	/**< Software rendering context */
+	unsigned char * _buffer;	/**< RGBA colour buffer the context renders into */
+#endif
+};
+
+#endif  // OFFSCREENCONTEXT_H
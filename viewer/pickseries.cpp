@@ -0,0 +1,179 @@
+/*
+  PickSeries class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <OpenThreads/ScopedLock>
+
+#include "hud.h"
+#include "pickseries.h"
+
+
+/**
+ * Read the series at one point, reporting each chunk.
+ */
+class PickSeries::FetchJob : public WorkerPool::Job, public SWWReader::SeriesProgress
+{
+public:
+	FetchJob(PickSeries * aOwner, unsigned int aGeneration, const osg::Vec2d & aLocation, SWWReader::TimeSeriesType aType) :
+		_owner(aOwner),
+		_generation(aGeneration),
+		_location(aLocation),
+		_type(aType)
+	{
+	}
+
+	virtual void run()
+	{
+		if (_owner->_generation != _generation)
+		{
+			return;	// superseded while it waited
+		}
+
+		std::vector<osg::Vec2d> points(1, _location);
+		std::vector< osg::ref_ptr<osg::FloatArray> > series;
+		if (_owner->_sww->getTimeSeries(points, _type, series, this))
+		{
+			_owner->fetched(_generation, series[0].get(), series[0]->size(), true);
+		}
+		else
+		{
+			// failed, unless it was cancelled in which case this is ignored
+			_owner->fetched(_generation, NULL, 0, true);
+		}
+	}
+
+	virtual bool progress(const std::vector< osg::ref_ptr<osg::FloatArray> > & aData, size_t aNumRead)
+	{
+		if (aNumRead == aData[0]->size())
+		{
+			// the whole series, run() hands it over
+			return _owner->_generation == _generation;
+		}
+
+		// the render thread gets a copy, the rest of the array is still being written
+		osg::FloatArray * part = new osg::FloatArray(aData[0]->begin(), aData[0]->begin() + aNumRead);
+		return _owner->fetched(_generation, part, aNumRead, false);
+	}
+
+private:
+	PickSeries * _owner;
+	unsigned int _generation;
+	osg::Vec2d _location;
+	SWWReader::TimeSeriesType _type;
+};
+
+
+PickSeries::PickSeries(SWWReader * aReader) :
+	_sww(aReader),
+	_pool(1),
+	_timeLength(0),
+	_numTimesteps(0),
+	_numRead(0),
+	_done(true),
+	_failed(false),
+	_updated(false)
+{
+}
+
+
+PickSeries::~PickSeries()
+{
+	// stop the read in progress, rather than finish it
+	++_generation;
+	_pool.wait();
+}
+
+
+void PickSeries::request(const osg::Vec3 & aPoint, SWWReader::TimeSeriesType aType, const std::string & aTitle)
+{
+	unsigned int generation = ++_generation;
+
+	_title = aTitle;
+	_numTimesteps = _sww->getNumberOfTimesteps();
+	_timeLength = _sww->getTime(_numTimesteps-1);
+
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+		_series = new osg::FloatArray;
+		_numRead = 0;
+		_done = false;
+		_failed = false;
+		_updated = true;
+	}
+
+	osg::Vec3d location = _sww->getGeoreferencedPoint(aPoint);
+	_pool.add(new FetchJob(this, generation, osg::Vec2d(location.x(), location.y()), aType));
+}
+
+
+void PickSeries::clear()
+{
+	++_generation;
+
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+	_series = NULL;
+	_numRead = 0;
+	_done = true;
+	_failed = false;
+	_updated = true;
+}
+
+
+bool PickSeries::fetched(unsigned int aGeneration, osg::FloatArray * aSeries, size_t aNumRead, bool aDone)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	// checked under the lock, so a clear() can't be undone by a late result
+	if (_generation != aGeneration)
+	{
+		return false;
+	}
+
+	_series = aSeries;
+	_numRead = aNumRead;
+	_done = aDone;
+	_failed = !aSeries;
+	_updated = true;
+
+	return true;
+}
+
+
+void PickSeries::update(HeadsUpDisplay * aHUD)
+{
+	OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+	if (!_updated)
+	{
+		return;
+	}
+	_updated = false;
+
+	std::string status;
+	if (_failed)
+	{
+		status = "read failed";
+	}
+	else if (!_series.valid() || (_done && _series->empty()))
+	{
+		status = "none";
+	}
+	else if (!_done)
+	{
+		char percent[32];
+		sprintf(percent, "loading %d%%", _numTimesteps ? (int) (100 * _numRead / _numTimesteps) : 0);
+		status = percent;
+	}
+	else
+	{
+		status = "ready";
+	}
+	aHUD->setStatus("timeseries", status);
+
+	osg::ref_ptr<osg::FloatArray> series = _series.valid() ? _series.get() : new osg::FloatArray;
+	aHUD->setTimeSeriesData(series, _timeLength, _title, _done ? 0 : _numTimesteps);
+}
@@ -0,0 +1,80 @@
+/*
+    PickSeries class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef PICKSERIES_H
+#define PICKSERIES_H
+
+#include <string>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+
+#include <swwreader.h>
+#include <workerpool.h>
+
+class HeadsUpDisplay;
+
+/**
+ * Fetches the timeseries at a picked point without holding up the render loop.
+ *
+ * Each request queues a read on a background thread, which reports a chunk of
+ * timesteps at a time so the HUD graph fills in as the file is read. A new request
+ * or clear() cancels the read in progress at its next chunk.
+ */
+class PickSeries
+{
+public:
+	PickSeries(SWWReader * aReader);
+	~PickSeries();
+
+	/**
+	 * Start reading the series at a point, cancelling any earlier read.
+	 * @param aPoint point in the reader's normalised coordinates, ie. a pick hit
+	 * @param aType quantity to read
+	 * @param aTitle graph title
+	 */
+	void request(const osg::Vec3 & aPoint, SWWReader::TimeSeriesType aType, const std::string & aTitle);
+
+	/**
+	 * Hide the series, cancelling any read.
+	 */
+	void clear();
+
+	/**
+	 * Pass the latest part of the series on to the HUD. Call once per frame.
+	 */
+	void update(HeadsUpDisplay * aHUD);
+
+protected:
+
+	class FetchJob;
+
+	/**
+	 * Called by the fetch thread with the series so far.
+	 * @param aSeries series read so far, NULL if the read failed
+	 * @return false if the fetch has been superseded
+	 */
+	bool fetched(unsigned int aGeneration, osg::FloatArray * aSeries, size_t aNumRead, bool aDone);
+
+protected:
+	SWWReader * _sww;
+	WorkerPool _pool;	/**< One thread, a superseded fetch still queued returns at once */
+	OpenThreads::Atomic _generation;	/**< Bumped by each request, older fetches stop */
+
+	std::string _title;
+	float _timeLength;
+	size_t _numTimesteps;
+
+	// latest progress from the fetch thread
+	OpenThreads::Mutex _mutex;
+	osg::ref_ptr<osg::FloatArray> _series;
+	size_t _numRead;
+	bool _done;
+	bool _failed;	/**< The last read couldn't be completed */
+	bool _updated;	/**< HUD needs the series again */
+};
+
+#endif  // PICKSERIES_H
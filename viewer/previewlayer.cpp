@@ -0,0 +1,244 @@
+/*
+  PreviewLayer class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <osg/Geode>
+#include <osg/Notify>
+
+#include "hud.h"
+#include "previewlayer.h"
+
+
+/**
+ * Take the preview frames, handing each to the render thread as it is taken.
+ */
+class PreviewLayer::ComputeJob : public WorkerPool::Job
+{
+public:
+	ComputeJob(PreviewLayer * aOwner) : _owner(aOwner) {}
+
+	virtual void run()
+	{
+		if (!_owner->_frames.compute(_owner->_sww))
+		{
+			osg::notify(osg::INFO) << "[PreviewLayer] No preview of " << _owner->_sww->getFilename() << std::endl;
+		}
+	}
+
+private:
+	PreviewLayer * _owner;
+};
+
+
+PreviewLayer::PreviewLayer(SWWReader * aReader, WaterSurface * aWater, size_t aMaxBytes) :
+	_sww(aReader),
+	_frames(aMaxBytes),
+	_requested(0),
+	_changed(0.0),
+	_settled(0),
+	_built(-1),
+	_builtQuantity(DerivedQuantity::DQ_NUM_OF),
+	_showing(false),
+	_pool(1, 0, OpenThreads::Thread::THREAD_PRIORITY_LOW)
+{
+	_geom = new osg::Geometry;
+	_geom->setUseDisplayList(false);
+	_geom->setUseVertexBufferObjects(true);
+	_geom->setDataVariance(osg::Object::DYNAMIC);
+
+	// drawn just as the water surface is
+	osg::Geode * geode = new osg::Geode;
+	geode->addDrawable(_geom.get());
+	geode->setStateSet(aWater->get()->getStateSet());
+
+	_switch = new osg::Switch;
+	_switch->addChild(geode, false);
+
+	_full.push_back(aWater->get());
+	_pool.add(new ComputeJob(this));
+}
+
+
+PreviewLayer::~PreviewLayer()
+{
+	_frames.cancel();
+	_pool.wait();
+}
+
+
+void PreviewLayer::addFullSurface(osg::Node * aNode)
+{
+	_full.push_back(aNode);
+}
+
+
+unsigned int PreviewLayer::update(unsigned int aTimestep, bool aStepping, double aTime, HeadsUpDisplay * aHUD)
+{
+	char status[32];
+	const float progress = _frames.getProgress();
+	if (progress < 1.0f)
+	{
+		sprintf(status, "building %d%%", (int) (100 * progress));
+	}
+	else
+	{
+		sprintf(status, "ready");
+	}
+	if (_status != status)
+	{
+		_status = status;
+		aHUD->setStatus("preview", _status);
+	}
+
+	if (aTimestep != _requested)
+	{
+		_requested = aTimestep;
+		_changed = aTime;
+	}
+
+	// the full frame once the steps stop, or wherever the preview can't stand in for it
+	const bool settled = !aStepping || (aTimestep == _settled) || (aTime - _changed >= PREVIEW_SETTLE_SECONDS);
+	if (settled || !_frames.isReady(aTimestep))
+	{
+		show(false);
+		_settled = aTimestep;
+		return aTimestep;
+	}
+
+	const DerivedQuantity::Type quantity = _sww->getColourQuantity();
+	if (((int) aTimestep != _built) || (quantity != _builtQuantity))
+	{
+		if (!build(aTimestep))
+		{
+			show(false);
+			_settled = aTimestep;
+			return aTimestep;
+		}
+		_built = aTimestep;
+		_builtQuantity = quantity;
+	}
+
+	// the full surfaces keep the last settled frame, rather than reading each step
+	show(true);
+	return _settled;
+}
+
+
+bool PreviewLayer::build(unsigned int aTimestep)
+{
+	const std::vector<unsigned int> & vertices = _frames.getVertices();
+	const std::vector<unsigned int> & triangles = _frames.getTriangles();
+	osg::ref_ptr<osg::Vec3Array> bed = _sww->getBedslopeVertexArray();
+	const size_t n = vertices.size();
+
+	// vertices ascend, so the last is the largest
+	if (!bed.valid() || n == 0 || vertices[n-1] >= bed->size())
+	{
+		return false;
+	}
+
+	const float scale = _sww->getScale();
+	const float * depth = _frames.getDepth(aTimestep);
+	const float * xmomentum = _frames.getXMomentum(aTimestep);
+	const float * ymomentum = _frames.getYMomentum(aTimestep);
+
+	osg::Vec3Array * points = new osg::Vec3Array(n);
+	for (size_t i=0; i<n; i++)
+	{
+		const osg::Vec3 & b = bed->at(vertices[i]);
+		(*points)[i].set(b.x(), b.y(), b.z() + depth[i] * scale);
+	}
+
+	// averaged from the triangles around each vertex, as for the water surface
+	osg::Vec3Array * normals = new osg::Vec3Array(n);
+	for (size_t it=0; it+2<triangles.size(); it+=3)
+	{
+		const osg::Vec3 & v1 = (*points)[triangles[it]];
+		const osg::Vec3 & v2 = (*points)[triangles[it+1]];
+		const osg::Vec3 & v3 = (*points)[triangles[it+2]];
+		osg::Vec3 nrm = (v2 - v1) ^ (v3 - v2);
+		nrm.normalize();
+		for (int i=0; i<3; i++)
+		{
+			(*normals)[triangles[it+i]] += nrm;
+		}
+	}
+	for (size_t i=0; i<n; i++)
+	{
+		(*normals)[i].normalize();
+	}
+
+	// the quantity the water is coloured by, computed from depth over a flat bed
+	std::vector<float> quantity;
+	if (xmomentum && ymomentum)
+	{
+		std::vector<float> zeros(n, 0.0f);
+		quantity.resize(n);
+		DerivedQuantity::compute(_sww->getColourQuantity(), n, depth, &zeros[0], xmomentum, ymomentum, &quantity[0]);
+	}
+
+	// alpha from the height of water, as the reader maps it
+	const float heightmin = _sww->getHeightMin();
+	const float alphamin = _sww->getAlphaMin();
+	const float alphamax = _sww->getAlphaMax();
+	const float alphascale = (alphamax - alphamin) / (_sww->getHeightMax() - heightmin);
+	const float quantityscale = 1.0f / DerivedQuantity::getScale(_sww->getColourQuantity());
+	osg::Vec4Array * colours = new osg::Vec4Array(n);
+	for (size_t i=0; i<n; i++)
+	{
+		const float height = depth[i] * scale;
+		float alpha = 0.0f;
+		if (height >= heightmin)
+		{
+			alpha = osg::minimum(alphascale * (height - heightmin) + alphamin, alphamax);
+		}
+
+		if (!quantity.empty())
+		{
+			const float intens = osg::minimum(1.0f, quantity[i] * quantityscale);
+			(*colours)[i].set(1.0f - intens, (0.5f - fabs(intens - 0.5f)) * 2, intens, alpha);
+		}
+		else
+		{
+			(*colours)[i].set(1.0f, 1.0f, 1.0f, alpha);
+		}
+	}
+
+	_geom->setVertexArray(points);
+	_geom->setNormalArray(normals);
+	_geom->setNormalBinding(osg::Geometry::BIND_PER_VERTEX);
+	_geom->setColorArray(colours);
+	_geom->setColorBinding(osg::Geometry::BIND_PER_VERTEX);
+
+	// the triangles never change
+	if (_geom->getNumPrimitiveSets() == 0)
+	{
+		osg::DrawElementsUInt * indices = new osg::DrawElementsUInt(osg::PrimitiveSet::TRIANGLES);
+		indices->insert(indices->end(), triangles.begin(), triangles.end());
+		_geom->addPrimitiveSet(indices);
+	}
+	_geom->dirtyBound();
+
+	return true;
+}
+
+
+void PreviewLayer::show(bool aPreview)
+{
+	if (aPreview == _showing)
+	{
+		return;
+	}
+	_showing = aPreview;
+
+	_switch->setValue(0, aPreview);
+	for (size_t i=0; i<_full.size(); i++)
+	{
+		_full[i]->setNodeMask(aPreview ? 0 : ~0);
+	}
+}
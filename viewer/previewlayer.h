@@ -0,0 +1,105 @@
+/*
+    PreviewLayer class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef PREVIEWLAYER_H
+#define PREVIEWLAYER_H
+
+#include <string>
+#include <vector>
+#include <osg/Geometry>
+#include <osg/Switch>
+#include <osg/ref_ptr>
+
+#include <swwreader.h>
+#include <previewframes.h>
+#include <workerpool.h>
+
+#include "watersurface.h"
+
+class HeadsUpDisplay;
+
+// seconds without a step before the full frame is read in place of the preview
+#define PREVIEW_SETTLE_SECONDS 0.3
+
+/**
+ * A coarse water surface shown in place of the full one while the user steps through
+ * the timesteps by hand, so each step shows at once however large the mesh, the full
+ * frame being read only once the steps stop.
+ *
+ * The preview frames are taken in a low priority pass over the file, or from their
+ * sidecar, started when the layer is made; steps to timesteps the pass hasn't reached
+ * yet read the full frame as before. The preview looks like the water surface, sharing
+ * its state, but has no steep triangles culled.
+ */
+class PreviewLayer
+{
+public:
+	/**
+	 * @param aReader reader of the run
+	 * @param aWater the run's water surface, hidden while the preview stands in for it
+	 * @param aMaxBytes most the preview frames take
+	 */
+	PreviewLayer(SWWReader * aReader, WaterSurface * aWater, size_t aMaxBytes);
+
+	/**
+	 * Destructor, stops the pass.
+	 */
+	~PreviewLayer();
+
+	/**
+	 * Add another node of full resolution surfaces, hidden while the preview is shown.
+	 */
+	void addFullSurface(osg::Node * aNode);
+
+	/**
+	 * Show the preview of a timestep while the user steps through them, or the full
+	 * frame once they stop, and tell the HUD how far the pass has got. Call once per frame,
+	 * before the surfaces are given their timestep.
+	 * @param aStepping is the user stepping by hand, rather than playing or following
+	 * @param aTime wall time, seconds
+	 * @return timestep the full resolution surfaces are to show
+	 */
+	unsigned int update(unsigned int aTimestep, bool aStepping, double aTime, HeadsUpDisplay * aHUD);
+
+	/**
+	 * Get the switch holding the preview surface, drawn in the run's normalised
+	 * coordinates.
+	 */
+	osg::Switch * get()	{	return _switch.get();	}
+
+protected:
+
+	class ComputeJob;
+
+	/**
+	 * Fill the preview surface with a timestep's frame.
+	 * @return false if the mesh no longer matches the preview
+	 */
+	bool build(unsigned int aTimestep);
+
+	/**
+	 * Show the preview in place of the full surfaces, or the other way round.
+	 */
+	void show(bool aPreview);
+
+protected:
+	SWWReader * _sww;
+	PreviewFrames _frames;
+	std::vector<osg::Node*> _full;	/**< Hidden while the preview is shown */
+	osg::ref_ptr<osg::Switch> _switch;
+	osg::ref_ptr<osg::Geometry> _geom;
+	unsigned int _requested;	/**< Timestep last asked for */
+	double _changed;	/**< When it was asked for */
+	unsigned int _settled;	/**< Timestep shown at full resolution */
+	int _built;	/**< Timestep in the preview surface, -1 for none */
+	DerivedQuantity::Type _builtQuantity;
+	bool _showing;
+	std::string _status;
+	WorkerPool _pool;	/**< One thread, runs the pass */
+};
+
+#endif  // PREVIEWLAYER_H
@@ -0,0 +1,80 @@
+/*
+  ReadAhead class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <utility>
+
+#include "readahead.h"
+
+
+ReadAhead::ReadAhead(SWWReader * aReader, unsigned int aNumFrames) :
+	_sww(aReader),
+	_numFrames(aNumFrames)
+{
+}
+
+
+ReadAhead::~ReadAhead()
+{
+	for (size_t i=0; i<_requests.size(); i++)
+	{
+		_requests[i]->cancel();
+	}
+}
+
+
+void ReadAhead::update(unsigned int aTimestep, unsigned int aShown, bool aPlaying)
+{
+	// timesteps wanted, and how urgently
+	std::vector< std::pair<unsigned int, int> > wanted;
+	if (aShown != aTimestep)
+	{
+		wanted.push_back(std::make_pair(aShown, 0));
+	}
+	if (aPlaying)
+	{
+		const unsigned int ntimesteps = _sww->getNumberOfTimesteps();
+		for (unsigned int i=1; i<=_numFrames && aTimestep+i<ntimesteps; i++)
+		{
+			wanted.push_back(std::make_pair(aTimestep+i, -(int) i));
+		}
+	}
+
+	// those gone past or no longer wanted are dropped unread
+	size_t kept = 0;
+	for (size_t i=0; i<_requests.size(); i++)
+	{
+		bool keep = false;
+		for (size_t j=0; j<wanted.size() && !keep; j++)
+		{
+			keep = (_requests[i]->getTimestep() == wanted[j].first);
+		}
+
+		if (keep)
+		{
+			_requests[kept++] = _requests[i];
+		}
+		else
+		{
+			_requests[i]->cancel();
+		}
+	}
+	_requests.resize(kept);
+
+	for (size_t j=0; j<wanted.size(); j++)
+	{
+		bool asked = false;
+		for (size_t i=0; i<_requests.size() && !asked; i++)
+		{
+			asked = (_requests[i]->getTimestep() == wanted[j].first);
+		}
+
+		if (!asked)
+		{
+			_requests.push_back(_sww->requestFrame(wanted[j].first, wanted[j].second));
+		}
+	}
+}
@@ -0,0 +1,54 @@
+/*
+    ReadAhead class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include <vector>
+#include <osg/ref_ptr>
+
+#include <swwreader.h>
+
+// frames read ahead of the one shown while playing
+#define READAHEAD_FRAMES 2
+
+/**
+ * Asks the reader for the frames about to be shown, so they are read in the background
+ * while the current one is drawn, and cancels those no longer wanted, such as the steps
+ * the user has gone past.
+ *
+ * While playing, or exporting, the next few timesteps are wanted, nearest first. While
+ * a preview stands in for the timestep stepped to, that one is.
+ */
+class ReadAhead
+{
+public:
+	/**
+	 * @param aNumFrames timesteps read ahead while playing
+	 */
+	ReadAhead(SWWReader * aReader, unsigned int aNumFrames = READAHEAD_FRAMES);
+
+	/**
+	 * Destructor, cancels the requests not yet read.
+	 */
+	~ReadAhead();
+
+	/**
+	 * Ask for the frames wanted next and cancel the rest. Call once per frame.
+	 * @param aTimestep timestep loaded now
+	 * @param aShown timestep on screen, a preview's while stepping by hand
+	 * @param aPlaying moving forward by itself, so the timesteps after are wanted
+	 */
+	void update(unsigned int aTimestep, unsigned int aShown, bool aPlaying);
+
+protected:
+	SWWReader * _sww;
+	unsigned int _numFrames;
+	std::vector< osg::ref_ptr<FrameRequest> > _requests;	/**< Still wanted, read or not */
+};
+
+#endif  // READAHEAD_H
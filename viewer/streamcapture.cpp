@@ -0,0 +1,280 @@
+/*
+  StreamCapture class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef WIN32
+#define popen _popen
+#define pclose _pclose
+#define POPEN_WRITE "wb"
+#else
+#include <signal.h>
+#define POPEN_WRITE "w"
+#endif
+
+#include <osg/Notify>
+#include <osgDB/FileNameUtils>
+
+#include "streamcapture.h"
+
+
+/**
+ * Pass one collected frame to the writer thread.
+ */
+class StreamCapture::HoldFrameJob : public WorkerPool::Job
+{
+public:
+	HoldFrameJob(const StreamCapture * aCapture, osg::Image * aImage, double aTime) :
+		_capture(const_cast<StreamCapture*>(aCapture)),
+		_image(aImage),
+		_time(aTime)
+	{
+	}
+
+	virtual void run()
+	{
+		_capture->holdFrame(_image.get(), _time);
+	}
+
+private:
+	StreamCapture * _capture;
+	osg::ref_ptr<osg::Image> _image;
+	double _time;
+};
+
+
+// a single writer thread keeps the frames in capture order
+StreamCapture::StreamCapture(const std::string & aTarget, StreamFormat aFormat, double aFrameRate, double aTimeScale) :
+	FrameCapture("", "", 1),
+	_target(aTarget),
+	_format(aFormat),
+	_frameRate(aFrameRate),
+	_timeScale(aTimeScale),
+	_stream(NULL),
+	_pipe(false),
+	_failed(false),
+	_heldTime(-1.0),
+	_carry(0.0),
+	_width(0),
+	_height(0),
+	_streamFrames(0)
+{
+}
+
+
+StreamCapture::~StreamCapture()
+{
+	// frames still queued are written before the stream closes
+	delete _pool;
+	_pool = NULL;
+
+	close();
+}
+
+
+StreamCapture::StreamFormat StreamCapture::formatFromString(const std::string & aName)
+{
+	std::string name = osgDB::getLowerCaseFileExtension(aName);
+	if (name.empty())
+	{
+		name = aName;
+	}
+
+	if (name == "rgb" || name == "raw")
+	{
+		return FORMAT_RGB;
+	}
+	if (name == "ppm")
+	{
+		return FORMAT_PPM;
+	}
+	return FORMAT_Y4M;
+}
+
+
+bool StreamCapture::open()
+{
+	if (!_target.empty() && _target[0] == '|')
+	{
+#ifndef WIN32
+		// an encoder exiting early shows up as a failed write rather than killing the viewer
+		signal(SIGPIPE, SIG_IGN);
+#endif
+		_stream = popen(_target.c_str() + 1, POPEN_WRITE);
+		_pipe = true;
+	}
+	else
+	{
+		_stream = fopen(_target.c_str(), "wb");
+		_pipe = false;
+	}
+
+	if (!_stream)
+	{
+		osg::notify(osg::FATAL) << "[StreamCapture] Unable to open " << _target << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+
+void StreamCapture::close()
+{
+	if (!_stream)
+	{
+		return;
+	}
+
+	if (_pipe)
+	{
+		if (pclose(_stream) != 0)
+		{
+			osg::notify(osg::WARN) << "[StreamCapture] " << _target.substr(1) << " exited with an error" << std::endl;
+		}
+	}
+	else
+	{
+		fclose(_stream);
+	}
+
+	_stream = NULL;
+}
+
+
+void StreamCapture::finish(osgViewer::Viewer & aViewer)
+{
+	FrameCapture::finish(aViewer);
+
+	// writer thread is idle, the last frame is shown for one stream frame
+	if (_held.valid())
+	{
+		writeFrame(_held.get(), 1);
+		_held = NULL;
+	}
+
+	close();
+}
+
+
+void StreamCapture::submit(osg::Image * aImage, unsigned int /*aContextID*/, unsigned int /*aSequence*/, double aTime) const
+{
+	// blocks here while the writer is behind
+	_pool->add(new HoldFrameJob(this, aImage, aTime));
+}
+
+
+void StreamCapture::holdFrame(osg::Image * aImage, double aTime)
+{
+	if (_held.valid())
+	{
+		unsigned int count = 1;
+
+		// frames of a paused simulation are each written once
+		if (_timeScale > 0.0 && _heldTime >= 0.0 && aTime > _heldTime)
+		{
+			// the held frame stays on screen until this frame's simulation time; one
+			// shorter than a stream frame is dropped and its time carried on, so the
+			// stream keeps to simulation time
+			double exact = (aTime - _heldTime) * _frameRate / _timeScale + _carry;
+			count = (exact >= 1.0) ? (unsigned int) floor(exact) : 0;
+			_carry = exact - count;
+		}
+
+		if (count > 0)
+		{
+			writeFrame(_held.get(), count);
+		}
+	}
+
+	_held = aImage;
+	_heldTime = aTime;
+}
+
+
+void StreamCapture::writeFrame(osg::Image * aImage, unsigned int aCount)
+{
+	if (!_stream || _failed)
+	{
+		return;
+	}
+
+	const int width = aImage->s();
+	const int height = aImage->t();
+
+	if (_width == 0)
+	{
+		// stream header, the frame size can't change after this
+		_width = width;
+		_height = height;
+
+		if (_format == FORMAT_Y4M)
+		{
+			fprintf(_stream, "YUV4MPEG2 W%d H%d F%u:1000 Ip A1:1 C444\n", _width, _height, (unsigned int) (_frameRate*1000.0 + 0.5));
+		}
+	}
+	else if (width != _width || height != _height)
+	{
+		osg::notify(osg::WARN) << "[StreamCapture] Frame size changed to " << width << "x" << height << ", frame dropped" << std::endl;
+		return;
+	}
+
+	const size_t npixels = (size_t) width * height;
+	_buffer.resize(npixels * 3);
+
+	// glReadPixels rows run bottom up, streams are top down
+	unsigned char * dst = &_buffer[0];
+	for (int row=height-1; row>=0; row--)
+	{
+		const unsigned char * src = aImage->data(0, row);
+
+		if (_format == FORMAT_Y4M)
+		{
+			// BT.601 studio range, planar
+			unsigned char * y = dst;
+			unsigned char * u = dst + npixels;
+			unsigned char * v = dst + 2*npixels;
+			for (int i=0; i<width; i++, src+=3)
+			{
+				int r = src[0], g = src[1], b = src[2];
+				*y++ = (unsigned char) (((66*r + 129*g + 25*b + 128) >> 8) + 16);
+				*u++ = (unsigned char) (((-38*r - 74*g + 112*b + 128) >> 8) + 128);
+				*v++ = (unsigned char) (((112*r - 94*g - 18*b + 128) >> 8) + 128);
+			}
+			dst += width;
+		}
+		else
+		{
+			memcpy(dst, src, width*3);
+			dst += width*3;
+		}
+	}
+
+	for (unsigned int n=0; n<aCount; n++)
+	{
+		if (_format == FORMAT_Y4M)
+		{
+			fputs("FRAME\n", _stream);
+		}
+		else if (_format == FORMAT_PPM)
+		{
+			fprintf(_stream, "P6\n%d %d\n255\n", width, height);
+		}
+
+		if (fwrite(&_buffer[0], 1, _buffer.size(), _stream) != _buffer.size())
+		{
+			osg::notify(osg::FATAL) << "[StreamCapture] Write to " << _target << " failed, stopping capture" << std::endl;
+			_failed = true;
+			return;
+		}
+		_streamFrames++;
+	}
+
+	frameWritten();
+}
@@ -0,0 +1,117 @@
+/*
+    StreamCapture class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef STREAMCAPTURE_H
+#define STREAMCAPTURE_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "framecapture.h"
+
+/**
+ * Captures rendered frames into a single uncompressed video stream, written to a file or
+ * piped into another process such as an encoder.
+ *
+ * Frames are written from one thread in capture order. Each frame is held until the next
+ * one arrives and then repeated to cover the simulation time between them, so the stream
+ * plays back at a constant rate proportional to simulation time however unevenly the
+ * timesteps were stored. A frame is always written at least once.
+ *
+ * Formats
+ *
+ * FORMAT_Y4M  YUV4MPEG2, 4:4:4 with the frame rate in the header
+ * FORMAT_RGB  bare 8 bit RGB pixels, top row first, no header
+ * FORMAT_PPM  concatenated binary PPM images, lossless and self-describing
+ *
+ * Usage
+ *
+ * osg::ref_ptr<StreamCapture> capture = new StreamCapture("|ffmpeg -i - out.mp4", StreamCapture::FORMAT_Y4M, 25.0, 60.0);
+ * if (capture->open()) viewer.getCamera()->setPostDrawCallback(capture.get());
+ */
+class StreamCapture : public FrameCapture
+{
+public:
+	enum StreamFormat
+	{
+		FORMAT_Y4M,
+		FORMAT_RGB,
+		FORMAT_PPM
+	};
+
+	/**
+	 * Constructor
+	 * @param aTarget file to write, or a command to pipe into if it starts with '|'
+	 * @param aFormat stream format
+	 * @param aFrameRate stream frames per second
+	 * @param aTimeScale simulation seconds per second of stream, 0 to write each frame once
+	 */
+	StreamCapture(const std::string & aTarget, StreamFormat aFormat, double aFrameRate, double aTimeScale);
+
+	/**
+	 * Open the file or start the pipe command.
+	 * @return false on error
+	 */
+	bool open();
+
+	/**
+	 * Flush the held frame and close the stream once all frames have been collected.
+	 */
+	virtual void finish(osgViewer::Viewer & aViewer);
+
+	/**
+	 * Get the number of frames in the stream, including repeats.
+	 */
+	unsigned int getNumStreamFrames()	{	return _streamFrames;	}
+
+	/**
+	 * Get the stream format named by a string, or implied by a target's extension.
+	 * @param aName "y4m", "rgb", "raw" or "ppm"; anything else selects y4m
+	 */
+	static StreamFormat formatFromString(const std::string & aName);
+
+protected:
+
+	virtual ~StreamCapture();
+
+	virtual void submit(osg::Image * aImage, unsigned int aContextID, unsigned int aSequence, double aTime) const;
+
+	/**
+	 * Append a frame a number of times, called from the writer thread only.
+	 */
+	void writeFrame(osg::Image * aImage, unsigned int aCount);
+
+	/**
+	 * Hold a frame until the next arrives, writing the previous held frame. Writer thread only.
+	 */
+	void holdFrame(osg::Image * aImage, double aTime);
+
+	void close();
+
+	class HoldFrameJob;
+
+protected:
+	std::string _target;
+	StreamFormat _format;
+	double _frameRate;
+	double _timeScale;
+
+	FILE * _stream;
+	bool _pipe;
+	bool _failed;	/**< A write failed, the rest of the stream is discarded */
+
+	// writer thread state
+	osg::ref_ptr<osg::Image> _held;	/**< Frame waiting for its display time to be known */
+	double _heldTime;
+	double _carry;	/**< Fraction of a stream frame left over from the frames written so far */
+	int _width, _height;	/**< Frame size fixed by the first frame */
+	std::vector<unsigned char> _buffer;	/**< One converted frame */
+	unsigned int _streamFrames;
+};
+
+#endif  // STREAMCAPTURE_H
@@ -0,0 +1,381 @@
+/*
+  TilePager class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <functional>
+#include <osg/Notify>
+#include <osg/Viewport>
+#include <OpenThreads/ScopedLock>
+
+#include "hud.h"
+#include "tilepager.h"
+
+
+/**
+ * Load a tile's reader, handed back to the main thread to be given its surfaces.
+ */
+class TilePager::LoadJob : public WorkerPool::Job
+{
+public:
+	LoadJob(TilePager * aOwner, unsigned int aTile) : _owner(aOwner), _tile(aTile) {}
+
+	virtual void run()
+	{
+		TileSWWReader * sww = new TileSWWReader(_owner->_tiles.get(), _tile, false, _owner->_overview->getLoadOptions());
+
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_owner->_loadedMutex);
+		_owner->_loaded.push_back(sww);
+	}
+
+private:
+	TilePager * _owner;
+	unsigned int _tile;
+};
+
+
+TilePager::TilePager(TileSWWReader * aOverview, BedSlope * aBedslope, WaterSurface * aWater, size_t aBudget, const std::string & aTexture) :
+	_overview(aOverview),
+	_bedslope(aBedslope),
+	_water(aWater),
+	_tiles(aOverview->getTileSet()),
+	_budget(aBudget),
+	_texture(aTexture),
+	_textured(true),
+	_dirtyHidden(false),
+	_group(new osg::Group),
+	_numLoaded(0),
+	_numLoading(0),
+	_numTimesteps(aOverview->getNumberOfTimesteps()),
+	_frame(0),
+	_pool(2, 0, OpenThreads::Thread::THREAD_PRIORITY_LOW)
+{
+	Tile empty;
+	empty._sww = NULL;
+	empty._bedslope = NULL;
+	empty._water = NULL;
+	empty._loading = false;
+	empty._failed = false;
+	empty._wanted = 0;
+	_tileList.resize(_tiles->getNumTiles(), empty);
+	_hidden.resize(_tiles->getNumTiles(), false);
+
+	// the overview is always loaded
+	_resident = _tiles->getTileBytes(_tiles->getOverview());
+}
+
+
+TilePager::~TilePager()
+{
+	_pool.wait();
+	for (size_t i=0; i<_loaded.size(); i++)
+	{
+		delete _loaded[i];
+	}
+
+	for (unsigned int it=0; it<_tileList.size(); it++)
+	{
+		if (_tileList[it]._sww)
+		{
+			drop(it);
+		}
+	}
+	freeDropped();
+}
+
+
+void TilePager::setTextured(bool aIsTextured)
+{
+	_textured = aIsTextured;
+	for (size_t it=0; it<_tileList.size(); it++)
+	{
+		if (_tileList[it]._sww)
+		{
+			_tileList[it]._bedslope->onRefreshTextured(aIsTextured);
+		}
+	}
+}
+
+
+void TilePager::update(osg::Camera * aCamera, unsigned int aTimestep, HeadsUpDisplay * aHUD)
+{
+	_frame++;
+
+	// out of the scene since the last frame was drawn, so no longer being drawn
+	freeDropped();
+	attachLoaded();
+
+	std::vector<unsigned int> wanted;
+	chooseTiles(aCamera, wanted);
+	for (size_t i=0; i<wanted.size(); i++)
+	{
+		_tileList[wanted[i]]._wanted = _frame;
+	}
+
+	// largest on screen first, counted against the budget from when they start loading
+	for (size_t i=0; i<wanted.size() && _numLoading<TILEPAGER_MAX_LOADING; i++)
+	{
+		const unsigned int it = wanted[i];
+		Tile & tile = _tileList[it];
+		if (tile._sww || tile._loading || tile._failed)
+		{
+			continue;
+		}
+
+		const size_t bytes = _tiles->getTileBytes(it);
+		if (!makeRoom(bytes))
+		{
+			continue;
+		}
+
+		_resident += bytes;
+		tile._loading = true;
+		_numLoading++;
+		_pool.add(new LoadJob(this, it));
+	}
+
+	// tiles leave watching the file to the overview, so are told of what it has seen:
+	// timesteps appended, or the file reloaded with new triangles
+	const bool reloaded = (_overview->getBedslopeIndexArray().get() != _indices.get());
+	if (reloaded || (_overview->getNumberOfTimesteps() != _numTimesteps))
+	{
+		_numTimesteps = _overview->getNumberOfTimesteps();
+		for (size_t it=0; it<_tileList.size(); it++)
+		{
+			if (_tileList[it]._sww)
+			{
+				_tileList[it]._sww->markChanged();
+			}
+		}
+	}
+
+	// the overview's triangles are read again when its file changes
+	if (_dirtyHidden || reloaded)
+	{
+		_indices = _overview->hideTiles(_hidden);
+		_bedslope->refreshIndices();
+		_water->refreshIndices();
+		_dirtyHidden = false;
+	}
+
+	// looking the same as the overview, so the tiles can't be told from it
+	for (size_t it=0; it<_tileList.size(); it++)
+	{
+		const Tile & tile = _tileList[it];
+		if (!tile._sww)
+		{
+			continue;
+		}
+
+		tile._water->setTimeStep(aTimestep);
+		tile._bedslope->setTimeStep(aTimestep);
+		tile._water->setWireframe(_water->getWireframe());
+		tile._bedslope->setWireframe(_bedslope->getWireframe());
+		tile._water->setCulling(_water->getCulling());
+		tile._water->setColourQuantity(_overview->getColourQuantity());
+
+		tile._water->update();
+		tile._bedslope->update();
+	}
+
+	char status[64];
+	sprintf(status, "%u of %u, %u MB", _numLoaded, _tiles->getNumTiles(), (unsigned int) (_resident / (1024*1024)));
+	if (_status != status)
+	{
+		_status = status;
+		aHUD->setStatus("tiles", _status);
+	}
+}
+
+
+void TilePager::attachLoaded()
+{
+	std::vector<TileSWWReader*> loaded;
+	{
+		OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_loadedMutex);
+		loaded.swap(_loaded);
+	}
+
+	for (size_t i=0; i<loaded.size(); i++)
+	{
+		TileSWWReader * sww = loaded[i];
+		const unsigned int it = sww->getTile();
+		Tile & tile = _tileList[it];
+		tile._loading = false;
+		_numLoading--;
+
+		if (!sww->isValid())
+		{
+			osg::notify(osg::WARN) << "[TilePager] Could not load tile " << it << " of " << sww->getFilename() << std::endl;
+			delete sww;
+			tile._failed = true;
+			_resident -= _tiles->getTileBytes(it);
+			continue;
+		}
+
+		// loaded from the file as it was, which may have changed since
+		if (sww->getNumberOfTimesteps() != _overview->getNumberOfTimesteps())
+		{
+			sww->markChanged();
+		}
+
+		sww->setSwollenDir( _overview->getSwollenDir() );
+		sww->setHeightMin( _overview->getHeightMin() );
+		sww->setHeightMax( _overview->getHeightMax() );
+		sww->setAlphaMin( _overview->getAlphaMin() );
+		sww->setAlphaMax( _overview->getAlphaMax() );
+		sww->setCullAngle( _overview->getCullAngle() );
+		if (!_texture.empty())
+		{
+			sww->setBedslopeTexture(_texture);
+		}
+
+		// the overview's texture, rather than each tile loading the image again
+		tile._sww = sww;
+		tile._bedslope = new BedSlope(sww, _bedslope->getTexture());
+		tile._bedslope->onRefreshTextured(_textured);
+		tile._water = new WaterSurface(sww);
+
+		tile._group = new osg::Group;
+		tile._group->addChild(tile._bedslope->get());
+		tile._group->addChild(tile._water->get());
+		_group->addChild(tile._group.get());
+
+		_hidden[it] = true;
+		_dirtyHidden = true;
+		_numLoaded++;
+	}
+}
+
+
+void TilePager::chooseTiles(osg::Camera * aCamera, std::vector<unsigned int> & aWanted)
+{
+	double fovy, aspect, znear, zfar;
+	if (!aCamera || !aCamera->getViewport() || !aCamera->getProjectionMatrixAsPerspective(fovy, aspect, znear, zfar))
+	{
+		return;
+	}
+
+	// half the view across and up, at unit distance
+	const double ty = tan(osg::DegreesToRadians(fovy) / 2.0);
+	const double tx = ty * aspect;
+	const double pixels = aCamera->getViewport()->height() / (2.0 * ty);
+
+	// tiles to eye coordinates, through the model's transform
+	osg::Matrix toEye = aCamera->getViewMatrix();
+	osg::MatrixList world = _group->getWorldMatrices();
+	if (!world.empty())
+	{
+		toEye = world[0] * toEye;
+	}
+
+	std::vector< std::pair<double, unsigned int> > inView;
+	for (unsigned int it=0; it<_tileList.size(); it++)
+	{
+		if (_tiles->getTileInfo(it)._numTriangles == 0)
+		{
+			continue;
+		}
+
+		// bounding sphere in eye coordinates, looking down -z
+		osg::BoundingBox box = _overview->getTileBounds(it);
+		osg::Vec3 centre = box.center() * toEye;
+		double radius = 0.0;
+		for (unsigned int ic=0; ic<8; ic++)
+		{
+			radius = osg::maximum(radius, (double) ((box.corner(ic) * toEye) - centre).length());
+		}
+
+		const double depth = -centre.z();
+		if ((depth + radius <= 0.0) ||
+			(fabs(centre.x()) - depth * tx > radius * sqrt(1.0 + tx * tx)) ||
+			(fabs(centre.y()) - depth * ty > radius * sqrt(1.0 + ty * ty)))
+		{
+			continue;
+		}
+
+		// radius on screen, as large as the view once the eye is inside the sphere
+		const double size = radius / osg::maximum(depth, radius) * pixels;
+		if (size >= TILEPAGER_MIN_PIXELS)
+		{
+			inView.push_back(std::make_pair(size, it));
+		}
+	}
+
+	std::sort(inView.begin(), inView.end(), std::greater< std::pair<double, unsigned int> >());
+	for (size_t i=0; i<inView.size(); i++)
+	{
+		aWanted.push_back(inView[i].second);
+	}
+}
+
+
+bool TilePager::makeRoom(size_t aBytes)
+{
+	if (_resident + aBytes <= _budget)
+	{
+		return true;
+	}
+
+	// loaded tiles out of view, longest out of it first
+	std::vector< std::pair<unsigned int, unsigned int> > unwanted;
+	size_t freed = 0;
+	for (unsigned int it=0; it<_tileList.size(); it++)
+	{
+		if (_tileList[it]._sww && (_tileList[it]._wanted != _frame))
+		{
+			unwanted.push_back(std::make_pair(_tileList[it]._wanted, it));
+			freed += _tiles->getTileBytes(it);
+		}
+	}
+
+	// dropping them all wouldn't be enough, so keep them
+	if (_resident + aBytes > _budget + freed)
+	{
+		return false;
+	}
+
+	std::sort(unwanted.begin(), unwanted.end());
+	for (size_t i=0; i<unwanted.size() && (_resident + aBytes > _budget); i++)
+	{
+		drop(unwanted[i].second);
+	}
+
+	return true;
+}
+
+
+void TilePager::drop(unsigned int aTile)
+{
+	Tile & tile = _tileList[aTile];
+	_group->removeChild(tile._group.get());
+	tile._group = NULL;
+
+	// freed once the frame drawn before it went is done with it
+	_dropped.push_back(tile);
+	tile._sww = NULL;
+	tile._bedslope = NULL;
+	tile._water = NULL;
+
+	_resident -= _tiles->getTileBytes(aTile);
+	_numLoaded--;
+	_hidden[aTile] = false;
+	_dirtyHidden = true;
+}
+
+
+void TilePager::freeDropped()
+{
+	for (size_t i=0; i<_dropped.size(); i++)
+	{
+		delete _dropped[i]._water;
+		delete _dropped[i]._bedslope;
+		delete _dropped[i]._sww;
+	}
+	_dropped.clear();
+}
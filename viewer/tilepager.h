@@ -0,0 +1,144 @@
+/*
+    TilePager class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef TILEPAGER_H
+#define TILEPAGER_H
+
+#include <string>
+#include <vector>
+#include <osg/Camera>
+#include <osg/Group>
+#include <osg/ref_ptr>
+#include <OpenThreads/Mutex>
+
+#include <tileswwreader.h>
+#include <workerpool.h>
+
+#include "bedslope.h"
+#include "watersurface.h"
+
+class HeadsUpDisplay;
+
+// tiles loading at once, and the smallest a tile may look on screen and still be loaded
+#define TILEPAGER_MAX_LOADING 4
+#define TILEPAGER_MIN_PIXELS 64
+
+/**
+ * The tiles of a mesh too large to load whole, loaded in the background where they are
+ * in view and dropped again once out of it, drawn over the overview.
+ *
+ * The overview is the viewer's own bedslope and water surface, always loaded. Tiles in
+ * view that look large enough on screen are loaded nearest first, dropping tiles that
+ * have gone longest out of view to keep within the memory budget. Once a tile is
+ * loaded the overview leaves out its triangles, so the tile is drawn in their place.
+ *
+ * Loaded tiles follow the overview's timestep and settings, reading frames only for
+ * their own vertices. They don't watch the file themselves, but take on the changes
+ * the overview's watcher sees.
+ */
+class TilePager
+{
+public:
+	/**
+	 * @param aOverview reader of the overview
+	 * @param aBedslope the overview's bedslope, updated by the caller
+	 * @param aWater the overview's water surface, updated by the caller
+	 * @param aBudget most memory the overview and loaded tiles hold, bytes
+	 * @param aTexture bedslope texture given on the command line, empty for none
+	 */
+	TilePager(TileSWWReader * aOverview, BedSlope * aBedslope, WaterSurface * aWater, size_t aBudget, const std::string & aTexture);
+
+	/**
+	 * Destructor, waits for loads in progress and drops every tile.
+	 */
+	~TilePager();
+
+	/**
+	 * Set the bedslope texturing of every loaded tile, and of those loaded later.
+	 */
+	void setTextured(bool aIsTextured);
+
+	/**
+	 * Load the tiles in view, drop those out of it, and bring the loaded tiles to the
+	 * overview's timestep and settings. Call once per frame, after the overview's
+	 * surfaces are set up.
+	 */
+	void update(osg::Camera * aCamera, unsigned int aTimestep, HeadsUpDisplay * aHUD);
+
+	/**
+	 * Get the group holding the loaded tiles' surfaces, drawn in the overview's
+	 * normalised coordinates.
+	 */
+	osg::Group * get()	{	return _group.get();	}
+
+protected:
+
+	class LoadJob;
+
+	struct Tile
+	{
+		TileSWWReader * _sww;	/**< NULL unless loaded */
+		BedSlope * _bedslope;
+		WaterSurface * _water;
+		osg::ref_ptr<osg::Group> _group;
+		bool _loading;
+		bool _failed;	/**< Couldn't be loaded, not tried again */
+		unsigned int _wanted;	/**< Frame it was last in view */
+	};
+
+	/**
+	 * Give the tiles loaded since the last frame their surfaces.
+	 */
+	void attachLoaded();
+
+	/**
+	 * Find the tiles in view and large enough on screen to load, largest first.
+	 */
+	void chooseTiles(osg::Camera * aCamera, std::vector<unsigned int> & aWanted);
+
+	/**
+	 * Drop tiles out of view, longest out of it first, until another tile fits.
+	 * @return false if it can't be made to fit
+	 */
+	bool makeRoom(size_t aBytes);
+
+	/**
+	 * Drop a loaded tile, drawing the overview in its place.
+	 */
+	void drop(unsigned int aTile);
+
+	/**
+	 * Free the surfaces and readers of tiles dropped since the last frame.
+	 */
+	void freeDropped();
+
+protected:
+	TileSWWReader * _overview;
+	BedSlope * _bedslope;
+	WaterSurface * _water;
+	osg::ref_ptr<TileSet> _tiles;
+	size_t _budget;
+	std::string _texture;
+	bool _textured;
+	std::vector<Tile> _tileList;
+	std::vector<Tile> _dropped;	/**< Out of the scene, freed next frame */
+	std::vector<bool> _hidden;	/**< Tiles the overview leaves out */
+	bool _dirtyHidden;
+	osg::ref_ptr<osg::DrawElementsUInt> _indices;	/**< Overview's triangles when last hidden */
+	osg::ref_ptr<osg::Group> _group;	/**< One child per loaded tile */
+	size_t _resident;	/**< Bytes held by the overview and tiles loaded or loading */
+	unsigned int _numLoaded;
+	unsigned int _numLoading;
+	unsigned int _numTimesteps;	/**< Overview's, when the tiles were last told of changes */
+	unsigned int _frame;
+	std::string _status;
+	OpenThreads::Mutex _loadedMutex;
+	std::vector<TileSWWReader*> _loaded;	/**< Readers loaded in the background, not yet attached */
+	WorkerPool _pool;	/**< Loads tiles at low priority, last so it stops first */
+};
+
+#endif  // TILEPAGER_H
@@ -0,0 +1,128 @@
+/*
+  TotalsPanel class
+
+  An OpenSceneGraph viewer for ANUGA .sww files.
+  Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#include <stdio.h>
+#include <osg/Notify>
+
+#include "hud.h"
+#include "totalspanel.h"
+
+// the graphs are redrawn about this many times as the totals come in
+#define TOTALS_REFRESH_STEPS 16
+
+
+/**
+ * Total the file.
+ */
+class TotalsPanel::ComputeJob : public WorkerPool::Job
+{
+public:
+	ComputeJob(TotalsPanel * aOwner) : _owner(aOwner) {}
+
+	virtual void run()
+	{
+		if (!_owner->_totals->compute(_owner->_sww))
+		{
+			osg::notify(osg::WARN) << "[TotalsPanel] Could not total " << _owner->_sww->getFilename() << std::endl;
+		}
+		_owner->_finished.exchange(1);
+	}
+
+private:
+	TotalsPanel * _owner;
+};
+
+
+TotalsPanel::TotalsPanel(SWWReader * aReader) :
+	_sww(aReader),
+	_totals(NULL),
+	_pool(1, 0, OpenThreads::Thread::THREAD_PRIORITY_LOW),
+	_enabled(false),
+	_dirty(false),
+	_numShown(0)
+{
+}
+
+
+TotalsPanel::~TotalsPanel()
+{
+	if (_totals)
+	{
+		_totals->cancel();
+		_pool.wait();
+		delete _totals;
+	}
+}
+
+
+void TotalsPanel::toggle()
+{
+	_enabled = !_enabled;
+	_dirty = true;
+
+	if (_enabled && !_totals)
+	{
+		_totals = new DomainTotals(DerivedQuantity::getMinDepth(), 0, true);
+		_pool.add(new ComputeJob(this));
+	}
+}
+
+
+void TotalsPanel::update(HeadsUpDisplay * aHUD)
+{
+	if (!_totals)
+	{
+		return;
+	}
+
+	const bool finished = (_finished != 0);
+	const unsigned int numtimesteps = _sww->getNumberOfTimesteps();
+	const unsigned int numdone = osg::minimum(_totals->getNumFramesDone(), numtimesteps);
+
+	std::string status = "off";
+	if (_enabled && !finished)
+	{
+		char progress[32];
+		sprintf(progress, "computing %d%%", (int) (100 * _totals->getProgress()));
+		status = progress;
+	}
+	else if (_enabled)
+	{
+		status = _totals->isValid() ? "on" : "unavailable";
+	}
+	if (_status != status)
+	{
+		_status = status;
+		aHUD->setStatus("totals", _status);
+	}
+
+	// redraw a few times as the totals come in, and once they're all in
+	const unsigned int step = osg::maximum(numtimesteps / TOTALS_REFRESH_STEPS, 1u);
+	const bool more = (numdone >= _numShown + step) || (finished && numdone != _numShown);
+	if (!_dirty && !(_enabled && more))
+	{
+		return;
+	}
+	_dirty = false;
+	_numShown = numdone;
+
+	const float timelength = numtimesteps ? _sww->getTime(numtimesteps-1) : 0.0f;
+	for (int q=0; q<DomainTotals::TOTAL_NUM_OF; q++)
+	{
+		const DomainTotals::Quantity quantity = (DomainTotals::Quantity) q;
+
+		// the leading timesteps are final, the rest not yet written
+		osg::ref_ptr<osg::FloatArray> data;
+		if (_enabled && numdone > 1)
+		{
+			const std::vector<float> & total = _totals->getTotal(quantity);
+			data = new osg::FloatArray(total.begin(), total.begin() + numdone);
+		}
+
+		aHUD->setSideGraph(q, DomainTotals::getName(quantity), data, DomainTotals::getUnits(quantity), timelength, numtimesteps);
+	}
+}
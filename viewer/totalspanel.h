@@ -0,0 +1,61 @@
+/*
+    TotalsPanel class
+
+    An OpenSceneGraph viewer for ANUGA .sww files.
+    Copyright (C) 2004, 2009 Geoscience Australia
+*/
+
+#ifndef TOTALSPANEL_H
+#define TOTALSPANEL_H
+
+#include <string>
+#include <OpenThreads/Atomic>
+
+#include <swwreader.h>
+#include <domaintotals.h>
+#include <workerpool.h>
+
+class HeadsUpDisplay;
+
+/**
+ * Graphs of the wet area, water volume and peak depth over the domain at each
+ * timestep, down the right of the HUD.
+ *
+ * The totals are computed the first time the graphs are shown, by a pass over the
+ * file on a low priority thread which gives way to the render loop's frame loads, so
+ * playback carries on as usual. The graphs fill in as the pass goes.
+ */
+class TotalsPanel
+{
+public:
+	TotalsPanel(SWWReader * aReader);
+	~TotalsPanel();
+
+	/**
+	 * Show or hide the graphs, starting the totals on first show.
+	 */
+	void toggle();
+
+	bool isEnabled() const	{	return _enabled;	}
+
+	/**
+	 * Pass the totals computed so far on to the HUD. Call once per frame.
+	 */
+	void update(HeadsUpDisplay * aHUD);
+
+protected:
+
+	class ComputeJob;
+
+protected:
+	SWWReader * _sww;
+	DomainTotals * _totals;	/**< Created on first use */
+	WorkerPool _pool;	/**< One low priority thread, runs the compute */
+	OpenThreads::Atomic _finished;	/**< The compute has returned */
+	bool _enabled;
+	bool _dirty;	/**< HUD needs the graphs again */
+	unsigned int _numShown;	/**< Timesteps passed to the HUD so far */
+	std::string _status;
+};
+
+#endif  // TOTALSPANEL_H
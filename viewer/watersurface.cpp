@@ -68,6 +68,26 @@ WaterSurface::~WaterSurface()
 }
 
 
+void WaterSurface::setColourLayer(osg::Vec4Array * aColours)
+{
+	if (aColours != _colourLayer.get())
+	{
+		_colourLayer = aColours;
+		dirtyData();
+	}
+}
+
+
+void WaterSurface::setColourQuantity(DerivedQuantity::Type aType)
+{
+	if (aType != _sww->getColourQuantity())
+	{
+		_sww->setColourQuantity(aType);
+		dirtyData();
+	}
+}
+
+
 void WaterSurface::onRefreshData()
 {
 	// delete if exists
@@ -87,6 +107,10 @@ void WaterSurface::onRefreshData()
 	osg::ref_ptr<osg::Vec3Array> vertices = _sww->getStageVertexArray();
 	osg::ref_ptr<osg::Vec3Array> vertexnormals = _sww->getStageVertexNormalArray();
 	osg::ref_ptr<osg::Vec4Array> colors = _sww->getStageColorArray();
+	if (_colourLayer.valid() && _colourLayer->size() == colors->size())
+	{
+		colors = _colourLayer;
+	}
 
 	// geometry
 	_geom->setVertexArray( vertices.get() );
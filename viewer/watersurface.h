@@ -27,13 +27,25 @@ class WaterSurface : public MeshObject
 public:
 
     WaterSurface(SWWReader *sww);
+    virtual ~WaterSurface();	// public, tile surfaces are dropped again
+
+	/**
+	 * Colour the surface with fixed per-vertex colours in place of those of each frame.
+	 * @param aColours one per vertex, NULL to go back to the frame's colours
+	 */
+	void setColourLayer(osg::Vec4Array * aColours);
+
+	/**
+	 * Choose the quantity the surface is coloured by. Does its own dirty test, so can
+	 * be called every frame.
+	 */
+	void setColourQuantity(DerivedQuantity::Type aType);
 
 protected:
 
-    virtual ~WaterSurface();
-	
 	void onRefreshData();
 
+	osg::ref_ptr<osg::Vec4Array> _colourLayer;	/**< Overrides the frame's colours if set */
 
 };
 